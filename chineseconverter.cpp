@@ -0,0 +1,221 @@
+#include "chineseconverter.h"
+#include "perftrace.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutex>
+#include <QStringList>
+#include <QTextStream>
+#include <algorithm>
+
+namespace {
+
+// 一一对应的简繁字对（简体在前），也按相反方向用于繁转简
+const char16_t kCharacterPairs[] =
+    u"万萬与與专專业業丛叢东東丝絲两兩严嚴丧喪个個丰豐临臨为為丽麗举舉么麼义義乐樂乔喬乡鄉书書买買乱亂"
+    u"争爭于於亏虧云雲亚亞产產亩畝亲親亿億仅僅从從仑侖仓倉仪儀们們价價众眾优優会會伞傘伟偉传傳伤傷伦倫"
+    u"体體佣傭侦偵侨僑债債倾傾儿兒党黨兰蘭关關兴興养養兽獸冈岡写寫军軍农農况況冻凍净淨准準减減几幾凤鳳"
+    u"凭憑凯凱击擊凿鑿刘劉则則刚剛创創删刪剑劍剧劇劝勸办辦务務动動励勵劳勞势勢区區医醫华華协協单單卖賣"
+    u"卢盧卧臥卫衛厂廠厅廳历歷厉厲压壓县縣参參双雙发發变變叶葉号號叹嘆后後吓嚇吗嗎吨噸听聽启啟员員响響"
+    u"唤喚喷噴嘱囑团團园園围圍国國图圖圆圓圣聖场場坏壞块塊坚堅坛壇坟墳垦墾堕墮墙牆壮壯声聲壳殼壶壺处處"
+    u"备備复復够夠头頭夹夾夺奪奋奮奖獎奥奧妆妝妇婦妈媽姗姍娇嬌娱娛婶嬸孙孫学學宁寧宝寶实實宠寵审審宪憲"
+    u"宫宮宽寬宾賓寝寢对對寻尋导導寿壽将將尔爾尘塵尝嘗尽盡层層届屆属屬岁歲岂豈岗崗岛島岭嶺峡峽巩鞏币幣"
+    u"帅帥师師帐帳帘簾带帶帮幫幂冪广廣庄莊庆慶库庫应應庙廟废廢开開异異弃棄张張弥彌弯彎弹彈强強归歸当當"
+    u"录錄彻徹径徑忆憶忧憂怀懷态態怂慫怜憐总總恋戀恳懇恶惡恼惱悦悅悬懸惊驚惧懼惨慘惩懲惫憊惯慣愤憤愿願"
+    u"戏戲战戰户戶扑撲执執扩擴扫掃扬揚扰擾抚撫抛拋抢搶护護报報担擔拟擬拢攏拣揀拥擁拦攔拧擰拨撥择擇挂掛"
+    u"挚摯挠撓挡擋挣掙挤擠挥揮捞撈损損捡撿换換捣搗据據掳擄掷擲掸撣掺摻揽攬搀攙搁擱搂摟搅攪携攜摄攝摆擺"
+    u"摇搖摊攤撑撐撵攆擞擻敌敵敛斂数數斋齋断斷无無旧舊时時旷曠昙曇昼晝显顯晋晉晒曬晓曉晕暈暂暫术術机機"
+    u"杀殺杂雜权權条條来來杨楊杰傑极極构構枣棗枪槍柜櫃标標栈棧栋棟栏欄树樹样樣桥橋桩樁梦夢检檢椭橢楼樓"
+    u"横橫欢歡欧歐歼殲残殘毁毀毕畢毙斃毡氈气氣汇匯汉漢汤湯沟溝没沒沪滬泪淚泼潑泽澤洁潔洒灑浅淺浊濁测測"
+    u"济濟浑渾浓濃涌湧涛濤润潤涨漲涩澀淀澱渊淵渐漸渗滲温溫湾灣湿濕滚滾滞滯满滿滤濾滩灘灭滅灯燈灵靈灶竈"
+    u"灾災灿燦炉爐点點炼煉烂爛烛燭烦煩烧燒烫燙热熱爱愛爷爺牵牽状狀犹猶独獨狭狹狮獅狱獄猎獵猪豬猫貓献獻"
+    u"玛瑪环環现現琐瑣琼瓊电電画畫畅暢疗療痒癢盏盞盐鹽监監盖蓋盗盜盘盤睁睜矫矯码碼砖磚础礎硕碩确確礼禮"
+    u"祸禍离離秃禿种種积積称稱税稅稳穩穷窮窃竊窍竅窝窩竞競笋筍笔筆筑築签簽简簡类類粪糞粮糧紧緊纠糾红紅"
+    u"纤纖约約级級纪紀纬緯纯純纱紗纲綱纳納纵縱纶綸纷紛纸紙线線练練组組细細织織终終绍紹经經绑綁结結绕繞"
+    u"绘繪给給络絡绝絕统統继繼绩績绪緒续續绳繩维維绵綿综綜绿綠编編缘緣缩縮网網罗羅罚罰罢罷职職联聯肃肅"
+    u"肾腎肿腫胀脹胁脅胆膽胜勝胶膠脑腦脚腳脸臉腾騰舰艦艳豔艺藝节節苏蘇苹蘋荐薦荣榮药藥获獲萝蘿营營萧蕭"
+    u"蓝藍虑慮虫蟲虽雖虾蝦蚁蟻蝇蠅补補袜襪袭襲装裝见見观觀规規觅覓视視觉覺触觸计計认認讨討让讓训訓议議"
+    u"讯訊记記讲講论論设設访訪证證评評识識诈詐诉訴词詞译譯试試诗詩诚誠话話该該详詳语語误誤说說诵誦请請"
+    u"诸諸诺諾读讀课課谁誰调調谅諒谈談谓謂谢謝谱譜贝貝负負贡貢责責贤賢账賬货貨质質贫貧购購贯貫贴貼贵貴"
+    u"贸貿费費贺賀贼賊资資赌賭赏賞赔賠赖賴赚賺赛賽赞贊赠贈赢贏赵趙赶趕趋趨跃躍践踐踪蹤车車轨軌转轉轮輪"
+    u"软軟轰轟轻輕载載轿轎较較辅輔辆輛辈輩辉輝输輸辞辭边邊辽遼达達迁遷过過运運还還这這进進远遠违違连連"
+    u"迟遲适適选選递遞逻邏遗遺邓鄧邮郵邹鄒邻鄰郑鄭酱醬酿釀释釋针針钓釣钞鈔钟鐘钢鋼钥鑰钩鉤钱錢钻鑽铁鐵"
+    u"铃鈴铅鉛铜銅银銀铺鋪链鏈销銷锁鎖锅鍋锐銳错錯锣鑼锦錦键鍵镇鎮镜鏡长長门門闪閃闭閉问問闯闖闲閒间間"
+    u"闷悶闸閘闹鬧闻聞阀閥阁閣阅閱阔闊队隊阳陽阴陰阵陣阶階际際陆陸陈陳险險随隨隐隱难難雏雛雾霧韩韓韵韻"
+    u"页頁顶頂项項顺順须須顽頑顾顧顿頓颂頌预預领領颇頗频頻颗顆题題颜顏额額风風飘飄飞飛饭飯饮飲饰飾饱飽"
+    u"饲飼饶饒饺餃饼餅饿餓馆館馒饅马馬驰馳驱驅驴驢驻駐驼駝驾駕骂罵骄驕骆駱验驗骑騎骗騙骡騾骤驟鬓鬢鱼魚"
+    u"鲁魯鲍鮑鲜鮮鸟鳥鸡雞鸣鳴鸦鴉鸭鴨鸽鴿鹅鵝鹏鵬鹰鷹麦麥黄黃齐齊齿齒龄齡龙龍龟龜";
+
+// 只用于繁转简的字对（繁体在前）：多个繁体字对应同一个简体字，或简体字单独无法确定繁体写法
+const char16_t kTraditionalOnlyPairs[] =
+    u"乾干佔占係系傢家儘尽劃划噁恶嚮向夥伙幹干彙汇捨舍捲卷摺折曆历檯台爲为甦苏瞭了祕秘穫获範范籲吁綫线"
+    u"繫系纔才臟脏臺台蒐搜衆众衝冲裏里裡里製制複复託托註注誌志迴回週周遊游醜丑錶表鍾钟隻只颱台飢饥餵喂"
+    u"髒脏髮发鬆松鬍胡鬚须鬥斗麵面";
+
+// 单字转换不能确定写法的常用词（简体、繁体，逗号分隔）
+const char16_t kPhrasePairs[] =
+    u"头发,頭髮,理发,理髮,白发,白髮,发型,髮型,长发,長髮,短发,短髮,"
+    u"干净,乾淨,干燥,乾燥,饼干,餅乾,干杯,乾杯,干脆,乾脆,干部,幹部,"
+    u"干活,幹活,干吗,幹嗎,干嘛,幹嘛,干什么,幹什麼,能干,能幹,皇后,皇后,"
+    u"王后,王后,太后,太后,面条,麵條,面包,麵包,面粉,麵粉,这里,這裡,"
+    u"那里,那裡,哪里,哪裡,心里,心裡,里面,裡面,家里,家裡,复杂,複雜,"
+    u"重复,重複,复制,複製,复印,複印,一只,一隻,两只,兩隻,茶几,茶几,"
+    u"关系,關係,联系,聯繫,制造,製造,制作,製作,放松,放鬆,轻松,輕鬆,"
+    u"胡子,鬍子,胡须,鬍鬚,游戏,遊戲,旅游,旅遊,台湾,臺灣,台风,颱風,"
+    u"日历,日曆,冲突,衝突,冲动,衝動,手表,手錶,收获,收穫,范围,範圍,"
+    u"规范,規範,模范,模範,丑陋,醜陋,斗争,鬥爭,战斗,戰鬥,奋斗,奮鬥,"
+    u"肮脏,骯髒,脏话,髒話,心脏,心臟,卷入,捲入,伙伴,夥伴,家伙,傢伙,"
+    u"杂志,雜誌,标志,標誌,注册,註冊,词汇,詞彙,计划,計劃,饥饿,飢餓,"
+    u"舍不得,捨不得,几乎,幾乎,几个,幾個,周末,週末,";
+
+// 各数组末尾的结束符不算在内
+template <int N>
+int lengthOf(const char16_t (&)[N]) {
+    return N - 1;
+}
+
+QString fromUtf16(const char16_t* text, int length) {
+    return QString(reinterpret_cast<const QChar*>(text), length);
+}
+
+}
+
+std::shared_ptr<const ChineseConverter> ChineseConverter::shared(Direction direction,
+                                                                 const QString& dictionaryDirectory,
+                                                                 QString& errorMsg) {
+    static QMutex mutex;
+    static QHash<QString, std::shared_ptr<const ChineseConverter>> cache;
+    
+    QString directory = dictionaryDirectory.isEmpty() ? QString() : QFileInfo(dictionaryDirectory).absoluteFilePath();
+    QString key = QString::number(direction) + '|' + directory;
+    QMutexLocker locker(&mutex);
+    auto it = cache.constFind(key);
+    if (it != cache.constEnd()) return it.value();
+    
+    PerfTrace::Scope scope("dictionary");
+    std::shared_ptr<ChineseConverter> converter(new ChineseConverter(direction));
+    converter->addBuiltinEntries();
+    if (!directory.isEmpty()) {
+        QStringList names = direction == SimplifiedToTraditional
+                            ? QStringList{"STCharacters.txt", "STPhrases.txt"}
+                            : QStringList{"TSCharacters.txt", "TSPhrases.txt"};
+        int loaded = 0;
+        for (const QString& name : names) {
+            QString path = QDir(directory).filePath(name);
+            if (!QFileInfo::exists(path)) continue;
+            if (!converter->loadDictionary(path, errorMsg)) return nullptr;
+            ++loaded;
+        }
+        if (loaded == 0) {
+            errorMsg = QString("词典目录中没有 %1：%2").arg(names.join("、"), directory);
+            return nullptr;
+        }
+    }
+    converter->compile();
+    scope.setCount(converter->entryCount());
+    cache.insert(key, converter);
+    return converter;
+}
+
+ChineseConverter::ChineseConverter(Direction direction)
+    : m_direction(direction)
+{
+}
+
+void ChineseConverter::addBuiltinEntries() {
+    const bool toTraditional = m_direction == SimplifiedToTraditional;
+    for (int i = 0; i + 1 < lengthOf(kCharacterPairs); i += 2) {
+        QString simplified = fromUtf16(kCharacterPairs + i, 1);
+        QString traditional = fromUtf16(kCharacterPairs + i + 1, 1);
+        if (toTraditional) {
+            m_entries.insert(simplified, traditional);
+        } else {
+            m_entries.insert(traditional, simplified);
+        }
+    }
+    if (!toTraditional) {
+        for (int i = 0; i + 1 < lengthOf(kTraditionalOnlyPairs); i += 2) {
+            m_entries.insert(fromUtf16(kTraditionalOnlyPairs + i, 1), fromUtf16(kTraditionalOnlyPairs + i + 1, 1));
+        }
+    }
+    
+    const QStringList phrases = fromUtf16(kPhrasePairs, lengthOf(kPhrasePairs)).split(',', Qt::SkipEmptyParts);
+    for (int i = 0; i + 1 < phrases.size(); i += 2) {
+        if (toTraditional) {
+            m_entries.insert(phrases[i], phrases[i + 1]);
+        } else {
+            m_entries.insert(phrases[i + 1], phrases[i]);
+        }
+    }
+}
+
+bool ChineseConverter::loadDictionary(const QString& filePath, QString& errorMsg) {
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        errorMsg = "无法打开词典: " + filePath;
+        return false;
+    }
+    
+    // 每行 "词条<Tab>写法1 写法2 ..."，取第一种写法
+    QTextStream in(&file);
+    int lineNumber = 0;
+    while (!in.atEnd()) {
+        QString line = in.readLine();
+        ++lineNumber;
+        if (line.trimmed().isEmpty() || line.startsWith('#')) continue;
+        
+        int tab = line.indexOf('\t');
+        QString key = tab > 0 ? line.left(tab) : QString();
+        QString value = tab > 0 ? line.mid(tab + 1).section(' ', 0, 0, QString::SectionSkipEmpty) : QString();
+        if (key.isEmpty() || value.isEmpty()) {
+            errorMsg = QString("词典 %1 第 %2 行格式无效").arg(QFileInfo(filePath).fileName()).arg(lineNumber);
+            return false;
+        }
+        m_entries.insert(key, value);
+    }
+    return true;
+}
+
+void ChineseConverter::compile() {
+    QVector<QString> keys;
+    keys.reserve(m_entries.size());
+    for (auto it = m_entries.constBegin(); it != m_entries.constEnd(); ++it) {
+        keys.append(it.key());
+    }
+    std::sort(keys.begin(), keys.end());
+    
+    QVector<int> indexes;
+    indexes.reserve(keys.size());
+    m_values.clear();
+    m_values.reserve(keys.size());
+    for (const QString& key : keys) {
+        indexes.append(m_values.size());
+        m_values.append(m_entries.value(key));
+    }
+    m_trie.build(keys, indexes);
+    m_entries.clear();
+}
+
+QString ChineseConverter::convert(const QString& text) const {
+    const QChar* data = text.constData();
+    const int length = text.size();
+    QString result;
+    result.reserve(length);
+    bool changed = false;
+    for (int i = 0; i < length; ) {
+        int value = 0;
+        int matched = m_trie.longestMatch(data + i, length - i, value);
+        if (matched > 0) {
+            const QString& replacement = m_values[value];
+            changed = changed || replacement.size() != matched
+                      || !std::equal(data + i, data + i + matched, replacement.constData());
+            result += replacement;
+            i += matched;
+        } else {
+            result += data[i];
+            ++i;
+        }
+    }
+    // 没有变化时返回原字符串，保留与文本池共享的存储
+    return changed ? result : text;
+}
@@ -0,0 +1,43 @@
+#ifndef CHINESECONVERTER_H
+#define CHINESECONVERTER_H
+
+#include <QHash>
+#include <QString>
+#include <QVector>
+#include <memory>
+#include "doublearraytrie.h"
+
+// 简繁转换：字和词条编译为一棵双数组字典树，从左到右按最长匹配替换，词条优先于单字
+// 内置常用的一一对应字和少量需要按词确定写法的词；完整转换可以加载 OpenCC 格式的词典目录
+// （STCharacters.txt、STPhrases.txt，繁转简为 TSCharacters.txt、TSPhrases.txt），其中的条目覆盖内置条目。
+// 编译好的转换器只读，可以在多个线程中同时使用。
+class ChineseConverter {
+public:
+    enum Direction {
+        SimplifiedToTraditional,
+        TraditionalToSimplified
+    };
+    
+    // 同一方向和词典目录的转换器只编译一次；词典目录为空时只用内置字词表。出错时返回空指针
+    static std::shared_ptr<const ChineseConverter> shared(Direction direction, const QString& dictionaryDirectory,
+                                                          QString& errorMsg);
+    
+    QString convert(const QString& text) const;
+    
+    Direction direction() const { return m_direction; }
+    int entryCount() const { return m_values.size(); }
+
+private:
+    explicit ChineseConverter(Direction direction);
+    
+    void addBuiltinEntries();
+    bool loadDictionary(const QString& filePath, QString& errorMsg);
+    void compile();
+    
+    Direction m_direction;
+    QHash<QString, QString> m_entries;      // 编译前收集的条目
+    DoubleArrayTrie m_trie;
+    QVector<QString> m_values;
+};
+
+#endif // CHINESECONVERTER_H
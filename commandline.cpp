@@ -0,0 +1,1181 @@
+#include "commandline.h"
+#include "libraryindex.h"
+#include "perftrace.h"
+#include "retimetransform.h"
+#include "subtitleconform.h"
+#include "subtitlediff.h"
+#include "subtitlemerge.h"
+#include "subtitlereflow.h"
+#include "subtitlesnap.h"
+#include "subtitlesplice.h"
+#include "syncfit.h"
+#include "subtitlestream.h"
+#include "subtitletexttransform.h"
+#include "textpool.h"
+#include <QCommandLineParser>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QSet>
+#include <QThreadPool>
+#include <QTextStream>
+#include <QtConcurrent/QtConcurrentMap>
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+
+namespace {
+
+// 退出码
+const int kExitOk = 0;
+const int kExitFailure = 1;
+const int kExitUsage = 2;
+
+struct Command {
+    const char* name;
+    const char* summary;
+    int (*handler)(const QStringList& arguments);
+};
+
+QTextStream& err() {
+    static QTextStream stream(stderr);
+    return stream;
+}
+
+// "-" 或空路径表示标准输入
+std::unique_ptr<QFile> openInput(const QString& path, QString& errorMsg) {
+    std::unique_ptr<QFile> file(new QFile());
+    bool ok = false;
+    if (path.isEmpty() || path == "-") {
+        ok = file->open(stdin, QIODevice::ReadOnly);
+    } else {
+        file->setFileName(path);
+        ok = file->open(QIODevice::ReadOnly);
+    }
+    if (!ok) {
+        errorMsg = "无法打开输入: " + (path.isEmpty() ? QString("-") : path);
+        return nullptr;
+    }
+    return file;
+}
+
+// "-" 或空路径表示标准输出（不缓冲，写入即流向下游）；写文件时先写临时文件，完成后再替换
+std::unique_ptr<QFileDevice> openOutput(const QString& path, QString& errorMsg) {
+    if (path.isEmpty() || path == "-") {
+        std::unique_ptr<QFile> file(new QFile());
+        if (!file->open(stdout, QIODevice::WriteOnly | QIODevice::Unbuffered)) {
+            errorMsg = "无法打开标准输出";
+            return nullptr;
+        }
+        return file;
+    }
+    
+    std::unique_ptr<QSaveFile> file(new QSaveFile(path));
+    if (!file->open(QIODevice::WriteOnly)) {
+        errorMsg = "无法写入文件: " + path;
+        return nullptr;
+    }
+    return file;
+}
+
+bool commitOutput(QFileDevice* device, QString& errorMsg) {
+    QSaveFile* saveFile = qobject_cast<QSaveFile*>(device);
+    if (saveFile && !saveFile->commit()) {
+        errorMsg = "无法写入文件: " + saveFile->fileName();
+        return false;
+    }
+    return true;
+}
+
+bool parseEncoding(const QString& name, SubtitleEncoding& encoding) {
+    QString lower = name.toLower();
+    if (lower.isEmpty() || lower == "utf8" || lower == "utf-8") {
+        encoding = SubtitleEncoding::Utf8;
+        return true;
+    }
+    if (lower == "gbk") {
+        encoding = SubtitleEncoding::Gbk;
+        return true;
+    }
+    if (lower == "gb18030") {
+        encoding = SubtitleEncoding::Gb18030;
+        return true;
+    }
+    if (lower == "utf16le" || lower == "utf-16le") {
+        encoding = SubtitleEncoding::Utf16Le;
+        return true;
+    }
+    return false;
+}
+
+void addOutputEncodingOption(QCommandLineParser& parser) {
+    parser.addOption(QCommandLineOption({"E", "output-encoding"},
+                                        "输出编码：utf8（默认）、gbk、gb18030 或 utf16le（带 BOM）", "name"));
+}
+
+// 读取 -e 和 -E 选项；出错时已输出错误信息
+bool readEncodings(const QCommandLineParser& parser, SubtitleEncoding& input, SubtitleEncoding& output) {
+    if (!parseEncoding(parser.value("encoding"), input)) {
+        err() << "不支持的编码: " << parser.value("encoding") << "\n";
+        return false;
+    }
+    if (!parseEncoding(parser.value("output-encoding"), output)) {
+        err() << "不支持的输出编码: " << parser.value("output-encoding") << "\n";
+        return false;
+    }
+    return true;
+}
+
+bool parseFitMode(const QString& name, SyncFitter::Mode& mode) {
+    static const char* const names[] = {"interpolate", "affine", "robust", "robust-piecewise"};
+    if (name.isEmpty()) {
+        mode = SyncFitter::Interpolate;
+        return true;
+    }
+    for (int i = 0; i < SyncFitter::ModeCount; ++i) {
+        if (name == QLatin1String(names[i])) {
+            mode = SyncFitter::Mode(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+void addIoOptions(QCommandLineParser& parser) {
+    parser.addOption(QCommandLineOption({"i", "input"}, "输入文件，默认或 - 为标准输入", "file"));
+    parser.addOption(QCommandLineOption({"o", "output"}, "输出文件，默认或 - 为标准输出", "file"));
+    parser.addOption(QCommandLineOption({"e", "encoding"}, "输入编码：utf8（默认）、gbk 或 gb18030", "name"));
+    addOutputEncodingOption(parser);
+}
+
+// 读取整数选项（未指定时保持 value 不变）；出错时已输出错误信息
+bool readIntOption(const QCommandLineParser& parser, const QString& name, int minimum, int& value) {
+    if (!parser.isSet(name)) return true;
+    bool ok = false;
+    int parsed = parser.value(name).toInt(&ok);
+    if (!ok || parsed < minimum) {
+        err() << "无效的 --" << name << ": " << parser.value(name) << "\n";
+        return false;
+    }
+    value = parsed;
+    return true;
+}
+
+bool readDoubleOption(const QCommandLineParser& parser, const QString& name, double& value) {
+    if (!parser.isSet(name)) return true;
+    bool ok = false;
+    double parsed = parser.value(name).toDouble(&ok);
+    if (!ok || parsed <= 0) {
+        err() << "无效的 --" << name << ": " << parser.value(name) << "\n";
+        return false;
+    }
+    value = parsed;
+    return true;
+}
+
+// 解析选项；出错时已输出错误信息
+bool parseArguments(QCommandLineParser& parser, const QStringList& arguments) {
+    parser.addHelpOption();
+    if (!parser.parse(arguments)) {
+        err() << parser.errorText() << "\n";
+        return false;
+    }
+    if (parser.isSet("help")) {
+        err() << parser.helpText();
+        return false;
+    }
+    return true;
+}
+
+void reportTiming() {
+    QString timing = PerfTrace::lastSummary();
+    if (!timing.isEmpty()) {
+        err() << timing << "\n";
+    }
+}
+
+// 把处理好的字幕写到 -o（默认标准输出），完成后输出 summary 和耗时；返回退出码
+int writeSubtitles(const QCommandLineParser& parser, const QVector<SubtitleItem>& items,
+                   SubtitleEncoding outputEncoding, const QString& summary) {
+    QString errorMsg;
+    std::unique_ptr<QFileDevice> output = openOutput(parser.value("output"), errorMsg);
+    if (!output) {
+        err() << errorMsg << "\n";
+        return kExitFailure;
+    }
+    SubtitleStreamWriter writer(output.get(), outputEncoding);
+    for (const SubtitleItem& item : items) {
+        if (!writer.write(item)) break;
+    }
+    writer.flush();
+    if (writer.hasError()) {
+        err() << writer.errorString() << "\n";
+        return kExitFailure;
+    }
+    if (!commitOutput(output.get(), errorMsg)) {
+        err() << errorMsg << "\n";
+        return kExitFailure;
+    }
+    err() << summary << "\n";
+    reportTiming();
+    return kExitOk;
+}
+
+// 批量处理的一个文件
+struct BatchJob {
+    QString inputPath;
+    QString outputPath;
+    QString name;           // 相对路径，用于输出信息
+    QString secondaryPath;  // 需要两个输入的命令（merge）的第二个输入
+};
+
+// 批量模式下各输入文件的输出路径：-o 目录下保留输入相对于它们公共上级目录的路径，
+// 不同目录下的同名文件不会互相覆盖；同一个文件给出两次时报错。出错时已输出错误信息，返回退出码
+int collectBatchJobs(const QCommandLineParser& parser, const QStringList& files, QVector<BatchJob>& jobs) {
+    QString outputDir = parser.value("output");
+    if (outputDir.isEmpty() || outputDir == "-" || parser.isSet("input")) {
+        err() << "批量模式用位置参数给出字幕文件，并用 -o 指定输出目录\n";
+        return kExitUsage;
+    }
+    
+    QDir root(QFileInfo(files.first()).absolutePath());
+    for (const QString& path : files) {
+        const QString dir = QFileInfo(path).absolutePath();
+        for (QString relative = root.relativeFilePath(dir);
+             relative == ".." || relative.startsWith("../"); relative = root.relativeFilePath(dir)) {
+            if (!root.cdUp()) break;
+        }
+    }
+    
+    QSet<QString> outputs;
+    for (const QString& path : files) {
+        QString name = root.relativeFilePath(QFileInfo(path).absoluteFilePath());
+        if (QDir::isAbsolutePath(name)) {
+            // 不在同一个根下（例如不同盘符），只能用文件名
+            name = QFileInfo(path).fileName();
+        }
+        QString outputPath = QDir::cleanPath(QDir(outputDir).absoluteFilePath(name));
+        if (outputs.contains(outputPath)) {
+            err() << "多个输入会写到同一个输出文件: " << outputPath << "\n";
+            return kExitUsage;
+        }
+        outputs.insert(outputPath);
+        jobs.append(BatchJob{path, outputPath, name});
+    }
+    return kExitOk;
+}
+
+// 在线程池中并行处理各文件，outcomes 与 jobs 顺序一致。process(job, outcome) 出错时设置 outcome.errorMsg。
+// 返回失败的文件数，失败原因已输出
+template <typename Outcome, typename Process>
+int runBatch(const QVector<BatchJob>& jobs, Process process, QVector<Outcome>& outcomes) {
+    auto processOne = [process](const BatchJob& job) {
+        Outcome outcome;
+        QString dir = QFileInfo(job.outputPath).absolutePath();
+        if (!QDir().mkpath(dir)) {
+            outcome.errorMsg = "无法创建目录: " + dir;
+            return outcome;
+        }
+        process(job, outcome);
+        return outcome;
+    };
+    {
+        PerfTrace::Scope scope("batch");
+        scope.setCount(jobs.size());
+        outcomes = QtConcurrent::blockingMapped<QVector<Outcome>>(jobs, processOne);
+    }
+    
+    int failed = 0;
+    for (int i = 0; i < jobs.size(); ++i) {
+        if (!outcomes[i].errorMsg.isEmpty()) {
+            err() << jobs[i].name << "：" << outcomes[i].errorMsg << "\n";
+            ++failed;
+        }
+    }
+    return failed;
+}
+
+const Command* commands();
+
+int runHelp(const QStringList& arguments) {
+    Q_UNUSED(arguments);
+    err() << "用法: SubtitleEditApp <命令> [选项]\n"
+          << "不带命令时启动图形界面。可用命令：\n";
+    for (const Command* command = commands(); command->name; ++command) {
+        err() << QString("  %1  %2\n").arg(QLatin1String(command->name), -10).arg(QString::fromUtf8(command->summary));
+    }
+    err() << "使用 SubtitleEditApp <命令> --help 查看各命令的选项\n";
+    return kExitOk;
+}
+
+int runRetime(const QStringList& arguments) {
+    QCommandLineParser parser;
+    parser.setApplicationDescription("逐条读取字幕并调整时间，内存占用与文件大小无关，可用于管道");
+    addIoOptions(parser);
+    parser.addOption(QCommandLineOption("shift", "平移（毫秒，可为负）", "ms"));
+    parser.addOption(QCommandLineOption("scale", "以 --anchor 为基准按比例缩放", "factor"));
+    parser.addOption(QCommandLineOption("anchor", "缩放基准时间 HH:MM:SS,mmm（默认 0）", "time"));
+    parser.addOption(QCommandLineOption("fps", "帧率转换，例如 23.976:25", "from:to"));
+    parser.addOption(QCommandLineOption("sync-points", "同步点文件，每行 \"源时间 目标时间\"", "file"));
+    parser.addOption(QCommandLineOption("fit", "同步点拟合方式：interpolate（默认，逐点插值）、affine（最小二乘）、"
+                                                "robust（稳健仿射）、robust-piecewise（剔除离群点并平滑后分段插值）", "mode"));
+    if (!parseArguments(parser, arguments)) return kExitUsage;
+    
+    SubtitleEncoding encoding = SubtitleEncoding::Utf8;
+    SubtitleEncoding outputEncoding = SubtitleEncoding::Utf8;
+    if (!readEncodings(parser, encoding, outputEncoding)) return kExitUsage;
+    
+    // 组合出时间映射
+    RetimeTransform transform;
+    QString errorMsg;
+    bool ok = true;
+    int shiftMs = parser.isSet("shift") ? parser.value("shift").toInt(&ok) : 0;
+    if (!ok) {
+        err() << "无效的平移量: " << parser.value("shift") << "\n";
+        return kExitUsage;
+    }
+    
+    double factor = 1.0;
+    if (parser.isSet("scale")) {
+        factor = parser.value("scale").toDouble(&ok);
+        if (!ok || factor <= 0) {
+            err() << "无效的缩放比例: " << parser.value("scale") << "\n";
+            return kExitUsage;
+        }
+    }
+    if (parser.isSet("fps")) {
+        QStringList rates = parser.value("fps").split(':');
+        bool fromOk = false;
+        bool toOk = false;
+        double from = rates.size() == 2 ? rates[0].toDouble(&fromOk) : 0;
+        double to = rates.size() == 2 ? rates[1].toDouble(&toOk) : 0;
+        if (!fromOk || !toOk || from <= 0 || to <= 0) {
+            err() << "无效的帧率: " << parser.value("fps") << "\n";
+            return kExitUsage;
+        }
+        // 按源帧率计时的字幕在目标帧率下播放，时间按 from/to 缩放
+        factor *= from / to;
+    }
+    
+    QTime anchor(0, 0);
+    if (parser.isSet("anchor")) {
+        anchor = SRTParser::parseTime(parser.value("anchor"), ok);
+        if (!ok) {
+            err() << "无效的基准时间: " << parser.value("anchor") << "\n";
+            return kExitUsage;
+        }
+    }
+    
+    if (parser.isSet("sync-points")) {
+        if (factor != 1.0 || shiftMs != 0) {
+            err() << "--sync-points 不能与 --shift/--scale/--fps 同时使用\n";
+            return kExitUsage;
+        }
+        QVector<QPair<int, int>> points;
+        if (!RetimeTransform::readSyncPoints(parser.value("sync-points"), points, errorMsg)) {
+            err() << errorMsg << "\n";
+            return kExitFailure;
+        }
+        
+        SyncFitter::Mode mode = SyncFitter::Interpolate;
+        if (!parseFitMode(parser.value("fit"), mode)) {
+            err() << "不支持的拟合方式: " << parser.value("fit") << "\n";
+            return kExitUsage;
+        }
+        SyncFitter::Result fit = SyncFitter::fit(points, mode);
+        if (!fit.ok) {
+            err() << QString("该拟合方式至少需要 %1 个同步点\n").arg(SyncFitter::minimumPoints(mode));
+            return kExitFailure;
+        }
+        if (mode != SyncFitter::Interpolate) {
+            err() << QString("拟合：%1，残差均方根 %2 ms，离群点 %3 个\n")
+                     .arg(SyncFitter::modeName(mode)).arg(fit.rmsMs, 0, 'f', 0).arg(fit.outlierCount);
+            for (int i = 0; i < points.size(); ++i) {
+                if (!fit.outliers[i]) continue;
+                err() << QString("  离群：%1 -> %2（残差 %3 ms）\n")
+                         .arg(SRTParser::formatTime(QTime::fromMSecsSinceStartOfDay(points[i].first)),
+                              SRTParser::formatTime(QTime::fromMSecsSinceStartOfDay(points[i].second)))
+                         .arg(qRound(fit.residuals[i]));
+            }
+        }
+        transform = fit.transform;
+    } else {
+        transform = RetimeTransform::scale(factor, anchor, shiftMs);
+    }
+    
+    std::unique_ptr<QFile> input = openInput(parser.value("input"), errorMsg);
+    if (!input) {
+        err() << errorMsg << "\n";
+        return kExitFailure;
+    }
+    std::unique_ptr<QFileDevice> output = openOutput(parser.value("output"), errorMsg);
+    if (!output) {
+        err() << errorMsg << "\n";
+        return kExitFailure;
+    }
+    
+    // 读一条、映射一条、写一条
+    {
+        PerfTrace::Scope scope("stream");
+        SubtitleStreamReader reader(input.get(), encoding);
+        SubtitleStreamWriter writer(output.get(), outputEncoding);
+        SubtitleItem item;
+        while (reader.readNext(item)) {
+            transform.apply(item);
+            if (!writer.write(item)) break;
+        }
+        writer.flush();
+        scope.setCount(writer.cuesWritten());
+        
+        if (reader.hasError() || writer.hasError()) {
+            err() << (reader.hasError() ? reader.errorString() : writer.errorString()) << "\n";
+            return kExitFailure;
+        }
+        if (reader.cuesRead() == 0) {
+            err() << "未找到有效的字幕条目\n";
+            return kExitFailure;
+        }
+        err() << QString("已处理 %1 条字幕（%2）\n").arg(reader.cuesRead()).arg(transform.description());
+    }
+    
+    if (!commitOutput(output.get(), errorMsg)) {
+        err() << errorMsg << "\n";
+        return kExitFailure;
+    }
+    reportTiming();
+    return kExitOk;
+}
+
+int runDiff(const QStringList& arguments) {
+    QCommandLineParser parser;
+    parser.setApplicationDescription("比较两个版本的字幕，输出 JSON 格式的比较报告");
+    parser.addPositionalArgument("old", "旧版本字幕文件");
+    parser.addPositionalArgument("new", "新版本字幕文件");
+    parser.addOption(QCommandLineOption({"o", "output"}, "报告文件，默认或 - 为标准输出", "file"));
+    parser.addOption(QCommandLineOption({"e", "encoding"}, "输入编码：utf8（默认）、gbk、gb18030 或 utf16le", "name"));
+    parser.addOption(QCommandLineOption("all", "报告中同时列出未变化的条目"));
+    if (!parseArguments(parser, arguments)) return kExitUsage;
+    
+    const QStringList files = parser.positionalArguments();
+    if (files.size() != 2) {
+        err() << "需要指定旧版本和新版本两个文件\n";
+        return kExitUsage;
+    }
+    SubtitleEncoding encoding = SubtitleEncoding::Utf8;
+    if (!parseEncoding(parser.value("encoding"), encoding)) {
+        err() << "不支持的编码: " << parser.value("encoding") << "\n";
+        return kExitUsage;
+    }
+    
+    // 两个文件共用一个驻留池，相同文本在比较时只需比较指针
+    TextPool pool;
+    QVector<SubtitleItem> oldItems;
+    QVector<SubtitleItem> newItems;
+    QString errorMsg;
+    if (!SRTParser::parse(files[0], oldItems, errorMsg, encoding, &pool)
+        || !SRTParser::parse(files[1], newItems, errorMsg, encoding, &pool)) {
+        err() << errorMsg << "\n";
+        return kExitFailure;
+    }
+    
+    SubtitleDiff diff;
+    diff.compare(oldItems, newItems);
+    QByteArray report = diff.toJson(oldItems, newItems, files[0], files[1], parser.isSet("all"));
+    
+    std::unique_ptr<QFileDevice> output = openOutput(parser.value("output"), errorMsg);
+    if (!output) {
+        err() << errorMsg << "\n";
+        return kExitFailure;
+    }
+    if (output->write(report) != report.size()) {
+        err() << "无法写入报告\n";
+        return kExitFailure;
+    }
+    if (!commitOutput(output.get(), errorMsg)) {
+        err() << errorMsg << "\n";
+        return kExitFailure;
+    }
+    
+    if (diff.isIdentical()) {
+        err() << QString("两个版本相同（%1 条字幕）\n").arg(oldItems.size());
+    } else {
+        err() << QString("旧版本 %1 条，新版本 %2 条：%3\n").arg(oldItems.size()).arg(newItems.size()).arg(diff.summary());
+    }
+    reportTiming();
+    return kExitOk;
+}
+
+int runJoin(const QStringList& arguments) {
+    QCommandLineParser parser;
+    parser.setApplicationDescription("按顺序合并分段字幕（如 CD1/CD2），各部分按开始时间平移后连续编号");
+    parser.addPositionalArgument("parts", "各部分字幕文件，按顺序", "part1.srt part2.srt...");
+    parser.addOption(QCommandLineOption({"o", "output"}, "输出文件，默认或 - 为标准输出", "file"));
+    parser.addOption(QCommandLineOption({"e", "encoding"}, "输入编码：utf8（默认）、gbk 或 gb18030", "name"));
+    addOutputEncodingOption(parser);
+    parser.addOption(QCommandLineOption("start", "第 2、3… 部分在完整影片中的开始时间，HH:MM:SS,mmm 或毫秒；"
+                                                  "按部分顺序重复指定", "time"));
+    if (!parseArguments(parser, arguments)) return kExitUsage;
+    
+    const QStringList files = parser.positionalArguments();
+    if (files.size() < 2) {
+        err() << "至少需要两个部分\n";
+        return kExitUsage;
+    }
+    SubtitleEncoding encoding = SubtitleEncoding::Utf8;
+    SubtitleEncoding outputEncoding = SubtitleEncoding::Utf8;
+    if (!readEncodings(parser, encoding, outputEncoding)) return kExitUsage;
+    
+    // 可以只给出第 2 部分起的开始时间，也可以连第 1 部分一起给出
+    QStringList starts = parser.values("start");
+    if (starts.size() == files.size() - 1) {
+        starts.prepend("0");
+    }
+    if (starts.size() != files.size()) {
+        err() << QString("需要为第 2 到第 %1 部分各指定一个 --start\n").arg(files.size());
+        return kExitUsage;
+    }
+    
+    QVector<SubtitleSplice::Part> parts;
+    for (int i = 0; i < files.size(); ++i) {
+        int startMs = 0;
+        if (!RetimeTransform::parseTimeValue(starts[i], startMs)) {
+            err() << "无效的开始时间: " << starts[i] << "\n";
+            return kExitUsage;
+        }
+        parts.append(SubtitleSplice::Part(files[i], startMs));
+    }
+    
+    QString errorMsg;
+    std::unique_ptr<QFileDevice> output = openOutput(parser.value("output"), errorMsg);
+    if (!output) {
+        err() << errorMsg << "\n";
+        return kExitFailure;
+    }
+    qint64 written = SubtitleSplice::join(parts, encoding, outputEncoding, output.get(), errorMsg);
+    if (written < 0 || !commitOutput(output.get(), errorMsg)) {
+        err() << errorMsg << "\n";
+        return kExitFailure;
+    }
+    err() << QString("已合并 %1 个部分，共 %2 条字幕\n").arg(parts.size()).arg(written);
+    reportTiming();
+    return kExitOk;
+}
+
+int runSplit(const QStringList& arguments) {
+    QCommandLineParser parser;
+    parser.setApplicationDescription("在指定时间处把字幕分成多段，依次写出 <输出>_part1.srt、<输出>_part2.srt ...");
+    parser.addOption(QCommandLineOption({"i", "input"}, "输入文件，默认或 - 为标准输入", "file"));
+    parser.addOption(QCommandLineOption({"o", "output"}, "输出文件名前缀，默认取输入文件名", "file"));
+    parser.addOption(QCommandLineOption({"e", "encoding"}, "输入编码：utf8（默认）、gbk 或 gb18030", "name"));
+    addOutputEncodingOption(parser);
+    parser.addOption(QCommandLineOption("at", "分割点，逗号分隔，HH:MM:SS,mmm 或毫秒", "times"));
+    parser.addOption(QCommandLineOption("keep-times", "保留原时间，默认每段从分割点起算"));
+    if (!parseArguments(parser, arguments)) return kExitUsage;
+    
+    SubtitleEncoding encoding = SubtitleEncoding::Utf8;
+    SubtitleEncoding outputEncoding = SubtitleEncoding::Utf8;
+    if (!readEncodings(parser, encoding, outputEncoding)) return kExitUsage;
+    QVector<int> cutPoints;
+    QString errorMsg;
+    if (!SubtitleSplice::parseCutPoints(parser.value("at"), cutPoints, errorMsg)) {
+        err() << errorMsg << "\n";
+        return kExitUsage;
+    }
+    
+    QString input = parser.value("input");
+    QString base = parser.value("output");
+    if (base.isEmpty() || base == "-") {
+        if (input.isEmpty() || input == "-") {
+            err() << "从标准输入读取时需要用 -o 指定输出文件名前缀\n";
+            return kExitUsage;
+        }
+        base = input;
+    }
+    QStringList outputPaths = SubtitleSplice::partPaths(base, cutPoints.size() + 1);
+    
+    std::unique_ptr<QFile> file = openInput(input, errorMsg);
+    if (!file) {
+        err() << errorMsg << "\n";
+        return kExitFailure;
+    }
+    QVector<qint64> counts;
+    if (!SubtitleSplice::split(file.get(), encoding, outputEncoding, cutPoints, outputPaths, !parser.isSet("keep-times"),
+                               counts, errorMsg)) {
+        err() << errorMsg << "\n";
+        return kExitFailure;
+    }
+    for (int i = 0; i < outputPaths.size(); ++i) {
+        err() << QString("%1：%2 条字幕\n").arg(outputPaths[i]).arg(counts[i]);
+    }
+    reportTiming();
+    return kExitOk;
+}
+
+struct MergeOutcome {
+    QString errorMsg;
+    SubtitleMerge::Stats stats;
+};
+
+// 在主字幕目录中递归查找以 primarySuffix 结尾的文件，按相对路径和文件名主干配对副字幕，
+// 输出保持相同的目录结构；副字幕路径放在 BatchJob::secondaryPath
+QVector<BatchJob> collectMergeJobs(const QString& primaryDir, const QString& secondaryDir, const QString& outputDir,
+                                   const QString& primarySuffix, const QString& secondarySuffix,
+                                   const QString& outputSuffix, QStringList& missing) {
+    QVector<BatchJob> jobs;
+    QDir primaryRoot(primaryDir);
+    QDirIterator it(primaryDir, QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        QString path = it.next();
+        QString relative = primaryRoot.relativeFilePath(path);
+        if (!relative.endsWith(primarySuffix, Qt::CaseInsensitive)) continue;
+        
+        QString stem = relative.left(relative.size() - primarySuffix.size());
+        QString secondaryPath = QDir(secondaryDir).filePath(stem + secondarySuffix);
+        if (QFileInfo(secondaryPath) == QFileInfo(path)) continue;
+        if (!QFileInfo::exists(secondaryPath)) {
+            missing << relative;
+            continue;
+        }
+        jobs.append(BatchJob{path, QDir(outputDir).filePath(stem + outputSuffix), relative, secondaryPath});
+    }
+    std::sort(jobs.begin(), jobs.end(), [](const BatchJob& a, const BatchJob& b) {
+        return a.inputPath < b.inputPath;
+    });
+    return jobs;
+}
+
+int runMerge(const QStringList& arguments) {
+    QCommandLineParser parser;
+    parser.setApplicationDescription("按时间重叠合并主、副两种语言的字幕，生成双语字幕；"
+                                     "--batch 时两个参数为目录，递归配对同名文件批量合并");
+    parser.addPositionalArgument("primary", "主字幕文件（显示在上方）或目录");
+    parser.addPositionalArgument("secondary", "副字幕文件或目录");
+    parser.addOption(QCommandLineOption({"o", "output"}, "输出文件，默认或 - 为标准输出；--batch 时为输出目录", "path"));
+    parser.addOption(QCommandLineOption({"e", "encoding"}, "输入编码：utf8（默认）、gbk、gb18030 或 utf16le", "name"));
+    addOutputEncodingOption(parser);
+    parser.addOption(QCommandLineOption("mode", "stack（默认，保留主字幕时间，副字幕并入重叠最多的主字幕）"
+                                                "或 split（在每个边界处切开）", "mode"));
+    parser.addOption(QCommandLineOption("min-overlap", "重叠少于此值视为不重叠，默认 100；为 0 时首尾相接仍不算重叠", "ms"));
+    parser.addOption(QCommandLineOption("min-segment", "split 模式下短于此值的片段并入相邻片段，默认 300", "ms"));
+    parser.addOption(QCommandLineOption("drop-unmatched", "丢弃没有对应主字幕的副字幕"));
+    parser.addOption(QCommandLineOption("secondary-first", "副语言放在上面"));
+    parser.addOption(QCommandLineOption("batch", "批量模式：primary、secondary 和 -o 都是目录"));
+    parser.addOption(QCommandLineOption("primary-suffix", "批量模式下主字幕的文件名后缀，默认 .srt", "suffix"));
+    parser.addOption(QCommandLineOption("secondary-suffix", "批量模式下副字幕的文件名后缀，默认 .srt", "suffix"));
+    parser.addOption(QCommandLineOption("output-suffix", "批量模式下输出的文件名后缀，默认 .srt", "suffix"));
+    if (!parseArguments(parser, arguments)) return kExitUsage;
+    
+    const QStringList files = parser.positionalArguments();
+    if (files.size() != 2) {
+        err() << "需要指定主字幕和副字幕\n";
+        return kExitUsage;
+    }
+    SubtitleEncoding encoding = SubtitleEncoding::Utf8;
+    SubtitleEncoding outputEncoding = SubtitleEncoding::Utf8;
+    if (!readEncodings(parser, encoding, outputEncoding)) return kExitUsage;
+    
+    SubtitleMerge::Options options;
+    if (!SubtitleMerge::parseMode(parser.value("mode"), options.mode)) {
+        err() << "不支持的合并方式: " << parser.value("mode") << "\n";
+        return kExitUsage;
+    }
+    if (!readIntOption(parser, "min-overlap", 0, options.minOverlapMs)
+        || !readIntOption(parser, "min-segment", 0, options.minSegmentMs)) {
+        return kExitUsage;
+    }
+    options.keepUnmatched = !parser.isSet("drop-unmatched");
+    options.secondaryFirst = parser.isSet("secondary-first");
+    
+    QString errorMsg;
+    if (!parser.isSet("batch")) {
+        TextPool pool;
+        QVector<SubtitleItem> primary;
+        QVector<SubtitleItem> secondary;
+        if (!SRTParser::parse(files[0], primary, errorMsg, encoding, &pool)
+            || !SRTParser::parse(files[1], secondary, errorMsg, encoding, &pool)) {
+            err() << errorMsg << "\n";
+            return kExitFailure;
+        }
+        
+        SubtitleMerge::Stats stats;
+        QVector<SubtitleItem> merged = SubtitleMerge::merge(primary, secondary, options, &stats);
+        return writeSubtitles(parser, merged, outputEncoding, stats.summary());
+    }
+    
+    QString outputDir = parser.value("output");
+    if (outputDir.isEmpty() || outputDir == "-") {
+        err() << "批量模式需要用 -o 指定输出目录\n";
+        return kExitUsage;
+    }
+    if (!QFileInfo(files[0]).isDir() || !QFileInfo(files[1]).isDir()) {
+        err() << "批量模式下主字幕和副字幕都应为目录\n";
+        return kExitUsage;
+    }
+    QString primarySuffix = parser.isSet("primary-suffix") ? parser.value("primary-suffix") : QString(".srt");
+    QString secondarySuffix = parser.isSet("secondary-suffix") ? parser.value("secondary-suffix") : QString(".srt");
+    QString outputSuffix = parser.isSet("output-suffix") ? parser.value("output-suffix") : QString(".srt");
+    
+    QStringList missing;
+    QVector<BatchJob> jobs = collectMergeJobs(files[0], files[1], outputDir, primarySuffix, secondarySuffix,
+                                              outputSuffix, missing);
+    for (const QString& name : missing) {
+        err() << "跳过（没有对应的副字幕）：" << name << "\n";
+    }
+    if (jobs.isEmpty()) {
+        err() << "没有找到可以配对的字幕文件\n";
+        return kExitFailure;
+    }
+    
+    // 各对文件互不相关，在线程池中并行合并
+    auto mergeOne = [encoding, outputEncoding, options](const BatchJob& job, MergeOutcome& outcome) {
+        outcome.errorMsg = SubtitleMerge::mergeFiles(job.inputPath, job.secondaryPath, job.outputPath,
+                                                     encoding, outputEncoding, options, &outcome.stats);
+    };
+    QVector<MergeOutcome> outcomes;
+    int failed = runBatch(jobs, mergeOne, outcomes);
+    
+    SubtitleMerge::Stats total;
+    for (const MergeOutcome& outcome : outcomes) {
+        if (!outcome.errorMsg.isEmpty()) continue;
+        total.primaryCues += outcome.stats.primaryCues;
+        total.secondaryCues += outcome.stats.secondaryCues;
+        total.matched += outcome.stats.matched;
+        total.unmatched += outcome.stats.unmatched;
+        total.outputCues += outcome.stats.outputCues;
+    }
+    err() << QString("已合并 %1 对文件，失败 %2 对，跳过 %3 个；%4\n")
+             .arg(jobs.size() - failed).arg(failed).arg(missing.size()).arg(total.summary());
+    reportTiming();
+    return failed == 0 ? kExitOk : kExitFailure;
+}
+
+int runReflow(const QStringList& arguments) {
+    QCommandLineParser parser;
+    parser.setApplicationDescription("按每行字数、行数和阅读速度整理字幕：重新断行、拆分过长的字幕、合并过短的字幕；"
+                                     "--dry-run 只输出修改报告");
+    addIoOptions(parser);
+    SubtitleReflow::Rules rules;
+    parser.addOption(QCommandLineOption("max-chars", QString("每行最多字数，默认 %1").arg(rules.maxCharsPerLine), "n"));
+    parser.addOption(QCommandLineOption("max-cjk-chars", QString("以中文为主时每行最多字数，默认 %1")
+                                        .arg(rules.maxCjkCharsPerLine), "n"));
+    parser.addOption(QCommandLineOption("max-lines", QString("每条最多行数，默认 %1").arg(rules.maxLines), "n"));
+    parser.addOption(QCommandLineOption("max-cps", QString("每秒最多字数，默认 %1").arg(rules.maxCps), "n"));
+    parser.addOption(QCommandLineOption("max-cjk-cps", QString("以中文为主时每秒最多字数，默认 %1").arg(rules.maxCjkCps), "n"));
+    parser.addOption(QCommandLineOption("min-duration", QString("短于此值的字幕尝试合并，默认 %1").arg(rules.minDurationMs), "ms"));
+    parser.addOption(QCommandLineOption("max-duration", QString("长于此值的多行字幕拆分，默认 %1").arg(rules.maxDurationMs), "ms"));
+    parser.addOption(QCommandLineOption("min-gap", QString("拆分和延长时保留的间隔，默认 %1").arg(rules.minGapMs), "ms"));
+    parser.addOption(QCommandLineOption("max-merge-gap", QString("间隔超过此值不合并，默认 %1").arg(rules.maxMergeGapMs), "ms"));
+    parser.addOption(QCommandLineOption("dry-run", "不输出字幕，只把修改报告写到 -o（默认标准输出）"));
+    if (!parseArguments(parser, arguments)) return kExitUsage;
+    
+    SubtitleEncoding encoding = SubtitleEncoding::Utf8;
+    SubtitleEncoding outputEncoding = SubtitleEncoding::Utf8;
+    if (!readEncodings(parser, encoding, outputEncoding)) return kExitUsage;
+    if (!readIntOption(parser, "max-chars", 1, rules.maxCharsPerLine)
+        || !readIntOption(parser, "max-cjk-chars", 1, rules.maxCjkCharsPerLine)
+        || !readIntOption(parser, "max-lines", 1, rules.maxLines)
+        || !readDoubleOption(parser, "max-cps", rules.maxCps)
+        || !readDoubleOption(parser, "max-cjk-cps", rules.maxCjkCps)
+        || !readIntOption(parser, "min-duration", 0, rules.minDurationMs)
+        || !readIntOption(parser, "max-duration", 0, rules.maxDurationMs)
+        || !readIntOption(parser, "min-gap", 0, rules.minGapMs)
+        || !readIntOption(parser, "max-merge-gap", 0, rules.maxMergeGapMs)) {
+        return kExitUsage;
+    }
+    
+    QString errorMsg;
+    std::unique_ptr<QFile> input = openInput(parser.value("input"), errorMsg);
+    if (!input) {
+        err() << errorMsg << "\n";
+        return kExitFailure;
+    }
+    TextPool pool;
+    QVector<SubtitleItem> subtitles;
+    if (!SRTParser::parseData(input->readAll(), subtitles, errorMsg, encoding, &pool)) {
+        err() << errorMsg << "\n";
+        return kExitFailure;
+    }
+    
+    SubtitleReflow::Result result;
+    QVector<SubtitleItem> reflowed = SubtitleReflow::apply(subtitles, rules, result, QThreadPool::globalInstance());
+    if (!parser.isSet("dry-run")) {
+        return writeSubtitles(parser, reflowed, outputEncoding, result.summary());
+    }
+    
+    std::unique_ptr<QFileDevice> output = openOutput(parser.value("output"), errorMsg);
+    if (!output) {
+        err() << errorMsg << "\n";
+        return kExitFailure;
+    }
+    QByteArray report = result.report().toUtf8() + '\n';
+    if (output->write(report) != report.size()) {
+        err() << "无法写入报告\n";
+        return kExitFailure;
+    }
+    if (!commitOutput(output.get(), errorMsg)) {
+        err() << errorMsg << "\n";
+        return kExitFailure;
+    }
+    err() << result.summary() << "\n";
+    reportTiming();
+    return kExitOk;
+}
+
+struct ConformOutcome {
+    QString errorMsg;
+    SubtitleConform::Stats stats;
+};
+
+int runConform(const QStringList& arguments) {
+    QCommandLineParser parser;
+    parser.setApplicationDescription("按剪辑表把字幕从旧版本对位到新版本：随片段移动，跨越剪辑点的裁剪或丢弃，"
+                                     "删除部分的字幕丢弃；给出多个文件时用同一剪辑表批量处理，-o 为输出目录，"
+                                     "保留各文件相对于公共上级目录的路径");
+    parser.addPositionalArgument("files", "批量模式下的字幕文件（例如同一节目的各语言字幕）", "[files...]");
+    addIoOptions(parser);
+    SubtitleConform::Options options;
+    parser.addOption(QCommandLineOption("edl", "剪辑表：每行“旧入点 旧出点 新入点”的 CSV/文本，或 CMX3600 EDL", "file"));
+    parser.addOption(QCommandLineOption("fps", "HH:MM:SS:FF 时间码的帧率，默认 25", "rate"));
+    parser.addOption(QCommandLineOption("origin", "剪辑表时间的起点，例如 01:00:00:00，默认 0", "time"));
+    parser.addOption(QCommandLineOption("drop-crossing", "丢弃跨越剪辑点的字幕，默认裁剪到片段内最长的部分"));
+    parser.addOption(QCommandLineOption("min-duration", QString("裁剪后短于此值的字幕丢弃，默认 %1")
+                                        .arg(options.minDurationMs), "ms"));
+    if (!parseArguments(parser, arguments)) return kExitUsage;
+    
+    SubtitleEncoding encoding = SubtitleEncoding::Utf8;
+    SubtitleEncoding outputEncoding = SubtitleEncoding::Utf8;
+    if (!readEncodings(parser, encoding, outputEncoding)) return kExitUsage;
+    double fps = 25.0;
+    int originMs = 0;
+    if (!readDoubleOption(parser, "fps", fps)
+        || !readIntOption(parser, "min-duration", 0, options.minDurationMs)) {
+        return kExitUsage;
+    }
+    if (parser.isSet("origin") && !SubtitleConform::parseTimecode(parser.value("origin"), fps, originMs)) {
+        err() << "无效的 --origin: " << parser.value("origin") << "\n";
+        return kExitUsage;
+    }
+    options.crossing = parser.isSet("drop-crossing") ? SubtitleConform::Drop : SubtitleConform::Trim;
+    if (!parser.isSet("edl")) {
+        err() << "需要用 --edl 指定剪辑表\n";
+        return kExitUsage;
+    }
+    
+    QString errorMsg;
+    QVector<SubtitleConform::Segment> segments;
+    if (!SubtitleConform::readEdl(parser.value("edl"), fps, originMs, segments, errorMsg)) {
+        err() << errorMsg << "\n";
+        return kExitFailure;
+    }
+    
+    const QStringList files = parser.positionalArguments();
+    if (files.isEmpty()) {
+        std::unique_ptr<QFile> input = openInput(parser.value("input"), errorMsg);
+        if (!input) {
+            err() << errorMsg << "\n";
+            return kExitFailure;
+        }
+        TextPool pool;
+        QVector<SubtitleItem> subtitles;
+        if (!SRTParser::parseData(input->readAll(), subtitles, errorMsg, encoding, &pool)) {
+            err() << errorMsg << "\n";
+            return kExitFailure;
+        }
+        
+        SubtitleConform::Stats stats;
+        QVector<SubtitleItem> conformed = SubtitleConform::conform(subtitles, segments, options, &stats);
+        return writeSubtitles(parser, conformed, outputEncoding, stats.summary());
+    }
+    
+    QVector<BatchJob> jobs;
+    int status = collectBatchJobs(parser, files, jobs);
+    if (status != kExitOk) return status;
+    
+    // 剪辑表只解析一次，各文件在线程池中并行对位
+    auto conformOne = [&segments, encoding, outputEncoding, options](const BatchJob& job, ConformOutcome& outcome) {
+        outcome.errorMsg = SubtitleConform::conformFile(job.inputPath, job.outputPath, segments, encoding,
+                                                        outputEncoding, options, &outcome.stats);
+    };
+    QVector<ConformOutcome> outcomes;
+    int failed = runBatch(jobs, conformOne, outcomes);
+    
+    SubtitleConform::Stats total;
+    for (const ConformOutcome& outcome : outcomes) {
+        if (!outcome.errorMsg.isEmpty()) continue;
+        total.kept += outcome.stats.kept;
+        total.trimmed += outcome.stats.trimmed;
+        total.dropped += outcome.stats.dropped;
+        total.removed += outcome.stats.removed;
+    }
+    err() << QString("已对位 %1 个文件，失败 %2 个；%3\n").arg(files.size() - failed).arg(failed).arg(total.summary());
+    reportTiming();
+    return failed == 0 ? kExitOk : kExitFailure;
+}
+
+int runSnap(const QStringList& arguments) {
+    QCommandLineParser parser;
+    parser.setApplicationDescription("把字幕的开始和结束时间吸附到镜头切换点，同时保持与相邻字幕的最小间隔");
+    addIoOptions(parser);
+    SubtitleSnap::Options options;
+    parser.addOption(QCommandLineOption("keyframes", "切换点文件：每行一个时间或帧号，也接受 Aegisub 关键帧文件", "file"));
+    parser.addOption(QCommandLineOption("fps", "帧号和 HH:MM:SS:FF 时间码的帧率，默认 25", "rate"));
+    parser.addOption(QCommandLineOption("frames", "切换点文件中的整数为帧号而不是毫秒"));
+    parser.addOption(QCommandLineOption("threshold", QString("与切换点相距不超过此值才吸附，默认 %1")
+                                        .arg(options.thresholdMs), "ms"));
+    parser.addOption(QCommandLineOption("min-gap", QString("与相邻字幕保留的最小间隔，默认 %1").arg(options.minGapMs), "ms"));
+    parser.addOption(QCommandLineOption("min-duration", QString("吸附后的最短时长，默认 %1").arg(options.minDurationMs), "ms"));
+    parser.addOption(QCommandLineOption("starts-only", "只吸附开始时间"));
+    parser.addOption(QCommandLineOption("ends-only", "只吸附结束时间"));
+    if (!parseArguments(parser, arguments)) return kExitUsage;
+    
+    SubtitleEncoding encoding = SubtitleEncoding::Utf8;
+    SubtitleEncoding outputEncoding = SubtitleEncoding::Utf8;
+    if (!readEncodings(parser, encoding, outputEncoding)) return kExitUsage;
+    double fps = 25.0;
+    if (!readDoubleOption(parser, "fps", fps)
+        || !readIntOption(parser, "threshold", 0, options.thresholdMs)
+        || !readIntOption(parser, "min-gap", 0, options.minGapMs)
+        || !readIntOption(parser, "min-duration", 0, options.minDurationMs)) {
+        return kExitUsage;
+    }
+    if (parser.isSet("starts-only") && parser.isSet("ends-only")) {
+        err() << "--starts-only 和 --ends-only 不能同时使用\n";
+        return kExitUsage;
+    }
+    options.snapStarts = !parser.isSet("ends-only");
+    options.snapEnds = !parser.isSet("starts-only");
+    if (!parser.isSet("keyframes")) {
+        err() << "需要用 --keyframes 指定切换点文件\n";
+        return kExitUsage;
+    }
+    
+    QString errorMsg;
+    QVector<int> keyframes;
+    if (!SubtitleSnap::readKeyframes(parser.value("keyframes"), fps, parser.isSet("frames"), keyframes, errorMsg)) {
+        err() << errorMsg << "\n";
+        return kExitFailure;
+    }
+    std::unique_ptr<QFile> input = openInput(parser.value("input"), errorMsg);
+    if (!input) {
+        err() << errorMsg << "\n";
+        return kExitFailure;
+    }
+    TextPool pool;
+    QVector<SubtitleItem> subtitles;
+    if (!SRTParser::parseData(input->readAll(), subtitles, errorMsg, encoding, &pool)) {
+        err() << errorMsg << "\n";
+        return kExitFailure;
+    }
+    
+    SubtitleSnap::Stats stats = SubtitleSnap::apply(subtitles, keyframes, options);
+    return writeSubtitles(parser, subtitles, outputEncoding, stats.summary());
+}
+
+struct TransformOutcome {
+    QString errorMsg;
+    SubtitleTextTransform::Result result;
+};
+
+int runConvert(const QStringList& arguments) {
+    QCommandLineParser parser;
+    parser.setApplicationDescription("批量处理字幕文本：去掉 HTML/ASS 标签、简繁转换、统一全角/半角标点；"
+                                     "给出多个文件时并行处理，-o 为输出目录，保留各文件相对于公共上级目录的路径");
+    parser.addPositionalArgument("files", "批量模式下的字幕文件", "[files...]");
+    addIoOptions(parser);
+    parser.addOption(QCommandLineOption("to", "简繁转换：traditional（简转繁）或 simplified（繁转简）", "script"));
+    parser.addOption(QCommandLineOption("dict-dir", "OpenCC 格式的词典目录（STCharacters.txt、STPhrases.txt 等），"
+                                                    "默认只用内置常用字词表", "dir"));
+    parser.addOption(QCommandLineOption("strip-tags", "去掉 <i>、<font> 等 HTML 标签和 {\\an8} 等 ASS 覆盖代码"));
+    parser.addOption(QCommandLineOption("punctuation", "half（全角改半角）或 full（紧邻汉字的标点改为中文全角标点）", "mode"));
+    if (!parseArguments(parser, arguments)) return kExitUsage;
+    
+    SubtitleEncoding encoding = SubtitleEncoding::Utf8;
+    SubtitleEncoding outputEncoding = SubtitleEncoding::Utf8;
+    if (!readEncodings(parser, encoding, outputEncoding)) return kExitUsage;
+    SubtitleTextTransform::Options options;
+    if (!SubtitleTextTransform::parseConversion(parser.value("to"), options.conversion)) {
+        err() << "不支持的转换: " << parser.value("to") << "\n";
+        return kExitUsage;
+    }
+    if (!SubtitleTextTransform::parsePunctuation(parser.value("punctuation"), options.punctuation)) {
+        err() << "不支持的标点处理方式: " << parser.value("punctuation") << "\n";
+        return kExitUsage;
+    }
+    options.stripTags = parser.isSet("strip-tags");
+    options.dictionaryDirectory = parser.value("dict-dir");
+    if (options.isEmpty()) {
+        err() << "需要指定 --to、--strip-tags 或 --punctuation 中的至少一项\n";
+        return kExitUsage;
+    }
+    
+    QString errorMsg;
+    const QStringList files = parser.positionalArguments();
+    if (files.isEmpty()) {
+        std::unique_ptr<QFile> input = openInput(parser.value("input"), errorMsg);
+        if (!input) {
+            err() << errorMsg << "\n";
+            return kExitFailure;
+        }
+        TextPool pool;
+        QVector<SubtitleItem> subtitles;
+        if (!SRTParser::parseData(input->readAll(), subtitles, errorMsg, encoding, &pool)) {
+            err() << errorMsg << "\n";
+            return kExitFailure;
+        }
+        
+        SubtitleTextTransform::Result result;
+        if (!SubtitleTextTransform::apply(subtitles, options, result, errorMsg, QThreadPool::globalInstance())) {
+            err() << errorMsg << "\n";
+            return kExitFailure;
+        }
+        return writeSubtitles(parser, subtitles, outputEncoding, result.summary());
+    }
+    
+    QVector<BatchJob> jobs;
+    int status = collectBatchJobs(parser, files, jobs);
+    if (status != kExitOk) return status;
+    
+    // 词典先在主线程编译一次，各文件共用同一个转换器
+    if (!SubtitleTextTransform::prepare(options, errorMsg)) {
+        err() << errorMsg << "\n";
+        return kExitFailure;
+    }
+    auto transformOne = [encoding, outputEncoding, options](const BatchJob& job, TransformOutcome& outcome) {
+        outcome.errorMsg = SubtitleTextTransform::transformFile(job.inputPath, job.outputPath, encoding,
+                                                                outputEncoding, options, &outcome.result);
+    };
+    QVector<TransformOutcome> outcomes;
+    int failed = runBatch(jobs, transformOne, outcomes);
+    
+    SubtitleTextTransform::Result total;
+    for (const TransformOutcome& outcome : outcomes) {
+        if (outcome.errorMsg.isEmpty()) total.changed += outcome.result.changed;
+    }
+    err() << QString("已处理 %1 个文件，失败 %2 个；%3\n").arg(files.size() - failed).arg(failed).arg(total.summary());
+    reportTiming();
+    return failed == 0 ? kExitOk : kExitFailure;
+}
+
+int runIndex(const QStringList& arguments) {
+    QCommandLineParser parser;
+    parser.setApplicationDescription("为目录树下的所有 .srt 文件建立或更新全文索引；"
+                                     "只重新解析修改时间或大小有变化的文件");
+    parser.addPositionalArgument("dir", "字幕库根目录");
+    parser.addOption(QCommandLineOption("index", "索引文件，默认为根目录下的 .srtindex", "file"));
+    parser.addOption(QCommandLineOption({"e", "encoding"}, "字幕编码：utf8（默认）、gbk、gb18030 或 utf16le", "name"));
+    if (!parseArguments(parser, arguments)) return kExitUsage;
+    
+    const QStringList positional = parser.positionalArguments();
+    if (positional.size() != 1) {
+        err() << "需要指定一个字幕库目录\n";
+        return kExitUsage;
+    }
+    SubtitleEncoding encoding = SubtitleEncoding::Utf8;
+    if (!parseEncoding(parser.value("encoding"), encoding)) {
+        err() << "不支持的编码: " << parser.value("encoding") << "\n";
+        return kExitUsage;
+    }
+    
+    // 原索引无效时直接重建
+    LibraryIndex index(positional.first(), parser.value("index"));
+    QString errorMsg;
+    if (QFileInfo::exists(index.indexPath()) && !index.load(errorMsg)) {
+        err() << errorMsg << "\n";
+    }
+    LibraryIndex::UpdateStats stats;
+    if (!index.update(encoding, stats, errorMsg, QThreadPool::globalInstance())) {
+        err() << errorMsg << "\n";
+        return kExitFailure;
+    }
+    for (const QString& error : stats.errors) {
+        err() << error << "\n";
+    }
+    err() << stats.summary() << "\n";
+    reportTiming();
+    return stats.errors.isEmpty() ? kExitOk : kExitFailure;
+}
+
+int runSearch(const QStringList& arguments) {
+    QCommandLineParser parser;
+    parser.setApplicationDescription("在字幕库索引中搜索，每行输出一条结果：文件、序号、开始时间和文本");
+    parser.addPositionalArgument("query", "要搜索的词语", "<query...>");
+    parser.addOption(QCommandLineOption("root", "字幕库根目录，默认为当前目录", "dir"));
+    parser.addOption(QCommandLineOption("index", "索引文件，默认为根目录下的 .srtindex", "file"));
+    parser.addOption(QCommandLineOption("limit", "最多输出的结果数（默认 20）", "n"));
+    if (!parseArguments(parser, arguments)) return kExitUsage;
+    
+    const QString query = parser.positionalArguments().join(' ');
+    if (query.trimmed().isEmpty()) {
+        err() << "需要指定搜索内容\n";
+        return kExitUsage;
+    }
+    int limit = 20;
+    if (!readIntOption(parser, "limit", 1, limit)) return kExitUsage;
+    
+    LibraryIndex index(parser.isSet("root") ? parser.value("root") : QDir::currentPath(), parser.value("index"));
+    QString errorMsg;
+    if (!index.load(errorMsg)) {
+        err() << errorMsg << "\n" << "请先运行 index 命令建立索引\n";
+        return kExitFailure;
+    }
+    
+    const QVector<LibraryIndex::Hit> hits = index.search(query, limit);
+    QTextStream out(stdout);
+    for (const LibraryIndex::Hit& hit : hits) {
+        QString text = hit.text;
+        text.replace('\n', ' ');
+        out << hit.filePath << '\t' << (hit.row + 1) << '\t'
+            << SRTParser::formatTime(QTime::fromMSecsSinceStartOfDay(hit.startMs)) << '\t' << text << '\n';
+    }
+    out.flush();
+    err() << QString("共 %1 个文件、%2 条字幕，显示 %3 条结果\n")
+                 .arg(index.fileCount()).arg(index.cueCount()).arg(hits.size());
+    reportTiming();
+    return kExitOk;
+}
+
+const Command* commands() {
+    static const Command table[] = {
+        {"help", "列出所有命令", &runHelp},
+        {"retime", "流式调整时间：平移、缩放、帧率转换或按同步点分段映射", &runRetime},
+        {"diff", "比较两个版本的字幕，输出 JSON 报告", &runDiff},
+        {"join", "流式合并分段字幕，按各部分开始时间平移并连续编号", &runJoin},
+        {"split", "流式在指定时间处分割字幕", &runSplit},
+        {"merge", "按时间重叠合并两种语言的字幕为双语字幕，可按目录批量处理", &runMerge},
+        {"reflow", "按每行字数、行数和阅读速度批量整理字幕，可只输出报告", &runReflow},
+        {"conform", "按剪辑表（CSV 或 CMX3600 EDL）把字幕对位到新剪辑版本，可批量处理", &runConform},
+        {"snap", "把字幕的开始和结束时间吸附到镜头切换点", &runSnap},
+        {"convert", "简繁转换、去掉 HTML/ASS 标签、统一全角/半角标点，可批量处理", &runConvert},
+        {"index", "为字幕库目录建立或增量更新全文索引", &runIndex},
+        {"search", "在字幕库索引中搜索，按相关度列出文件、序号和时间", &runSearch},
+        {nullptr, nullptr, nullptr}
+    };
+    return table;
+}
+
+}
+
+bool CommandLine::isCommand(const QString& name) {
+    for (const Command* command = commands(); command->name; ++command) {
+        if (name == QLatin1String(command->name)) return true;
+    }
+    return false;
+}
+
+int CommandLine::run(const QStringList& arguments) {
+    // 去掉命令名，其余参数交给各命令的解析器
+    QStringList commandArguments = arguments;
+    QString name = commandArguments.takeAt(1);
+    
+    PerfTrace::beginOperation();
+    for (const Command* command = commands(); command->name; ++command) {
+        if (name == QLatin1String(command->name)) {
+            int result = command->handler(commandArguments);
+            err().flush();
+            return result;
+        }
+    }
+    return kExitUsage;
+}
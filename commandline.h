@@ -0,0 +1,18 @@
+#ifndef COMMANDLINE_H
+#define COMMANDLINE_H
+
+#include <QString>
+#include <QStringList>
+
+// 无界面的命令行模式：SubtitleEditApp <命令> [选项]
+// 不创建任何窗口，可以在管道和批处理脚本中使用
+class CommandLine {
+public:
+    // argv[1] 是否为已知的命令
+    static bool isCommand(const QString& name);
+    
+    // arguments 为完整的命令行参数（含程序名和命令名），返回进程退出码
+    static int run(const QStringList& arguments);
+};
+
+#endif // COMMANDLINE_H
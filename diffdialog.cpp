@@ -0,0 +1,116 @@
+#include "diffdialog.h"
+#include "perftrace.h"
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QFileDialog>
+#include <QFileInfo>
+#include <QMessageBox>
+#include <QSaveFile>
+
+DiffDialog::DiffDialog(const QVector<SubtitleItem>& oldItems, const QString& oldName,
+                       const QVector<SubtitleItem>& newItems, const QString& newName,
+                       QWidget* parent)
+    : QDialog(parent)
+    , m_oldItems(oldItems)
+    , m_newItems(newItems)
+    , m_oldName(oldName)
+    , m_newName(newName)
+    , m_model(nullptr)
+{
+    setWindowTitle(QString("比较字幕 - %1 ↔ %2").arg(QFileInfo(oldName).fileName(), QFileInfo(newName).fileName()));
+    resize(1200, 700);
+    
+    m_diff.compare(m_oldItems, m_newItems);
+    setupUI();
+}
+
+DiffDialog::~DiffDialog()
+{
+}
+
+void DiffDialog::setupUI()
+{
+    QVBoxLayout* mainLayout = new QVBoxLayout(this);
+    
+    m_summaryLabel = new QLabel(this);
+    m_summaryLabel->setWordWrap(true);
+    m_summaryLabel->setStyleSheet("color: #666; padding: 5px; background: #f0f0f0; border-radius: 3px;");
+    if (m_diff.isIdentical()) {
+        m_summaryLabel->setText(QString("两个版本完全相同（共 %1 条字幕）").arg(m_oldItems.size()));
+    } else {
+        m_summaryLabel->setText(QString("旧版本 %1 条，新版本 %2 条：%3")
+                                .arg(m_oldItems.size()).arg(m_newItems.size()).arg(m_diff.summary()));
+    }
+    mainLayout->addWidget(m_summaryLabel);
+    
+    m_model = new DiffTableModel(&m_oldItems, &m_newItems, &m_diff, this);
+    m_model->setChangesOnly(true);
+    
+    m_table = new QTableView(this);
+    m_table->setModel(m_model);
+    m_table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    m_table->setSelectionBehavior(QAbstractItemView::SelectRows);
+    m_table->setSelectionMode(QAbstractItemView::SingleSelection);
+    m_table->setColumnWidth(DiffTableModel::OldIndexColumn, 60);
+    m_table->setColumnWidth(DiffTableModel::OldTimeColumn, 200);
+    m_table->setColumnWidth(DiffTableModel::OldTextColumn, 300);
+    m_table->setColumnWidth(DiffTableModel::NewIndexColumn, 60);
+    m_table->setColumnWidth(DiffTableModel::NewTimeColumn, 200);
+    m_table->horizontalHeader()->setStretchLastSection(true);
+    // 行高固定，视图不必逐行测量
+    m_table->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+    m_table->setWordWrap(false);
+    mainLayout->addWidget(m_table);
+    
+    QHBoxLayout* buttonLayout = new QHBoxLayout();
+    m_changesOnlyCheck = new QCheckBox("只显示差异", this);
+    m_changesOnlyCheck->setChecked(true);
+    buttonLayout->addWidget(m_changesOnlyCheck);
+    buttonLayout->addStretch();
+    
+    m_exportButton = new QPushButton("导出报告...", this);
+    m_exportButton->setToolTip("导出 JSON 格式的比较报告");
+    buttonLayout->addWidget(m_exportButton);
+    
+    QPushButton* closeButton = new QPushButton("关闭", this);
+    buttonLayout->addWidget(closeButton);
+    mainLayout->addLayout(buttonLayout);
+    
+    connect(m_changesOnlyCheck, &QCheckBox::toggled, this, &DiffDialog::onChangesOnlyToggled);
+    connect(m_table, &QTableView::doubleClicked, this, &DiffDialog::onRowDoubleClicked);
+    connect(m_exportButton, &QPushButton::clicked, this, &DiffDialog::onExportReport);
+    connect(closeButton, &QPushButton::clicked, this, &QDialog::accept);
+}
+
+void DiffDialog::onChangesOnlyToggled(bool checked)
+{
+    m_model->setChangesOnly(checked);
+}
+
+void DiffDialog::onRowDoubleClicked(const QModelIndex& index)
+{
+    if (!index.isValid()) return;
+    const SubtitleDiff::Entry& entry = m_model->entryAt(index.row());
+    if (entry.oldRow >= 0) {
+        emit oldRowActivated(entry.oldRow);
+    }
+}
+
+void DiffDialog::onExportReport()
+{
+    QString filePath = QFileDialog::getSaveFileName(this, "导出比较报告", "diff.json", "JSON文件 (*.json);;所有文件 (*)");
+    if (filePath.isEmpty()) return;
+    
+    QByteArray report;
+    {
+        PerfTrace::Scope scope("report");
+        scope.setCount(m_diff.changeCount());
+        report = m_diff.toJson(m_oldItems, m_newItems, m_oldName, m_newName);
+    }
+    
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly) || file.write(report) != report.size() || !file.commit()) {
+        QMessageBox::critical(this, "错误", "无法写入文件: " + filePath);
+    }
+}
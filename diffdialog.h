@@ -0,0 +1,51 @@
+#ifndef DIFFDIALOG_H
+#define DIFFDIALOG_H
+
+#include <QDialog>
+#include <QTableView>
+#include <QCheckBox>
+#include <QLabel>
+#include <QPushButton>
+#include <QVector>
+#include "subtitle.h"
+#include "subtitlediff.h"
+#include "difftablemodel.h"
+
+// 两个版本字幕的左右对照比较
+class DiffDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    DiffDialog(const QVector<SubtitleItem>& oldItems, const QString& oldName,
+               const QVector<SubtitleItem>& newItems, const QString& newName,
+               QWidget* parent = nullptr);
+    ~DiffDialog();
+
+signals:
+    // 双击某一行，请求在主窗口中定位旧版本的这一条
+    void oldRowActivated(int row);
+
+private slots:
+    void onChangesOnlyToggled(bool checked);
+    void onRowDoubleClicked(const QModelIndex& index);
+    void onExportReport();
+
+private:
+    void setupUI();
+    
+    // 隐式共享的副本，主窗口之后修改字幕不会影响比较结果
+    QVector<SubtitleItem> m_oldItems;
+    QVector<SubtitleItem> m_newItems;
+    QString m_oldName;
+    QString m_newName;
+    SubtitleDiff m_diff;
+    
+    DiffTableModel* m_model;
+    QTableView* m_table;
+    QCheckBox* m_changesOnlyCheck;
+    QLabel* m_summaryLabel;
+    QPushButton* m_exportButton;
+};
+
+#endif // DIFFDIALOG_H
@@ -0,0 +1,143 @@
+#include "difftablemodel.h"
+#include <QBrush>
+#include <QColor>
+#include <QFont>
+
+namespace {
+
+// 表格中文本列最多显示的字符数
+const int kTextPreviewLength = 80;
+
+QColor kindColor(SubtitleDiff::Kind kind) {
+    switch (kind) {
+    case SubtitleDiff::TimingChanged:
+        return QColor(220, 235, 255);
+    case SubtitleDiff::TextChanged:
+        return QColor(255, 243, 205);
+    case SubtitleDiff::Inserted:
+        return QColor(215, 245, 215);
+    case SubtitleDiff::Deleted:
+        return QColor(255, 220, 220);
+    default:
+        return QColor();
+    }
+}
+
+}
+
+DiffTableModel::DiffTableModel(const QVector<SubtitleItem>* oldItems, const QVector<SubtitleItem>* newItems,
+                               const SubtitleDiff* diff, QObject* parent)
+    : QAbstractTableModel(parent)
+    , m_oldItems(oldItems)
+    , m_newItems(newItems)
+    , m_diff(diff)
+    , m_changesOnly(false)
+{
+    const QVector<SubtitleDiff::Entry>& entries = m_diff->entries();
+    m_changedEntries.reserve(m_diff->changeCount());
+    for (int i = 0; i < entries.size(); ++i) {
+        if (entries[i].kind != SubtitleDiff::Unchanged) {
+            m_changedEntries.append(i);
+        }
+    }
+}
+
+int DiffTableModel::rowCount(const QModelIndex& parent) const
+{
+    if (parent.isValid()) return 0;
+    return m_changesOnly ? m_changedEntries.size() : m_diff->entries().size();
+}
+
+int DiffTableModel::columnCount(const QModelIndex& parent) const
+{
+    if (parent.isValid()) return 0;
+    return ColumnCount;
+}
+
+const SubtitleDiff::Entry& DiffTableModel::entryAt(int row) const
+{
+    return m_diff->entries()[entryIndex(row)];
+}
+
+QVariant DiffTableModel::data(const QModelIndex& index, int role) const
+{
+    if (!index.isValid() || index.row() >= rowCount()) return QVariant();
+    
+    const SubtitleDiff::Entry& entry = entryAt(index.row());
+    bool oldSide = index.column() < NewIndexColumn;
+    int row = oldSide ? entry.oldRow : entry.newRow;
+    
+    if (role == Qt::BackgroundRole) {
+        QColor color = kindColor(entry.kind);
+        return color.isValid() ? QVariant(QBrush(color)) : QVariant();
+    }
+    if (role == Qt::ToolTipRole) {
+        return SubtitleDiff::kindName(entry.kind);
+    }
+    if (role == Qt::FontRole) {
+        // 两边都有时，加粗实际发生变化的单元格
+        if (entry.oldRow < 0 || entry.newRow < 0) return QVariant();
+        const SubtitleItem& oldItem = m_oldItems->at(entry.oldRow);
+        const SubtitleItem& newItem = m_newItems->at(entry.newRow);
+        bool changed = false;
+        if (index.column() == OldTimeColumn || index.column() == NewTimeColumn) {
+            changed = oldItem.startTime != newItem.startTime || oldItem.endTime != newItem.endTime;
+        } else if (index.column() == OldTextColumn || index.column() == NewTextColumn) {
+            changed = oldItem.text != newItem.text;
+        }
+        if (!changed) return QVariant();
+        QFont font;
+        font.setBold(true);
+        return font;
+    }
+    if (role != Qt::DisplayRole || row < 0) return QVariant();
+    
+    const SubtitleItem& item = oldSide ? m_oldItems->at(row) : m_newItems->at(row);
+    switch (index.column()) {
+    case OldIndexColumn:
+    case NewIndexColumn:
+        return QString::number(row + 1);
+    case OldTimeColumn:
+    case NewTimeColumn:
+        return SRTParser::formatTime(item.startTime) + " --> " + SRTParser::formatTime(item.endTime);
+    case OldTextColumn:
+    case NewTextColumn: {
+        QString text = item.text;
+        text.replace('\n', " / ");
+        if (text.length() > kTextPreviewLength) {
+            return text.left(kTextPreviewLength) + "...";
+        }
+        return text;
+    }
+    }
+    return QVariant();
+}
+
+QVariant DiffTableModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (role != Qt::DisplayRole) return QVariant();
+    if (orientation == Qt::Vertical) return section + 1;
+    
+    switch (section) {
+    case OldIndexColumn:
+    case NewIndexColumn:
+        return QString("序号");
+    case OldTimeColumn:
+        return QString("旧版本时间");
+    case OldTextColumn:
+        return QString("旧版本文本");
+    case NewTimeColumn:
+        return QString("新版本时间");
+    case NewTextColumn:
+        return QString("新版本文本");
+    }
+    return QVariant();
+}
+
+void DiffTableModel::setChangesOnly(bool changesOnly)
+{
+    if (m_changesOnly == changesOnly) return;
+    beginResetModel();
+    m_changesOnly = changesOnly;
+    endResetModel();
+}
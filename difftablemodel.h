@@ -0,0 +1,53 @@
+#ifndef DIFFTABLEMODEL_H
+#define DIFFTABLEMODEL_H
+
+#include <QAbstractTableModel>
+#include <QVector>
+#include "subtitle.h"
+#include "subtitlediff.h"
+
+// 比较结果的左右对照表格模型
+// 每一行是一条比较结果，左半边为旧版本、右半边为新版本；
+// 与其他表格模型一样只为可见行生成文本，十万条结果也能立即显示。
+// 可以只显示有变化的行，此时只维护一个结果下标数组。
+class DiffTableModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    enum Column {
+        OldIndexColumn = 0,
+        OldTimeColumn,
+        OldTextColumn,
+        NewIndexColumn,
+        NewTimeColumn,
+        NewTextColumn,
+        ColumnCount
+    };
+    
+    DiffTableModel(const QVector<SubtitleItem>* oldItems, const QVector<SubtitleItem>* newItems,
+                   const SubtitleDiff* diff, QObject* parent = nullptr);
+    
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+    
+    // 是否只显示有变化的条目
+    void setChangesOnly(bool changesOnly);
+    bool changesOnly() const { return m_changesOnly; }
+    
+    // 表格行对应的比较结果
+    const SubtitleDiff::Entry& entryAt(int row) const;
+
+private:
+    int entryIndex(int row) const { return m_changesOnly ? m_changedEntries[row] : row; }
+    
+    const QVector<SubtitleItem>* m_oldItems;
+    const QVector<SubtitleItem>* m_newItems;
+    const SubtitleDiff* m_diff;
+    QVector<int> m_changedEntries;
+    bool m_changesOnly;
+};
+
+#endif // DIFFTABLEMODEL_H
@@ -0,0 +1,117 @@
+#include "doublearraytrie.h"
+
+DoubleArrayTrie::DoubleArrayTrie()
+    : m_firstFree(1)
+{
+}
+
+void DoubleArrayTrie::build(const QVector<QString>& keys, const QVector<int>& values) {
+    m_codes = QVector<int>(0x10000, 0);
+    int codeCount = 0;
+    int totalLength = 0;
+    for (const QString& key : keys) {
+        for (QChar ch : key) {
+            int& code = m_codes[ch.unicode()];
+            if (code == 0) code = ++codeCount;
+        }
+        totalLength += key.size();
+    }
+    
+    m_base = QVector<int>(1, 0);
+    m_check = QVector<int>(1, 0);
+    m_value = QVector<int>(1, -1);
+    m_firstFree = 1;
+    reserve(qMax(1024, totalLength + codeCount + 1));
+    if (!keys.isEmpty()) {
+        insert(keys, values, 0, 0, 0, keys.size());
+    }
+    
+    // 去掉末尾的空闲位置
+    int size = m_check.size();
+    while (size > 1 && m_check[size - 1] == -1) --size;
+    m_base.resize(size);
+    m_check.resize(size);
+    m_value.resize(size);
+}
+
+void DoubleArrayTrie::reserve(int size) {
+    if (size <= m_check.size()) return;
+    int newSize = qMax(size, m_check.size() * 2);
+    m_base.resize(newSize, 0);
+    m_check.resize(newSize, -1);
+    m_value.resize(newSize, -1);
+}
+
+void DoubleArrayTrie::insert(const QVector<QString>& keys, const QVector<int>& values, int node, int depth,
+                             int begin, int end) {
+    // 有序的键中，恰好在此结束的键排在最前
+    if (keys[begin].size() == depth) {
+        m_value[node] = values[begin];
+        ++begin;
+    }
+    if (begin == end) return;
+    
+    // 子节点按第 depth 个码元分组，同一码元的键在有序数组中相邻
+    QVector<int> codes;
+    QVector<int> starts;
+    for (int i = begin; i < end; ++i) {
+        int code = m_codes[keys[i][depth].unicode()];
+        if (codes.isEmpty() || codes.last() != code) {
+            codes.append(code);
+            starts.append(i);
+        }
+    }
+    starts.append(end);
+    
+    // 先占住所有子节点的位置再递归，子树不会抢占兄弟节点的位置
+    const int base = findBase(codes);
+    m_base[node] = base;
+    for (int code : codes) {
+        m_check[base + code] = node;
+    }
+    while (m_firstFree < m_check.size() && m_check[m_firstFree] != -1) ++m_firstFree;
+    
+    for (int k = 0; k < codes.size(); ++k) {
+        insert(keys, values, base + codes[k], depth + 1, starts[k], starts[k + 1]);
+    }
+}
+
+int DoubleArrayTrie::findBase(const QVector<int>& codes) {
+    // 让第一个子节点依次落在每个空闲位置上，直到其余子节点的位置也都空闲
+    for (int position = m_firstFree; ; ++position) {
+        reserve(position + 1);
+        if (m_check[position] != -1) continue;
+        int base = position - codes[0];
+        if (base < 1) continue;
+        
+        bool fits = true;
+        for (int code : codes) {
+            reserve(base + code + 1);
+            if (m_check[base + code] != -1) {
+                fits = false;
+                break;
+            }
+        }
+        if (fits) return base;
+    }
+}
+
+int DoubleArrayTrie::longestMatch(const QChar* text, int length, int& value) const {
+    if (m_codes.isEmpty()) return 0;
+    
+    int node = 0;
+    int matched = 0;
+    for (int i = 0; i < length; ++i) {
+        int code = m_codes[text[i].unicode()];
+        int base = m_base[node];
+        if (code == 0 || base <= 0) break;
+        int next = base + code;
+        if (next >= m_check.size() || m_check[next] != node) break;
+        node = next;
+        if (m_value[node] >= 0) {
+            matched = i + 1;
+            value = m_value[node];
+        }
+    }
+    return matched;
+}
@@ -0,0 +1,34 @@
+#ifndef DOUBLEARRAYTRIE_H
+#define DOUBLEARRAYTRIE_H
+
+#include <QString>
+#include <QVector>
+
+// 以 UTF-16 码元为字母表的双数组字典树，用于词典的最长匹配
+// 节点 s 经码元 c 转移到 t = base[s] + code(c)，且要求 check[t] == s；码元先映射为稠密编号，
+// 数组大小与词典实际用到的字符数有关，而不是 65536。建成后只读，可以在多个线程中同时查询。
+class DoubleArrayTrie {
+public:
+    DoubleArrayTrie();
+    
+    // keys 必须升序且不重复，values[i] 为 keys[i] 对应的编号（非负）
+    void build(const QVector<QString>& keys, const QVector<int>& values);
+    
+    bool isEmpty() const { return m_base.size() <= 1; }
+    
+    // 从 text 开始、最长不超过 length 的最长匹配，返回匹配的码元数（0 为没有匹配），value 为对应编号
+    int longestMatch(const QChar* text, int length, int& value) const;
+
+private:
+    void insert(const QVector<QString>& keys, const QVector<int>& values, int node, int depth, int begin, int end);
+    int findBase(const QVector<int>& codes);
+    void reserve(int size);
+    
+    QVector<int> m_codes;       // 码元 → 稠密编号，0 表示词典中没有这个码元
+    QVector<int> m_base;
+    QVector<int> m_check;       // -1 表示空闲
+    QVector<int> m_value;       // 以该节点结尾的词条编号，-1 表示不是词条
+    int m_firstFree;            // 之前的位置都已被占用，查找 base 时从这里开始
+};
+
+#endif // DOUBLEARRAYTRIE_H
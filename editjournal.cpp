@@ -0,0 +1,554 @@
+#include "editjournal.h"
+#include "perftrace.h"
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QLockFile>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QQueue>
+#include <QSaveFile>
+#include <QSet>
+#include <QStandardPaths>
+#include <QThread>
+#include <QtEndian>
+#include <QWaitCondition>
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+
+const quint32 kJournalMagic = 0x53454A31; // "SEJ1"
+const quint16 kJournalVersion = 1;
+
+// 快照之后累计的记录数超过该值即压缩，重放最多处理这么多条记录
+const int kCompactThreshold = 2000;
+
+// 记录格式：quint32 载荷长度 + quint16 校验和 + 载荷（大端，与 QDataStream 一致）
+// 崩溃时最后一条记录可能只写了一半，读取时遇到长度或校验和不符即停止
+QByteArray frameRecord(const QByteArray& payload) {
+    QByteArray framed;
+    framed.reserve(payload.size() + 6);
+    {
+        QDataStream out(&framed, QIODevice::WriteOnly);
+        out << quint32(payload.size()) << quint16(qChecksum(payload));
+    }
+    framed.append(payload);
+    return framed;
+}
+
+QVector<QByteArray> readRecords(const QString& journalPath) {
+    QVector<QByteArray> records;
+    
+    QFile file(journalPath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return records;
+    }
+    QByteArray data = file.readAll();
+    file.close();
+    
+    qsizetype pos = 0;
+    while (pos + 6 <= data.size()) {
+        const uchar* frame = reinterpret_cast<const uchar*>(data.constData() + pos);
+        quint32 length = qFromBigEndian<quint32>(frame);
+        quint16 checksum = qFromBigEndian<quint16>(frame + 4);
+        if (pos + 6 + qsizetype(length) > data.size()) break;
+        
+        QByteArray payload = data.mid(pos + 6, length);
+        if (quint16(qChecksum(payload)) != checksum) break;
+        
+        records.append(payload);
+        pos += 6 + length;
+    }
+    return records;
+}
+
+QByteArray serializeSnapshot(const QVector<SubtitleItem>& subtitles) {
+    QByteArray payload;
+    QDataStream out(&payload, QIODevice::WriteOnly);
+    out << quint8(EditJournal::Snapshot) << qint32(subtitles.size());
+    for (const SubtitleItem& item : subtitles) {
+        out << qint32(item.index)
+            << qint32(item.startTime.msecsSinceStartOfDay())
+            << qint32(item.endTime.msecsSinceStartOfDay())
+            << item.text;
+    }
+    return payload;
+}
+
+void deserializeSnapshot(QDataStream& in, QVector<SubtitleItem>& subtitles) {
+    qint32 count = 0;
+    in >> count;
+    subtitles.clear();
+    subtitles.reserve(qMax(0, count));
+    for (qint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+        qint32 index = 0;
+        qint32 startMs = 0;
+        qint32 endMs = 0;
+        QString text;
+        in >> index >> startMs >> endMs >> text;
+        subtitles.append(SubtitleItem(index,
+                                      QTime::fromMSecsSinceStartOfDay(startMs),
+                                      QTime::fromMSecsSinceStartOfDay(endMs),
+                                      text));
+    }
+}
+
+// 与表格编辑相同的语义重放单元格修改
+void applyCellEdit(QVector<SubtitleItem>& subtitles, int row, int column, const QString& value) {
+    if (row < 0 || row >= subtitles.size()) return;
+    
+    SubtitleItem& item = subtitles[row];
+    bool ok = false;
+    switch (column) {
+    case 0: {
+        int index = value.toInt(&ok);
+        if (ok) item.index = index;
+        break;
+    }
+    case 1: {
+        QTime time = SRTParser::parseTime(value, ok);
+        if (ok) item.startTime = time;
+        break;
+    }
+    case 2: {
+        QTime time = SRTParser::parseTime(value, ok);
+        if (ok) item.endTime = time;
+        break;
+    }
+    case 3:
+        item.text = value;
+        break;
+    }
+}
+
+QString journalPathFor(const QString& filePath) {
+    QByteArray key = QFileInfo(filePath).absoluteFilePath().toUtf8();
+    QString name = QString::fromLatin1(QCryptographicHash::hash(key, QCryptographicHash::Md5).toHex());
+    return EditJournal::journalDirectory() + "/" + name + ".journal";
+}
+
+// 尝试占用日志；已被存活的进程占用时返回空
+// 不按时间判断过期，只有持有者进程已经退出的锁才会被接管
+std::unique_ptr<QLockFile> lockJournal(const QString& journalPath) {
+    QDir().mkpath(QFileInfo(journalPath).absolutePath());
+    std::unique_ptr<QLockFile> lock(new QLockFile(journalPath + ".lock"));
+    lock->setStaleLockTime(0);
+    if (!lock->tryLock(0)) {
+        return nullptr;
+    }
+    return lock;
+}
+
+void syncToDisk(QFileDevice* file) {
+    file->flush();
+#ifdef Q_OS_WIN
+    _commit(file->handle());
+#else
+    ::fsync(file->handle());
+#endif
+}
+
+struct JournalJob {
+    enum Kind {
+        Append,
+        Rewrite,
+        Remove
+    };
+    
+    Kind kind;
+    QString path;
+    QByteArray data;                 // Append：已分帧的记录；Rewrite：已分帧的头部
+    bool withSnapshot;
+    QVector<SubtitleItem> snapshot;  // 隐式共享的副本，在后台线程中序列化
+    
+    JournalJob() : kind(Append), withSnapshot(false) {}
+};
+
+// 所有日志共用的后台写入线程
+// 每批任务写完后对涉及的文件只做一次 fsync，界面线程从不等待磁盘
+class JournalWriter : public QThread {
+public:
+    static JournalWriter* instance() {
+        static JournalWriter* writer = nullptr;
+        if (!writer) {
+            writer = new JournalWriter();
+            writer->start(QThread::LowPriority);
+            qAddPostRoutine(&JournalWriter::shutdown);
+        }
+        return writer;
+    }
+    
+    void enqueue(const JournalJob& job) {
+        QMutexLocker locker(&m_mutex);
+        m_jobs.enqueue(job);
+        m_condition.wakeOne();
+    }
+
+protected:
+    void run() override {
+        forever {
+            QQueue<JournalJob> batch;
+            {
+                QMutexLocker locker(&m_mutex);
+                while (m_jobs.isEmpty() && !m_stopping) {
+                    m_condition.wait(&m_mutex);
+                }
+                if (m_jobs.isEmpty()) break;
+                batch.swap(m_jobs);
+            }
+            
+            QSet<QFile*> dirty;
+            for (const JournalJob& job : batch) {
+                process(job, dirty);
+            }
+            for (QFile* file : dirty) {
+                syncToDisk(file);
+            }
+        }
+        
+        qDeleteAll(m_files);
+        m_files.clear();
+    }
+
+private:
+    JournalWriter() : m_stopping(false) {}
+    
+    static void shutdown() {
+        JournalWriter* writer = instance();
+        {
+            QMutexLocker locker(&writer->m_mutex);
+            writer->m_stopping = true;
+            writer->m_condition.wakeOne();
+        }
+        // 退出前写完队列中剩余的记录
+        writer->wait();
+    }
+    
+    void closeFile(const QString& path, QSet<QFile*>& dirty) {
+        QFile* file = m_files.take(path);
+        if (file) {
+            dirty.remove(file);
+            delete file;
+        }
+    }
+    
+    void process(const JournalJob& job, QSet<QFile*>& dirty) {
+        switch (job.kind) {
+        case JournalJob::Append: {
+            QFile* file = m_files.value(job.path);
+            if (!file) {
+                file = new QFile(job.path);
+                if (!file->open(QIODevice::WriteOnly | QIODevice::Append)) {
+                    delete file;
+                    return;
+                }
+                m_files.insert(job.path, file);
+            }
+            file->write(job.data);
+            dirty.insert(file);
+            break;
+        }
+        case JournalJob::Rewrite: {
+            closeFile(job.path, dirty);
+            QDir().mkpath(QFileInfo(job.path).absolutePath());
+            
+            // 写临时文件再原子替换，压缩过程中崩溃也不会丢掉旧日志
+            QSaveFile file(job.path);
+            if (!file.open(QIODevice::WriteOnly)) return;
+            file.write(job.data);
+            if (job.withSnapshot) {
+                file.write(frameRecord(serializeSnapshot(job.snapshot)));
+            }
+            syncToDisk(&file);
+            file.commit();
+            break;
+        }
+        case JournalJob::Remove:
+            closeFile(job.path, dirty);
+            QFile::remove(job.path);
+            break;
+        }
+    }
+    
+    QMutex m_mutex;
+    QWaitCondition m_condition;
+    QQueue<JournalJob> m_jobs;
+    bool m_stopping;
+    QHash<QString, QFile*> m_files;  // 只在写入线程中访问
+};
+
+}
+
+EditJournal::EditJournal(const QVector<SubtitleItem>* subtitles)
+    : m_subtitles(subtitles)
+    , m_recordsSinceSnapshot(0)
+{
+}
+
+EditJournal::~EditJournal()
+{
+}
+
+QString EditJournal::journalDirectory() {
+    return QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + "/journal";
+}
+
+QStringList EditJournal::pendingJournals() {
+    QStringList result;
+    QDir dir(journalDirectory());
+    const QStringList names = dir.entryList({"*.journal"}, QDir::Files);
+    for (const QString& name : names) {
+        QString path = dir.filePath(name);
+        // 另一个正在运行的实例的日志，既不能恢复也不能删除
+        std::unique_ptr<QLockFile> lock = lockJournal(path);
+        if (!lock) continue;
+        
+        // 只有头部的日志说明上次退出时没有未保存的修改
+        if (readRecords(path).size() > 1) {
+            result << path;
+        } else {
+            QFile::remove(path);
+        }
+    }
+    return result;
+}
+
+bool EditJournal::recover(const QString& journalPath, RecoveredSession& session, QString& errorMsg) {
+    PerfTrace::Scope scope("replay");
+    
+    QVector<QByteArray> records = readRecords(journalPath);
+    if (records.isEmpty()) {
+        errorMsg = "日志文件为空或已损坏";
+        return false;
+    }
+    
+    // 头部
+    qint64 baseSize = 0;
+    qint64 baseModified = 0;
+    {
+        QDataStream in(records[0]);
+        quint8 type = 0;
+        quint32 magic = 0;
+        quint16 version = 0;
+        qint32 encoding = 0;
+        in >> type >> magic >> version;
+        if (type != Header || magic != kJournalMagic || version != kJournalVersion) {
+            errorMsg = "无法识别的日志格式";
+            return false;
+        }
+        in >> session.filePath >> encoding >> baseSize >> baseModified;
+        session.encoding = static_cast<SubtitleEncoding>(encoding);
+    }
+    
+    // 基准内容：最后一份快照，没有快照时使用磁盘上的原文件
+    int replayFrom = 1;
+    bool hasSnapshot = false;
+    for (int i = records.size() - 1; i >= 1; --i) {
+        if (!records[i].isEmpty() && quint8(records[i][0]) == Snapshot) {
+            QDataStream in(records[i]);
+            quint8 type = 0;
+            in >> type;
+            deserializeSnapshot(in, session.subtitles);
+            replayFrom = i + 1;
+            hasSnapshot = true;
+            break;
+        }
+    }
+    
+    if (!hasSnapshot) {
+        QFileInfo info(session.filePath);
+        if (!info.exists() || info.size() != baseSize ||
+            info.lastModified().toMSecsSinceEpoch() != baseModified) {
+            errorMsg = "原文件在上次编辑后已被修改或删除，无法安全重放日志: " + session.filePath;
+            return false;
+        }
+        if (!SRTParser::parse(session.filePath, session.subtitles, errorMsg, session.encoding)) {
+            return false;
+        }
+    }
+    
+    // 依次重放快照之后的记录
+    for (int i = replayFrom; i < records.size(); ++i) {
+        QDataStream in(records[i]);
+        quint8 type = 0;
+        in >> type;
+        
+        switch (type) {
+        case CellEdit: {
+            qint32 row = 0;
+            qint32 column = 0;
+            QString value;
+            in >> row >> column >> value;
+            applyCellEdit(session.subtitles, row, column, value);
+            break;
+        }
+        case Shift: {
+            qint32 first = 0;
+            qint32 last = 0;
+            qint32 milliseconds = 0;
+            in >> first >> last >> milliseconds;
+            SRTParser::shiftTime(session.subtitles, milliseconds, first, last);
+            break;
+        }
+        case Scale: {
+            qint32 first = 0;
+            qint32 last = 0;
+            double factor = 1.0;
+            qint32 anchorMs = 0;
+            in >> first >> last >> factor >> anchorMs;
+            SRTParser::scaleTime(session.subtitles, factor, QTime::fromMSecsSinceStartOfDay(anchorMs),
+                                 first, last);
+            break;
+        }
+        case PointSync: {
+            qint32 point1Index = 0;
+            qint32 point1Ms = 0;
+            qint32 point2Index = 0;
+            qint32 point2Ms = 0;
+            qint32 first = 0;
+            qint32 last = 0;
+            in >> point1Index >> point1Ms >> point2Index >> point2Ms >> first >> last;
+            SRTParser::pointSync(session.subtitles,
+                                 point1Index, QTime::fromMSecsSinceStartOfDay(point1Ms),
+                                 point2Index, QTime::fromMSecsSinceStartOfDay(point2Ms),
+                                 first, last);
+            break;
+        }
+        default:
+            continue;
+        }
+        ++session.replayedRecords;
+    }
+    
+    scope.setCount(session.replayedRecords);
+    return true;
+}
+
+void EditJournal::removeJournal(const QString& journalPath) {
+    JournalJob job;
+    job.kind = JournalJob::Remove;
+    job.path = journalPath;
+    JournalWriter::instance()->enqueue(job);
+}
+
+void EditJournal::start(const QString& filePath, SubtitleEncoding encoding) {
+    QString journalPath = journalPathFor(filePath);
+    if (!m_journalPath.isEmpty() && m_journalPath != journalPath) {
+        // 另存为新文件后旧路径的日志不再需要
+        discard();
+    }
+    if (m_journalPath != journalPath) {
+        m_lock = lockJournal(journalPath);
+        if (!m_lock) {
+            // 另一个实例正在编辑同一文件，不能覆盖它的日志
+            m_journalPath.clear();
+            m_header.clear();
+            return;
+        }
+    }
+    m_journalPath = journalPath;
+    m_recordsSinceSnapshot = 0;
+    
+    QFileInfo info(filePath);
+    QByteArray payload;
+    {
+        QDataStream out(&payload, QIODevice::WriteOnly);
+        out << quint8(Header) << kJournalMagic << kJournalVersion
+            << info.absoluteFilePath() << qint32(encoding)
+            << qint64(info.size()) << qint64(info.lastModified().toMSecsSinceEpoch());
+    }
+    m_header = frameRecord(payload);
+    
+    JournalJob job;
+    job.kind = JournalJob::Rewrite;
+    job.path = m_journalPath;
+    job.data = m_header;
+    JournalWriter::instance()->enqueue(job);
+}
+
+void EditJournal::discard() {
+    if (!isActive()) return;
+    removeJournal(m_journalPath);
+    m_journalPath.clear();
+    m_header.clear();
+    m_recordsSinceSnapshot = 0;
+    m_lock.reset();
+}
+
+void EditJournal::recordCellEdit(int row, int column, const QString& value) {
+    if (!isActive()) return;
+    QByteArray payload;
+    QDataStream out(&payload, QIODevice::WriteOnly);
+    out << quint8(CellEdit) << qint32(row) << qint32(column) << value;
+    appendRecord(payload);
+}
+
+void EditJournal::recordShift(int first, int last, int milliseconds) {
+    if (!isActive()) return;
+    QByteArray payload;
+    QDataStream out(&payload, QIODevice::WriteOnly);
+    out << quint8(Shift) << qint32(first) << qint32(last) << qint32(milliseconds);
+    appendRecord(payload);
+}
+
+void EditJournal::recordScale(int first, int last, double factor, const QTime& anchor) {
+    if (!isActive()) return;
+    QByteArray payload;
+    QDataStream out(&payload, QIODevice::WriteOnly);
+    out << quint8(Scale) << qint32(first) << qint32(last) << factor
+        << qint32(anchor.msecsSinceStartOfDay());
+    appendRecord(payload);
+}
+
+void EditJournal::recordPointSync(int point1Index, const QTime& newPoint1Time,
+                                  int point2Index, const QTime& newPoint2Time,
+                                  int first, int last) {
+    if (!isActive()) return;
+    QByteArray payload;
+    QDataStream out(&payload, QIODevice::WriteOnly);
+    out << quint8(PointSync)
+        << qint32(point1Index) << qint32(newPoint1Time.msecsSinceStartOfDay())
+        << qint32(point2Index) << qint32(newPoint2Time.msecsSinceStartOfDay())
+        << qint32(first) << qint32(last);
+    appendRecord(payload);
+}
+
+void EditJournal::recordReplaceAll() {
+    if (!isActive()) return;
+    compact();
+}
+
+void EditJournal::appendRecord(const QByteArray& payload) {
+    JournalJob job;
+    job.kind = JournalJob::Append;
+    job.path = m_journalPath;
+    job.data = frameRecord(payload);
+    JournalWriter::instance()->enqueue(job);
+    
+    if (++m_recordsSinceSnapshot >= kCompactThreshold) {
+        compact();
+    }
+}
+
+void EditJournal::compact() {
+    // 字幕数组隐式共享，这里只增加引用计数；序列化在写入线程中进行
+    JournalJob job;
+    job.kind = JournalJob::Rewrite;
+    job.path = m_journalPath;
+    job.data = m_header;
+    job.withSnapshot = true;
+    job.snapshot = *m_subtitles;
+    JournalWriter::instance()->enqueue(job);
+    
+    m_recordsSinceSnapshot = 0;
+}
@@ -0,0 +1,87 @@
+#ifndef EDITJOURNAL_H
+#define EDITJOURNAL_H
+
+#include <QString>
+#include <QStringList>
+#include <QTime>
+#include <QVector>
+#include <memory>
+#include "subtitle.h"
+
+class QLockFile;
+
+// 从日志中恢复出的会话
+struct RecoveredSession {
+    QString filePath;
+    SubtitleEncoding encoding;
+    QVector<SubtitleItem> subtitles;
+    int replayedRecords;
+    
+    RecoveredSession() : encoding(SubtitleEncoding::Utf8), replayedRecords(0) {}
+};
+
+// 崩溃恢复用的追加式编辑日志
+// 每次编辑或批量操作只追加一条很小的记录，由后台线程写入并 fsync；
+// 记录数超过阈值时在后台写入一份快照并截断日志，保证重放时间有上限。
+// 活动的日志旁边有一个 .lock 文件（QLockFile，记录进程号），其它实例不会恢复或删除仍在使用的日志。
+class EditJournal {
+public:
+    enum RecordType : quint8 {
+        Header = 0,
+        Snapshot,
+        CellEdit,
+        Shift,
+        Scale,
+        PointSync
+    };
+    
+    // subtitles 指向文档的字幕数组，用于生成快照
+    explicit EditJournal(const QVector<SubtitleItem>* subtitles);
+    ~EditJournal();
+    
+    // 日志文件所在目录
+    static QString journalDirectory();
+    
+    // 含有未保存编辑、且没有被正在运行的实例占用的日志文件
+    static QStringList pendingJournals();
+    
+    // 读取日志并重放，得到崩溃前的字幕内容
+    static bool recover(const QString& journalPath, RecoveredSession& session, QString& errorMsg);
+    
+    // 删除日志文件（用户放弃恢复时）
+    static void removeJournal(const QString& journalPath);
+    
+    // 以磁盘上的文件为基准开始新的日志（打开或保存后调用）
+    // 同一文件的日志已被另一个实例占用时不记录日志，isActive() 为 false
+    void start(const QString& filePath, SubtitleEncoding encoding);
+    
+    // 文档关闭且无需恢复时删除日志
+    void discard();
+    
+    bool isActive() const { return !m_journalPath.isEmpty(); }
+    
+    void recordCellEdit(int row, int column, const QString& value);
+    void recordShift(int first, int last, int milliseconds);
+    void recordScale(int first, int last, double factor, const QTime& anchor);
+    void recordPointSync(int point1Index, const QTime& newPoint1Time,
+                         int point2Index, const QTime& newPoint2Time,
+                         int first, int last);
+    
+    // 无法用小记录描述的操作（例如多点同步）直接写一份快照
+    void recordReplaceAll();
+
+private:
+    EditJournal(const EditJournal&) = delete;
+    EditJournal& operator=(const EditJournal&) = delete;
+    
+    void appendRecord(const QByteArray& payload);
+    void compact();
+    
+    const QVector<SubtitleItem>* m_subtitles;
+    QString m_journalPath;
+    std::unique_ptr<QLockFile> m_lock;
+    QByteArray m_header;
+    int m_recordsSinceSnapshot;
+};
+
+#endif // EDITJOURNAL_H
@@ -0,0 +1,209 @@
+#include "intervalindex.h"
+#include "perftrace.h"
+#include <algorithm>
+
+IntervalIndex::IntervalIndex()
+    : m_root(-1)
+    , m_seed(0x2545F491u)
+{
+}
+
+void IntervalIndex::clear() {
+    m_nodes.clear();
+    m_freeNodes.clear();
+    m_rowStart.clear();
+    m_root = -1;
+}
+
+quint32 IntervalIndex::nextPriority() {
+    // xorshift32，固定种子让构建结果可复现
+    m_seed ^= m_seed << 13;
+    m_seed ^= m_seed >> 17;
+    m_seed ^= m_seed << 5;
+    return m_seed;
+}
+
+int IntervalIndex::newNode(int start, int end, int row) {
+    Node node;
+    node.start = start;
+    node.end = end;
+    node.row = row;
+    node.maxEnd = end;
+    node.left = -1;
+    node.right = -1;
+    node.priority = nextPriority();
+    
+    if (!m_freeNodes.isEmpty()) {
+        int index = m_freeNodes.takeLast();
+        m_nodes[index] = node;
+        return index;
+    }
+    m_nodes.append(node);
+    return m_nodes.size() - 1;
+}
+
+void IntervalIndex::pull(int node) {
+    Node& n = m_nodes[node];
+    n.maxEnd = n.end;
+    if (n.left >= 0) n.maxEnd = qMax(n.maxEnd, m_nodes[n.left].maxEnd);
+    if (n.right >= 0) n.maxEnd = qMax(n.maxEnd, m_nodes[n.right].maxEnd);
+}
+
+void IntervalIndex::split(int node, int start, int row, int& left, int& right) {
+    if (node < 0) {
+        left = -1;
+        right = -1;
+        return;
+    }
+    if (keyLess(m_nodes[node].start, m_nodes[node].row, start, row)) {
+        int l = -1;
+        int r = -1;
+        split(m_nodes[node].right, start, row, l, r);
+        m_nodes[node].right = l;
+        pull(node);
+        left = node;
+        right = r;
+    } else {
+        int l = -1;
+        int r = -1;
+        split(m_nodes[node].left, start, row, l, r);
+        m_nodes[node].left = r;
+        pull(node);
+        left = l;
+        right = node;
+    }
+}
+
+int IntervalIndex::merge(int left, int right) {
+    if (left < 0) return right;
+    if (right < 0) return left;
+    if (m_nodes[left].priority > m_nodes[right].priority) {
+        m_nodes[left].right = merge(m_nodes[left].right, right);
+        pull(left);
+        return left;
+    }
+    m_nodes[right].left = merge(left, m_nodes[right].left);
+    pull(right);
+    return right;
+}
+
+void IntervalIndex::insert(int start, int end, int row) {
+    int left = -1;
+    int right = -1;
+    split(m_root, start, row, left, right);
+    m_root = merge(merge(left, newNode(start, end, row)), right);
+}
+
+void IntervalIndex::erase(int start, int row) {
+    int left = -1;
+    int rest = -1;
+    split(m_root, start, row, left, rest);
+    int middle = -1;
+    int right = -1;
+    split(rest, start, row + 1, middle, right);
+    // middle 中恰好是 (start, row) 这一个节点
+    if (middle >= 0) {
+        m_freeNodes.append(middle);
+    }
+    m_root = merge(left, right);
+}
+
+void IntervalIndex::build(const QVector<SubtitleItem>& subtitles) {
+    PerfTrace::Scope scope("index");
+    scope.setCount(subtitles.size());
+    
+    clear();
+    m_rowStart.resize(subtitles.size());
+    m_nodes.reserve(subtitles.size());
+    
+    // 按键排序后用栈构建笛卡尔树，避免逐个插入的递归开销
+    QVector<int> order(subtitles.size());
+    for (int i = 0; i < subtitles.size(); ++i) {
+        order[i] = i;
+        m_rowStart[i] = subtitles[i].startTime.msecsSinceStartOfDay();
+    }
+    std::sort(order.begin(), order.end(), [this](int a, int b) {
+        return keyLess(m_rowStart[a], a, m_rowStart[b], b);
+    });
+    
+    QVector<int> stack;
+    for (int row : order) {
+        int node = newNode(m_rowStart[row], subtitles[row].endTime.msecsSinceStartOfDay(), row);
+        int last = -1;
+        while (!stack.isEmpty() && m_nodes[stack.last()].priority < m_nodes[node].priority) {
+            last = stack.takeLast();
+            pull(last);
+        }
+        m_nodes[node].left = last;
+        if (!stack.isEmpty()) {
+            m_nodes[stack.last()].right = node;
+        }
+        stack.append(node);
+    }
+    // 栈底是优先级最高的节点，即根
+    m_root = stack.isEmpty() ? -1 : stack.first();
+    while (!stack.isEmpty()) {
+        pull(stack.takeLast());
+    }
+}
+
+void IntervalIndex::update(int row, int startMs, int endMs) {
+    if (row < 0 || row >= m_rowStart.size()) return;
+    erase(m_rowStart[row], row);
+    insert(startMs, endMs, row);
+    m_rowStart[row] = startMs;
+}
+
+void IntervalIndex::collectStab(int node, int timeMs, QVector<int>& rows) const {
+    // 子树中所有字幕都在 timeMs 之前结束，整棵子树剪掉
+    if (node < 0 || m_nodes[node].maxEnd <= timeMs) return;
+    
+    const Node& n = m_nodes[node];
+    collectStab(n.left, timeMs, rows);
+    if (n.start > timeMs) return;  // 右子树的开始时间更晚
+    if (n.end > timeMs) rows.append(n.row);
+    collectStab(n.right, timeMs, rows);
+}
+
+void IntervalIndex::collectOverlapping(int node, int fromMs, int toMs, QVector<int>& rows) const {
+    if (node < 0 || m_nodes[node].maxEnd <= fromMs) return;
+    
+    const Node& n = m_nodes[node];
+    collectOverlapping(n.left, fromMs, toMs, rows);
+    if (n.start >= toMs) return;
+    if (n.end > fromMs) rows.append(n.row);
+    collectOverlapping(n.right, fromMs, toMs, rows);
+}
+
+QVector<int> IntervalIndex::stab(int timeMs) const {
+    QVector<int> rows;
+    collectStab(m_root, timeMs, rows);
+    return rows;
+}
+
+QVector<int> IntervalIndex::overlapping(int fromMs, int toMs) const {
+    QVector<int> rows;
+    if (fromMs < toMs) {
+        collectOverlapping(m_root, fromMs, toMs, rows);
+    }
+    return rows;
+}
+
+int IntervalIndex::firstStartingAtOrAfter(int timeMs) const {
+    int result = -1;
+    int node = m_root;
+    while (node >= 0) {
+        const Node& n = m_nodes[node];
+        if (n.start >= timeMs) {
+            result = n.row;
+            node = n.left;
+        } else {
+            node = n.right;
+        }
+    }
+    return result;
+}
+
+int IntervalIndex::maxEndMs() const {
+    return m_root < 0 ? 0 : m_nodes[m_root].maxEnd;
+}
@@ -0,0 +1,71 @@
+#ifndef INTERVALINDEX_H
+#define INTERVALINDEX_H
+
+#include <QVector>
+#include "subtitle.h"
+
+// 字幕时间区间索引
+// 以 (开始时间, 行号) 为键的 treap，每个节点额外记录子树内最大的结束时间，
+// 可以在 O(log N + k) 内回答"某一时刻正在显示哪些字幕"和"某个时间段内有哪些字幕"，
+// 重叠的字幕也能正确处理。修改单条字幕时间只需 O(log N) 更新，无需重建。
+class IntervalIndex {
+public:
+    IntervalIndex();
+    
+    // 从字幕数组整体构建，O(N log N)
+    void build(const QVector<SubtitleItem>& subtitles);
+    void clear();
+    
+    bool isEmpty() const { return m_root < 0; }
+    int size() const { return m_rowStart.size(); }
+    
+    // 第 row 条字幕的时间被修改
+    void update(int row, int startMs, int endMs);
+    
+    // 在 timeMs 时刻正在显示的字幕（start <= t < end），按开始时间排序
+    QVector<int> stab(int timeMs) const;
+    
+    // 与 [fromMs, toMs) 有重叠的字幕，按开始时间排序
+    QVector<int> overlapping(int fromMs, int toMs) const;
+    
+    // 开始时间不早于 timeMs 的第一条字幕，没有时返回 -1
+    int firstStartingAtOrAfter(int timeMs) const;
+    
+    // 所有字幕中最晚的结束时间
+    int maxEndMs() const;
+
+private:
+    struct Node {
+        int start;
+        int end;
+        int row;
+        int maxEnd;
+        int left;
+        int right;
+        quint32 priority;
+    };
+    
+    int newNode(int start, int end, int row);
+    void pull(int node);
+    bool keyLess(int startA, int rowA, int startB, int rowB) const {
+        return startA < startB || (startA == startB && rowA < rowB);
+    }
+    // 按键把树分成 < (start,row) 和 >= (start,row) 两部分
+    void split(int node, int start, int row, int& left, int& right);
+    int merge(int left, int right);
+    void insert(int start, int end, int row);
+    void erase(int start, int row);
+    
+    void collectStab(int node, int timeMs, QVector<int>& rows) const;
+    void collectOverlapping(int node, int fromMs, int toMs, QVector<int>& rows) const;
+    
+    quint32 nextPriority();
+    
+    QVector<Node> m_nodes;
+    QVector<int> m_freeNodes;
+    QVector<int> m_rowStart;   // 行号 -> 当前索引中的开始时间，用于定位旧键
+    int m_root;
+    quint32 m_seed;
+};
+
+#endif // INTERVALINDEX_H
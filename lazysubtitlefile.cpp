@@ -0,0 +1,155 @@
+#include "lazysubtitlefile.h"
+#include "perftrace.h"
+#include <QFileInfo>
+#include <QSaveFile>
+#include <cstring>
+
+LazySubtitleFile::LazySubtitleFile()
+    : m_encoding(SubtitleEncoding::Utf8)
+    , m_mapped(nullptr)
+    , m_size(0)
+    , m_newline("\n")
+{
+}
+
+LazySubtitleFile::~LazySubtitleFile()
+{
+    close();
+}
+
+bool LazySubtitleFile::open(const QString& filePath, SubtitleEncoding encoding, QString& errorMsg)
+{
+    close();
+    
+    if (!SRTParser::isAsciiCompatible(encoding)) {
+        errorMsg = "仅时间模式不支持该编码，请使用普通方式打开";
+        return false;
+    }
+    
+    {
+        PerfTrace::Scope scope("read");
+        m_file.setFileName(filePath);
+        if (!m_file.open(QIODevice::ReadOnly)) {
+            errorMsg = "无法打开文件: " + filePath;
+            return false;
+        }
+        
+        m_size = m_file.size();
+        m_mapped = m_size > 0 ? m_file.map(0, m_size) : nullptr;
+        if (!m_mapped) {
+            // 某些文件系统不支持映射，退回整体读取
+            m_buffer = m_file.readAll();
+            m_size = m_buffer.size();
+            m_file.close();
+        }
+        scope.setCount(m_size);
+    }
+    
+    const char* data = bytes();
+    const char* firstNewline = static_cast<const char*>(memchr(data, '\n', size_t(m_size)));
+    m_newline = (firstNewline && firstNewline > data && firstNewline[-1] == '\r') ? "\r\n" : "\n";
+    
+    if (SRTParser::scanBlocks(data, m_size, m_cues, m_spans) == 0) {
+        errorMsg = "未找到有效的字幕条目";
+        close();
+        return false;
+    }
+    
+    m_filePath = filePath;
+    m_encoding = encoding;
+    m_textLoaded.fill(false, m_cues.size());
+    return true;
+}
+
+void LazySubtitleFile::close()
+{
+    if (m_mapped) {
+        m_file.unmap(const_cast<uchar*>(m_mapped));
+        m_mapped = nullptr;
+    }
+    m_file.close();
+    m_buffer.clear();
+    m_size = 0;
+    m_filePath.clear();
+    m_cues.clear();
+    m_spans.clear();
+    m_textLoaded.clear();
+}
+
+const char* LazySubtitleFile::bytes() const
+{
+    return m_mapped ? reinterpret_cast<const char*>(m_mapped) : m_buffer.constData();
+}
+
+void LazySubtitleFile::detachFromFile()
+{
+    // 覆盖原文件前把内容复制出来；Windows 上被映射的文件无法替换
+    if (!m_mapped) return;
+    m_buffer = QByteArray(reinterpret_cast<const char*>(m_mapped), m_size);
+    m_file.unmap(const_cast<uchar*>(m_mapped));
+    m_mapped = nullptr;
+    m_file.close();
+}
+
+QString LazySubtitleFile::text(int row)
+{
+    if (row < 0 || row >= m_cues.size()) return QString();
+    if (m_textLoaded[row]) return m_cues[row].text;
+    
+    QString text = SRTParser::decodeText(bytes(), m_spans[row], m_encoding);
+    m_cues[row].text = text;
+    m_textLoaded[row] = true;
+    return text;
+}
+
+bool LazySubtitleFile::save(const QString& filePath, QString& errorMsg)
+{
+    PerfTrace::Scope scope("save");
+    scope.setCount(m_cues.size());
+
+#ifdef Q_OS_WIN
+    if (QFileInfo(filePath).absoluteFilePath() == QFileInfo(m_filePath).absoluteFilePath()) {
+        detachFromFile();
+    }
+#endif
+
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        errorMsg = "无法保存文件: " + filePath;
+        return false;
+    }
+    
+    const char* data = bytes();
+    bool ok = true;
+    QByteArray out;
+    out.reserve(256 * 1024);
+    for (int i = 0; i < m_cues.size(); ++i) {
+        const SubtitleItem& item = m_cues[i];
+        const CueSpan& span = m_spans[i];
+        
+        // 序号和时间行是纯 ASCII，在所有支持的编码中字节相同
+        out += QByteArray::number(i + 1);
+        out += m_newline;
+        out += SRTParser::formatTime(item.startTime).toLatin1();
+        out += " --> ";
+        out += SRTParser::formatTime(item.endTime).toLatin1();
+        out += m_newline;
+        out.append(data + span.textOffset, span.textLength);
+        out += m_newline;
+        if (i < m_cues.size() - 1) {
+            out += m_newline;
+        }
+        
+        if (out.size() >= 192 * 1024) {
+            ok = file.write(out) == out.size();
+            if (!ok) break;
+            out.resize(0);
+        }
+    }
+    
+    if (!ok || file.write(out) != out.size() || !file.commit()) {
+        errorMsg = "无法保存文件: " + filePath;
+        return false;
+    }
+    return true;
+}
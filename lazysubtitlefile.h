@@ -0,0 +1,59 @@
+#ifndef LAZYSUBTITLEFILE_H
+#define LAZYSUBTITLEFILE_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+#include <QVector>
+#include "subtitle.h"
+
+// 仅时间加载模式
+// 文件映射到内存后按字节扫描，只解析序号和时间并记录每条文本的字节位置，
+// 文本在第一次访问时才解码。平移、缩放、同步等只改时间的批量操作完成后，
+// save() 直接复制原始文本字节，不经过解码和重新编码，输出保持原文件编码。
+class LazySubtitleFile {
+public:
+    LazySubtitleFile();
+    ~LazySubtitleFile();
+    
+    // 只支持与 ASCII 兼容的编码（UTF-8、GBK/GB18030）
+    bool open(const QString& filePath, SubtitleEncoding encoding, QString& errorMsg);
+    void close();
+    
+    QString filePath() const { return m_filePath; }
+    SubtitleEncoding encoding() const { return m_encoding; }
+    int size() const { return m_cues.size(); }
+    
+    // 只含序号和时间的字幕数组（text 为空），可以直接交给 SRTParser::shiftTime 等函数
+    QVector<SubtitleItem>& cues() { return m_cues; }
+    const QVector<SubtitleItem>& cues() const { return m_cues; }
+    
+    const CueSpan& span(int row) const { return m_spans[row]; }
+    
+    // 第 row 条字幕的文本，首次访问时解码并缓存
+    QString text(int row);
+    
+    // 按当前时间写出，文本字节原样复制；可以写回原文件
+    bool save(const QString& filePath, QString& errorMsg);
+
+private:
+    LazySubtitleFile(const LazySubtitleFile&) = delete;
+    LazySubtitleFile& operator=(const LazySubtitleFile&) = delete;
+    
+    const char* bytes() const;
+    void detachFromFile();
+    
+    QString m_filePath;
+    SubtitleEncoding m_encoding;
+    QFile m_file;
+    const uchar* m_mapped;       // 映射失败或已脱离文件时为空，改用 m_buffer
+    QByteArray m_buffer;
+    qint64 m_size;
+    QByteArray m_newline;        // 沿用原文件的换行风格
+    
+    QVector<SubtitleItem> m_cues;
+    QVector<CueSpan> m_spans;
+    QVector<bool> m_textLoaded;
+};
+
+#endif // LAZYSUBTITLEFILE_H
@@ -0,0 +1,694 @@
+#include "libraryindex.h"
+#include "perftrace.h"
+#include <QDateTime>
+#include <QDir>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QHash>
+#include <QSaveFile>
+#include <QtAlgorithms>
+#include <QThreadPool>
+#include <QtConcurrent/QtConcurrentMap>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+const quint32 kIndexMagic = 0x31494C53;     // "SLI1"
+const quint32 kByteOrderMark = 0x01020304;
+const quint32 kIndexVersion = 1;
+const int kMaxQueryTerms = 32;              // 每个查询词占命中掩码的一位
+
+// BM25 参数
+const double kTermSaturation = 1.2;
+const double kLengthNormalization = 0.75;
+
+// 索引文件依次为：文件头、文件表、字幕表、词表、倒排表、字符串段、文本段，各段按 8 字节对齐，
+// 记录直接在映射的内存上读取。按本机字节序写出，字节序不同的机器上视为无效索引，重新建立即可。
+struct IndexHeader {
+    quint32 magic;
+    quint32 byteOrder;
+    quint32 version;
+    quint32 encoding;
+    quint32 fileCount;
+    quint32 cueCount;
+    quint32 termCount;
+    quint32 reserved;
+    quint64 totalTokens;
+    quint64 filesOffset;
+    quint64 cuesOffset;
+    quint64 termsOffset;
+    quint64 postingsOffset;
+    quint64 postingsSize;
+    quint64 stringsOffset;
+    quint64 stringsSize;
+    quint64 textOffset;
+    quint64 textSize;
+};
+
+struct FileRecord {
+    qint64 modified;        // 修改时间（毫秒）
+    qint64 size;
+    quint32 pathOffset;     // 相对根目录的路径（UTF-8），在字符串段中
+    quint32 pathLength;
+    quint32 firstCue;       // 各文件的字幕在字幕表中连续存放
+    quint32 cueCount;
+};
+
+struct CueRecord {
+    quint64 textOffset;     // 字幕文本（UTF-8），在文本段中
+    quint32 textLength;
+    qint32 startMs;
+    quint32 tokenCount;     // 文本切出的词数，BM25 的文档长度
+    quint32 reserved;
+};
+
+struct TermRecord {
+    quint64 postingOffset;  // (字幕编号差值, 词频) 的变长整数序列，字幕编号升序
+    quint32 postingSize;
+    quint32 keyOffset;      // 词（UTF-8），在字符串段中；词表按字节升序排列
+    quint32 keyLength;
+    quint32 cueCount;       // 含有该词的字幕数
+};
+
+static_assert(sizeof(IndexHeader) == 112, "索引文件头大小不能改变");
+static_assert(sizeof(FileRecord) == 32 && sizeof(CueRecord) == 24 && sizeof(TermRecord) == 24,
+              "索引记录大小不能改变");
+
+quint64 align8(quint64 offset) {
+    return (offset + 7) & ~quint64(7);
+}
+
+bool sectionFits(quint64 offset, quint64 count, quint64 recordSize, qint64 fileSize) {
+    return offset % 8 == 0 && offset <= quint64(fileSize) && count <= (quint64(fileSize) - offset) / recordSize;
+}
+
+void appendVarint(QByteArray& out, quint32 value) {
+    while (value >= 0x80) {
+        out.append(char((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.append(char(value));
+}
+
+bool readVarint(const uchar*& p, const uchar* end, quint32& value) {
+    value = 0;
+    for (int shift = 0; shift < 35 && p < end; shift += 7) {
+        const uchar byte = *p++;
+        value |= quint32(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+// 汉字、假名和谚文按字索引，其余的字母数字按词索引
+bool isCjk(ushort u) {
+    return (u >= 0x4E00 && u <= 0x9FFF) || (u >= 0x3400 && u <= 0x4DBF) || (u >= 0xF900 && u <= 0xFAFF)
+        || (u >= 0x3040 && u <= 0x30FF) || (u >= 0xAC00 && u <= 0xD7AF);
+}
+
+// 把文本切成索引词，依次交给 emit(词, 是否按前缀匹配)
+// 连续汉字输出相邻两字；建索引时末字另作单字，查询时只有一个字的汉字串按前缀匹配（单字和以它开头的两字词）
+template <typename Emit>
+void tokenize(const QString& text, bool forQuery, Emit emit) {
+    const int length = text.size();
+    int i = 0;
+    while (i < length) {
+        const QChar ch = text[i];
+        if (isCjk(ch.unicode())) {
+            int end = i + 1;
+            while (end < length && isCjk(text[end].unicode())) ++end;
+            if (end - i == 1) {
+                emit(text.mid(i, 1), forQuery);
+            } else {
+                for (int k = i; k + 1 < end; ++k) {
+                    emit(text.mid(k, 2), false);
+                }
+                if (!forQuery) emit(text.mid(end - 1, 1), false);
+            }
+            i = end;
+        } else if (ch.isLetterOrNumber()) {
+            int end = i + 1;
+            while (end < length && text[end].isLetterOrNumber() && !isCjk(text[end].unicode())) ++end;
+            emit(text.mid(i, end - i).toCaseFolded(), false);
+            i = end;
+        } else {
+            ++i;
+        }
+    }
+}
+
+int compareKey(const char* a, int aLength, const char* b, int bLength) {
+    int result = std::memcmp(a, b, size_t(qMin(aLength, bLength)));
+    return result != 0 ? result : aLength - bLength;
+}
+
+// 映射内存上的只读视图；load() 已检查过各段和文件表、词表的范围
+struct IndexView {
+    const uchar* data;
+    const IndexHeader* header;
+    const FileRecord* files;
+    const CueRecord* cues;
+    const TermRecord* terms;
+    const uchar* postings;
+    const char* strings;
+    const char* text;
+    
+    explicit IndexView(const uchar* base)
+        : data(base)
+        , header(reinterpret_cast<const IndexHeader*>(base))
+        , files(reinterpret_cast<const FileRecord*>(base + header->filesOffset))
+        , cues(reinterpret_cast<const CueRecord*>(base + header->cuesOffset))
+        , terms(reinterpret_cast<const TermRecord*>(base + header->termsOffset))
+        , postings(base + header->postingsOffset)
+        , strings(reinterpret_cast<const char*>(base + header->stringsOffset))
+        , text(reinterpret_cast<const char*>(base + header->textOffset))
+    {
+    }
+    
+    const char* key(int term) const { return strings + terms[term].keyOffset; }
+    
+    QString path(int file) const {
+        return QString::fromUtf8(strings + files[file].pathOffset, files[file].pathLength);
+    }
+    
+    bool cueTextValid(quint32 cue) const {
+        const CueRecord& record = cues[cue];
+        return record.textOffset <= header->textSize && record.textLength <= header->textSize - record.textOffset;
+    }
+    
+    QString cueText(quint32 cue) const {
+        if (!cueTextValid(cue)) return QString();
+        return QString::fromUtf8(text + cues[cue].textOffset, cues[cue].textLength);
+    }
+    
+    // 包含第 cue 条字幕的文件
+    int fileOf(quint32 cue) const {
+        const FileRecord* end = files + header->fileCount;
+        const FileRecord* found = std::upper_bound(files, end, cue, [](quint32 value, const FileRecord& record) {
+            return value < record.firstCue;
+        });
+        return int(found - files) - 1;
+    }
+    
+    // 第一个不小于 key 的词
+    int lowerBound(const QByteArray& key) const {
+        int low = 0;
+        int high = int(header->termCount);
+        while (low < high) {
+            int middle = low + (high - low) / 2;
+            if (compareKey(this->key(middle), int(terms[middle].keyLength), key.constData(), key.size()) < 0) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+        return low;
+    }
+    
+    bool keyStartsWith(int term, const QByteArray& prefix) const {
+        return int(terms[term].keyLength) >= prefix.size()
+            && std::memcmp(key(term), prefix.constData(), size_t(prefix.size())) == 0;
+    }
+    
+    template <typename Visit>
+    void forEachPosting(int term, Visit visit) const {
+        const uchar* p = postings + terms[term].postingOffset;
+        const uchar* end = p + terms[term].postingSize;
+        quint32 cue = 0;
+        quint32 delta = 0;
+        quint32 frequency = 0;
+        while (p < end && readVarint(p, end, delta) && readVarint(p, end, frequency)) {
+            cue += delta;
+            if (cue >= header->cueCount) return;
+            visit(cue, frequency);
+        }
+    }
+};
+
+bool isValidIndex(const uchar* data, qint64 size) {
+    if (size < qint64(sizeof(IndexHeader))) return false;
+    const IndexHeader* header = reinterpret_cast<const IndexHeader*>(data);
+    if (header->magic != kIndexMagic || header->byteOrder != kByteOrderMark || header->version != kIndexVersion) {
+        return false;
+    }
+    if (!sectionFits(header->filesOffset, header->fileCount, sizeof(FileRecord), size)
+        || !sectionFits(header->cuesOffset, header->cueCount, sizeof(CueRecord), size)
+        || !sectionFits(header->termsOffset, header->termCount, sizeof(TermRecord), size)
+        || !sectionFits(header->postingsOffset, header->postingsSize, 1, size)
+        || !sectionFits(header->stringsOffset, header->stringsSize, 1, size)
+        || !sectionFits(header->textOffset, header->textSize, 1, size)) {
+        return false;
+    }
+    
+    IndexView view(data);
+    quint32 nextCue = 0;
+    for (quint32 i = 0; i < header->fileCount; ++i) {
+        const FileRecord& file = view.files[i];
+        if (quint64(file.pathOffset) + file.pathLength > header->stringsSize || file.firstCue != nextCue
+            || quint64(file.firstCue) + file.cueCount > header->cueCount) {
+            return false;
+        }
+        nextCue = file.firstCue + file.cueCount;
+    }
+    for (quint32 i = 0; i < header->termCount; ++i) {
+        const TermRecord& term = view.terms[i];
+        if (quint64(term.keyOffset) + term.keyLength > header->stringsSize
+            || term.postingOffset > header->postingsSize
+            || term.postingSize > header->postingsSize - term.postingOffset) {
+            return false;
+        }
+    }
+    return nextCue == header->cueCount;
+}
+
+struct DiskFile {
+    QString relativePath;
+    qint64 modified;
+    qint64 size;
+};
+
+// 在线程池中解析的一个文件，字幕编号为文件内的行号
+struct ParsedFile {
+    DiskFile file;
+    QString errorMsg;
+    QVector<qint32> starts;
+    QVector<QByteArray> texts;                      // UTF-8
+    QVector<quint32> tokenCounts;
+    QHash<QByteArray, QVector<quint64>> postings;   // 词 → (行号 << 32 | 词频)，行号升序
+};
+
+ParsedFile parseFile(const QString& rootPath, const DiskFile& file, SubtitleEncoding encoding) {
+    ParsedFile parsed;
+    parsed.file = file;
+    QVector<SubtitleItem> subtitles;
+    if (!SRTParser::parse(QDir(rootPath).filePath(file.relativePath), subtitles, parsed.errorMsg, encoding)) {
+        return parsed;
+    }
+    
+    parsed.starts.reserve(subtitles.size());
+    parsed.texts.reserve(subtitles.size());
+    parsed.tokenCounts.reserve(subtitles.size());
+    QHash<QString, int> counts;
+    for (int row = 0; row < subtitles.size(); ++row) {
+        const SubtitleItem& item = subtitles[row];
+        counts.clear();
+        quint32 tokens = 0;
+        tokenize(item.text, false, [&counts, &tokens](const QString& term, bool) {
+            ++counts[term];
+            ++tokens;
+        });
+        for (auto it = counts.constBegin(); it != counts.constEnd(); ++it) {
+            parsed.postings[it.key().toUtf8()].append(quint64(row) << 32 | quint32(it.value()));
+        }
+        parsed.starts.append(item.startTime.msecsSinceStartOfDay());
+        parsed.texts.append(item.text.toUtf8());
+        parsed.tokenCounts.append(tokens);
+    }
+    return parsed;
+}
+
+struct QueryTerm {
+    QByteArray key;
+    bool prefix;
+};
+
+struct Candidate {
+    quint32 cue;
+    double score;
+    quint32 termMask;       // 第 q 位为 1 表示命中了第 q 个查询词
+    
+    Candidate() : cue(0), score(0), termMask(0) {}
+};
+
+bool writeSection(QSaveFile& file, const void* data, quint64 size) {
+    static const char padding[8] = {};
+    const quint64 padded = align8(size);
+    return file.write(static_cast<const char*>(data), qint64(size)) == qint64(size)
+        && file.write(padding, qint64(padded - size)) == qint64(padded - size);
+}
+
+}
+
+QString LibraryIndex::UpdateStats::summary() const {
+    QString text = QString("索引了 %1 个文件、%2 条字幕：重新解析 %3 个，沿用 %4 个，移除 %5 个")
+                       .arg(files).arg(cues).arg(parsed).arg(reused).arg(removed);
+    if (!errors.isEmpty()) {
+        text += QString("，%1 个无法解析").arg(errors.size());
+    }
+    return text;
+}
+
+LibraryIndex::LibraryIndex(const QString& rootPath, const QString& indexPath)
+    : m_rootPath(QDir(rootPath).absolutePath())
+    , m_indexPath(indexPath.isEmpty() ? defaultIndexPath(rootPath) : indexPath)
+    , m_data(nullptr)
+    , m_size(0)
+{
+}
+
+LibraryIndex::~LibraryIndex() {
+    close();
+}
+
+QString LibraryIndex::defaultIndexPath(const QString& rootPath) {
+    return QDir(rootPath).filePath(".srtindex");
+}
+
+bool LibraryIndex::load(QString& errorMsg) {
+    close();
+    
+    m_file.setFileName(m_indexPath);
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        errorMsg = "无法打开索引文件: " + m_indexPath;
+        return false;
+    }
+    m_size = m_file.size();
+    const uchar* data = m_size > 0 ? m_file.map(0, m_size) : nullptr;
+    if (!data || !isValidIndex(data, m_size)) {
+        if (data) m_file.unmap(const_cast<uchar*>(data));
+        m_file.close();
+        m_size = 0;
+        errorMsg = "索引文件无效或版本不符，需要重新建立: " + m_indexPath;
+        return false;
+    }
+    m_data = data;
+    return true;
+}
+
+void LibraryIndex::close() {
+    if (m_data) {
+        m_file.unmap(const_cast<uchar*>(m_data));
+        m_data = nullptr;
+    }
+    m_file.close();
+    m_size = 0;
+}
+
+int LibraryIndex::fileCount() const {
+    return m_data ? int(IndexView(m_data).header->fileCount) : 0;
+}
+
+int LibraryIndex::cueCount() const {
+    return m_data ? int(IndexView(m_data).header->cueCount) : 0;
+}
+
+bool LibraryIndex::update(SubtitleEncoding encoding, UpdateStats& stats, QString& errorMsg, QThreadPool* pool) {
+    stats = UpdateStats();
+    QDir root(m_rootPath);
+    if (!root.exists()) {
+        errorMsg = "目录不存在: " + m_rootPath;
+        return false;
+    }
+    PerfTrace::Scope scope("libraryIndex");
+    
+    // 目录中的字幕文件，按相对路径排序
+    QVector<DiskFile> diskFiles;
+    QDirIterator iterator(m_rootPath, QStringList{"*.srt"}, QDir::Files, QDirIterator::Subdirectories);
+    while (iterator.hasNext()) {
+        iterator.next();
+        const QFileInfo info = iterator.fileInfo();
+        diskFiles.append(DiskFile{root.relativeFilePath(info.filePath()), info.lastModified().toMSecsSinceEpoch(),
+                                  info.size()});
+    }
+    std::sort(diskFiles.begin(), diskFiles.end(), [](const DiskFile& a, const DiskFile& b) {
+        return a.relativePath < b.relativePath;
+    });
+    
+    // 原索引中修改时间和大小都没有变的文件直接沿用；编码改变时全部重新解析
+    const bool reuseOld = m_data && IndexView(m_data).header->encoding == quint32(encoding);
+    QHash<QString, int> oldFiles;
+    if (reuseOld) {
+        IndexView old(m_data);
+        for (quint32 i = 0; i < old.header->fileCount; ++i) {
+            oldFiles.insert(old.path(int(i)), int(i));
+        }
+    }
+    QVector<int> reusedFrom(diskFiles.size(), -1);
+    QVector<DiskFile> jobs;
+    int stillPresent = 0;
+    for (int i = 0; i < diskFiles.size(); ++i) {
+        const DiskFile& file = diskFiles[i];
+        auto found = oldFiles.constFind(file.relativePath);
+        if (found != oldFiles.constEnd()) {
+            ++stillPresent;
+            const FileRecord& record = IndexView(m_data).files[found.value()];
+            if (record.modified == file.modified && record.size == file.size) {
+                reusedFrom[i] = found.value();
+                continue;
+            }
+        }
+        jobs.append(file);
+    }
+    stats.removed = oldFiles.size() - stillPresent;
+    
+    const QString rootPath = m_rootPath;
+    auto parseOne = [rootPath, encoding](const DiskFile& file) {
+        return parseFile(rootPath, file, encoding);
+    };
+    QVector<ParsedFile> parsedFiles;
+    if (pool && jobs.size() > 1) {
+        parsedFiles = QtConcurrent::blockingMapped<QVector<ParsedFile>>(pool, jobs, parseOne);
+    } else {
+        for (const DiskFile& file : jobs) {
+            parsedFiles.append(parseOne(file));
+        }
+    }
+    
+    // 按相对路径顺序排出新的文件表和字幕表
+    QVector<FileRecord> files;
+    QVector<CueRecord> cues;
+    QByteArray strings;
+    QByteArray text;
+    QHash<QByteArray, QVector<quint64>> postings;   // 词 → (新字幕编号 << 32 | 词频)
+    QVector<qint64> oldCueMap;                      // 原字幕编号 → 新编号，-1 为不再使用
+    quint64 totalTokens = 0;
+    if (reuseOld) {
+        oldCueMap.fill(-1, int(IndexView(m_data).header->cueCount));
+    }
+    
+    int nextJob = 0;
+    for (int i = 0; i < diskFiles.size(); ++i) {
+        FileRecord record;
+        const QByteArray path = diskFiles[i].relativePath.toUtf8();
+        record.modified = diskFiles[i].modified;
+        record.size = diskFiles[i].size;
+        record.pathOffset = quint32(strings.size());
+        record.pathLength = quint32(path.size());
+        record.firstCue = quint32(cues.size());
+        
+        if (reusedFrom[i] >= 0) {
+            IndexView old(m_data);
+            const FileRecord& oldRecord = old.files[reusedFrom[i]];
+            for (quint32 k = 0; k < oldRecord.cueCount; ++k) {
+                const quint32 oldCue = oldRecord.firstCue + k;
+                CueRecord cue = old.cues[oldCue];
+                cue.textOffset = quint64(text.size());
+                if (old.cueTextValid(oldCue)) {
+                    text.append(old.text + old.cues[oldCue].textOffset, int(cue.textLength));
+                } else {
+                    cue.textLength = 0;
+                }
+                oldCueMap[int(oldCue)] = cues.size();
+                totalTokens += cue.tokenCount;
+                cues.append(cue);
+            }
+            ++stats.reused;
+        } else {
+            const ParsedFile& parsed = parsedFiles[nextJob++];
+            if (!parsed.errorMsg.isEmpty()) {
+                stats.errors << diskFiles[i].relativePath + "：" + parsed.errorMsg;
+                continue;
+            }
+            const quint64 firstCue = quint64(cues.size());
+            for (int row = 0; row < parsed.starts.size(); ++row) {
+                CueRecord cue;
+                cue.textOffset = quint64(text.size());
+                cue.textLength = quint32(parsed.texts[row].size());
+                cue.startMs = parsed.starts[row];
+                cue.tokenCount = parsed.tokenCounts[row];
+                cue.reserved = 0;
+                text.append(parsed.texts[row]);
+                totalTokens += cue.tokenCount;
+                cues.append(cue);
+            }
+            for (auto it = parsed.postings.constBegin(); it != parsed.postings.constEnd(); ++it) {
+                QVector<quint64>& list = postings[it.key()];
+                for (quint64 entry : it.value()) {
+                    list.append(entry + (firstCue << 32));
+                }
+            }
+            ++stats.parsed;
+        }
+        record.cueCount = quint32(cues.size()) - record.firstCue;
+        strings.append(path);
+        files.append(record);
+    }
+    
+    // 沿用文件的倒排表：遍历原词表，把仍在使用的字幕换成新编号
+    if (stats.reused > 0) {
+        IndexView old(m_data);
+        for (quint32 term = 0; term < old.header->termCount; ++term) {
+            QVector<quint64>* list = nullptr;
+            old.forEachPosting(int(term), [&](quint32 cue, quint32 frequency) {
+                const qint64 mapped = oldCueMap[int(cue)];
+                if (mapped < 0) return;
+                if (!list) list = &postings[QByteArray(old.key(int(term)), int(old.terms[term].keyLength))];
+                list->append(quint64(mapped) << 32 | frequency);
+            });
+        }
+    }
+    
+    // 词表按字节升序，倒排表按字幕编号升序编码
+    QVector<QByteArray> keys;
+    keys.reserve(postings.size());
+    for (auto it = postings.constBegin(); it != postings.constEnd(); ++it) {
+        keys.append(it.key());
+    }
+    std::sort(keys.begin(), keys.end());
+    QVector<TermRecord> terms;
+    terms.reserve(keys.size());
+    QByteArray postingData;
+    for (const QByteArray& key : keys) {
+        QVector<quint64>& list = postings[key];
+        std::sort(list.begin(), list.end());
+        TermRecord record;
+        record.postingOffset = quint64(postingData.size());
+        record.keyOffset = quint32(strings.size());
+        record.keyLength = quint32(key.size());
+        record.cueCount = quint32(list.size());
+        quint32 previous = 0;
+        for (quint64 entry : list) {
+            const quint32 cue = quint32(entry >> 32);
+            appendVarint(postingData, cue - previous);
+            appendVarint(postingData, quint32(entry));
+            previous = cue;
+        }
+        record.postingSize = quint32(quint64(postingData.size()) - record.postingOffset);
+        strings.append(key);
+        terms.append(record);
+    }
+    
+    IndexHeader header;
+    std::memset(&header, 0, sizeof(header));
+    header.magic = kIndexMagic;
+    header.byteOrder = kByteOrderMark;
+    header.version = kIndexVersion;
+    header.encoding = quint32(encoding);
+    header.fileCount = quint32(files.size());
+    header.cueCount = quint32(cues.size());
+    header.termCount = quint32(terms.size());
+    header.totalTokens = totalTokens;
+    header.filesOffset = sizeof(IndexHeader);
+    header.cuesOffset = align8(header.filesOffset + quint64(files.size()) * sizeof(FileRecord));
+    header.termsOffset = align8(header.cuesOffset + quint64(cues.size()) * sizeof(CueRecord));
+    header.postingsOffset = align8(header.termsOffset + quint64(terms.size()) * sizeof(TermRecord));
+    header.postingsSize = quint64(postingData.size());
+    header.stringsOffset = align8(header.postingsOffset + header.postingsSize);
+    header.stringsSize = quint64(strings.size());
+    header.textOffset = align8(header.stringsOffset + header.stringsSize);
+    header.textSize = quint64(text.size());
+    
+    // 原索引读完后才解除映射，Windows 上映射中的文件不能被替换
+    close();
+    QSaveFile output(m_indexPath);
+    bool ok = output.open(QIODevice::WriteOnly)
+        && writeSection(output, &header, sizeof(header))
+        && writeSection(output, files.constData(), quint64(files.size()) * sizeof(FileRecord))
+        && writeSection(output, cues.constData(), quint64(cues.size()) * sizeof(CueRecord))
+        && writeSection(output, terms.constData(), quint64(terms.size()) * sizeof(TermRecord))
+        && writeSection(output, postingData.constData(), header.postingsSize)
+        && writeSection(output, strings.constData(), header.stringsSize)
+        && writeSection(output, text.constData(), header.textSize)
+        && output.commit();
+    if (!ok) {
+        errorMsg = "无法写入索引文件: " + m_indexPath;
+        QString ignored;
+        load(ignored);
+        return false;
+    }
+    
+    stats.files = files.size();
+    stats.cues = cues.size();
+    stats.terms = terms.size();
+    scope.setCount(stats.cues);
+    return load(errorMsg);
+}
+
+QVector<LibraryIndex::Hit> LibraryIndex::search(const QString& query, int limit) const {
+    QVector<Hit> hits;
+    if (!m_data || limit <= 0) return hits;
+    
+    const IndexView view(m_data);
+    QVector<QueryTerm> terms;
+    tokenize(query, true, [&terms](const QString& term, bool prefix) {
+        QByteArray key = term.toUtf8();
+        for (const QueryTerm& existing : terms) {
+            if (existing.key == key && existing.prefix == prefix) return;
+        }
+        if (terms.size() < kMaxQueryTerms) terms.append(QueryTerm{key, prefix});
+    });
+    if (terms.isEmpty() || view.header->cueCount == 0) return hits;
+    
+    PerfTrace::Scope scope("librarySearch");
+    const double cueTotal = double(view.header->cueCount);
+    const double averageLength = qMax(1.0, double(view.header->totalTokens) / cueTotal);
+    QHash<quint32, Candidate> candidates;
+    for (int q = 0; q < terms.size(); ++q) {
+        const QueryTerm& queryTerm = terms[q];
+        for (int term = view.lowerBound(queryTerm.key); term < int(view.header->termCount); ++term) {
+            if (queryTerm.prefix ? !view.keyStartsWith(term, queryTerm.key)
+                                 : compareKey(view.key(term), int(view.terms[term].keyLength),
+                                              queryTerm.key.constData(), queryTerm.key.size()) != 0) {
+                break;
+            }
+            const double documentCount = view.terms[term].cueCount;
+            const double idf = std::log(1.0 + (cueTotal - documentCount + 0.5) / (documentCount + 0.5));
+            view.forEachPosting(term, [&](quint32 cue, quint32 frequency) {
+                const double length = view.cues[cue].tokenCount / averageLength;
+                const double tf = frequency * (kTermSaturation + 1.0)
+                    / (frequency + kTermSaturation * (1.0 - kLengthNormalization + kLengthNormalization * length));
+                Candidate& candidate = candidates[cue];
+                candidate.cue = cue;
+                candidate.score += idf * tf;
+                candidate.termMask |= quint32(1) << q;
+            });
+            if (!queryTerm.prefix) break;
+        }
+    }
+    
+    // 命中的查询词多的在前，其次按得分，得分相同时按文件和字幕顺序
+    QVector<Candidate> ranked;
+    ranked.reserve(candidates.size());
+    for (auto it = candidates.constBegin(); it != candidates.constEnd(); ++it) {
+        ranked.append(it.value());
+    }
+    auto better = [](const Candidate& a, const Candidate& b) {
+        const int aMatched = qPopulationCount(a.termMask);
+        const int bMatched = qPopulationCount(b.termMask);
+        if (aMatched != bMatched) return aMatched > bMatched;
+        if (a.score != b.score) return a.score > b.score;
+        return a.cue < b.cue;
+    };
+    const int count = qMin(limit, ranked.size());
+    std::partial_sort(ranked.begin(), ranked.begin() + count, ranked.end(), better);
+    
+    const QDir root(m_rootPath);
+    hits.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        const Candidate& candidate = ranked[i];
+        const int file = view.fileOf(candidate.cue);
+        if (file < 0) continue;
+        Hit hit;
+        hit.filePath = root.filePath(view.path(file));
+        hit.row = int(candidate.cue - view.files[file].firstCue);
+        hit.startMs = view.cues[candidate.cue].startMs;
+        hit.text = view.cueText(candidate.cue);
+        hit.score = candidate.score;
+        hit.matchedTerms = qPopulationCount(candidate.termMask);
+        hits.append(hit);
+    }
+    scope.setCount(candidates.size());
+    return hits;
+}
@@ -0,0 +1,78 @@
+#ifndef LIBRARYINDEX_H
+#define LIBRARYINDEX_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include "subtitle.h"
+
+class QThreadPool;
+
+// 字幕库全文索引：目录树下所有 .srt 文件的倒排索引，保存为一个文件（默认在根目录下的 .srtindex），
+// 打开时整体映射到内存，查询只做二分查找和解码倒排表，不读取字幕文件。
+// 拉丁字母和数字按词（转为小写）索引，汉字和假名按相邻两字索引，连续汉字的最后一个字另按单字索引，
+// 单字查询也能命中。更新时按修改时间和大小判断文件是否变化，未变化的文件直接沿用原有的倒排表，
+// 只有新增和改动的文件在线程池中并行解析。结果按 BM25 排序，命中的查询词多的在前。
+class LibraryIndex {
+public:
+    struct Hit {
+        QString filePath;       // 绝对路径
+        int row;                // 文件中的第几条字幕（从 0 开始）
+        int startMs;
+        QString text;
+        double score;
+        int matchedTerms;       // 命中的查询词个数
+        
+        Hit() : row(0), startMs(0), score(0), matchedTerms(0) {}
+    };
+    
+    struct UpdateStats {
+        int files;              // 索引中的文件数
+        int parsed;             // 新增或有变化、重新解析的文件
+        int reused;             // 未变化、沿用原索引的文件
+        int removed;            // 已从目录中删除的文件
+        int cues;
+        int terms;
+        QStringList errors;     // 无法解析的文件，不计入索引
+        
+        UpdateStats() : files(0), parsed(0), reused(0), removed(0), cues(0), terms(0) {}
+        QString summary() const;
+    };
+    
+    // indexPath 为空时使用 defaultIndexPath(rootPath)
+    explicit LibraryIndex(const QString& rootPath, const QString& indexPath = QString());
+    ~LibraryIndex();
+    
+    static QString defaultIndexPath(const QString& rootPath);
+    
+    QString rootPath() const { return m_rootPath; }
+    QString indexPath() const { return m_indexPath; }
+    
+    // 映射已有的索引文件；文件不存在或格式不符时返回 false，可以调用 update() 重建
+    bool load(QString& errorMsg);
+    void close();
+    bool isLoaded() const { return m_data != nullptr; }
+    
+    int fileCount() const;
+    int cueCount() const;
+    
+    // 扫描目录并写出新的索引，完成后重新映射。编码与原索引不同时全部重新解析。pool 为空时单线程解析
+    bool update(SubtitleEncoding encoding, UpdateStats& stats, QString& errorMsg, QThreadPool* pool = nullptr);
+    
+    // 按相关度返回最多 limit 条结果；索引未加载时返回空
+    QVector<Hit> search(const QString& query, int limit = 100) const;
+
+private:
+    LibraryIndex(const LibraryIndex&) = delete;
+    LibraryIndex& operator=(const LibraryIndex&) = delete;
+    
+    QString m_rootPath;
+    QString m_indexPath;
+    QFile m_file;
+    const uchar* m_data;        // 映射的索引文件，未加载时为空
+    qint64 m_size;
+};
+
+#endif // LIBRARYINDEX_H
@@ -0,0 +1,231 @@
+#include "librarysearchdialog.h"
+#include "perftrace.h"
+#include <QDir>
+#include <QFileDialog>
+#include <QFileInfo>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QMessageBox>
+#include <QVBoxLayout>
+#include <QtConcurrent/QtConcurrentRun>
+
+namespace {
+
+const int kResultLimit = 200;
+
+enum ResultColumn {
+    FileColumn,
+    IndexColumn,
+    TimeColumn,
+    TextColumn,
+    ColumnCount
+};
+
+}
+
+LibrarySearchDialog::LibrarySearchDialog(QThreadPool* pool, QWidget* parent)
+    : QDialog(parent)
+    , m_pool(pool)
+    , m_encoding(SubtitleEncoding::Utf8)
+    , m_updateWatcher(new QFutureWatcher<UpdateResult>(this))
+{
+    setWindowTitle("搜索字幕库");
+    resize(1000, 600);
+    setupUI();
+    connect(m_updateWatcher, &QFutureWatcher<UpdateResult>::finished, this, &LibrarySearchDialog::onUpdateFinished);
+}
+
+LibrarySearchDialog::~LibrarySearchDialog()
+{
+    // 后台更新使用 m_index，必须等它结束
+    m_updateWatcher->waitForFinished();
+}
+
+void LibrarySearchDialog::setupUI()
+{
+    QVBoxLayout* mainLayout = new QVBoxLayout(this);
+    
+    QHBoxLayout* rootLayout = new QHBoxLayout();
+    rootLayout->addWidget(new QLabel("字幕库目录：", this));
+    m_rootEdit = new QLineEdit(this);
+    m_rootEdit->setReadOnly(true);
+    m_rootEdit->setPlaceholderText("选择包含 SRT 文件的目录");
+    rootLayout->addWidget(m_rootEdit);
+    m_browseButton = new QPushButton("浏览...", this);
+    rootLayout->addWidget(m_browseButton);
+    m_updateButton = new QPushButton("更新索引", this);
+    m_updateButton->setToolTip("只重新解析新增和修改过的文件");
+    m_updateButton->setEnabled(false);
+    rootLayout->addWidget(m_updateButton);
+    mainLayout->addLayout(rootLayout);
+    
+    m_queryEdit = new QLineEdit(this);
+    m_queryEdit->setPlaceholderText("输入要搜索的词语，汉字和英文单词都可以");
+    m_queryEdit->setClearButtonEnabled(true);
+    m_queryEdit->setEnabled(false);
+    mainLayout->addWidget(m_queryEdit);
+    
+    m_summaryLabel = new QLabel(this);
+    m_summaryLabel->setWordWrap(true);
+    m_summaryLabel->setStyleSheet("color: #666; padding: 5px; background: #f0f0f0; border-radius: 3px;");
+    m_summaryLabel->setText("请选择字幕库目录");
+    mainLayout->addWidget(m_summaryLabel);
+    
+    m_resultTable = new QTableWidget(0, ColumnCount, this);
+    m_resultTable->setHorizontalHeaderLabels({"文件", "序号", "开始时间", "文本"});
+    m_resultTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    m_resultTable->setSelectionBehavior(QAbstractItemView::SelectRows);
+    m_resultTable->setSelectionMode(QAbstractItemView::SingleSelection);
+    m_resultTable->setColumnWidth(FileColumn, 260);
+    m_resultTable->setColumnWidth(IndexColumn, 60);
+    m_resultTable->setColumnWidth(TimeColumn, 110);
+    m_resultTable->horizontalHeader()->setStretchLastSection(true);
+    m_resultTable->verticalHeader()->setVisible(false);
+    m_resultTable->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+    m_resultTable->setWordWrap(false);
+    mainLayout->addWidget(m_resultTable);
+    
+    QHBoxLayout* buttonLayout = new QHBoxLayout();
+    QLabel* hintLabel = new QLabel("双击结果在编辑器中打开并定位到该条字幕", this);
+    hintLabel->setStyleSheet("color: gray; font-size: 10pt;");
+    buttonLayout->addWidget(hintLabel);
+    buttonLayout->addStretch();
+    QPushButton* closeButton = new QPushButton("关闭", this);
+    buttonLayout->addWidget(closeButton);
+    mainLayout->addLayout(buttonLayout);
+    
+    connect(m_browseButton, &QPushButton::clicked, this, &LibrarySearchDialog::onBrowse);
+    connect(m_updateButton, &QPushButton::clicked, this, &LibrarySearchDialog::onUpdateIndex);
+    connect(m_queryEdit, &QLineEdit::textChanged, this, &LibrarySearchDialog::onSearch);
+    connect(m_resultTable, &QTableWidget::cellDoubleClicked, this, &LibrarySearchDialog::onResultActivated);
+    connect(closeButton, &QPushButton::clicked, this, &QDialog::close);
+}
+
+void LibrarySearchDialog::onBrowse()
+{
+    QString rootPath = QFileDialog::getExistingDirectory(this, "选择字幕库目录", m_rootEdit->text());
+    if (rootPath.isEmpty()) return;
+    setRoot(rootPath);
+}
+
+void LibrarySearchDialog::setRoot(const QString& rootPath)
+{
+    m_index.reset(new LibraryIndex(rootPath));
+    m_rootEdit->setText(m_index->rootPath());
+    m_updateButton->setEnabled(true);
+    
+    // 先用已有的索引，随后在后台增量更新
+    QString errorMsg;
+    if (QFileInfo::exists(m_index->indexPath())) {
+        m_index->load(errorMsg);
+    }
+    onUpdateIndex();
+}
+
+void LibrarySearchDialog::setUpdating(bool updating)
+{
+    m_browseButton->setEnabled(!updating);
+    m_updateButton->setEnabled(!updating && m_index);
+    m_queryEdit->setEnabled(!updating && m_index && m_index->isLoaded());
+    m_resultTable->setEnabled(!updating);
+}
+
+void LibrarySearchDialog::onUpdateIndex()
+{
+    if (!m_index || m_updateWatcher->isRunning()) return;
+    
+    // 更新结束时会重新映射索引文件，期间不能搜索
+    setUpdating(true);
+    m_hits.clear();
+    m_resultTable->setRowCount(0);
+    m_summaryLabel->setText("正在更新索引...");
+    PerfTrace::beginOperation();
+    LibraryIndex* index = m_index.get();
+    SubtitleEncoding encoding = m_encoding;
+    QThreadPool* pool = m_pool;
+    // 协调任务放在全局线程池中，解析任务在 m_pool 中并行，避免占用自己等待的线程池
+    m_updateWatcher->setFuture(QtConcurrent::run([index, encoding, pool]() {
+        UpdateResult result;
+        result.ok = index->update(encoding, result.stats, result.errorMsg, pool);
+        return result;
+    }));
+}
+
+void LibrarySearchDialog::onUpdateFinished()
+{
+    UpdateResult result = m_updateWatcher->result();
+    setUpdating(false);
+    if (!result.ok) {
+        QMessageBox::critical(this, "错误", "无法更新索引：\n" + result.errorMsg);
+        showIndexSummary();
+        return;
+    }
+    if (!result.stats.errors.isEmpty()) {
+        QMessageBox::warning(this, "更新索引", "以下文件无法解析，未加入索引：\n" + result.stats.errors.join("\n"));
+    }
+    
+    QString message = result.stats.summary();
+    QString timing = PerfTrace::lastSummary();
+    if (!timing.isEmpty()) {
+        message += "\n" + timing;
+    }
+    m_summaryLabel->setText(message);
+    if (!m_queryEdit->text().trimmed().isEmpty()) {
+        onSearch();
+    }
+    m_queryEdit->setFocus();
+}
+
+void LibrarySearchDialog::showIndexSummary()
+{
+    if (m_index && m_index->isLoaded()) {
+        m_summaryLabel->setText(QString("索引中共 %1 个文件、%2 条字幕")
+                                .arg(m_index->fileCount()).arg(m_index->cueCount()));
+    } else {
+        m_summaryLabel->setText("尚未建立索引");
+    }
+}
+
+void LibrarySearchDialog::onSearch()
+{
+    if (!m_index || !m_index->isLoaded() || m_updateWatcher->isRunning()) return;
+    
+    const QString query = m_queryEdit->text();
+    PerfTrace::beginOperation();
+    m_hits = query.trimmed().isEmpty() ? QVector<LibraryIndex::Hit>() : m_index->search(query, kResultLimit);
+    
+    const QDir root(m_index->rootPath());
+    m_resultTable->setRowCount(m_hits.size());
+    for (int i = 0; i < m_hits.size(); ++i) {
+        const LibraryIndex::Hit& hit = m_hits[i];
+        QString text = hit.text;
+        text.replace('\n', " / ");
+        QTableWidgetItem* fileItem = new QTableWidgetItem(root.relativeFilePath(hit.filePath));
+        fileItem->setToolTip(hit.filePath);
+        m_resultTable->setItem(i, FileColumn, fileItem);
+        m_resultTable->setItem(i, IndexColumn, new QTableWidgetItem(QString::number(hit.row + 1)));
+        m_resultTable->setItem(i, TimeColumn, new QTableWidgetItem(
+                                   SRTParser::formatTime(QTime::fromMSecsSinceStartOfDay(hit.startMs))));
+        m_resultTable->setItem(i, TextColumn, new QTableWidgetItem(text));
+    }
+    
+    if (query.trimmed().isEmpty()) {
+        showIndexSummary();
+        return;
+    }
+    QString message = m_hits.size() < kResultLimit
+        ? QString("找到 %1 条结果").arg(m_hits.size())
+        : QString("显示相关度最高的 %1 条结果").arg(m_hits.size());
+    QString timing = PerfTrace::lastSummary();
+    if (!timing.isEmpty()) {
+        message += "（" + timing + "）";
+    }
+    m_summaryLabel->setText(message);
+}
+
+void LibrarySearchDialog::onResultActivated(int row, int column)
+{
+    Q_UNUSED(column);
+    if (row < 0 || row >= m_hits.size()) return;
+    emit openRequested(m_hits[row]);
+}
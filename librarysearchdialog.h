@@ -0,0 +1,65 @@
+#ifndef LIBRARYSEARCHDIALOG_H
+#define LIBRARYSEARCHDIALOG_H
+
+#include <QDialog>
+#include <QFutureWatcher>
+#include <QLabel>
+#include <QLineEdit>
+#include <QPushButton>
+#include <QTableWidget>
+#include <memory>
+#include "libraryindex.h"
+
+class QThreadPool;
+
+// 字幕库搜索：选择根目录后在后台增量更新索引，输入时即时搜索，双击结果在主窗口中打开并定位到该条字幕
+class LibrarySearchDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit LibrarySearchDialog(QThreadPool* pool, QWidget* parent = nullptr);
+    ~LibrarySearchDialog();
+    
+    // 之后更新索引时使用的字幕编码
+    void setEncoding(SubtitleEncoding encoding) { m_encoding = encoding; }
+
+signals:
+    void openRequested(const LibraryIndex::Hit& hit);
+
+private slots:
+    void onBrowse();
+    void onUpdateIndex();
+    void onUpdateFinished();
+    void onSearch();
+    void onResultActivated(int row, int column);
+
+private:
+    struct UpdateResult {
+        bool ok;
+        QString errorMsg;
+        LibraryIndex::UpdateStats stats;
+        
+        UpdateResult() : ok(false) {}
+    };
+    
+    void setupUI();
+    void setRoot(const QString& rootPath);
+    void setUpdating(bool updating);
+    void showIndexSummary();
+    
+    QThreadPool* m_pool;
+    SubtitleEncoding m_encoding;
+    std::unique_ptr<LibraryIndex> m_index;
+    QVector<LibraryIndex::Hit> m_hits;
+    QFutureWatcher<UpdateResult>* m_updateWatcher;
+    
+    QLineEdit* m_rootEdit;
+    QPushButton* m_browseButton;
+    QPushButton* m_updateButton;
+    QLineEdit* m_queryEdit;
+    QLabel* m_summaryLabel;
+    QTableWidget* m_resultTable;
+};
+
+#endif // LIBRARYSEARCHDIALOG_H
@@ -1,11 +1,28 @@
 #include "mainwindow.h"
+#include "perftrace.h"
+#include "commandline.h"
 
 #include <QApplication>
+#include <QCoreApplication>
 
 int main(int argc, char *argv[])
 {
+    // 带命令参数时以无界面模式运行，例如 SubtitleEditApp retime --shift 500 < in.srt > out.srt
+    if (argc > 1 && CommandLine::isCommand(QString::fromLocal8Bit(argv[1]))) {
+        QCoreApplication app(argc, argv);
+        PerfTrace::initFromEnvironment();
+        int result = CommandLine::run(app.arguments());
+        PerfTrace::flushTraceFile();
+        return result;
+    }
+    
     QApplication a(argc, argv);
+    PerfTrace::initFromEnvironment();
+    
     MainWindow w;
     w.show();
-    return a.exec();
+    int result = a.exec();
+    
+    PerfTrace::flushTraceFile();
+    return result;
 }
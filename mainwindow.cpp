@@ -1,6 +1,17 @@
 #include "mainwindow.h"
 #include "./ui_mainwindow.h"
 #include "pointsyncdialog.h"
+#include "diffdialog.h"
+#include "librarysearchdialog.h"
+#include "subtitlesplice.h"
+#include "subtitlemerge.h"
+#include "subtitlereflow.h"
+#include "subtitleconform.h"
+#include "subtitlesnap.h"
+#include "subtitletexttransform.h"
+#include "perftrace.h"
+#include "subtitletablemodel.h"
+#include "timelinewidget.h"
 #include <QFileDialog>
 #include <QMessageBox>
 #include <QInputDialog>
@@ -14,18 +25,146 @@
 #include <QDialogButtonBox>
 #include <QGroupBox>
 #include <QFileInfo>
+#include <QDir>
 #include <QStringList>
+#include <QTableView>
+#include <QHeaderView>
+#include <QFutureWatcher>
+#include <QtConcurrent/QtConcurrentRun>
+#include <QtConcurrent/QtConcurrentMap>
+#include <QRadioButton>
+#include <QDoubleSpinBox>
+#include <QFormLayout>
+#include <QItemSelection>
+#include <QCloseEvent>
+#include <QTimer>
+#include <QLineEdit>
+#include <QPointer>
+#include <QCheckBox>
+#include <QCollator>
+#include <QComboBox>
+#include <QFileSystemWatcher>
+#include <QPlainTextEdit>
+#include <algorithm>
 
 namespace {
 
-QString encodingDisplayName(SubtitleEncoding encoding) {
-    switch (encoding) {
-    case SubtitleEncoding::Utf8:
-        return "UTF-8";
-    case SubtitleEncoding::Gbk:
-        return "GBK";
+// 判断是否为同一文件用的路径：解析符号链接；文件不存在时取绝对路径，避免不存在的文件彼此相等
+QString pathKey(const QString& filePath) {
+    QFileInfo info(filePath);
+    QString canonicalPath = info.canonicalFilePath();
+    return canonicalPath.isEmpty() ? QDir::cleanPath(info.absoluteFilePath()) : canonicalPath;
+}
+
+// 搜索结果在文档中的行：原行号处的开始时间和文本都相同时就是它，否则取两者都相同、离原行号最近的一条；
+// 没有时返回 -1
+int locateHit(const QVector<SubtitleItem>& subtitles, const LibraryIndex::Hit& hit) {
+    auto matches = [&subtitles, &hit](int row) {
+        return subtitles[row].startTime.msecsSinceStartOfDay() == hit.startMs && subtitles[row].text == hit.text;
+    };
+    if (hit.row >= 0 && hit.row < subtitles.size() && matches(hit.row)) return hit.row;
+    
+    int best = -1;
+    for (int row = 0; row < subtitles.size(); ++row) {
+        if (matches(row) && (best < 0 || qAbs(row - hit.row) < qAbs(best - hit.row))) {
+            best = row;
+        }
+    }
+    return best;
+}
+
+// 后台文本处理的结果
+struct TextTransformOutcome {
+    bool ok;
+    QString errorMsg;
+    QVector<SubtitleItem> subtitles;
+    SubtitleTextTransform::Result result;
+    
+    TextTransformOutcome() : ok(false) {}
+};
+
+// 重定时操作的作用范围：全部字幕 / 选中行 / 时间窗口
+class RetimeScopeBox : public QGroupBox {
+public:
+    // 选中的行不连续时“选中行”不可用，否则会连带修改中间未选中的行；
+    // 字幕未按开始时间排列时“时间窗口”不可用，窗口内的字幕不是连续的一段
+    RetimeScopeBox(int selectionFirst, int selectionLast, bool contiguous, bool sorted, QWidget* parent)
+        : QGroupBox("作用范围", parent)
+        , m_selectionFirst(selectionFirst)
+        , m_selectionLast(selectionLast)
+    {
+        QVBoxLayout* layout = new QVBoxLayout(this);
+        
+        m_allButton = new QRadioButton("全部字幕", this);
+        layout->addWidget(m_allButton);
+        
+        const bool usable = selectionFirst >= 0 && contiguous;
+        QString selectionText;
+        if (selectionFirst < 0) {
+            selectionText = "选中行（未选择）";
+        } else if (!contiguous) {
+            selectionText = "选中行（选区不连续，请选择连续的行）";
+        } else {
+            selectionText = QString("选中行（第 %1–%2 条）").arg(selectionFirst + 1).arg(selectionLast + 1);
+        }
+        m_selectionButton = new QRadioButton(selectionText, this);
+        m_selectionButton->setEnabled(usable);
+        layout->addWidget(m_selectionButton);
+        
+        QHBoxLayout* windowLayout = new QHBoxLayout();
+        m_windowButton = new QRadioButton(sorted ? "时间窗口" : "时间窗口（字幕未按时间排列，请先排序）", this);
+        m_windowButton->setEnabled(sorted);
+        windowLayout->addWidget(m_windowButton);
+        m_fromEdit = new QTimeEdit(this);
+        m_fromEdit->setDisplayFormat("HH:mm:ss.zzz");
+        windowLayout->addWidget(m_fromEdit);
+        windowLayout->addWidget(new QLabel("至", this));
+        m_toEdit = new QTimeEdit(this);
+        m_toEdit->setDisplayFormat("HH:mm:ss.zzz");
+        m_toEdit->setTime(QTime(23, 59, 59, 999));
+        windowLayout->addWidget(m_toEdit);
+        m_fromEdit->setEnabled(sorted);
+        m_toEdit->setEnabled(sorted);
+        layout->addLayout(windowLayout);
+        
+        // 有选中多行时默认只作用于选中行
+        if (usable && selectionLast > selectionFirst) {
+            m_selectionButton->setChecked(true);
+        } else {
+            m_allButton->setChecked(true);
+        }
+    }
+    
+    // 解析出要修改的连续行区间
+    bool resolve(const QVector<SubtitleItem>& subtitles, int& first, int& last) const {
+        if (m_selectionButton->isChecked()) {
+            first = m_selectionFirst;
+            last = m_selectionLast;
+            return first >= 0;
+        }
+        if (m_windowButton->isChecked() && m_windowButton->isEnabled()) {
+            return SRTParser::rangeForTimeWindow(subtitles, m_fromEdit->time(), m_toEdit->time(), first, last);
+        }
+        first = 0;
+        last = subtitles.size() - 1;
+        return last >= 0;
+    }
+    
+private:
+    int m_selectionFirst;
+    int m_selectionLast;
+    QRadioButton* m_allButton;
+    QRadioButton* m_selectionButton;
+    QRadioButton* m_windowButton;
+    QTimeEdit* m_fromEdit;
+    QTimeEdit* m_toEdit;
+};
+
+QString rangeDescription(int first, int last, int total) {
+    if (first == 0 && last == total - 1) {
+        return "全部字幕";
     }
-    return "未知";
+    return QString("第 %1–%2 条字幕").arg(first + 1).arg(last + 1);
 }
 
 }
@@ -33,34 +172,71 @@ QString encodingDisplayName(SubtitleEncoding encoding) {
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
     , ui(new Ui::MainWindow)
-    , m_tableModel(new QStandardItemModel(this))
-    , m_modified(false)
-    , m_currentEncoding(SubtitleEncoding::Utf8)
+    , m_activeView(nullptr)
+    , m_lastEncoding(SubtitleEncoding::Utf8)
+    , m_librarySearch(nullptr)
+    , m_selectionFirst(-1)
+    , m_selectionLast(-1)
+    , m_selectionContiguous(true)
+    , m_pendingLoads(0)
+    , m_loadedFiles(0)
+    , m_loadedSubtitles(0)
+    , m_playbackTimer(new QTimer(this))
+    , m_playbackStartMs(0)
+    , m_timeline(new TimelineWidget(this))
+    , m_fileWatcher(new QFileSystemWatcher(this))
+    , m_diskCheckTimer(new QTimer(this))
 {
     ui->setupUi(this);
-    
-    // 设置表格模型
-    m_tableModel->setHorizontalHeaderLabels({"序号", "开始时间", "结束时间", "字幕文本"});
-    ui->tableView->setModel(m_tableModel);
-    
-    // 设置列宽
-    ui->tableView->setColumnWidth(0, 60);
-    ui->tableView->setColumnWidth(1, 120);
-    ui->tableView->setColumnWidth(2, 120);
-    ui->tableView->setColumnWidth(3, 400);
+    ui->verticalLayout->addWidget(m_timeline);
     
     // 连接信号槽
     connect(ui->actionOpen, &QAction::triggered, this, &MainWindow::onOpenFile);
     connect(ui->actionSave, &QAction::triggered, this, &MainWindow::onSaveFile);
     connect(ui->actionSaveAs, &QAction::triggered, this, &MainWindow::onSaveAsFile);
+    connect(ui->actionClose, &QAction::triggered, this, &MainWindow::onCloseFile);
     connect(ui->actionTimeShift, &QAction::triggered, this, &MainWindow::onTimeShift);
+    connect(ui->actionTimeScale, &QAction::triggered, this, &MainWindow::onTimeScale);
+    connect(ui->actionRangeSync, &QAction::triggered, this, &MainWindow::onRangeSync);
     connect(ui->actionPointSync, &QAction::triggered, this, &MainWindow::onPointSync);
+    connect(ui->actionSortByTime, &QAction::triggered, this, &MainWindow::onSortByTime);
+    connect(ui->actionReflow, &QAction::triggered, this, &MainWindow::onReflow);
+    connect(ui->actionConform, &QAction::triggered, this, &MainWindow::onConform);
+    connect(ui->actionSnapToShots, &QAction::triggered, this, &MainWindow::onSnapToShots);
+    connect(ui->actionJumpToTime, &QAction::triggered, this, &MainWindow::onJumpToTime);
+    connect(ui->actionPlayback, &QAction::toggled, this, &MainWindow::onTogglePlayback);
+    connect(ui->actionTimeline, &QAction::toggled, this, &MainWindow::onToggleTimeline);
+    connect(ui->actionBatchShift, &QAction::triggered, this, &MainWindow::onBatchShift);
+    connect(ui->actionDuplicateTexts, &QAction::triggered, this, &MainWindow::onDuplicateTexts);
+    connect(ui->actionCompare, &QAction::triggered, this, &MainWindow::onCompare);
+    connect(ui->actionMergeBilingual, &QAction::triggered, this, &MainWindow::onMergeBilingual);
+    connect(ui->actionTextTransform, &QAction::triggered, this, &MainWindow::onTextTransform);
+    connect(ui->actionSearchLibrary, &QAction::triggered, this, &MainWindow::onSearchLibrary);
+    connect(ui->actionJoinParts, &QAction::triggered, this, &MainWindow::onJoinParts);
+    connect(ui->actionSplitFile, &QAction::triggered, this, &MainWindow::onSplitFile);
+    connect(ui->actionPerfStats, &QAction::toggled, this, &MainWindow::onTogglePerfStats);
+    ui->actionPerfStats->setChecked(PerfTrace::isEnabled());
     
-    connect(m_tableModel, &QStandardItemModel::dataChanged, this, &MainWindow::onTableDataChanged);
-    connect(ui->tableView->selectionModel(), &QItemSelectionModel::selectionChanged, 
-            this, &MainWindow::onSelectionChanged);
+    m_playbackTimer->setInterval(40);
+    connect(m_playbackTimer, &QTimer::timeout, this, &MainWindow::onPlaybackTick);
+    
+    // 单击时间轴上的字幕选中表格中对应的行
+    connect(m_timeline, &TimelineWidget::rowActivated, this, [this](int row) {
+        selectRows(QVector<int>{row});
+    });
+    
+    // 外部程序保存时常常连续写入几次，等它写完再比较
+    m_diskCheckTimer->setSingleShot(true);
+    m_diskCheckTimer->setInterval(300);
+    connect(m_diskCheckTimer, &QTimer::timeout, this, &MainWindow::checkChangedFiles);
+    connect(m_fileWatcher, &QFileSystemWatcher::fileChanged, this, &MainWindow::onFileChangedOnDisk);
+    
+    connect(ui->tabWidget, &QTabWidget::currentChanged, this, &MainWindow::onCurrentTabChanged);
+    connect(ui->tabWidget, &QTabWidget::tabCloseRequested, this, &MainWindow::onTabCloseRequested);
     
     updateWindowTitle();
+    
+    QTimer::singleShot(0, this, &MainWindow::checkRecoverableSessions);
 }
 
 MainWindow::~MainWindow()
@@ -68,36 +244,76 @@ MainWindow::~MainWindow()
     delete ui;
 }
 
+void MainWindow::closeEvent(QCloseEvent* event) {
+    for (SubtitleDocument* document : m_documents) {
+        if (!maybeSaveDocument(document)) {
+            event->ignore();
+            return;
+        }
+    }
+    
+    // 正常退出，不再需要恢复日志
+    for (SubtitleDocument* document : m_documents) {
+        document->journal().discard();
+    }
+    event->accept();
+}
+
 void MainWindow::onOpenFile() {
-    QString filePath = QFileDialog::getOpenFileName(this, "打开SRT文件", "", "SRT文件 (*.srt);;所有文件 (*)");
-    if (filePath.isEmpty()) return;
+    QStringList filePaths = QFileDialog::getOpenFileNames(this, "打开SRT文件", "", "SRT文件 (*.srt);;所有文件 (*)");
+    if (filePaths.isEmpty()) return;
     
-    SubtitleEncoding encoding = m_currentEncoding;
+    SubtitleEncoding encoding = m_lastEncoding;
     if (!promptEncodingSelection(encoding)) {
         return;
     }
     
-    loadSubtitles(filePath, encoding);
+    loadSubtitles(filePaths, encoding);
 }
 
 void MainWindow::onSaveFile() {
-    if (m_currentFilePath.isEmpty()) {
-        onSaveAsFile();
-        return;
-    }
+    SubtitleDocument* document = currentDocument();
+    if (!document) return;
     
-    saveSubtitles(m_currentFilePath);
+    saveDocument(document, false);
 }
 
 void MainWindow::onSaveAsFile() {
+    SubtitleDocument* document = currentDocument();
+    if (!document) return;
+    
+    saveDocumentAs(document, false);
+}
+
+bool MainWindow::saveDocument(SubtitleDocument* document, bool wait) {
+    if (document->filePath().isEmpty()) {
+        return saveDocumentAs(document, wait);
+    }
+    return saveSubtitles(document, document->filePath(), document->encoding(), wait);
+}
+
+bool MainWindow::saveDocumentAs(SubtitleDocument* document, bool wait) {
     QString filePath = QFileDialog::getSaveFileName(this, "保存SRT文件", "", "SRT文件 (*.srt);;所有文件 (*)");
-    if (filePath.isEmpty()) return;
+    if (filePath.isEmpty()) return false;
     
-    saveSubtitles(filePath);
+    // 另存为时可以换一种编码，默认沿用打开时的编码
+    SubtitleEncoding encoding = document->encoding();
+    if (!promptEncodingSelection(encoding, "请选择保存的编码：")) {
+        return false;
+    }
+    return saveSubtitles(document, filePath, encoding, wait);
+}
+
+void MainWindow::onCloseFile() {
+    int index = ui->tabWidget->currentIndex();
+    if (index >= 0) {
+        onTabCloseRequested(index);
+    }
 }
 
 void MainWindow::onTimeShift() {
-    if (m_subtitles.isEmpty()) {
+    SubtitleDocument* document = currentDocument();
+    if (!document || document->subtitles().isEmpty()) {
         QMessageBox::warning(this, "警告", "请先打开一个SRT文件");
         return;
     }
@@ -122,157 +338,1704 @@ void MainWindow::onTimeShift() {
     infoLabel->setStyleSheet("color: gray; font-size: 10pt;");
     layout->addWidget(infoLabel);
     
+    RetimeScopeBox* scopeBox = new RetimeScopeBox(m_selectionFirst, m_selectionLast, m_selectionContiguous,
+                                                  SubtitleSort::isSorted(document->subtitles()), &dialog);
+    layout->addWidget(scopeBox);
+    
     QDialogButtonBox* buttonBox = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, &dialog);
     connect(buttonBox, &QDialogButtonBox::accepted, &dialog, &QDialog::accept);
     connect(buttonBox, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
     layout->addWidget(buttonBox);
     
     if (dialog.exec() == QDialog::Accepted) {
+        int first = 0;
+        int last = 0;
+        if (!scopeBox->resolve(document->subtitles(), first, last)) {
+            QMessageBox::warning(this, "警告", "所选范围内没有字幕");
+            return;
+        }
+        
         int milliseconds = spinBox->value();
-        SRTParser::shiftTime(m_subtitles, milliseconds);
-        updateTableView();
+        PerfTrace::beginOperation();
+        SRTParser::shiftTime(document->subtitles(), milliseconds, first, last);
+        document->journal().recordShift(first, last, milliseconds);
+        updateTableRows(first, last);
         setModified(true);
-        ui->statusbar->showMessage(QString("已应用 %1 毫秒的时间偏移").arg(milliseconds), 3000);
+        showStatusMessage(QString("已对%1应用 %2 毫秒的时间偏移")
+                          .arg(rangeDescription(first, last, document->subtitles().size()))
+                          .arg(milliseconds));
     }
 }
 
-void MainWindow::onPointSync() {
-    if (m_subtitles.isEmpty()) {
+void MainWindow::onTimeScale() {
+    SubtitleDocument* document = currentDocument();
+    if (!document || document->subtitles().isEmpty()) {
         QMessageBox::warning(this, "警告", "请先打开一个SRT文件");
         return;
     }
     
-    // 创建并显示点同步对话框
-    PointSyncDialog dialog(m_subtitles, this);
+    QDialog dialog(this);
+    dialog.setWindowTitle("时间缩放");
+    
+    QVBoxLayout* layout = new QVBoxLayout(&dialog);
+    
+    QLabel* label = new QLabel("输入缩放比例：", &dialog);
+    layout->addWidget(label);
+    
+    QDoubleSpinBox* factorBox = new QDoubleSpinBox(&dialog);
+    factorBox->setRange(0.5, 2.0);
+    factorBox->setDecimals(6);
+    factorBox->setSingleStep(0.001);
+    factorBox->setValue(1.0);
+    layout->addWidget(factorBox);
+    
+    QLabel* infoLabel = new QLabel("以范围内第一条字幕的开始时间为基准，例如 25/23.976 ≈ 1.042709", &dialog);
+    infoLabel->setStyleSheet("color: gray; font-size: 10pt;");
+    layout->addWidget(infoLabel);
+    
+    RetimeScopeBox* scopeBox = new RetimeScopeBox(m_selectionFirst, m_selectionLast, m_selectionContiguous,
+                                                  SubtitleSort::isSorted(document->subtitles()), &dialog);
+    layout->addWidget(scopeBox);
+    
+    QDialogButtonBox* buttonBox = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, &dialog);
+    connect(buttonBox, &QDialogButtonBox::accepted, &dialog, &QDialog::accept);
+    connect(buttonBox, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
+    layout->addWidget(buttonBox);
     
     if (dialog.exec() == QDialog::Accepted) {
-        m_subtitles = dialog.getSyncedSubtitles();
-        updateTableView();
+        int first = 0;
+        int last = 0;
+        if (!scopeBox->resolve(document->subtitles(), first, last)) {
+            QMessageBox::warning(this, "警告", "所选范围内没有字幕");
+            return;
+        }
+        
+        double factor = factorBox->value();
+        QTime anchor = document->subtitles()[first].startTime;
+        PerfTrace::beginOperation();
+        SRTParser::scaleTime(document->subtitles(), factor, anchor, first, last);
+        document->journal().recordScale(first, last, factor, anchor);
+        updateTableRows(first, last);
         setModified(true);
-        ui->statusbar->showMessage("已应用点同步", 3000);
+        showStatusMessage(QString("已对%1应用 %2 倍时间缩放")
+                          .arg(rangeDescription(first, last, document->subtitles().size()))
+                          .arg(factor, 0, 'f', 6));
     }
 }
 
-void MainWindow::onTableDataChanged(const QModelIndex& topLeft, const QModelIndex& bottomRight) {
-    Q_UNUSED(bottomRight);
+void MainWindow::onRangeSync() {
+    SubtitleDocument* document = currentDocument();
+    if (!document || document->subtitles().isEmpty()) {
+        QMessageBox::warning(this, "警告", "请先打开一个SRT文件");
+        return;
+    }
     
-    if (topLeft.row() < 0 || topLeft.row() >= m_subtitles.size()) return;
+    QVector<SubtitleItem>& subtitles = document->subtitles();
     
-    int row = topLeft.row();
-    int col = topLeft.column();
+    QDialog dialog(this);
+    dialog.setWindowTitle("两点同步");
     
-    SubtitleItem& item = m_subtitles[row];
-    QString text = m_tableModel->item(row, col)->text();
+    QVBoxLayout* layout = new QVBoxLayout(&dialog);
     
-    bool ok;
-    switch (col) {
-    case 0: // 序号
-        item.index = text.toInt(&ok);
-        break;
-    case 1: // 开始时间
-        item.startTime = SRTParser::parseTime(text, ok);
-        if (!ok) {
-            QMessageBox::warning(this, "错误", "时间格式不正确，应为 HH:MM:SS,mmm");
-            updateTableView();
+    QLabel* infoLabel = new QLabel("设置范围内首条和末条字幕的正确开始时间，中间的字幕按线性比例调整", &dialog);
+    infoLabel->setWordWrap(true);
+    infoLabel->setStyleSheet("color: gray; font-size: 10pt;");
+    layout->addWidget(infoLabel);
+    
+    RetimeScopeBox* scopeBox = new RetimeScopeBox(m_selectionFirst, m_selectionLast, m_selectionContiguous,
+                                                  SubtitleSort::isSorted(document->subtitles()), &dialog);
+    layout->addWidget(scopeBox);
+    
+    QFormLayout* formLayout = new QFormLayout();
+    QTimeEdit* firstEdit = new QTimeEdit(&dialog);
+    firstEdit->setDisplayFormat("HH:mm:ss.zzz");
+    QTimeEdit* lastEdit = new QTimeEdit(&dialog);
+    lastEdit->setDisplayFormat("HH:mm:ss.zzz");
+    formLayout->addRow("首条字幕新时间：", firstEdit);
+    formLayout->addRow("末条字幕新时间：", lastEdit);
+    layout->addLayout(formLayout);
+    
+    // 预填当前范围首尾字幕的原时间
+    int first = 0;
+    int last = 0;
+    if (scopeBox->resolve(subtitles, first, last)) {
+        firstEdit->setTime(subtitles[first].startTime);
+        lastEdit->setTime(subtitles[last].startTime);
+    }
+    
+    QDialogButtonBox* buttonBox = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, &dialog);
+    connect(buttonBox, &QDialogButtonBox::accepted, &dialog, &QDialog::accept);
+    connect(buttonBox, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
+    layout->addWidget(buttonBox);
+    
+    if (dialog.exec() == QDialog::Accepted) {
+        if (!scopeBox->resolve(subtitles, first, last)) {
+            QMessageBox::warning(this, "警告", "所选范围内没有字幕");
             return;
         }
-        break;
-    case 2: // 结束时间
-        item.endTime = SRTParser::parseTime(text, ok);
-        if (!ok) {
-            QMessageBox::warning(this, "错误", "时间格式不正确，应为 HH:MM:SS,mmm");
-            updateTableView();
+        if (first == last || subtitles[first].startTime == subtitles[last].startTime) {
+            QMessageBox::warning(this, "警告", "两点同步需要范围内至少两条开始时间不同的字幕");
             return;
         }
-        break;
-    case 3: // 文本
-        item.text = text;
-        break;
+        
+        PerfTrace::beginOperation();
+        SRTParser::pointSync(subtitles, first, firstEdit->time(), last, lastEdit->time(), first, last);
+        document->journal().recordPointSync(first, firstEdit->time(), last, lastEdit->time(), first, last);
+        updateTableRows(first, last);
+        setModified(true);
+        showStatusMessage(QString("已对%1应用两点同步")
+                          .arg(rangeDescription(first, last, subtitles.size())));
+    }
+}
+
+void MainWindow::onPointSync() {
+    SubtitleDocument* document = currentDocument();
+    if (!document || document->subtitles().isEmpty()) {
+        QMessageBox::warning(this, "警告", "请先打开一个SRT文件");
+        return;
+    }
+    
+    // 创建并显示点同步对话框
+    PerfTrace::beginOperation();
+    PointSyncDialog dialog(document->subtitles(), this);
+    
+    if (dialog.exec() == QDialog::Accepted) {
+        document->setSubtitles(dialog.getSyncedSubtitles());
+        document->journal().recordReplaceAll();
+        setModified(true);
+        showStatusMessage("已应用点同步");
+    }
+}
+
+void MainWindow::onSortByTime() {
+    SubtitleDocument* document = currentDocument();
+    if (!document || document->subtitles().isEmpty()) {
+        QMessageBox::warning(this, "警告", "请先打开一个SRT文件");
+        return;
+    }
+    
+    PerfTrace::beginOperation();
+    SubtitleSort::Result result = document->sortByStartTime();
+    if (!result.changed()) {
+        showStatusMessage("字幕已按时间排列，序号连续，无需调整");
+        return;
     }
     
     setModified(true);
+    // 选区跟随字幕移动，重新计算选中行的首尾
+    onSelectionChanged();
+    showStatusMessage(QString("已按时间排序：%1 条字幕移动了位置，%2 条重新编号")
+                      .arg(result.moved).arg(result.renumbered));
 }
 
-void MainWindow::onSelectionChanged() {
-    // 可以在此处添加选中行的处理逻辑
+void MainWindow::onReflow() {
+    SubtitleDocument* document = currentDocument();
+    if (!document || document->subtitles().isEmpty()) {
+        QMessageBox::warning(this, "警告", "请先打开一个SRT文件");
+        return;
+    }
+    
+    QDialog dialog(this);
+    dialog.setWindowTitle("按阅读速度规则整理");
+    
+    QVBoxLayout* layout = new QVBoxLayout(&dialog);
+    QLabel* infoLabel = new QLabel("超长的行重新断行，行数过多或时间过长的字幕按字数比例拆分，"
+                                   "过短的相邻字幕合并，阅读速度过快时向后面的间隙延长", &dialog);
+    infoLabel->setWordWrap(true);
+    infoLabel->setStyleSheet("color: gray; font-size: 10pt;");
+    layout->addWidget(infoLabel);
+    
+    SubtitleReflow::Rules defaults;
+    QFormLayout* formLayout = new QFormLayout();
+    auto addSpin = [&](const QString& label, int value, int maximum, const QString& suffix) {
+        QSpinBox* spin = new QSpinBox(&dialog);
+        spin->setRange(0, maximum);
+        spin->setSuffix(suffix);
+        spin->setValue(value);
+        formLayout->addRow(label, spin);
+        return spin;
+    };
+    auto addCpsSpin = [&](const QString& label, double value) {
+        QDoubleSpinBox* spin = new QDoubleSpinBox(&dialog);
+        spin->setRange(1, 100);
+        spin->setDecimals(1);
+        spin->setSuffix(" 字/秒");
+        spin->setValue(value);
+        formLayout->addRow(label, spin);
+        return spin;
+    };
+    QSpinBox* charsSpin = addSpin("每行最多字数（西文）：", defaults.maxCharsPerLine, 200, "");
+    QSpinBox* cjkCharsSpin = addSpin("每行最多字数（中文）：", defaults.maxCjkCharsPerLine, 200, "");
+    QSpinBox* linesSpin = addSpin("每条最多行数：", defaults.maxLines, 10, "");
+    QDoubleSpinBox* cpsSpin = addCpsSpin("阅读速度上限（西文）：", defaults.maxCps);
+    QDoubleSpinBox* cjkCpsSpin = addCpsSpin("阅读速度上限（中文）：", defaults.maxCjkCps);
+    QSpinBox* minDurationSpin = addSpin("短于此时长的字幕尝试合并：", defaults.minDurationMs, 10000, " 毫秒");
+    QSpinBox* maxDurationSpin = addSpin("长于此时长的多行字幕拆分：", defaults.maxDurationMs, 60000, " 毫秒");
+    QSpinBox* gapSpin = addSpin("与下一条字幕的最小间隔：", defaults.minGapMs, 5000, " 毫秒");
+    QSpinBox* mergeGapSpin = addSpin("间隔超过此值不合并：", defaults.maxMergeGapMs, 10000, " 毫秒");
+    linesSpin->setMinimum(1);
+    charsSpin->setMinimum(1);
+    cjkCharsSpin->setMinimum(1);
+    layout->addLayout(formLayout);
+    
+    auto currentRules = [&]() {
+        SubtitleReflow::Rules rules;
+        rules.maxCharsPerLine = charsSpin->value();
+        rules.maxCjkCharsPerLine = cjkCharsSpin->value();
+        rules.maxLines = linesSpin->value();
+        rules.maxCps = cpsSpin->value();
+        rules.maxCjkCps = cjkCpsSpin->value();
+        rules.minDurationMs = minDurationSpin->value();
+        rules.maxDurationMs = maxDurationSpin->value();
+        rules.minGapMs = gapSpin->value();
+        rules.maxMergeGapMs = mergeGapSpin->value();
+        return rules;
+    };
+    
+    QDialogButtonBox* buttonBox = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, &dialog);
+    QPushButton* previewButton = buttonBox->addButton("预览...", QDialogButtonBox::ActionRole);
+    connect(buttonBox, &QDialogButtonBox::accepted, &dialog, &QDialog::accept);
+    connect(buttonBox, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
+    layout->addWidget(buttonBox);
+    
+    // 试运行：只生成报告，不修改文档
+    connect(previewButton, &QPushButton::clicked, &dialog, [&]() {
+        PerfTrace::beginOperation();
+        SubtitleReflow::Result result;
+        SubtitleReflow::apply(document->subtitles(), currentRules(), result, SubtitleDocument::workerPool());
+        
+        QDialog reportDialog(&dialog);
+        reportDialog.setWindowTitle("整理预览");
+        reportDialog.resize(560, 420);
+        QVBoxLayout* reportLayout = new QVBoxLayout(&reportDialog);
+        QPlainTextEdit* reportEdit = new QPlainTextEdit(result.report(), &reportDialog);
+        reportEdit->setReadOnly(true);
+        reportEdit->setLineWrapMode(QPlainTextEdit::NoWrap);
+        reportLayout->addWidget(reportEdit);
+        QDialogButtonBox* closeBox = new QDialogButtonBox(QDialogButtonBox::Close, &reportDialog);
+        connect(closeBox, &QDialogButtonBox::rejected, &reportDialog, &QDialog::reject);
+        reportLayout->addWidget(closeBox);
+        reportDialog.exec();
+    });
+    
+    if (dialog.exec() != QDialog::Accepted) return;
+    
+    PerfTrace::beginOperation();
+    SubtitleReflow::Result result;
+    QVector<SubtitleItem> reflowed = SubtitleReflow::apply(document->subtitles(), currentRules(), result,
+                                                           SubtitleDocument::workerPool());
+    if (!result.changed()) {
+        showStatusMessage(result.violations > 0
+                          ? QString("没有可以自动修正的字幕，%1 处仍不符合规范").arg(result.violations)
+                          : QString("所有字幕都符合规范，无需调整"));
+        return;
+    }
+    
+    document->setSubtitles(reflowed);
+    document->journal().recordReplaceAll();
+    setModified(true);
+    onSelectionChanged();
+    showStatusMessage("已整理：" + result.summary());
 }
 
-void MainWindow::loadSubtitles(const QString& filePath, SubtitleEncoding encoding) {
+void MainWindow::onConform() {
+    SubtitleDocument* document = currentDocument();
+    if (!document || document->subtitles().isEmpty()) {
+        QMessageBox::warning(this, "警告", "请先打开一个SRT文件");
+        return;
+    }
+    
+    QString edlPath = QFileDialog::getOpenFileName(this, "选择剪辑表", "",
+                                                   "剪辑表 (*.edl *.csv *.txt);;所有文件 (*)");
+    if (edlPath.isEmpty()) return;
+    
+    QDialog dialog(this);
+    dialog.setWindowTitle("按剪辑表重新对位");
+    
+    QVBoxLayout* layout = new QVBoxLayout(&dialog);
+    QLabel* infoLabel = new QLabel("按 " + QFileInfo(edlPath).fileName() + " 把字幕从旧剪辑版本移到新版本，"
+                                   "落在被删除部分的字幕将被丢弃", &dialog);
+    infoLabel->setWordWrap(true);
+    infoLabel->setStyleSheet("color: gray; font-size: 10pt;");
+    layout->addWidget(infoLabel);
+    
+    QGroupBox* crossingGroup = new QGroupBox("跨越剪辑点的字幕", &dialog);
+    QVBoxLayout* crossingLayout = new QVBoxLayout(crossingGroup);
+    QRadioButton* trimRadio = new QRadioButton("裁剪：保留落在同一片段内最长的部分", crossingGroup);
+    QRadioButton* dropRadio = new QRadioButton("丢弃", crossingGroup);
+    trimRadio->setChecked(true);
+    crossingLayout->addWidget(trimRadio);
+    crossingLayout->addWidget(dropRadio);
+    layout->addWidget(crossingGroup);
+    
+    SubtitleConform::Options options;
+    QFormLayout* formLayout = new QFormLayout();
+    QSpinBox* minDurationSpin = new QSpinBox(&dialog);
+    minDurationSpin->setRange(0, 10000);
+    minDurationSpin->setSuffix(" 毫秒");
+    minDurationSpin->setValue(options.minDurationMs);
+    formLayout->addRow("裁剪后短于此值的字幕丢弃：", minDurationSpin);
+    QDoubleSpinBox* fpsSpin = new QDoubleSpinBox(&dialog);
+    fpsSpin->setRange(1, 240);
+    fpsSpin->setDecimals(3);
+    fpsSpin->setValue(25.0);
+    formLayout->addRow("时间码帧率：", fpsSpin);
+    QLineEdit* originEdit = new QLineEdit("00:00:00:00", &dialog);
+    originEdit->setToolTip("剪辑表中对应字幕零点的时间码，节目从 01:00:00:00 开始时填写该值");
+    formLayout->addRow("时间码起点：", originEdit);
+    layout->addLayout(formLayout);
+    
+    QDialogButtonBox* buttonBox = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, &dialog);
+    connect(buttonBox, &QDialogButtonBox::accepted, &dialog, &QDialog::accept);
+    connect(buttonBox, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
+    layout->addWidget(buttonBox);
+    
+    if (dialog.exec() != QDialog::Accepted) return;
+    
+    options.crossing = dropRadio->isChecked() ? SubtitleConform::Drop : SubtitleConform::Trim;
+    options.minDurationMs = minDurationSpin->value();
+    int originMs = 0;
+    if (!SubtitleConform::parseTimecode(originEdit->text().trimmed(), fpsSpin->value(), originMs)) {
+        QMessageBox::warning(this, "警告", "时间码起点格式无效：" + originEdit->text());
+        return;
+    }
+    
     QString errorMsg;
-    if (!SRTParser::parse(filePath, m_subtitles, errorMsg, encoding)) {
-        QMessageBox::critical(this, "错误", "无法加载文件：\n" + errorMsg);
+    QVector<SubtitleConform::Segment> segments;
+    if (!SubtitleConform::readEdl(edlPath, fpsSpin->value(), originMs, segments, errorMsg)) {
+        QMessageBox::critical(this, "错误", errorMsg);
         return;
     }
     
-    m_currentFilePath = filePath;
-    m_currentEncoding = encoding;
-    updateTableView();
-    setModified(false);
-    ui->statusbar->showMessage(
-        QString("已加载 %1 条字幕（编码：%2）").arg(m_subtitles.size()).arg(encodingDisplayName(encoding)),
-        3000);
+    PerfTrace::beginOperation();
+    SubtitleConform::Stats stats;
+    document->setSubtitles(SubtitleConform::conform(document->subtitles(), segments, options, &stats));
+    document->journal().recordReplaceAll();
+    setModified(true);
+    onSelectionChanged();
+    showStatusMessage("已按剪辑表对位：" + stats.summary());
 }
 
-void MainWindow::saveSubtitles(const QString& filePath) {
+void MainWindow::onSnapToShots() {
+    SubtitleDocument* document = currentDocument();
+    if (!document || document->subtitles().isEmpty()) {
+        QMessageBox::warning(this, "警告", "请先打开一个SRT文件");
+        return;
+    }
+    
+    QString keyframePath = QFileDialog::getOpenFileName(this, "选择镜头切换点文件", "",
+                                                        "切换点列表 (*.txt *.log *.csv);;所有文件 (*)");
+    if (keyframePath.isEmpty()) return;
+    
+    QDialog dialog(this);
+    dialog.setWindowTitle("吸附到镜头切换");
+    
+    QVBoxLayout* layout = new QVBoxLayout(&dialog);
+    QLabel* infoLabel = new QLabel("把靠近 " + QFileInfo(keyframePath).fileName() + " 中切换点的开始和结束时间移到切换点上，"
+                                   "下一条从同一切换点开始时结束时间停在其前方的最小间隔处", &dialog);
+    infoLabel->setWordWrap(true);
+    infoLabel->setStyleSheet("color: gray; font-size: 10pt;");
+    layout->addWidget(infoLabel);
+    
+    SubtitleSnap::Options options;
+    QFormLayout* formLayout = new QFormLayout();
+    auto addSpin = [&](const QString& label, int value, int maximum) {
+        QSpinBox* spin = new QSpinBox(&dialog);
+        spin->setRange(0, maximum);
+        spin->setSuffix(" 毫秒");
+        spin->setValue(value);
+        formLayout->addRow(label, spin);
+        return spin;
+    };
+    QSpinBox* thresholdSpin = addSpin("与切换点相距不超过：", options.thresholdMs, 5000);
+    QSpinBox* gapSpin = addSpin("与相邻字幕的最小间隔：", options.minGapMs, 5000);
+    QSpinBox* minDurationSpin = addSpin("吸附后的最短时长：", options.minDurationMs, 10000);
+    QDoubleSpinBox* fpsSpin = new QDoubleSpinBox(&dialog);
+    fpsSpin->setRange(1, 240);
+    fpsSpin->setDecimals(3);
+    fpsSpin->setValue(25.0);
+    formLayout->addRow("帧率（帧号和时间码）：", fpsSpin);
+    layout->addLayout(formLayout);
+    
+    QCheckBox* framesCheck = new QCheckBox("文件中的整数为帧号", &dialog);
+    layout->addWidget(framesCheck);
+    QCheckBox* startsCheck = new QCheckBox("吸附开始时间", &dialog);
+    startsCheck->setChecked(options.snapStarts);
+    layout->addWidget(startsCheck);
+    QCheckBox* endsCheck = new QCheckBox("吸附结束时间", &dialog);
+    endsCheck->setChecked(options.snapEnds);
+    layout->addWidget(endsCheck);
+    
+    QDialogButtonBox* buttonBox = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, &dialog);
+    connect(buttonBox, &QDialogButtonBox::accepted, &dialog, &QDialog::accept);
+    connect(buttonBox, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
+    layout->addWidget(buttonBox);
+    
+    if (dialog.exec() != QDialog::Accepted) return;
+    
+    options.thresholdMs = thresholdSpin->value();
+    options.minGapMs = gapSpin->value();
+    options.minDurationMs = minDurationSpin->value();
+    options.snapStarts = startsCheck->isChecked();
+    options.snapEnds = endsCheck->isChecked();
+    
     QString errorMsg;
-    if (!SRTParser::save(filePath, m_subtitles, errorMsg)) {
-        QMessageBox::critical(this, "错误", "无法保存文件：\n" + errorMsg);
+    QVector<int> keyframes;
+    if (!SubtitleSnap::readKeyframes(keyframePath, fpsSpin->value(), framesCheck->isChecked(), keyframes, errorMsg)) {
+        QMessageBox::critical(this, "错误", errorMsg);
+        return;
+    }
+    
+    PerfTrace::beginOperation();
+    SubtitleSnap::Stats stats = SubtitleSnap::apply(document->subtitles(), keyframes, options);
+    if (!stats.changed()) {
+        showStatusMessage("没有需要吸附的时间");
         return;
     }
     
-    m_currentFilePath = filePath;
-    setModified(false);
-    ui->statusbar->showMessage("文件已保存", 3000);
+    document->journal().recordReplaceAll();
+    updateTableRows(stats.firstRow, stats.lastRow);
+    setModified(true);
+    showStatusMessage("已吸附到镜头切换：" + stats.summary());
 }
 
-void MainWindow::updateTableView() {
-    // 断开信号以避免触发dataChanged
-    disconnect(m_tableModel, &QStandardItemModel::dataChanged, this, &MainWindow::onTableDataChanged);
+void MainWindow::onTableDataChanged(const QModelIndex& topLeft, const QModelIndex& bottomRight) {
+    Q_UNUSED(topLeft);
+    Q_UNUSED(bottomRight);
     
-    m_tableModel->removeRows(0, m_tableModel->rowCount());
+    // 模型在 setData 中已经校验并写回了字幕数组，这里只需要标记文档已修改
+    SubtitleTableModel* model = qobject_cast<SubtitleTableModel*>(sender());
+    SubtitleDocument* document = model ? qobject_cast<SubtitleDocument*>(model->parent()) : nullptr;
+    if (document) {
+        document->setModified(true);
+    }
+}
+
+void MainWindow::onSelectionChanged() {
+    m_selectionFirst = -1;
+    m_selectionLast = -1;
+    m_selectionContiguous = true;
+    if (!m_activeView || !m_activeView->selectionModel()) return;
     
-    for (const SubtitleItem& item : m_subtitles) {
-        QList<QStandardItem*> rowItems;
-        
-        QStandardItem* indexItem = new QStandardItem(QString::number(item.index));
-        QStandardItem* startItem = new QStandardItem(SRTParser::formatTime(item.startTime));
-        QStandardItem* endItem = new QStandardItem(SRTParser::formatTime(item.endTime));
-        QStandardItem* textItem = new QStandardItem(item.text);
-        
-        rowItems << indexItem << startItem << endItem << textItem;
-        m_tableModel->appendRow(rowItems);
+    // 只看各选区范围的首尾，不展开成逐行列表，全选十万行也是常数时间
+    const QItemSelection selection = m_activeView->selectionModel()->selection();
+    QVector<QPair<int, int>> ranges;
+    for (const QItemSelectionRange& range : selection) {
+        ranges.append(qMakePair(range.top(), range.bottom()));
+    }
+    std::sort(ranges.begin(), ranges.end());
+    for (const QPair<int, int>& range : ranges) {
+        // 相接或重叠的范围仍算连续
+        if (m_selectionFirst >= 0 && range.first > m_selectionLast + 1) {
+            m_selectionContiguous = false;
+        }
+        if (m_selectionFirst < 0) {
+            m_selectionFirst = range.first;
+        }
+        m_selectionLast = qMax(m_selectionLast, range.second);
     }
+    m_timeline->setSelectedRows(m_selectionFirst, m_selectionLast);
     
-    // 重新连接信号
-    connect(m_tableModel, &QStandardItemModel::dataChanged, this, &MainWindow::onTableDataChanged);
+    if (!m_selectionContiguous) {
+        ui->statusbar->showMessage("选中的行不连续，时间平移/缩放/两点同步的“选中行”范围不可用", 3000);
+    } else if (m_selectionFirst >= 0 && m_selectionLast > m_selectionFirst) {
+        ui->statusbar->showMessage(QString("已选择第 %1–%2 条字幕，时间平移/缩放/两点同步可只作用于选中范围")
+                                   .arg(m_selectionFirst + 1).arg(m_selectionLast + 1), 3000);
+    }
 }
 
-void MainWindow::setModified(bool modified) {
-    m_modified = modified;
+void MainWindow::onCurrentTabChanged(int index) {
+    QTableView* view = qobject_cast<QTableView*>(ui->tabWidget->widget(index));
+    
+    // 播放预览只跟随当前文档
+    ui->actionPlayback->setChecked(false);
+    
+    // 非活动文档释放表格模型，切回时重新创建（模型不复制数据，创建是常数时间）
+    if (m_activeView && m_activeView != view) {
+        detachView(m_activeView);
+    }
+    
+    m_activeView = view;
+    m_selectionFirst = -1;
+    m_selectionLast = -1;
+    m_selectionContiguous = true;
+    if (view) {
+        attachView(view, m_documents.value(view));
+    }
+    
     updateWindowTitle();
 }
 
-void MainWindow::updateWindowTitle() {
-    QString title = "SRT字幕编辑器";
-    if (!m_currentFilePath.isEmpty()) {
-        QFileInfo fileInfo(m_currentFilePath);
-        title += " - " + fileInfo.fileName();
+void MainWindow::onTabCloseRequested(int index) {
+    QTableView* view = qobject_cast<QTableView*>(ui->tabWidget->widget(index));
+    SubtitleDocument* document = m_documents.value(view);
+    if (!view || !document) return;
+    
+    if (!maybeSaveDocument(document)) {
+        return;
     }
-    if (m_modified) {
-        title += " *";
+    
+    if (view == m_activeView) {
+        detachView(view);
+        m_activeView = nullptr;
     }
-    setWindowTitle(title);
+    
+    document->journal().discard();
+    m_documents.remove(view);
+    ui->tabWidget->removeTab(index);
+    view->deleteLater();
+    document->deleteLater();
+    updateWatchedFiles();
+    
+    updateWindowTitle();
 }
 
-bool MainWindow::promptEncodingSelection(SubtitleEncoding& encoding) {
-    QStringList options = {"UTF-8", "GBK"};
-    int defaultIndex = (encoding == SubtitleEncoding::Gbk) ? 1 : 0;
+void MainWindow::onJumpToTime() {
+    SubtitleDocument* document = currentDocument();
+    if (!document || document->subtitles().isEmpty()) {
+        QMessageBox::warning(this, "警告", "请先打开一个SRT文件");
+        return;
+    }
+    
+    QString defaultText = "00:00:00,000";
+    if (m_selectionFirst >= 0) {
+        defaultText = SRTParser::formatTime(document->subtitles()[m_selectionFirst].startTime);
+    }
+    
     bool ok = false;
-    QString choice = QInputDialog::getItem(this, "选择编码", "请选择字幕文件编码：", options, defaultIndex, false, &ok);
+    QString text = QInputDialog::getText(this, "跳转到时间", "时间 (HH:MM:SS,mmm)：",
+                                         QLineEdit::Normal, defaultText, &ok);
+    if (!ok) return;
+    
+    QTime time = SRTParser::parseTime(text.trimmed(), ok);
     if (!ok) {
-        return false;
+        QMessageBox::warning(this, "错误", "时间格式无效，应为 HH:MM:SS,mmm");
+        return;
     }
     
-    encoding = (choice == "GBK") ? SubtitleEncoding::Gbk : SubtitleEncoding::Utf8;
-    return true;
+    int timeMs = time.msecsSinceStartOfDay();
+    const IntervalIndex& index = document->timeIndex();
+    QVector<int> rows = index.stab(timeMs);
+    if (!rows.isEmpty()) {
+        selectRows(rows);
+        ui->statusbar->showMessage(QString("%1 时刻正在显示 %2 条字幕")
+                                   .arg(SRTParser::formatTime(time)).arg(rows.size()), 3000);
+        return;
+    }
+    
+    // 该时刻没有字幕，定位到之后的第一条
+    int next = index.firstStartingAtOrAfter(timeMs);
+    if (next < 0) {
+        ui->statusbar->showMessage(QString("%1 之后没有字幕").arg(SRTParser::formatTime(time)), 3000);
+        return;
+    }
+    selectRows(QVector<int>{next});
+    ui->statusbar->showMessage(QString("%1 时刻没有字幕，已定位到下一条（第 %2 条）")
+                               .arg(SRTParser::formatTime(time)).arg(next + 1), 3000);
+}
+
+void MainWindow::onTogglePlayback(bool enabled) {
+    m_playbackRows.clear();
+    if (!enabled) {
+        m_timeline->setPlayhead(-1);
+        if (m_playbackTimer->isActive()) {
+            m_playbackTimer->stop();
+            ui->statusbar->clearMessage();
+        }
+        return;
+    }
+    
+    SubtitleDocument* document = currentDocument();
+    if (!document || document->subtitles().isEmpty()) {
+        ui->actionPlayback->setChecked(false);
+        return;
+    }
+    
+    // 从选中字幕的开始时间起播放
+    m_playbackStartMs = 0;
+    if (m_selectionFirst >= 0) {
+        m_playbackStartMs = document->subtitles()[m_selectionFirst].startTime.msecsSinceStartOfDay();
+    }
+    m_playbackClock.start();
+    m_playbackTimer->start();
+    onPlaybackTick();
+}
+
+void MainWindow::onPlaybackTick() {
+    SubtitleDocument* document = currentDocument();
+    if (!document) {
+        ui->actionPlayback->setChecked(false);
+        return;
+    }
+    
+    // 每次只做一次 O(log N + k) 的区间查询，不随字幕总数增长
+    const IntervalIndex& index = document->timeIndex();
+    int timeMs = m_playbackStartMs + int(m_playbackClock.elapsed());
+    if (timeMs >= index.maxEndMs()) {
+        ui->actionPlayback->setChecked(false);
+        ui->statusbar->showMessage("播放预览结束", 3000);
+        return;
+    }
+    
+    m_timeline->setPlayhead(timeMs);
+    QVector<int> rows = index.stab(timeMs);
+    if (rows != m_playbackRows) {
+        m_playbackRows = rows;
+        if (!rows.isEmpty()) {
+            selectRows(rows);
+        }
+    }
+    
+    QStringList texts;
+    for (int row : m_playbackRows) {
+        texts << document->subtitles()[row].text.simplified();
+    }
+    ui->statusbar->showMessage(QString("▶ %1  %2")
+                               .arg(SRTParser::formatTime(QTime::fromMSecsSinceStartOfDay(timeMs)),
+                                    texts.join(" / ")));
+}
+
+void MainWindow::onDuplicateTexts() {
+    SubtitleDocument* document = currentDocument();
+    if (!document || document->subtitles().isEmpty()) {
+        QMessageBox::warning(this, "警告", "请先打开一个SRT文件");
+        return;
+    }
+    
+    const QVector<SubtitleItem>& subtitles = document->subtitles();
+    
+    // 文本已驻留，相同文本共享同一缓冲，按指针分组即可，不需要比较字符串
+    QHash<const QChar*, QVector<int>> groups;
+    for (int row = 0; row < subtitles.size(); ++row) {
+        if (subtitles[row].text.isEmpty()) continue;
+        groups[subtitles[row].text.constData()].append(row);
+    }
+    
+    // 选中了某一行时，选中所有与它文本相同的行
+    if (m_selectionFirst >= 0 && m_selectionFirst < subtitles.size()) {
+        auto it = groups.constFind(subtitles[m_selectionFirst].text.constData());
+        if (it != groups.constEnd() && it->size() > 1) {
+            selectRows(*it);
+            ui->statusbar->showMessage(QString("共有 %1 条字幕与选中行的文本相同").arg(it->size()), 3000);
+            return;
+        }
+    }
+    
+    QVector<QVector<int>> repeated;
+    for (auto it = groups.constBegin(); it != groups.constEnd(); ++it) {
+        if (it->size() > 1) repeated.append(*it);
+    }
+    std::sort(repeated.begin(), repeated.end(), [](const QVector<int>& a, const QVector<int>& b) {
+        return a.size() > b.size() || (a.size() == b.size() && a.first() < b.first());
+    });
+    
+    TextPool::Stats stats = TextPool::measure(subtitles);
+    QString message = QString("共 %1 条字幕，%2 种不同文本，%3 种文本重复出现\n"
+                              "文本占用 %4 KB，共享后 %5 KB，节省 %6 KB\n")
+                          .arg(stats.cues).arg(stats.uniqueTexts).arg(repeated.size())
+                          .arg(stats.logicalBytes / 1024).arg(stats.storedBytes / 1024)
+                          .arg(stats.savedBytes() / 1024);
+    
+    const int maxShown = 15;
+    if (!repeated.isEmpty()) {
+        message += "\n出现最多的文本：\n";
+        for (int i = 0; i < repeated.size() && i < maxShown; ++i) {
+            QString text = subtitles[repeated[i].first()].text.simplified();
+            if (text.size() > 40) text = text.left(40) + "...";
+            message += QString("%1 次（第 %2 条起）：%3\n").arg(repeated[i].size()).arg(repeated[i].first() + 1).arg(text);
+        }
+        message += "\n选中一行后再次执行可选中所有文本相同的行。";
+    }
+    QMessageBox::information(this, "重复文本统计", message);
+}
+
+void MainWindow::onCompare() {
+    SubtitleDocument* document = currentDocument();
+    if (!document || document->subtitles().isEmpty()) {
+        QMessageBox::warning(this, "警告", "请先打开一个SRT文件");
+        return;
+    }
+    
+    QString filePath = QFileDialog::getOpenFileName(this, "选择要比较的新版本", "", "SRT文件 (*.srt);;所有文件 (*)");
+    if (filePath.isEmpty()) return;
+    
+    SubtitleEncoding encoding = document->encoding();
+    if (!promptEncodingSelection(encoding)) {
+        return;
+    }
+    
+    // 新版本在线程池中解析，完成后再打开对照窗口
+    PerfTrace::beginOperation();
+    ui->statusbar->showMessage("正在加载 " + QFileInfo(filePath).fileName() + "...");
+    QPointer<SubtitleDocument> target(document);
+    QFutureWatcher<SubtitleLoadResult>* watcher = new QFutureWatcher<SubtitleLoadResult>(this);
+    connect(watcher, &QFutureWatcher<SubtitleLoadResult>::finished, this, [this, watcher, target]() {
+        SubtitleLoadResult result = watcher->result();
+        watcher->deleteLater();
+        ui->statusbar->clearMessage();
+        if (!target) return;
+        if (!result.ok) {
+            QMessageBox::critical(this, "错误", "无法加载文件：\n" + result.errorMsg);
+            return;
+        }
+        
+        QString oldName = target->filePath().isEmpty() ? target->displayName() : target->filePath();
+        DiffDialog dialog(target->subtitles(), oldName, result.subtitles, result.filePath, this);
+        connect(&dialog, &DiffDialog::oldRowActivated, this, [this, target](int row) {
+            if (target && target == currentDocument() && row < target->subtitles().size()) {
+                selectRows(QVector<int>{row});
+            }
+        });
+        showStatusMessage("比较完成");
+        dialog.exec();
+    });
+    watcher->setFuture(QtConcurrent::run(SubtitleDocument::workerPool(),
+                                         &SubtitleDocument::loadFile, filePath, encoding));
+}
+
+void MainWindow::onMergeBilingual() {
+    SubtitleDocument* document = currentDocument();
+    if (!document || document->subtitles().isEmpty()) {
+        QMessageBox::warning(this, "警告", "请先打开主语言的SRT文件");
+        return;
+    }
+    
+    QString filePath = QFileDialog::getOpenFileName(this, "选择另一种语言的字幕", "", "SRT文件 (*.srt);;所有文件 (*)");
+    if (filePath.isEmpty()) return;
+    
+    QDialog dialog(this);
+    dialog.setWindowTitle("合并双语字幕");
+    
+    QVBoxLayout* layout = new QVBoxLayout(&dialog);
+    QLabel* infoLabel = new QLabel("当前字幕为主语言，" + QFileInfo(filePath).fileName() + " 为副语言，"
+                                   "按时间重叠把两者合并为一条字幕", &dialog);
+    infoLabel->setWordWrap(true);
+    infoLabel->setStyleSheet("color: gray; font-size: 10pt;");
+    layout->addWidget(infoLabel);
+    
+    QGroupBox* modeGroup = new QGroupBox("一条字幕与多条字幕重叠时", &dialog);
+    QVBoxLayout* modeLayout = new QVBoxLayout(modeGroup);
+    QRadioButton* stackRadio = new QRadioButton("叠加：保留主字幕的时间，副字幕并入重叠最多的主字幕", modeGroup);
+    QRadioButton* splitRadio = new QRadioButton("切分：在每个边界处切开，每段显示当时出现的全部文本", modeGroup);
+    stackRadio->setChecked(true);
+    modeLayout->addWidget(stackRadio);
+    modeLayout->addWidget(splitRadio);
+    layout->addWidget(modeGroup);
+    
+    SubtitleMerge::Options options;
+    QFormLayout* formLayout = new QFormLayout();
+    QSpinBox* overlapSpin = new QSpinBox(&dialog);
+    overlapSpin->setRange(0, 5000);
+    overlapSpin->setSuffix(" 毫秒");
+    overlapSpin->setValue(options.minOverlapMs);
+    formLayout->addRow("重叠少于此值视为不重叠：", overlapSpin);
+    layout->addLayout(formLayout);
+    
+    QCheckBox* keepCheck = new QCheckBox("保留没有对应主字幕的副字幕", &dialog);
+    keepCheck->setChecked(options.keepUnmatched);
+    layout->addWidget(keepCheck);
+    QCheckBox* secondaryFirstCheck = new QCheckBox("副语言显示在上方", &dialog);
+    layout->addWidget(secondaryFirstCheck);
+    
+    QDialogButtonBox* buttonBox = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, &dialog);
+    connect(buttonBox, &QDialogButtonBox::accepted, &dialog, &QDialog::accept);
+    connect(buttonBox, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
+    layout->addWidget(buttonBox);
+    
+    if (dialog.exec() != QDialog::Accepted) return;
+    
+    options.mode = splitRadio->isChecked() ? SubtitleMerge::Split : SubtitleMerge::Stack;
+    options.minOverlapMs = overlapSpin->value();
+    options.keepUnmatched = keepCheck->isChecked();
+    options.secondaryFirst = secondaryFirstCheck->isChecked();
+    
+    SubtitleEncoding encoding = document->encoding();
+    if (!promptEncodingSelection(encoding)) {
+        return;
+    }
+    
+    // 副字幕在线程池中解析，完成后与当前内容合并
+    PerfTrace::beginOperation();
+    ui->statusbar->showMessage("正在加载 " + QFileInfo(filePath).fileName() + "...");
+    QPointer<SubtitleDocument> target(document);
+    QFutureWatcher<SubtitleLoadResult>* watcher = new QFutureWatcher<SubtitleLoadResult>(this);
+    connect(watcher, &QFutureWatcher<SubtitleLoadResult>::finished, this, [this, watcher, target, options]() {
+        SubtitleLoadResult result = watcher->result();
+        watcher->deleteLater();
+        ui->statusbar->clearMessage();
+        if (!target) return;
+        if (!result.ok) {
+            QMessageBox::critical(this, "错误", "无法加载文件：\n" + result.errorMsg);
+            return;
+        }
+        
+        SubtitleMerge::Stats stats;
+        target->setSubtitles(SubtitleMerge::merge(target->subtitles(), result.subtitles, options, &stats));
+        target->journal().recordReplaceAll();
+        target->setModified(true);
+        if (target == currentDocument()) {
+            onSelectionChanged();
+        }
+        showStatusMessage("已合并双语字幕：" + stats.summary());
+    });
+    watcher->setFuture(QtConcurrent::run(SubtitleDocument::workerPool(),
+                                         &SubtitleDocument::loadFile, filePath, encoding));
+}
+
+void MainWindow::onTextTransform() {
+    SubtitleDocument* document = currentDocument();
+    if (!document || document->subtitles().isEmpty()) {
+        QMessageBox::warning(this, "警告", "请先打开一个SRT文件");
+        return;
+    }
+    
+    QDialog dialog(this);
+    dialog.setWindowTitle("简繁转换与文本整理");
+    
+    QVBoxLayout* layout = new QVBoxLayout(&dialog);
+    QLabel* infoLabel = new QLabel("依次去掉标签、转换简繁、统一标点，只修改字幕文本。"
+                                   "内置常用字词表，完整转换请选择 OpenCC 词典目录", &dialog);
+    infoLabel->setWordWrap(true);
+    infoLabel->setStyleSheet("color: gray; font-size: 10pt;");
+    layout->addWidget(infoLabel);
+    
+    QFormLayout* formLayout = new QFormLayout();
+    QComboBox* conversionCombo = new QComboBox(&dialog);
+    conversionCombo->addItem("不转换", SubtitleTextTransform::NoConversion);
+    conversionCombo->addItem("简体 → 繁体", SubtitleTextTransform::ToTraditional);
+    conversionCombo->addItem("繁体 → 简体", SubtitleTextTransform::ToSimplified);
+    formLayout->addRow("简繁转换：", conversionCombo);
+    QComboBox* punctuationCombo = new QComboBox(&dialog);
+    punctuationCombo->addItem("不改变", SubtitleTextTransform::KeepPunctuation);
+    punctuationCombo->addItem("全角改为半角", SubtitleTextTransform::HalfWidth);
+    punctuationCombo->addItem("中文语境使用全角标点", SubtitleTextTransform::FullWidth);
+    formLayout->addRow("标点：", punctuationCombo);
+    
+    QHBoxLayout* dictionaryLayout = new QHBoxLayout();
+    QLineEdit* dictionaryEdit = new QLineEdit(m_dictionaryDirectory, &dialog);
+    dictionaryEdit->setPlaceholderText("内置字词表");
+    QPushButton* browseButton = new QPushButton("浏览...", &dialog);
+    dictionaryLayout->addWidget(dictionaryEdit);
+    dictionaryLayout->addWidget(browseButton);
+    formLayout->addRow("词典目录：", dictionaryLayout);
+    connect(browseButton, &QPushButton::clicked, &dialog, [&]() {
+        QString directory = QFileDialog::getExistingDirectory(&dialog, "选择 OpenCC 词典目录", dictionaryEdit->text());
+        if (!directory.isEmpty()) dictionaryEdit->setText(directory);
+    });
+    layout->addLayout(formLayout);
+    
+    QCheckBox* stripCheck = new QCheckBox("去掉 HTML 标签（<i>、<font> 等）和 ASS 覆盖代码（{\\an8} 等）", &dialog);
+    layout->addWidget(stripCheck);
+    
+    QDialogButtonBox* buttonBox = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, &dialog);
+    connect(buttonBox, &QDialogButtonBox::accepted, &dialog, &QDialog::accept);
+    connect(buttonBox, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
+    layout->addWidget(buttonBox);
+    
+    if (dialog.exec() != QDialog::Accepted) return;
+    
+    SubtitleTextTransform::Options options;
+    options.conversion = static_cast<SubtitleTextTransform::Conversion>(conversionCombo->currentData().toInt());
+    options.punctuation = static_cast<SubtitleTextTransform::Punctuation>(punctuationCombo->currentData().toInt());
+    options.stripTags = stripCheck->isChecked();
+    options.dictionaryDirectory = dictionaryEdit->text().trimmed();
+    m_dictionaryDirectory = options.dictionaryDirectory;
+    if (options.isEmpty()) return;
+    
+    // 编译词典（可能要读几 MB 的 OpenCC 文件）和逐条处理都在后台进行：
+    // 协调任务放在全局线程池中，分块在 workerPool 中并行，避免占用自己等待的线程池
+    PerfTrace::beginOperation();
+    ui->statusbar->showMessage("正在处理文本...");
+    const QVector<SubtitleItem> original = document->subtitles();
+    QPointer<SubtitleDocument> target(document);
+    QFutureWatcher<TextTransformOutcome>* watcher = new QFutureWatcher<TextTransformOutcome>(this);
+    connect(watcher, &QFutureWatcher<TextTransformOutcome>::finished, this, [this, watcher, target, original]() {
+        TextTransformOutcome outcome = watcher->result();
+        watcher->deleteLater();
+        ui->statusbar->clearMessage();
+        if (!target) return;
+        if (!outcome.ok) {
+            QMessageBox::critical(this, "错误", outcome.errorMsg);
+            return;
+        }
+        // 处理期间文档又被修改过（数组不再与快照共享），结果已经过时
+        if (target->subtitles().constData() != original.constData()) {
+            QMessageBox::warning(this, "警告", "处理期间字幕已被修改，本次结果未应用，请重新执行");
+            return;
+        }
+        if (outcome.result.changed == 0) {
+            showStatusMessage("没有需要修改的文本");
+            return;
+        }
+        
+        target->setSubtitles(outcome.subtitles);
+        target->journal().recordReplaceAll();
+        target->setModified(true);
+        if (target == currentDocument()) {
+            onSelectionChanged();
+        }
+        showStatusMessage("已处理文本：" + outcome.result.summary());
+    });
+    QThreadPool* pool = SubtitleDocument::workerPool();
+    watcher->setFuture(QtConcurrent::run([original, options, pool]() {
+        TextTransformOutcome outcome;
+        outcome.subtitles = original;
+        // apply() 在第一次使用某个词典时编译它（即 prepare() 的工作）
+        outcome.ok = SubtitleTextTransform::apply(outcome.subtitles, options, outcome.result, outcome.errorMsg, pool);
+        return outcome;
+    }));
+}
+
+void MainWindow::onToggleTimeline(bool visible) {
+    m_timeline->setVisible(visible);
+}
+
+void MainWindow::onBatchShift() {
+    QStringList filePaths = QFileDialog::getOpenFileNames(this, "批量时间平移（仅时间）", "", "SRT文件 (*.srt);;所有文件 (*)");
+    if (filePaths.isEmpty()) return;
+    
+    bool ok = false;
+    int milliseconds = QInputDialog::getInt(this, "批量时间平移",
+                                            QString("对 %1 个文件应用的时间偏移量（毫秒）：\n正数为向后延迟，负数为向前提前")
+                                            .arg(filePaths.size()),
+                                            0, -3600000, 3600000, 100, &ok);
+    if (!ok || milliseconds == 0) return;
+    
+    QMessageBox box(QMessageBox::Question, "批量时间平移",
+                    "只解析时间，文本按原始字节复制，输出保持原文件编码。\n请选择输出位置：",
+                    QMessageBox::Cancel, this);
+    QPushButton* overwriteButton = box.addButton("覆盖原文件", QMessageBox::DestructiveRole);
+    QPushButton* directoryButton = box.addButton("保存到目录...", QMessageBox::AcceptRole);
+    box.exec();
+    
+    QString outputDirectory;
+    if (box.clickedButton() == directoryButton) {
+        outputDirectory = QFileDialog::getExistingDirectory(this, "选择输出目录");
+        if (outputDirectory.isEmpty()) return;
+    } else if (box.clickedButton() != overwriteButton) {
+        return;
+    }
+    
+    // 编辑器中已打开的文件不能在后台覆盖，否则标签页内容会与磁盘不一致
+    QStringList skipped;
+    QStringList jobs;
+    for (const QString& filePath : filePaths) {
+        if (outputDirectory.isEmpty() && findDocument(filePath)) {
+            skipped << QFileInfo(filePath).fileName() + "：已在编辑器中打开，请直接在标签页中平移";
+            continue;
+        }
+        jobs << filePath;
+    }
+    
+    PerfTrace::beginOperation();
+    SubtitleEncoding encoding = m_lastEncoding;
+    RetimeTransform transform = RetimeTransform::shift(milliseconds);
+    auto shiftOne = [outputDirectory, encoding, transform](const QString& filePath) -> QString {
+        QString targetPath = outputDirectory.isEmpty()
+            ? filePath
+            : QDir(outputDirectory).filePath(QFileInfo(filePath).fileName());
+        QString errorMsg = SubtitleDocument::retimeFileTimingOnly(filePath, targetPath, encoding, transform);
+        return errorMsg.isEmpty() ? QString() : QFileInfo(filePath).fileName() + "：" + errorMsg;
+    };
+    
+    QFutureWatcher<QString>* watcher = new QFutureWatcher<QString>(this);
+    connect(watcher, &QFutureWatcher<QString>::finished, this, [this, watcher, skipped]() {
+        QStringList errors = skipped;
+        int succeeded = 0;
+        for (const QString& error : watcher->future().results()) {
+            if (error.isEmpty()) {
+                ++succeeded;
+            } else {
+                errors << error;
+            }
+        }
+        watcher->deleteLater();
+        
+        if (!errors.isEmpty()) {
+            QMessageBox::warning(this, "批量时间平移", "以下文件未处理：\n" + errors.join("\n"));
+        }
+        showStatusMessage(QString("批量时间平移完成：%1 个文件").arg(succeeded));
+    });
+    watcher->setFuture(QtConcurrent::mapped(SubtitleDocument::workerPool(), jobs, shiftOne));
+    ui->statusbar->showMessage(QString("正在批量平移 %1 个文件...").arg(jobs.size()));
+}
+
+void MainWindow::onSearchLibrary() {
+    if (!m_librarySearch) {
+        m_librarySearch = new LibrarySearchDialog(SubtitleDocument::workerPool(), this);
+        connect(m_librarySearch, &LibrarySearchDialog::openRequested, this, &MainWindow::openAtRow);
+    }
+    m_librarySearch->setEncoding(m_lastEncoding);
+    m_librarySearch->show();
+    m_librarySearch->raise();
+    m_librarySearch->activateWindow();
+}
+
+void MainWindow::openAtRow(const LibraryIndex::Hit& hit) {
+    SubtitleDocument* existing = findDocument(hit.filePath);
+    if (existing) {
+        ui->tabWidget->setCurrentWidget(viewForDocument(existing));
+        jumpToHit(existing, hit);
+        return;
+    }
+    
+    // 加载完成后在 onLoadFinished 中定位
+    m_pendingCueJumps.insert(pathKey(hit.filePath), hit);
+    loadSubtitles(QStringList{hit.filePath}, m_lastEncoding);
+}
+
+void MainWindow::jumpToHit(SubtitleDocument* document, const LibraryIndex::Hit& hit) {
+    // 已打开的文档可能有未保存的编辑，磁盘文件也可能在建立索引后改过，行号不一定还对得上：
+    // 按开始时间和文本找回那条字幕；找不到时只有未修改的文档才按行号定位
+    int row = locateHit(document->subtitles(), hit);
+    if (row < 0 && !document->isModified() && hit.row < document->subtitles().size()) {
+        row = hit.row;
+    }
+    if (row < 0) {
+        showStatusMessage("文档中找不到这条字幕，可能已被修改");
+        return;
+    }
+    selectRows(QVector<int>{row});
+}
+
+void MainWindow::onJoinParts() {
+    QStringList filePaths = QFileDialog::getOpenFileNames(this, "选择要合并的各部分字幕", "", "SRT文件 (*.srt);;所有文件 (*)");
+    if (filePaths.size() < 2) {
+        if (filePaths.size() == 1) {
+            QMessageBox::warning(this, "警告", "至少需要选择两个部分");
+        }
+        return;
+    }
+    // 按文件名自然排序，CD2 排在 CD10 之前
+    QCollator collator;
+    collator.setNumericMode(true);
+    collator.setCaseSensitivity(Qt::CaseInsensitive);
+    std::sort(filePaths.begin(), filePaths.end(), collator);
+    
+    QDialog dialog(this);
+    dialog.setWindowTitle("合并分段字幕");
+    
+    QVBoxLayout* layout = new QVBoxLayout(&dialog);
+    QLabel* infoLabel = new QLabel("设置第 2 部分起每一部分在完整影片中的开始时间，"
+                                   "各部分的字幕按此平移后依次写出并连续编号", &dialog);
+    infoLabel->setWordWrap(true);
+    infoLabel->setStyleSheet("color: gray; font-size: 10pt;");
+    layout->addWidget(infoLabel);
+    
+    QFormLayout* formLayout = new QFormLayout();
+    QVector<QTimeEdit*> startEdits;
+    for (int i = 0; i < filePaths.size(); ++i) {
+        QTimeEdit* edit = new QTimeEdit(&dialog);
+        edit->setDisplayFormat("HH:mm:ss.zzz");
+        edit->setEnabled(i > 0);
+        formLayout->addRow(QString("%1. %2：").arg(i + 1).arg(QFileInfo(filePaths[i]).fileName()), edit);
+        startEdits.append(edit);
+    }
+    layout->addLayout(formLayout);
+    
+    QDialogButtonBox* buttonBox = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, &dialog);
+    connect(buttonBox, &QDialogButtonBox::accepted, &dialog, &QDialog::accept);
+    connect(buttonBox, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
+    layout->addWidget(buttonBox);
+    
+    if (dialog.exec() != QDialog::Accepted) return;
+    
+    QVector<SubtitleSplice::Part> parts;
+    for (int i = 0; i < filePaths.size(); ++i) {
+        int startMs = i == 0 ? 0 : startEdits[i]->time().msecsSinceStartOfDay();
+        if (!parts.isEmpty() && startMs < parts.last().startMs) {
+            QMessageBox::warning(this, "警告", QString("第 %1 部分的开始时间早于前一部分").arg(i + 1));
+            return;
+        }
+        parts.append(SubtitleSplice::Part(filePaths[i], startMs));
+    }
+    
+    SubtitleEncoding encoding = m_lastEncoding;
+    if (!promptEncodingSelection(encoding)) {
+        return;
+    }
+    
+    QString outputPath = QFileDialog::getSaveFileName(this, "保存合并后的字幕", "", "SRT文件 (*.srt);;所有文件 (*)");
+    if (outputPath.isEmpty()) return;
+    if (findDocument(outputPath)) {
+        QMessageBox::warning(this, "警告", "输出文件已在编辑器中打开，请先关闭或选择其他文件");
+        return;
+    }
+    
+    // 逐条流式处理，不把各部分整体载入内存
+    PerfTrace::beginOperation();
+    QFutureWatcher<QString>* watcher = new QFutureWatcher<QString>(this);
+    connect(watcher, &QFutureWatcher<QString>::finished, this, [this, watcher, outputPath, encoding]() {
+        QString errorMsg = watcher->result();
+        watcher->deleteLater();
+        if (!errorMsg.isEmpty()) {
+            ui->statusbar->clearMessage();
+            QMessageBox::critical(this, "错误", "合并失败：\n" + errorMsg);
+            return;
+        }
+        showStatusMessage("已合并到 " + QFileInfo(outputPath).fileName());
+        if (QMessageBox::question(this, "合并分段字幕", "合并完成，是否打开合并后的文件？") == QMessageBox::Yes) {
+            // 合并结果按输入编码写出
+            loadSubtitles(QStringList{outputPath}, encoding);
+        }
+    });
+    watcher->setFuture(QtConcurrent::run(SubtitleDocument::workerPool(),
+                                         &SubtitleSplice::joinFiles, parts, encoding, encoding, outputPath));
+    ui->statusbar->showMessage(QString("正在合并 %1 个部分...").arg(parts.size()));
+}
+
+void MainWindow::onSplitFile() {
+    // 默认分割当前文档对应的文件
+    SubtitleDocument* document = currentDocument();
+    QString initialPath = document ? document->filePath() : QString();
+    QString inputPath = QFileDialog::getOpenFileName(this, "选择要分割的字幕", initialPath, "SRT文件 (*.srt);;所有文件 (*)");
+    if (inputPath.isEmpty()) return;
+    
+    SubtitleDocument* existing = findDocument(inputPath);
+    if (existing && existing->isModified()) {
+        QMessageBox::information(this, "分割字幕", "该文件有未保存的修改，分割将使用磁盘上已保存的内容。");
+    }
+    
+    QDialog dialog(this);
+    dialog.setWindowTitle("分割字幕");
+    
+    QVBoxLayout* layout = new QVBoxLayout(&dialog);
+    QLabel* infoLabel = new QLabel("在指定时间处分割，开始时间不早于分割点的字幕进入下一段。"
+                                   "多个分割点用逗号分隔，例如 00:45:00,000, 01:30:00,000", &dialog);
+    infoLabel->setWordWrap(true);
+    infoLabel->setStyleSheet("color: gray; font-size: 10pt;");
+    layout->addWidget(infoLabel);
+    
+    QFormLayout* formLayout = new QFormLayout();
+    QLineEdit* cutEdit = new QLineEdit(&dialog);
+    formLayout->addRow("分割点：", cutEdit);
+    QCheckBox* rebaseCheck = new QCheckBox("每段的时间从分割点起算", &dialog);
+    rebaseCheck->setChecked(true);
+    formLayout->addRow(QString(), rebaseCheck);
+    layout->addLayout(formLayout);
+    
+    QDialogButtonBox* buttonBox = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, &dialog);
+    connect(buttonBox, &QDialogButtonBox::accepted, &dialog, &QDialog::accept);
+    connect(buttonBox, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
+    layout->addWidget(buttonBox);
+    
+    if (dialog.exec() != QDialog::Accepted) return;
+    
+    QVector<int> cutPoints;
+    QString errorMsg;
+    if (!SubtitleSplice::parseCutPoints(cutEdit->text(), cutPoints, errorMsg)) {
+        QMessageBox::warning(this, "警告", errorMsg);
+        return;
+    }
+    
+    SubtitleEncoding encoding = existing ? existing->encoding() : m_lastEncoding;
+    if (!promptEncodingSelection(encoding)) {
+        return;
+    }
+    
+    QString basePath = QFileDialog::getSaveFileName(this, "输出文件名（自动添加 _part1、_part2 ...）",
+                                                    inputPath, "SRT文件 (*.srt);;所有文件 (*)");
+    if (basePath.isEmpty()) return;
+    QStringList outputPaths = SubtitleSplice::partPaths(basePath, cutPoints.size() + 1);
+    for (const QString& path : outputPaths) {
+        if (findDocument(path)) {
+            QMessageBox::warning(this, "警告", QFileInfo(path).fileName() + " 已在编辑器中打开，请先关闭");
+            return;
+        }
+    }
+    
+    PerfTrace::beginOperation();
+    bool rebase = rebaseCheck->isChecked();
+    QFutureWatcher<QString>* watcher = new QFutureWatcher<QString>(this);
+    connect(watcher, &QFutureWatcher<QString>::finished, this, [this, watcher, outputPaths]() {
+        QString errorMsg = watcher->result();
+        watcher->deleteLater();
+        if (!errorMsg.isEmpty()) {
+            ui->statusbar->clearMessage();
+            QMessageBox::critical(this, "错误", "分割失败：\n" + errorMsg);
+            return;
+        }
+        showStatusMessage(QString("已分割为 %1 个文件").arg(outputPaths.size()));
+    });
+    watcher->setFuture(QtConcurrent::run(SubtitleDocument::workerPool(), &SubtitleSplice::splitFile,
+                                         inputPath, encoding, encoding, cutPoints, outputPaths, rebase));
+    ui->statusbar->showMessage("正在分割 " + QFileInfo(inputPath).fileName() + "...");
+}
+
+void MainWindow::onTogglePerfStats(bool enabled) {
+    PerfTrace::setEnabled(enabled);
+    ui->statusbar->showMessage(enabled ? "已启用性能统计" : "已关闭性能统计", 3000);
+}
+
+void MainWindow::checkRecoverableSessions() {
+    QStringList journals = EditJournal::pendingJournals();
+    if (journals.isEmpty()) return;
+    
+    QMessageBox::StandardButton answer = QMessageBox::question(
+        this, "恢复未保存的编辑",
+        QString("发现 %1 个未保存的编辑会话（上次可能异常退出），是否恢复？").arg(journals.size()),
+        QMessageBox::Yes | QMessageBox::No);
+    
+    if (answer != QMessageBox::Yes) {
+        for (const QString& journalPath : journals) {
+            EditJournal::removeJournal(journalPath);
+        }
+        return;
+    }
+    
+    PerfTrace::beginOperation();
+    QStringList errors;
+    int recovered = 0;
+    for (const QString& journalPath : journals) {
+        RecoveredSession session;
+        QString errorMsg;
+        if (!EditJournal::recover(journalPath, session, errorMsg)) {
+            // 无法重放的日志留着也没有用，避免每次启动都提示
+            errors << errorMsg;
+            EditJournal::removeJournal(journalPath);
+            continue;
+        }
+        
+        SubtitleDocument* document = new SubtitleDocument(this);
+        document->subtitles() = session.subtitles;
+        document->internTexts();
+        document->setFilePath(session.filePath);
+        document->setEncoding(session.encoding);
+        addDocument(document);
+        document->setModified(true);
+        
+        // 以恢复后的内容重新开始日志，旧记录压缩进快照
+        document->journal().start(session.filePath, session.encoding);
+        document->journal().recordReplaceAll();
+        ++recovered;
+    }
+    updateWatchedFiles();
+    
+    if (!errors.isEmpty()) {
+        QMessageBox::warning(this, "恢复失败", errors.join("\n"));
+    }
+    if (recovered > 0) {
+        showStatusMessage(QString("已恢复 %1 个未保存的编辑会话").arg(recovered));
+    }
+}
+
+void MainWindow::loadSubtitles(const QStringList& filePaths, SubtitleEncoding encoding) {
+    if (m_pendingLoads == 0) {
+        PerfTrace::beginOperation();
+        m_loadedFiles = 0;
+        m_loadedSubtitles = 0;
+        m_loadErrors.clear();
+    }
+    m_lastEncoding = encoding;
+    
+    for (const QString& filePath : filePaths) {
+        // 已经打开的文件直接切换过去
+        SubtitleDocument* existing = findDocument(filePath);
+        if (existing) {
+            ui->tabWidget->setCurrentWidget(viewForDocument(existing));
+            continue;
+        }
+        // 同一文件正在加载时不再重复加载，否则会打开两个标签页，各自持有日志锁并互相覆盖保存
+        const QString key = pathKey(filePath);
+        if (m_loadingPaths.contains(key)) continue;
+        m_loadingPaths.insert(key);
+        
+        // 所有文件在共享线程池中并行解析，界面线程只负责创建标签页
+        ++m_pendingLoads;
+        QFutureWatcher<SubtitleLoadResult>* watcher = new QFutureWatcher<SubtitleLoadResult>(this);
+        connect(watcher, &QFutureWatcher<SubtitleLoadResult>::finished, this, [this, watcher]() {
+            SubtitleLoadResult result = watcher->result();
+            watcher->deleteLater();
+            onLoadFinished(result);
+        });
+        watcher->setFuture(QtConcurrent::run(SubtitleDocument::workerPool(),
+                                             &SubtitleDocument::loadFile, filePath, encoding));
+    }
+    
+    if (m_pendingLoads > 0) {
+        ui->statusbar->showMessage(QString("正在加载 %1 个文件...").arg(m_pendingLoads));
+    }
+}
+
+void MainWindow::onLoadFinished(const SubtitleLoadResult& result) {
+    --m_pendingLoads;
+    const QString key = pathKey(result.filePath);
+    m_loadingPaths.remove(key);
+    
+    if (result.ok) {
+        SubtitleDocument* document = new SubtitleDocument(this);
+        // 解析时已经驻留过，接管解析用的池，之后编辑的文本继续共享
+        document->subtitles() = result.subtitles;
+        document->setTextPool(result.textPool);
+        document->setFilePath(result.filePath);
+        document->setEncoding(result.encoding);
+        document->setDiskData(result.data);
+        document->journal().start(result.filePath, result.encoding);
+        addDocument(document);
+        updateWatchedFiles();
+        
+        ++m_loadedFiles;
+        m_loadedSubtitles += result.subtitles.size();
+        
+        // 从字幕库搜索结果打开的文件直接定位到命中的字幕
+        if (m_pendingCueJumps.contains(key)) {
+            jumpToHit(document, m_pendingCueJumps.take(key));
+        }
+    } else {
+        m_pendingCueJumps.remove(key);
+        m_loadErrors << QFileInfo(result.filePath).fileName() + "：" + result.errorMsg;
+    }
+    
+    if (m_pendingLoads > 0) return;
+    
+    if (!m_loadErrors.isEmpty()) {
+        QMessageBox::critical(this, "错误", "无法加载文件：\n" + m_loadErrors.join("\n"));
+    }
+    
+    if (m_loadedFiles == 1) {
+        QString message = QString("已加载 %1 条字幕（编码：%2）")
+                              .arg(m_loadedSubtitles).arg(SRTParser::encodingName(result.encoding));
+        if (result.ok && !SubtitleSort::isSorted(result.subtitles)) {
+            message += "；字幕未按时间排列，可使用“按时间排序并重新编号”";
+        }
+        showStatusMessage(message);
+    } else if (m_loadedFiles > 1) {
+        showStatusMessage(QString("已加载 %1 个文件，共 %2 条字幕").arg(m_loadedFiles).arg(m_loadedSubtitles));
+    } else {
+        ui->statusbar->clearMessage();
+    }
+}
+
+bool MainWindow::saveSubtitles(SubtitleDocument* document, const QString& filePath, SubtitleEncoding encoding,
+                               bool wait) {
+    if (document->isSaving()) {
+        if (!wait) {
+            ui->statusbar->showMessage("上一次保存尚未完成，请稍候", 3000);
+            return false;
+        }
+        document->waitForSave();
+    }
+    
+    // 在后台写出当前内容的快照，界面可以继续编辑；结果在 onSaveFinished 中处理
+    PerfTrace::beginOperation();
+    document->startSave(filePath, encoding);
+    if (wait) {
+        document->waitForSave();
+    } else {
+        ui->statusbar->showMessage("正在保存 " + QFileInfo(filePath).fileName() + "...");
+    }
+    return true;
+}
+
+void MainWindow::onSaveFinished(SubtitleDocument* document, const QString& errorMsg) {
+    if (!errorMsg.isEmpty()) {
+        QMessageBox::critical(this, "错误", "无法保存文件：\n" + errorMsg);
+        return;
+    }
+    
+    updateTabTitle(document);
+    if (document == currentDocument()) {
+        updateWindowTitle();
+    }
+    updateWatchedFiles();
+    showStatusMessage(document->isModified() ? "文件已保存（保存期间的修改尚未保存）" : "文件已保存");
+}
+
+void MainWindow::onFileChangedOnDisk(const QString& filePath) {
+    m_changedFiles.insert(filePath);
+    m_diskCheckTimer->start();
+}
+
+void MainWindow::checkChangedFiles() {
+    const QSet<QString> paths = m_changedFiles;
+    m_changedFiles.clear();
+    
+    for (const QString& path : paths) {
+        SubtitleDocument* document = nullptr;
+        for (SubtitleDocument* candidate : m_documents) {
+            if (candidate->filePath() == path) {
+                document = candidate;
+                break;
+            }
+        }
+        if (!document) continue;
+        
+        if (!QFileInfo::exists(path)) {
+            ui->statusbar->showMessage(QFileInfo(path).fileName() + " 已在磁盘上被删除或移动", 5000);
+            continue;
+        }
+        
+        // 自己的保存或上一次重新解析还没结束，结束后再比较
+        if (document->isSaving() || m_reloadingDocuments.contains(document)) {
+            m_changedFiles.insert(path);
+            m_diskCheckTimer->start();
+            continue;
+        }
+        reloadDocument(document);
+    }
+    
+    // 以改名方式写入的文件会从监视列表中消失，重新加入
+    updateWatchedFiles();
+}
+
+void MainWindow::reloadDocument(SubtitleDocument* document) {
+    // 有未保存的编辑时行号与磁盘对不上，只能整体重新解析，并由用户决定是否放弃编辑
+    const bool modified = document->isModified();
+    const quint64 revision = document->revision();
+    const int rowCount = modified ? -1 : document->subtitles().size();
+    
+    PerfTrace::beginOperation();
+    m_reloadingDocuments.insert(document);
+    QPointer<SubtitleDocument> guard(document);
+    QFutureWatcher<SubtitleReloadResult>* watcher = new QFutureWatcher<SubtitleReloadResult>(this);
+    connect(watcher, &QFutureWatcher<SubtitleReloadResult>::finished, this,
+            [this, watcher, document, guard, modified, revision]() {
+        SubtitleReloadResult result = watcher->result();
+        watcher->deleteLater();
+        m_reloadingDocuments.remove(document);
+        if (!guard) return;
+        
+        if (!result.ok) {
+            QMessageBox::warning(this, "警告", "无法重新载入外部修改的文件：\n" + result.errorMsg);
+            return;
+        }
+        if (!result.changed) return;
+        
+        // 解析期间又有编辑或开始了保存，结果已经过时，稍后重新比较
+        if (document->revision() != revision || document->isSaving()) {
+            m_changedFiles.insert(result.filePath);
+            m_diskCheckTimer->start();
+            return;
+        }
+        
+        if (modified) {
+            QMessageBox::StandardButton answer = QMessageBox::question(
+                this, "文件已在外部修改",
+                QString("“%1”已被其他程序修改，是否重新载入？\n重新载入将丢失未保存的修改。").arg(document->displayName()),
+                QMessageBox::Yes | QMessageBox::No);
+            if (answer != QMessageBox::Yes) {
+                // 保留编辑；记住这次的磁盘内容，同样的修改不再重复询问
+                document->setDiskData(result.data);
+                return;
+            }
+        }
+        
+        document->applyReload(result);
+        document->setModified(false);
+        
+        QString name = document->displayName();
+        if (result.incremental) {
+            showStatusMessage(QString("%1 已在外部修改：更新了第 %2 条起的 %3 条字幕（原 %4 条）")
+                                  .arg(name).arg(result.first + 1).arg(result.items.size()).arg(result.removed));
+        } else {
+            showStatusMessage(QString("%1 已在外部修改：重新载入 %2 条字幕").arg(name).arg(result.items.size()));
+        }
+    });
+    watcher->setFuture(QtConcurrent::run(SubtitleDocument::workerPool(), &SubtitleDocument::reloadFile,
+                                         document->filePath(), document->encoding(),
+                                         document->diskData(), document->diskSpans(), rowCount));
+}
+
+void MainWindow::updateWatchedFiles() {
+    QStringList wanted;
+    for (SubtitleDocument* document : m_documents) {
+        if (!document->filePath().isEmpty() && QFileInfo::exists(document->filePath())) {
+            wanted << document->filePath();
+        }
+    }
+    
+    const QStringList watched = m_fileWatcher->files();
+    for (const QString& path : watched) {
+        if (!wanted.contains(path)) {
+            m_fileWatcher->removePath(path);
+        }
+    }
+    for (const QString& path : wanted) {
+        if (!watched.contains(path)) {
+            m_fileWatcher->addPath(path);
+        }
+    }
+}
+
+void MainWindow::updateTableRows(int first, int last) {
+    SubtitleDocument* document = currentDocument();
+    if (!document) return;
+    document->timingsChanged(first, last);
+    if (!document->hasModel()) return;
+    
+    PerfTrace::Scope scope("table");
+    scope.setCount(last - first + 1);
+    
+    // 只通知被修改的连续区间，视图保留选区和滚动位置
+    document->model()->notifyRowsChanged(first, last);
+}
+
+void MainWindow::setModified(bool modified) {
+    SubtitleDocument* document = currentDocument();
+    if (document) {
+        document->setModified(modified);
+    }
+}
+
+void MainWindow::updateWindowTitle() {
+    QString title = "SRT字幕编辑器";
+    SubtitleDocument* document = currentDocument();
+    if (document && !document->filePath().isEmpty()) {
+        title += " - " + document->displayName();
+    }
+    if (document && document->isModified()) {
+        title += " *";
+    }
+    setWindowTitle(title);
+}
+
+void MainWindow::updateTabTitle(SubtitleDocument* document) {
+    QTableView* view = viewForDocument(document);
+    int index = ui->tabWidget->indexOf(view);
+    if (index < 0) return;
+    
+    QString title = document->displayName();
+    if (document->isModified()) {
+        title += " *";
+    }
+    ui->tabWidget->setTabText(index, title);
+    ui->tabWidget->setTabToolTip(index, document->filePath());
+}
+
+bool MainWindow::promptEncodingSelection(SubtitleEncoding& encoding, const QString& title) {
+    const QVector<SubtitleEncoding> encodings = {
+        SubtitleEncoding::Utf8, SubtitleEncoding::Gbk, SubtitleEncoding::Gb18030, SubtitleEncoding::Utf16Le
+    };
+    QStringList options;
+    for (SubtitleEncoding candidate : encodings) {
+        options << SRTParser::encodingName(candidate);
+    }
+    int defaultIndex = qMax(0, encodings.indexOf(encoding));
+    bool ok = false;
+    QString choice = QInputDialog::getItem(this, "选择编码", title, options, defaultIndex, false, &ok);
+    if (!ok) {
+        return false;
+    }
+    
+    encoding = encodings[options.indexOf(choice)];
+    return true;
+}
+
+void MainWindow::showStatusMessage(const QString& message) {
+    // 启用性能统计时附带各阶段耗时，并延长显示时间便于抄录
+    QString timing = PerfTrace::lastSummary();
+    if (timing.isEmpty()) {
+        ui->statusbar->showMessage(message, 3000);
+    } else {
+        ui->statusbar->showMessage(message + " | " + timing, 15000);
+    }
+}
+
+SubtitleDocument* MainWindow::currentDocument() const {
+    return m_documents.value(ui->tabWidget->currentWidget());
+}
+
+SubtitleDocument* MainWindow::findDocument(const QString& filePath) const {
+    const QString key = pathKey(filePath);
+    for (SubtitleDocument* document : m_documents) {
+        if (pathKey(document->filePath()) == key) {
+            return document;
+        }
+    }
+    return nullptr;
+}
+
+QTableView* MainWindow::viewForDocument(SubtitleDocument* document) const {
+    return qobject_cast<QTableView*>(m_documents.key(document));
+}
+
+void MainWindow::addDocument(SubtitleDocument* document) {
+    QTableView* view = new QTableView(ui->tabWidget);
+    view->setAlternatingRowColors(true);
+    view->setSelectionBehavior(QAbstractItemView::SelectRows);
+    view->setSortingEnabled(false);
+    
+    m_documents.insert(view, document);
+    connect(document, &SubtitleDocument::modifiedChanged, this, [this, document]() {
+        updateTabTitle(document);
+        if (document == currentDocument()) {
+            updateWindowTitle();
+        }
+    });
+    connect(document, &SubtitleDocument::saveFinished, this, [this, document](const QString& errorMsg) {
+        onSaveFinished(document, errorMsg);
+    });
+    
+    int index = ui->tabWidget->addTab(view, document->displayName());
+    updateTabTitle(document);
+    ui->tabWidget->setCurrentIndex(index);
+}
+
+void MainWindow::attachView(QTableView* view, SubtitleDocument* document) {
+    if (!document) return;
+    
+    SubtitleTableModel* model = document->model();
+    QItemSelectionModel* oldSelection = view->selectionModel();
+    view->setModel(model);
+    delete oldSelection;
+    
+    // 设置列宽
+    view->setColumnWidth(0, 60);
+    view->setColumnWidth(1, 120);
+    view->setColumnWidth(2, 120);
+    view->setColumnWidth(3, 400);
+    
+    connect(model, &SubtitleTableModel::dataChanged, this, &MainWindow::onTableDataChanged, Qt::UniqueConnection);
+    connect(model, &SubtitleTableModel::editRejected, this, [this](const QString& message) {
+        QMessageBox::warning(this, "错误", message);
+    });
+    connect(view->selectionModel(), &QItemSelectionModel::selectionChanged,
+            this, &MainWindow::onSelectionChanged);
+    m_timeline->setSubtitles(&document->subtitles(), model);
+}
+
+void MainWindow::detachView(QTableView* view) {
+    SubtitleDocument* document = m_documents.value(view);
+    m_timeline->setSubtitles(nullptr, nullptr);
+    
+    QItemSelectionModel* oldSelection = view->selectionModel();
+    view->setModel(nullptr);
+    delete oldSelection;
+    
+    if (document) {
+        document->releaseModel();
+    }
+}
+
+bool MainWindow::maybeSaveDocument(SubtitleDocument* document) {
+    // 先让正在进行的后台保存写完，再看是否还有未保存的修改
+    document->waitForSave();
+    if (!document->isModified()) return true;
+    
+    QMessageBox::StandardButton answer = QMessageBox::question(
+        this, "未保存的修改",
+        QString("“%1”已修改，是否保存？").arg(document->displayName()),
+        QMessageBox::Save | QMessageBox::Discard | QMessageBox::Cancel);
+    
+    if (answer == QMessageBox::Cancel) return false;
+    if (answer == QMessageBox::Discard) return true;
+    
+    if (document != currentDocument()) {
+        ui->tabWidget->setCurrentWidget(viewForDocument(document));
+    }
+    saveDocument(document, true);
+    return !document->isModified();
+}
+
+void MainWindow::selectRows(const QVector<int>& rows) {
+    if (!m_activeView || !m_activeView->model() || rows.isEmpty()) return;
+    
+    QAbstractItemModel* model = m_activeView->model();
+    int lastColumn = model->columnCount() - 1;
+    QItemSelection selection;
+    for (int row : rows) {
+        selection.select(model->index(row, 0), model->index(row, lastColumn));
+    }
+    m_activeView->selectionModel()->select(selection, QItemSelectionModel::ClearAndSelect);
+    m_activeView->scrollTo(model->index(rows.first(), 0));
 }
@@ -3,8 +3,19 @@
 
 #include <QMainWindow>
 #include <QVector>
-#include <QStandardItemModel>
+#include <QHash>
+#include <QSet>
+#include <QStringList>
+#include <QElapsedTimer>
 #include "subtitle.h"
+#include "subtitledocument.h"
+#include "libraryindex.h"
+
+class QFileSystemWatcher;
+class QTableView;
+class QTimer;
+class LibrarySearchDialog;
+class TimelineWidget;
 
 QT_BEGIN_NAMESPACE
 namespace Ui {
@@ -20,35 +31,121 @@ public:
     MainWindow(QWidget *parent = nullptr);
     ~MainWindow();
 
+protected:
+    void closeEvent(QCloseEvent* event) override;
+
 private slots:
     // 文件操作
     void onOpenFile();
     void onSaveFile();
     void onSaveAsFile();
+    void onCloseFile();
     
     // 编辑操作
     void onTimeShift();
+    void onTimeScale();
+    void onRangeSync();
     void onPointSync();
+    void onSortByTime();
+    void onReflow();
+    void onConform();
+    void onSnapToShots();
     
     // 表格编辑
     void onTableDataChanged(const QModelIndex& topLeft, const QModelIndex& bottomRight);
     void onSelectionChanged();
     
+    // 标签页
+    void onCurrentTabChanged(int index);
+    void onTabCloseRequested(int index);
+    
+    // 视图
+    void onJumpToTime();
+    void onTogglePlayback(bool enabled);
+    void onPlaybackTick();
+    void onToggleTimeline(bool visible);
+    
+    // 工具
+    void onBatchShift();
+    void onDuplicateTexts();
+    void onCompare();
+    void onMergeBilingual();
+    void onTextTransform();
+    void onSearchLibrary();
+    void onJoinParts();
+    void onSplitFile();
+    void onTogglePerfStats(bool enabled);
+    
+    // 启动时检查上次异常退出留下的编辑日志
+    void checkRecoverableSessions();
+    
+    // 打开的文件在外部被修改
+    void onFileChangedOnDisk(const QString& filePath);
+    void checkChangedFiles();
+
 private:
     Ui::MainWindow *ui;
     
-    QVector<SubtitleItem> m_subtitles;
-    QStandardItemModel* m_tableModel;
-    QString m_currentFilePath;
-    bool m_modified;
-    SubtitleEncoding m_currentEncoding;
+    // 每个标签页的表格视图对应一个文档
+    QHash<QWidget*, SubtitleDocument*> m_documents;
+    QTableView* m_activeView;
+    SubtitleEncoding m_lastEncoding;
+    QString m_dictionaryDirectory;      // 简繁转换使用的 OpenCC 词典目录，本次运行内记住
+    LibrarySearchDialog* m_librarySearch;   // 第一次使用时创建，关闭后保留目录和索引
+    
+    // 当前视图选中行的首尾（-1 表示没有选中）
+    int m_selectionFirst;
+    int m_selectionLast;
+    bool m_selectionContiguous;         // 选中的行是否连成一段，不连续时不能按“选中行”重定时
+    
+    // 正在后台解析的文件
+    int m_pendingLoads;
+    int m_loadedFiles;
+    int m_loadedSubtitles;
+    QStringList m_loadErrors;
+    QSet<QString> m_loadingPaths;       // 正在加载的文件（规范化路径）
+    QHash<QString, LibraryIndex::Hit> m_pendingCueJumps;  // 加载完成后要定位的搜索结果（按规范化路径）
+    
+    // 播放预览
+    QTimer* m_playbackTimer;
+    QElapsedTimer m_playbackClock;
+    int m_playbackStartMs;
+    QVector<int> m_playbackRows;
+    
+    // 当前文档的时间轴
+    TimelineWidget* m_timeline;
+    
+    // 监视打开的文件，外部修改合并一小段时间后再检查
+    QFileSystemWatcher* m_fileWatcher;
+    QTimer* m_diskCheckTimer;
+    QSet<QString> m_changedFiles;
+    QSet<SubtitleDocument*> m_reloadingDocuments;
     
     // 辅助函数
-    void loadSubtitles(const QString& filePath, SubtitleEncoding encoding);
-    void saveSubtitles(const QString& filePath);
-    void updateTableView();
+    void loadSubtitles(const QStringList& filePaths, SubtitleEncoding encoding);
+    void onLoadFinished(const SubtitleLoadResult& result);
+    bool saveDocument(SubtitleDocument* document, bool wait);
+    bool saveDocumentAs(SubtitleDocument* document, bool wait);
+    bool saveSubtitles(SubtitleDocument* document, const QString& filePath, SubtitleEncoding encoding, bool wait);
+    void onSaveFinished(SubtitleDocument* document, const QString& errorMsg);
+    void reloadDocument(SubtitleDocument* document);
+    void updateWatchedFiles();
+    void updateTableRows(int first, int last);
     void setModified(bool modified);
     void updateWindowTitle();
-    bool promptEncodingSelection(SubtitleEncoding& encoding);
+    void updateTabTitle(SubtitleDocument* document);
+    bool promptEncodingSelection(SubtitleEncoding& encoding, const QString& title = "请选择字幕文件编码：");
+    void showStatusMessage(const QString& message);
+    
+    SubtitleDocument* currentDocument() const;
+    SubtitleDocument* findDocument(const QString& filePath) const;
+    QTableView* viewForDocument(SubtitleDocument* document) const;
+    void addDocument(SubtitleDocument* document);
+    void openAtRow(const LibraryIndex::Hit& hit);
+    void jumpToHit(SubtitleDocument* document, const LibraryIndex::Hit& hit);
+    void attachView(QTableView* view, SubtitleDocument* document);
+    void detachView(QTableView* view);
+    bool maybeSaveDocument(SubtitleDocument* document);
+    void selectRows(const QVector<int>& rows);
 };
 #endif // MAINWINDOW_H
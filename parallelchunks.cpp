@@ -0,0 +1,28 @@
+#include "parallelchunks.h"
+#include <QThreadPool>
+#include <QVector>
+#include <QtConcurrent/QtConcurrentMap>
+
+int ParallelChunks::chunkCount(int count) {
+    return count > 0 ? (count + kChunkSize - 1) / kChunkSize : 0;
+}
+
+void ParallelChunks::run(int count, QThreadPool* pool, const std::function<void(int chunk, int begin, int end)>& work) {
+    const int chunks = chunkCount(count);
+    auto runChunk = [count, &work](int chunk) {
+        const int begin = chunk * kChunkSize;
+        work(chunk, begin, qMin(begin + kChunkSize, count));
+    };
+    if (!pool || chunks <= 1) {
+        for (int chunk = 0; chunk < chunks; ++chunk) {
+            runChunk(chunk);
+        }
+        return;
+    }
+    
+    QVector<int> indices(chunks);
+    for (int chunk = 0; chunk < chunks; ++chunk) {
+        indices[chunk] = chunk;
+    }
+    QtConcurrent::blockingMap(pool, indices, [&runChunk](int& chunk) { runChunk(chunk); });
+}
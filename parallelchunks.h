@@ -0,0 +1,20 @@
+#ifndef PARALLELCHUNKS_H
+#define PARALLELCHUNKS_H
+
+#include <functional>
+
+class QThreadPool;
+
+// 按固定条数把 [0, count) 分块，在线程池中并行处理
+// 各块互不依赖；调用方按块号存放每块的结果，按块号顺序合并即与单线程结果一致
+class ParallelChunks {
+public:
+    static constexpr int kChunkSize = 4096;
+    
+    static int chunkCount(int count);
+    
+    // work(块号, 起始行, 结束行)；pool 为空或只有一块时在当前线程依次处理
+    static void run(int count, QThreadPool* pool, const std::function<void(int chunk, int begin, int end)>& work);
+};
+
+#endif // PARALLELCHUNKS_H
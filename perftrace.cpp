@@ -0,0 +1,210 @@
+#include "perftrace.h"
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QStringList>
+#include <QThread>
+#include <QVector>
+
+namespace {
+
+struct PhaseRecord {
+    const char* phase;
+    qint64 startNs;
+    qint64 durationNs;
+    qint64 count;
+    quint64 threadId;
+};
+
+// 缓存的trace事件达到这么多条，或距上次写出超过这么久时追加到文件
+const int kTraceFlushEvents = 1024;
+const qint64 kTraceFlushIntervalNs = 2000000000LL;
+
+struct TraceState {
+    QMutex mutex;
+    QElapsedTimer clock;
+    QVector<PhaseRecord> currentOperation;   // 当前一轮操作的阶段
+    QVector<PhaseRecord> traceEvents;        // 待写入trace文件的事件
+    QString traceFilePath;
+    qint64 traceEventsWritten = 0;           // 已写入文件的事件数
+    qint64 lastTraceFlushNs = 0;
+};
+
+TraceState& state() {
+    static TraceState s;
+    return s;
+}
+
+QString escapeJson(const char* text) {
+    QString result = QString::fromUtf8(text);
+    result.replace('\\', "\\\\");
+    result.replace('"', "\\\"");
+    return result;
+}
+
+// 把缓存的事件追加到trace文件末尾并清空缓存；调用方持有锁
+// 使用 JSON 数组格式，结尾的 ] 可以省略，进程异常退出时已写出的事件仍然可以打开
+void appendTraceEvents(TraceState& s) {
+    if (s.traceFilePath.isEmpty() || s.traceEvents.isEmpty()) return;
+
+    QFile file(s.traceFilePath);
+    if (file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        const qint64 pid = QCoreApplication::applicationPid();
+        QByteArray out;
+        out.reserve(s.traceEvents.size() * 128);
+        for (const PhaseRecord& r : s.traceEvents) {
+            if (s.traceEventsWritten++ > 0) out += ",\n";
+            // Chrome trace 的时间单位为微秒
+            QString line = QString("{\"name\":\"%1\",\"cat\":\"subtitle\",\"ph\":\"X\","
+                                   "\"ts\":%2,\"dur\":%3,\"pid\":%4,\"tid\":%5,\"args\":{\"count\":%6}}")
+                .arg(escapeJson(r.phase))
+                .arg(r.startNs / 1000.0, 0, 'f', 3)
+                .arg(r.durationNs / 1000.0, 0, 'f', 3)
+                .arg(pid)
+                .arg(r.threadId)
+                .arg(r.count);
+            out += line.toUtf8();
+        }
+        file.write(out);
+    }
+    // 写入失败时同样丢弃，缓存不会无限增长
+    s.traceEvents.clear();
+    s.lastTraceFlushNs = s.clock.isValid() ? s.clock.nsecsElapsed() : 0;
+}
+
+}
+
+std::atomic<bool> PerfTrace::s_enabled(false);
+
+void PerfTrace::setEnabled(bool enabled) {
+    TraceState& s = state();
+    QMutexLocker locker(&s.mutex);
+    if (enabled && !s.clock.isValid()) {
+        s.clock.start();
+    }
+    s_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+void PerfTrace::initFromEnvironment() {
+    const QString tracePath = qEnvironmentVariable("SUBTITLEEDIT_TRACE");
+    if (!tracePath.isEmpty()) {
+        QString errorMsg;
+        if (!setTraceFile(tracePath, errorMsg)) {
+            qWarning("%s", qPrintable(errorMsg));
+        }
+        return;
+    }
+
+    if (qEnvironmentVariableIntValue("SUBTITLEEDIT_PERF") != 0) {
+        setEnabled(true);
+    }
+}
+
+bool PerfTrace::setTraceFile(const QString& filePath, QString& errorMsg) {
+    if (!filePath.isEmpty()) {
+        // 先写出数组开头，同时尽早暴露路径错误
+        QFile file(filePath);
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate) || file.write("[\n") != 2) {
+            errorMsg = "无法创建trace文件: " + filePath;
+            return false;
+        }
+        file.close();
+    }
+
+    {
+        TraceState& s = state();
+        QMutexLocker locker(&s.mutex);
+        appendTraceEvents(s);
+        s.traceFilePath = filePath;
+        s.traceEvents.clear();
+        s.traceEventsWritten = 0;
+    }
+
+    if (!filePath.isEmpty()) {
+        setEnabled(true);
+    }
+    return true;
+}
+
+void PerfTrace::flushTraceFile() {
+    TraceState& s = state();
+    QMutexLocker locker(&s.mutex);
+    appendTraceEvents(s);
+}
+
+void PerfTrace::beginOperation() {
+    if (!isEnabled()) return;
+    TraceState& s = state();
+    QMutexLocker locker(&s.mutex);
+    s.currentOperation.clear();
+}
+
+QString PerfTrace::lastSummary() {
+    if (!isEnabled()) return QString();
+
+    TraceState& s = state();
+    QMutexLocker locker(&s.mutex);
+    QStringList parts;
+    qint64 maxCount = 0;
+    for (const PhaseRecord& r : s.currentOperation) {
+        parts << QString("%1 %2 ms").arg(QString::fromUtf8(r.phase)).arg(r.durationNs / 1e6, 0, 'f', 1);
+        maxCount = qMax(maxCount, r.count);
+    }
+    if (parts.isEmpty()) return QString();
+
+    QString summary = parts.join(" · ");
+    if (maxCount > 0) {
+        summary += QString("（%1 条）").arg(maxCount);
+    }
+    return summary;
+}
+
+qint64 PerfTrace::nowNs() {
+    // setEnabled 可能同时在其他线程中启动时钟，读取时也要加锁
+    TraceState& s = state();
+    QMutexLocker locker(&s.mutex);
+    return s.clock.isValid() ? s.clock.nsecsElapsed() : 0;
+}
+
+void PerfTrace::record(const char* phase, qint64 startNs, qint64 durationNs, qint64 count) {
+    PhaseRecord r;
+    r.phase = phase;
+    r.startNs = startNs;
+    r.durationNs = durationNs;
+    r.count = count;
+    r.threadId = static_cast<quint64>(reinterpret_cast<quintptr>(QThread::currentThreadId()));
+
+    TraceState& s = state();
+    QMutexLocker locker(&s.mutex);
+    s.currentOperation.append(r);
+    if (s.currentOperation.size() > 256) {
+        // 调用方忘记 beginOperation 时避免无限增长
+        s.currentOperation.remove(0, s.currentOperation.size() - 256);
+    }
+    if (!s.traceFilePath.isEmpty()) {
+        s.traceEvents.append(r);
+        // 定期写出，长时间运行时缓存不会无限增长，异常退出也只丢失最近一小段
+        if (s.traceEvents.size() >= kTraceFlushEvents
+            || s.clock.nsecsElapsed() - s.lastTraceFlushNs >= kTraceFlushIntervalNs) {
+            appendTraceEvents(s);
+        }
+    }
+}
+
+PerfTrace::Scope::Scope(const char* phase)
+    : m_phase(phase)
+    , m_count(0)
+    , m_startNs(0)
+    , m_active(PerfTrace::isEnabled())
+{
+    if (m_active) {
+        m_startNs = PerfTrace::nowNs();
+    }
+}
+
+PerfTrace::Scope::~Scope() {
+    if (!m_active) return;
+    PerfTrace::record(m_phase, m_startNs, PerfTrace::nowNs() - m_startNs, m_count);
+}
@@ -1,4 +1,5 @@
 #include "pointsyncdialog.h"
+#include "perftrace.h"
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QLabel>
@@ -9,19 +10,23 @@
 #include <QSplitter>
 #include <QColor>
 #include <QBrush>
+#include <QItemSelectionModel>
 #include <cmath>
 
 PointSyncDialog::PointSyncDialog(const QVector<SubtitleItem>& sourceSubtitles, QWidget *parent)
     : QDialog(parent)
     , m_originalSubtitles(sourceSubtitles)
     , m_sourceSubtitles(sourceSubtitles)
+    , m_sourceModel(nullptr)
+    , m_referenceModel(nullptr)
     , m_applied(false)
 {
     setWindowTitle("点同步 - 通过参考字幕同步");
     resize(1200, 700);
     
     setupUI();
-    updateSourceTable();
+    updateSyncPointsList();
+    m_ranker.setSource(m_originalSubtitles);
 }
 
 PointSyncDialog::~PointSyncDialog()
@@ -51,15 +56,18 @@ void PointSyncDialog::setupUI()
     QLabel* sourceLabel = new QLabel("<b>当前字幕（源）</b>", leftWidget);
     leftLayout->addWidget(sourceLabel);
     
-    m_sourceTable = new QTableWidget(leftWidget);
-    m_sourceTable->setColumnCount(3);
-    m_sourceTable->setHorizontalHeaderLabels({"序号", "时间", "文本"});
+    m_sourceModel = new SyncTrackModel(&m_sourceSubtitles, this);
+    m_sourceTable = new QTableView(leftWidget);
+    m_sourceTable->setModel(m_sourceModel);
     m_sourceTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
     m_sourceTable->setSelectionBehavior(QAbstractItemView::SelectRows);
     m_sourceTable->setSelectionMode(QAbstractItemView::SingleSelection);
     m_sourceTable->horizontalHeader()->setStretchLastSection(true);
     m_sourceTable->setColumnWidth(0, 50);
     m_sourceTable->setColumnWidth(1, 100);
+    // 行高固定，视图不必逐行测量，长字幕轨也能立即显示
+    m_sourceTable->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+    m_sourceTable->setWordWrap(false);
     leftLayout->addWidget(m_sourceTable);
     
     splitter->addWidget(leftWidget);
@@ -85,6 +93,20 @@ void PointSyncDialog::setupUI()
     m_removePointButton->setEnabled(false);
     centerLayout->addWidget(m_removePointButton);
     
+    QLabel* fitLabel = new QLabel("拟合方式：", centerWidget);
+    centerLayout->addWidget(fitLabel);
+    m_fitModeCombo = new QComboBox(centerWidget);
+    for (int mode = 0; mode < SyncFitter::ModeCount; ++mode) {
+        m_fitModeCombo->addItem(SyncFitter::modeName(SyncFitter::Mode(mode)), mode);
+    }
+    m_fitModeCombo->setToolTip("同步点较多或可能有点错时，选择稳健拟合可以自动剔除离群点");
+    centerLayout->addWidget(m_fitModeCombo);
+    
+    m_fitSummaryLabel = new QLabel(centerWidget);
+    m_fitSummaryLabel->setWordWrap(true);
+    m_fitSummaryLabel->setStyleSheet("color: #666;");
+    centerLayout->addWidget(m_fitSummaryLabel);
+    
     centerLayout->addStretch();
     
     splitter->addWidget(centerWidget);
@@ -102,15 +124,18 @@ void PointSyncDialog::setupUI()
     rightHeaderLayout->addWidget(m_loadRefButton);
     rightLayout->addLayout(rightHeaderLayout);
     
-    m_referenceTable = new QTableWidget(rightWidget);
-    m_referenceTable->setColumnCount(3);
-    m_referenceTable->setHorizontalHeaderLabels({"序号", "时间", "文本"});
+    m_referenceModel = new SyncTrackModel(&m_referenceSubtitles, this);
+    m_referenceTable = new QTableView(rightWidget);
+    m_referenceTable->setModel(m_referenceModel);
     m_referenceTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
     m_referenceTable->setSelectionBehavior(QAbstractItemView::SelectRows);
     m_referenceTable->setSelectionMode(QAbstractItemView::SingleSelection);
     m_referenceTable->horizontalHeader()->setStretchLastSection(true);
     m_referenceTable->setColumnWidth(0, 50);
     m_referenceTable->setColumnWidth(1, 100);
+    // 行高固定，视图不必逐行测量，长字幕轨也能立即显示
+    m_referenceTable->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+    m_referenceTable->setWordWrap(false);
     rightLayout->addWidget(m_referenceTable);
     
     splitter->addWidget(rightWidget);
@@ -155,53 +180,31 @@ void PointSyncDialog::setupUI()
     connect(m_finishButton, &QPushButton::clicked, this, &PointSyncDialog::onFinish);
     connect(m_closeButton, &QPushButton::clicked, this, &QDialog::reject);
     
-    connect(m_sourceTable, &QTableWidget::itemSelectionChanged, 
+    connect(m_sourceTable->selectionModel(), &QItemSelectionModel::selectionChanged,
             this, &PointSyncDialog::onSourceSelectionChanged);
-    connect(m_referenceTable, &QTableWidget::itemSelectionChanged, 
+    connect(m_referenceTable->selectionModel(), &QItemSelectionModel::selectionChanged,
             this, &PointSyncDialog::onReferenceSelectionChanged);
+    connect(m_fitModeCombo, QOverload<int>::of(&QComboBox::currentIndexChanged),
+            this, &PointSyncDialog::updateSyncPointsList);
     connect(m_syncPointsList, &QListWidget::itemDoubleClicked,
             this, &PointSyncDialog::onSyncPointDoubleClicked);
 }
 
 void PointSyncDialog::updateSourceTable()
 {
-    updateSourceTable(m_sourceSubtitles);
-}
-
-void PointSyncDialog::updateSourceTable(const QVector<SubtitleItem>& subtitles)
-{
-    m_sourceTable->setRowCount(0);
-    
-    for (int i = 0; i < subtitles.size(); ++i) {
-        const SubtitleItem& item = subtitles[i];
-        
-        int row = m_sourceTable->rowCount();
-        m_sourceTable->insertRow(row);
-        
-        m_sourceTable->setItem(row, 0, new QTableWidgetItem(QString::number(i + 1)));
-        m_sourceTable->setItem(row, 1, new QTableWidgetItem(SRTParser::formatTime(item.startTime)));
-        m_sourceTable->setItem(row, 2, new QTableWidgetItem(item.text.left(50) + (item.text.length() > 50 ? "..." : "")));
-    }
+    // 应用/重置只改变时间，行数不变，不需要重置模型
+    m_sourceModel->notifyTimesChanged();
 }
 
-void PointSyncDialog::updateReferenceTable()
+int PointSyncDialog::selectedRow(QTableView* table) const
 {
-    m_referenceTable->setRowCount(0);
-    
-    for (int i = 0; i < m_referenceSubtitles.size(); ++i) {
-        const SubtitleItem& item = m_referenceSubtitles[i];
-        
-        int row = m_referenceTable->rowCount();
-        m_referenceTable->insertRow(row);
-        
-        m_referenceTable->setItem(row, 0, new QTableWidgetItem(QString::number(i + 1)));
-        m_referenceTable->setItem(row, 1, new QTableWidgetItem(SRTParser::formatTime(item.startTime)));
-        m_referenceTable->setItem(row, 2, new QTableWidgetItem(item.text.left(50) + (item.text.length() > 50 ? "..." : "")));
-    }
+    QModelIndexList rows = table->selectionModel()->selectedRows();
+    return rows.isEmpty() ? -1 : rows.first().row();
 }
 
 void PointSyncDialog::updateSyncPointsList()
 {
+    updateFit();
     m_syncPointsList->clear();
     
     for (int i = 0; i < m_syncPoints.size(); ++i) {
@@ -212,11 +215,56 @@ void PointSyncDialog::updateSyncPointsList()
             .arg(SRTParser::formatTime(sp.sourceTime))
             .arg(sp.referenceIndex + 1)
             .arg(SRTParser::formatTime(sp.referenceTime));
-        m_syncPointsList->addItem(text);
+        
+        QListWidgetItem* item = new QListWidgetItem(m_syncPointsList);
+        if (m_fit.ok && fitMode() != SyncFitter::Interpolate) {
+            text += QString("  残差 %1 ms").arg(qRound(m_fit.residuals[i]));
+            if (m_fit.outliers[i]) {
+                text += "  ⚠ 离群";
+                item->setForeground(QBrush(QColor(200, 40, 40)));
+                item->setToolTip("该点与其余同步点给出的映射相差较大，可能选错了对应的参考字幕");
+            }
+        }
+        item->setText(text);
     }
     
     m_removePointButton->setEnabled(!m_syncPoints.isEmpty());
-    m_applyButton->setEnabled(m_syncPoints.size() >= 2);
+    m_applyButton->setEnabled(m_fit.ok);
+}
+
+SyncFitter::Mode PointSyncDialog::fitMode() const
+{
+    return SyncFitter::Mode(m_fitModeCombo->currentData().toInt());
+}
+
+void PointSyncDialog::updateFit()
+{
+    QVector<QPair<int, int>> points;
+    points.reserve(m_syncPoints.size());
+    for (const SyncPoint& sp : m_syncPoints) {
+        points.append(qMakePair(sp.sourceTime.msecsSinceStartOfDay(), sp.referenceTime.msecsSinceStartOfDay()));
+    }
+    
+    SyncFitter::Mode mode = fitMode();
+    m_fit = SyncFitter::fit(points, mode);
+    
+    if (!m_fit.ok) {
+        m_fitSummaryLabel->setText(QString("至少需要 %1 个同步点").arg(SyncFitter::minimumPoints(mode)));
+    } else if (mode == SyncFitter::Interpolate) {
+        m_fitSummaryLabel->setText("映射严格经过每个同步点");
+    } else {
+        QString summary = QString("残差均方根 %1 ms").arg(m_fit.rmsMs, 0, 'f', 0);
+        if (m_fit.transform.kind() == RetimeTransform::Affine) {
+            summary += QString("\n速度 ×%1，偏移 %2 s")
+                .arg(m_fit.transform.factor(), 0, 'f', 5)
+                .arg(m_fit.transform.offset() / 1000.0, 0, 'f', 3);
+        }
+        if (m_fit.outlierCount > 0) {
+            summary += QString("\n%1 个离群点%2").arg(m_fit.outlierCount)
+                .arg(mode == SyncFitter::LeastSquares ? "（最小二乘仍会使用它们）" : "已排除");
+        }
+        m_fitSummaryLabel->setText(summary);
+    }
 }
 
 void PointSyncDialog::onLoadReference()
@@ -224,162 +272,111 @@ void PointSyncDialog::onLoadReference()
     QString filePath = QFileDialog::getOpenFileName(this, "加载参考字幕", "", "SRT文件 (*.srt);;所有文件 (*)");
     if (filePath.isEmpty()) return;
     
+    // 解析失败时保留原来的参考字幕
     QString errorMsg;
-    if (!SRTParser::parse(filePath, m_referenceSubtitles, errorMsg)) {
+    QVector<SubtitleItem> reference;
+    if (!SRTParser::parse(filePath, reference, errorMsg)) {
         QMessageBox::critical(this, "错误", "无法加载参考字幕：\n" + errorMsg);
         return;
     }
     
-    updateReferenceTable();
-    QMessageBox::information(this, "成功", QString("已加载 %1 条参考字幕").arg(m_referenceSubtitles.size()));
+    m_referenceModel->beginResetRows();
+    m_referenceSubtitles = reference;
+    m_referenceModel->endResetRows();
+    m_ranker.setReference(m_referenceSubtitles);
+    
+    QString message = QString("已加载 %1 条参考字幕").arg(m_referenceSubtitles.size());
+    if (m_ranker.estimatedOffset() != 0) {
+        message += QString("\n根据文本匹配估计两轨相差约 %1 秒").arg(m_ranker.estimatedOffset() / 1000.0, 0, 'f', 1);
+    }
+    QMessageBox::information(this, "成功", message);
 }
 
 void PointSyncDialog::onSourceSelectionChanged()
 {
-    QList<QTableWidgetItem*> selected = m_sourceTable->selectedItems();
-    if (selected.isEmpty()) {
+    int row = selectedRow(m_sourceTable);
+    if (row < 0) {
         m_addPointButton->setEnabled(false);
         return;
     }
     
-    int row = selected[0]->row();
-    if (row >= 0 && row < m_sourceSubtitles.size()) {
-        QTime sourceTime = m_sourceSubtitles[row].startTime;
-        highlightReferenceByTime(sourceTime);
+    if (row < m_sourceSubtitles.size()) {
+        highlightReferenceCandidates(row);
         
         // 检查是否可以添加同步点
-        QList<QTableWidgetItem*> refSelected = m_referenceTable->selectedItems();
-        m_addPointButton->setEnabled(!refSelected.isEmpty());
+        m_addPointButton->setEnabled(selectedRow(m_referenceTable) >= 0);
     }
 }
 
 void PointSyncDialog::onReferenceSelectionChanged()
 {
-    QList<QTableWidgetItem*> srcSelected = m_sourceTable->selectedItems();
-    QList<QTableWidgetItem*> refSelected = m_referenceTable->selectedItems();
-    
-    m_addPointButton->setEnabled(!srcSelected.isEmpty() && !refSelected.isEmpty());
+    m_addPointButton->setEnabled(selectedRow(m_sourceTable) >= 0 && selectedRow(m_referenceTable) >= 0);
 }
 
-void PointSyncDialog::highlightReferenceByTime(const QTime& sourceTime)
+int PointSyncDialog::expectedReferenceTime(int sourceRow) const
 {
-    if (m_referenceSubtitles.isEmpty()) return;
+    int sourceMs = m_sourceSubtitles[sourceRow].startTime.msecsSinceStartOfDay();
     
-    // 先清除所有高亮
-    for (int i = 0; i < m_referenceTable->rowCount(); ++i) {
-        for (int col = 0; col < m_referenceTable->columnCount(); ++col) {
-            QTableWidgetItem* item = m_referenceTable->item(i, col);
-            if (item) {
-                item->setBackground(QBrush(Qt::white));
-            }
-        }
-    }
-    
-    // 计算每个参考字幕与源字幕的时间差（绝对值）
-    QVector<QPair<int, int>> timeDiffs; // <行号, 时间差毫秒>
-    
-    for (int i = 0; i < m_referenceSubtitles.size(); ++i) {
-        int diff = std::abs(sourceTime.msecsTo(m_referenceSubtitles[i].startTime));
-        timeDiffs.append(qMakePair(i, diff));
+    // 已应用预览时左侧显示的就是同步后的时间
+    if (!m_syncedSubtitles.isEmpty()) {
+        return sourceMs;
     }
     
-    // 找到最小时间差
-    int minDiff = timeDiffs[0].second;
-    for (const auto& pair : timeDiffs) {
-        minDiff = qMin(minDiff, pair.second);
+    // 同步点足够时使用当前拟合的映射
+    if (m_fit.ok) {
+        return m_fit.transform.map(sourceMs);
     }
     
-    // 如果最小时间差超过30秒，说明根本不可能匹配，不高亮任何行
-    if (minDiff > 30000) {
-        return;
-    }
-    
-    // 计算时间差的标准差（用于确定高亮范围）
-    // 只考虑时间差较小的那些候选项
-    QVector<int> candidateDiffs;
-    for (const auto& pair : timeDiffs) {
-        if (pair.second <= minDiff + 10000) { // 只取最小值+10秒内的
-            candidateDiffs.append(pair.second);
-        }
-    }
-    
-    // 计算平均值和标准差
-    double sum = 0;
-    for (int diff : candidateDiffs) {
-        sum += diff;
-    }
-    double mean = candidateDiffs.isEmpty() ? 0 : sum / candidateDiffs.size();
-    
-    double variance = 0;
-    for (int diff : candidateDiffs) {
-        variance += (diff - mean) * (diff - mean);
-    }
-    double stdDev = candidateDiffs.size() <= 1 ? 1000 : std::sqrt(variance / candidateDiffs.size());
-    
-    // 使用高斯分布的思想：计算每个候选项的"概率"
-    // 只高亮在 minDiff + 2*stdDev 范围内的，且概率总和归一化
-    double totalProbability = 0;
-    QVector<QPair<int, double>> probabilities; // <行号, 概率>
-    
-    double threshold = minDiff + std::max(2.0 * stdDev, 3000.0); // 至少3秒阈值
-    
-    for (const auto& pair : timeDiffs) {
-        int diff = pair.second;
-        if (diff <= threshold) {
-            // 使用指数衰减函数计算"概率"（越近概率越高）
-            // probability = exp(-diff^2 / (2 * scale^2))
-            double scale = std::max(stdDev, 1000.0); // 至少1秒的scale
-            double prob = std::exp(-std::pow(diff / scale, 2) / 2.0);
-            probabilities.append(qMakePair(pair.first, prob));
-            totalProbability += prob;
+    // 有同步点时使用最近同步点的偏移，否则使用文本匹配估计的整体偏移
+    if (!m_syncPoints.isEmpty()) {
+        const SyncPoint* nearest = &m_syncPoints[0];
+        for (const SyncPoint& sp : m_syncPoints) {
+            if (std::abs(sp.sourceTime.msecsSinceStartOfDay() - sourceMs) <
+                std::abs(nearest->sourceTime.msecsSinceStartOfDay() - sourceMs)) {
+                nearest = &sp;
+            }
         }
+        return sourceMs + nearest->sourceTime.msecsTo(nearest->referenceTime);
     }
+    return sourceMs + m_ranker.estimatedOffset();
+}
+
+void PointSyncDialog::highlightReferenceCandidates(int sourceRow)
+{
+    if (m_referenceSubtitles.isEmpty()) return;
     
-    // 归一化概率，只有当累积概率达到0.95时才停止（保留最可能的候选项）
-    // 按概率从大到小排序
-    std::sort(probabilities.begin(), probabilities.end(), 
-              [](const QPair<int, double>& a, const QPair<int, double>& b) {
-                  return a.second > b.second;
-              });
-    
-    double cumulativeProbability = 0;
-    QVector<QPair<int, double>> selectedCandidates;
+    QVector<SyncCandidateRanker::Candidate> candidates =
+        m_ranker.rank(sourceRow, expectedReferenceTime(sourceRow), 5);
     
-    for (const auto& prob : probabilities) {
-        if (cumulativeProbability >= 0.95 && selectedCandidates.size() >= 3) {
-            break; // 已经包含了95%的可能性，且至少有3个候选
-        }
-        selectedCandidates.append(prob);
-        cumulativeProbability += prob.second / totalProbability;
+    // 设置颜色 - 按相对最佳候选的得分设置颜色深度，明显更差的候选不高亮
+    const double bestScore = candidates.isEmpty() ? 0.0 : candidates[0].score;
+    if (bestScore <= 0.01) {
+        m_referenceModel->clearHighlights();
+        return;
     }
     
-    // 设置颜色 - 只给筛选出的候选项上色
-    for (const auto& candidate : selectedCandidates) {
-        int rowIndex = candidate.first;
-        double normalizedProb = candidate.second / (selectedCandidates.isEmpty() ? 1.0 : selectedCandidates[0].second);
+    QVector<SyncTrackModel::Highlight> highlights;
+    for (const SyncCandidateRanker::Candidate& candidate : candidates) {
+        double normalizedScore = candidate.score / bestScore;
+        if (normalizedScore < 0.3) break;
         
-        // 根据归一化概率设置颜色深度
-        int alpha = static_cast<int>(80 + normalizedProb * 170); // 80-250
-        QColor color(100, 150, 255, alpha);
-        
-        for (int col = 0; col < m_referenceTable->columnCount(); ++col) {
-            QTableWidgetItem* item = m_referenceTable->item(rowIndex, col);
-            if (item) {
-                item->setBackground(QBrush(color));
-            }
-        }
+        int alpha = static_cast<int>(80 + normalizedScore * 170); // 80-250
+        QString tip = QString("文本相似度 %1% · 时间接近度 %2%")
+            .arg(qRound(candidate.textScore * 100))
+            .arg(qRound(candidate.timeScore * 100));
+        highlights.append(SyncTrackModel::Highlight(candidate.referenceIndex, QColor(100, 150, 255, alpha), tip));
     }
+    m_referenceModel->setHighlights(highlights);
+    
+    // 最佳候选可能离当前滚动位置很远
+    m_referenceTable->scrollTo(m_referenceModel->index(candidates[0].referenceIndex, 0),
+                               QAbstractItemView::PositionAtCenter);
 }
 
 void PointSyncDialog::onAddSyncPoint()
 {
-    QList<QTableWidgetItem*> srcSelected = m_sourceTable->selectedItems();
-    QList<QTableWidgetItem*> refSelected = m_referenceTable->selectedItems();
-    
-    if (srcSelected.isEmpty() || refSelected.isEmpty()) return;
-    
-    int srcRow = srcSelected[0]->row();
-    int refRow = refSelected[0]->row();
+    int srcRow = selectedRow(m_sourceTable);
+    int refRow = selectedRow(m_referenceTable);
     
     if (srcRow < 0 || srcRow >= m_sourceSubtitles.size() ||
         refRow < 0 || refRow >= m_referenceSubtitles.size()) {
@@ -435,8 +432,9 @@ void PointSyncDialog::onSyncPointDoubleClicked(QListWidgetItem* item)
 
 void PointSyncDialog::onApply()
 {
-    if (m_syncPoints.size() < 2) {
-        QMessageBox::warning(this, "警告", "至少需要2个同步点才能进行同步");
+    if (!m_fit.ok) {
+        QMessageBox::warning(this, "警告",
+                             QString("至少需要%1个同步点才能进行同步").arg(SyncFitter::minimumPoints(fitMode())));
         return;
     }
     
@@ -444,7 +442,7 @@ void PointSyncDialog::onApply()
     
     // 更新左侧表格显示同步后的效果
     m_sourceSubtitles = m_syncedSubtitles;
-    updateSourceTable(m_syncedSubtitles);
+    updateSourceTable();
     
     // 启用重置和完成按钮
     m_resetButton->setEnabled(true);
@@ -456,9 +454,10 @@ void PointSyncDialog::onApply()
     
     // 状态栏提示（如果有的话）
     QMessageBox::information(this, "预览成功", 
-        QString("已应用 %1 个同步点的分段线性变换\n"
+        QString("已按“%1”应用 %2 个同步点\n"
                 "左侧表格已更新显示同步后的时间\n"
                 "您可以继续调整同步点，或点击'完成'按钮确认")
+        .arg(SyncFitter::modeName(fitMode()))
         .arg(m_syncPoints.size()));
 }
 
@@ -467,7 +466,7 @@ void PointSyncDialog::onReset()
     // 重置到原始状态
     m_sourceSubtitles = m_originalSubtitles;
     m_syncedSubtitles.clear();
-    updateSourceTable(m_originalSubtitles);
+    updateSourceTable();
     
     m_resetButton->setEnabled(false);
     m_finishButton->setEnabled(false);
@@ -488,9 +487,18 @@ void PointSyncDialog::onFinish()
 
 void PointSyncDialog::applySyncTransformation()
 {
+    PerfTrace::Scope scope("sync");
+    scope.setCount(m_originalSubtitles.size());
+    
     // 总是从原始字幕开始计算，这样可以重复应用而不累积误差
     m_syncedSubtitles = m_originalSubtitles;
     
+    // 拟合模式直接使用拟合出的映射；逐点插值沿用下面按段插值、保持时长的算法
+    if (fitMode() != SyncFitter::Interpolate) {
+        m_fit.transform.apply(m_syncedSubtitles, 0, m_syncedSubtitles.size() - 1);
+        return;
+    }
+    
     // 分段线性变换
     for (int i = 0; i < m_syncedSubtitles.size(); ++i) {
         SubtitleItem& item = m_syncedSubtitles[i];
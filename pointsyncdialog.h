@@ -2,11 +2,16 @@
 #define POINTSYNCDIALOG_H
 
 #include <QDialog>
-#include <QTableWidget>
+#include <QTableView>
 #include <QListWidget>
 #include <QPushButton>
+#include <QComboBox>
+#include <QLabel>
 #include <QVector>
 #include "subtitle.h"
+#include "syncmatcher.h"
+#include "synctrackmodel.h"
+#include "syncfit.h"
 
 struct SyncPoint {
     int sourceIndex;      // 源字幕索引（左侧）
@@ -46,15 +51,19 @@ private slots:
 private:
     void setupUI();
     void updateSourceTable();
-    void updateSourceTable(const QVector<SubtitleItem>& subtitles);
-    void updateReferenceTable();
+    int selectedRow(QTableView* table) const;
     void updateSyncPointsList();
-    void highlightReferenceByTime(const QTime& sourceTime);
+    void highlightReferenceCandidates(int sourceRow);
+    int expectedReferenceTime(int sourceRow) const;
     void applySyncTransformation();
+    SyncFitter::Mode fitMode() const;
+    void updateFit();
     
     // UI组件
-    QTableWidget* m_sourceTable;
-    QTableWidget* m_referenceTable;
+    QTableView* m_sourceTable;
+    QTableView* m_referenceTable;
+    SyncTrackModel* m_sourceModel;
+    SyncTrackModel* m_referenceModel;
     QListWidget* m_syncPointsList;
     QPushButton* m_loadRefButton;
     QPushButton* m_addPointButton;
@@ -63,6 +72,8 @@ private:
     QPushButton* m_resetButton;
     QPushButton* m_finishButton;
     QPushButton* m_closeButton;
+    QComboBox* m_fitModeCombo;
+    QLabel* m_fitSummaryLabel;
     
     // 数据
     QVector<SubtitleItem> m_originalSubtitles;  // 原始字幕（不变）
@@ -71,6 +82,12 @@ private:
     QVector<SubtitleItem> m_syncedSubtitles;
     QVector<SyncPoint> m_syncPoints;
     
+    // 参考字幕候选排序（文本指纹 + 时间）
+    SyncCandidateRanker m_ranker;
+    
+    // 当前同步点的拟合结果，添加/移除同步点或切换拟合方式时重算
+    SyncFitter::Result m_fit;
+    
     bool m_applied;
 };
 
@@ -0,0 +1,196 @@
+#include "retimetransform.h"
+#include "perftrace.h"
+#include <QFile>
+#include <QRegularExpression>
+#include <QTextStream>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// 时间值限制在 QTime 可表示的一天之内
+const int kMaxMilliseconds = 24 * 3600 * 1000 - 1;
+
+}
+
+bool RetimeTransform::parseTimeValue(const QString& token, int& milliseconds) {
+    bool ok = false;
+    QTime time = SRTParser::parseTime(token, ok);
+    if (ok && token.size() == 12) {
+        milliseconds = time.msecsSinceStartOfDay();
+        return true;
+    }
+    milliseconds = token.toInt(&ok);
+    return ok;
+}
+
+RetimeTransform::RetimeTransform()
+    : m_kind(Identity)
+    , m_factor(1.0)
+    , m_offset(0.0)
+{
+}
+
+RetimeTransform RetimeTransform::shift(int milliseconds) {
+    return affine(1.0, milliseconds);
+}
+
+RetimeTransform RetimeTransform::affine(double factor, double offsetMs) {
+    RetimeTransform transform;
+    if (factor != 1.0 || offsetMs != 0.0) {
+        transform.m_kind = Affine;
+        transform.m_factor = factor;
+        transform.m_offset = offsetMs;
+    }
+    return transform;
+}
+
+RetimeTransform RetimeTransform::scale(double factor, const QTime& anchor, int shiftMs) {
+    // anchor + (t - anchor) * factor + shift = t * factor + anchor * (1 - factor) + shift
+    double anchorMs = anchor.isValid() ? anchor.msecsSinceStartOfDay() : 0;
+    return affine(factor, anchorMs * (1.0 - factor) + shiftMs);
+}
+
+RetimeTransform RetimeTransform::piecewise(const QVector<QPair<int, int>>& points) {
+    RetimeTransform transform;
+    if (points.isEmpty()) return transform;
+    
+    QVector<QPair<int, int>> sorted = points;
+    std::sort(sorted.begin(), sorted.end());
+    
+    // 源时间相同的点只保留第一个，避免分段斜率除零
+    sorted.erase(std::unique(sorted.begin(), sorted.end(),
+                             [](const QPair<int, int>& a, const QPair<int, int>& b) { return a.first == b.first; }),
+                 sorted.end());
+    
+    if (sorted.size() == 1) {
+        // 只有一个点时退化为平移
+        return shift(sorted[0].second - sorted[0].first);
+    }
+    transform.m_kind = Piecewise;
+    transform.m_points = sorted;
+    return transform;
+}
+
+bool RetimeTransform::loadSyncPoints(const QString& filePath, RetimeTransform& transform, QString& errorMsg) {
+    QVector<QPair<int, int>> points;
+    if (!readSyncPoints(filePath, points, errorMsg)) {
+        return false;
+    }
+    transform = piecewise(points);
+    return true;
+}
+
+bool RetimeTransform::readSyncPoints(const QString& filePath, QVector<QPair<int, int>>& points, QString& errorMsg) {
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        errorMsg = "无法打开同步点文件: " + filePath;
+        return false;
+    }
+    
+    points.clear();
+    QTextStream in(&file);
+    int lineNumber = 0;
+    // "00:01:02,345 --> 00:01:03,000" 中的逗号属于时间，只按空白和箭头切分
+    static const QRegularExpression separator("\\s*(?:-->|->|=>)\\s*|\\s+");
+    while (!in.atEnd()) {
+        QString line = in.readLine().trimmed();
+        ++lineNumber;
+        if (line.isEmpty() || line.startsWith('#')) continue;
+        
+        QStringList tokens = line.split(separator, Qt::SkipEmptyParts);
+        int source = 0;
+        int target = 0;
+        if (tokens.size() != 2 || !parseTimeValue(tokens[0], source) || !parseTimeValue(tokens[1], target)) {
+            errorMsg = QString("同步点文件第 %1 行格式无效：%2").arg(lineNumber).arg(line);
+            return false;
+        }
+        points.append(qMakePair(source, target));
+    }
+    
+    if (points.isEmpty()) {
+        errorMsg = "同步点文件中没有同步点";
+        return false;
+    }
+    
+    std::sort(points.begin(), points.end());
+    for (int i = 1; i < points.size(); ++i) {
+        if (points[i].first == points[i - 1].first) {
+            errorMsg = QString("同步点文件中源时间 %1 重复")
+                .arg(SRTParser::formatTime(QTime::fromMSecsSinceStartOfDay(points[i].first)));
+            return false;
+        }
+    }
+    return true;
+}
+
+int RetimeTransform::map(int milliseconds) const {
+    double mapped = milliseconds;
+    switch (m_kind) {
+    case Identity:
+        return milliseconds;
+    case Affine:
+        mapped = milliseconds * m_factor + m_offset;
+        break;
+    case Piecewise: {
+        // 找到 milliseconds 所在的段，首尾之外使用最近的一段外推
+        auto it = std::upper_bound(m_points.constBegin(), m_points.constEnd(), milliseconds,
+                                   [](int value, const QPair<int, int>& point) { return value < point.first; });
+        int segment = int(it - m_points.constBegin()) - 1;
+        segment = qBound(0, segment, m_points.size() - 2);
+        const QPair<int, int>& p1 = m_points[segment];
+        const QPair<int, int>& p2 = m_points[segment + 1];
+        double slope = double(p2.second - p1.second) / (p2.first - p1.first);
+        mapped = p1.second + (milliseconds - p1.first) * slope;
+        break;
+    }
+    }
+    return qBound(0, int(std::lround(mapped)), kMaxMilliseconds);
+}
+
+QTime RetimeTransform::map(const QTime& time) const {
+    return QTime::fromMSecsSinceStartOfDay(map(time.msecsSinceStartOfDay()));
+}
+
+void RetimeTransform::apply(SubtitleItem& item) const {
+    int start = map(item.startTime.msecsSinceStartOfDay());
+    int end = qMax(start, map(item.endTime.msecsSinceStartOfDay()));
+    item.startTime = QTime::fromMSecsSinceStartOfDay(start);
+    item.endTime = QTime::fromMSecsSinceStartOfDay(end);
+}
+
+void RetimeTransform::apply(QVector<SubtitleItem>& subtitles, int first, int last) const {
+    first = qMax(first, 0);
+    last = qMin(last, subtitles.size() - 1);
+    if (first > last || isIdentity()) return;
+    
+    PerfTrace::Scope scope("retime");
+    scope.setCount(last - first + 1);
+    
+    for (int i = first; i <= last; ++i) {
+        apply(subtitles[i]);
+    }
+}
+
+double RetimeTransform::factor() const {
+    return m_kind == Affine ? m_factor : 1.0;
+}
+
+double RetimeTransform::offset() const {
+    return m_kind == Affine ? m_offset : 0.0;
+}
+
+QString RetimeTransform::description() const {
+    switch (m_kind) {
+    case Identity:
+        return "不变";
+    case Affine:
+        if (m_factor == 1.0) {
+            return QString("平移 %1 毫秒").arg(qRound(m_offset));
+        }
+        return QString("缩放 ×%1，偏移 %2 毫秒").arg(m_factor, 0, 'f', 6).arg(qRound(m_offset));
+    case Piecewise:
+        return QString("%1 个同步点分段线性映射").arg(m_points.size());
+    }
+    return QString();
+}
@@ -0,0 +1,66 @@
+#ifndef RETIMETRANSFORM_H
+#define RETIMETRANSFORM_H
+
+#include <QPair>
+#include <QString>
+#include <QTime>
+#include <QVector>
+#include "subtitle.h"
+
+// 时间映射：平移、仿射（缩放 + 平移）或由同步点定义的分段线性映射
+// 每条字幕独立映射，适合流式处理；GUI 和命令行共用
+class RetimeTransform {
+public:
+    enum Kind {
+        Identity,
+        Affine,
+        Piecewise
+    };
+    
+    RetimeTransform();
+    
+    static RetimeTransform shift(int milliseconds);
+    
+    // t' = t * factor + offsetMs
+    static RetimeTransform affine(double factor, double offsetMs);
+    
+    // 以 anchor 为基准缩放后再平移
+    static RetimeTransform scale(double factor, const QTime& anchor, int shiftMs = 0);
+    
+    // 同步点 (源毫秒, 目标毫秒)，按源时间排序；点之间线性插值，首尾按相邻两点的斜率外推
+    static RetimeTransform piecewise(const QVector<QPair<int, int>>& points);
+    
+    // 读取同步点文件：每行 "源时间 目标时间"，时间为 HH:MM:SS,mmm 或毫秒数，
+    // 中间可以用 "-->" 分隔，# 开头为注释
+    static bool loadSyncPoints(const QString& filePath, RetimeTransform& transform, QString& errorMsg);
+    
+    // 只读取同步点，按源时间排序，供拟合使用
+    static bool readSyncPoints(const QString& filePath, QVector<QPair<int, int>>& points, QString& errorMsg);
+    
+    // 解析 HH:MM:SS,mmm 或毫秒数
+    static bool parseTimeValue(const QString& token, int& milliseconds);
+    
+    Kind kind() const { return m_kind; }
+    bool isIdentity() const { return m_kind == Identity; }
+    
+    // 仿射映射的系数，其他类型分别为 1 和 0
+    double factor() const;
+    double offset() const;
+    
+    int map(int milliseconds) const;
+    QTime map(const QTime& time) const;
+    
+    // 映射一条字幕的开始和结束时间，保证结束不早于开始
+    void apply(SubtitleItem& item) const;
+    void apply(QVector<SubtitleItem>& subtitles, int first, int last) const;
+    
+    QString description() const;
+
+private:
+    Kind m_kind;
+    double m_factor;
+    double m_offset;
+    QVector<QPair<int, int>> m_points;
+};
+
+#endif // RETIMETRANSFORM_H
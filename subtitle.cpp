@@ -1,10 +1,15 @@
 #include "subtitle.h"
+#include "perftrace.h"
+#include "textpool.h"
 #include <QFile>
-#include <QTextStream>
+#include <QSaveFile>
 #include <QRegularExpression>
 #include <QByteArray>
 #include <QStringDecoder>
+#include <QStringEncoder>
 #include <QStringConverter>
+#include <algorithm>
+#include <cstring>
 
 #ifdef Q_OS_WIN
 #include <qt_windows.h>
@@ -23,10 +28,140 @@ QStringDecoder createDecoderForEncoding(SubtitleEncoding encoding) {
         }
         return QStringDecoder("GBK");
     }
+    case SubtitleEncoding::Gb18030:
+        return QStringDecoder("GB18030");
+    case SubtitleEncoding::Utf16Le:
+        return QStringDecoder(QStringConverter::Utf16LE);
     }
     return QStringDecoder();
 }
 
+// 与 createDecoderForEncoding 对应的编码器。GBK 优先用 GBK 本身，
+// 避免写出只认 GBK 的播放器无法识别的 GB18030 四字节序列
+QStringEncoder createEncoderForEncoding(SubtitleEncoding encoding) {
+    switch (encoding) {
+    case SubtitleEncoding::Utf8:
+        return QStringEncoder(QStringConverter::Utf8);
+    case SubtitleEncoding::Gbk: {
+        QStringEncoder encoder("GBK");
+        if (encoder.isValid()) {
+            return encoder;
+        }
+        return QStringEncoder("GB18030");
+    }
+    case SubtitleEncoding::Gb18030:
+        return QStringEncoder("GB18030");
+    case SubtitleEncoding::Utf16Le:
+        return QStringEncoder(QStringConverter::Utf16LE, QStringConverter::Flag::WriteBom);
+    }
+    return QStringEncoder();
+}
+
+// 保存时每凑够这么多字符编码并写出一次
+const int kSaveChunkChars = 64 * 1024;
+
+// 块中第三个非空行起到块末尾（去掉末尾换行）的文本，与 lines.mid(2).join("\n") 相同
+QStringView textAfterSecondLine(const QString& block) {
+    qsizetype pos = 0;
+    int skipped = 0;
+    while (pos < block.size() && skipped < 2) {
+        qsizetype newline = block.indexOf('\n', pos);
+        if (newline < 0) return QStringView();
+        if (newline > pos) ++skipped;
+        pos = newline + 1;
+    }
+    while (pos < block.size() && block[pos] == '\n') ++pos;
+    
+    qsizetype end = block.size();
+    while (end > pos && block[end - 1] == '\n') --end;
+    return QStringView(block).mid(pos, end - pos);
+}
+
+// 原始字节中的一行（不含 \r\n）
+struct Line {
+    qint64 offset;
+    qint64 length;
+};
+
+Line nextLine(const char* data, qint64 size, qint64& pos) {
+    Line line;
+    line.offset = pos;
+    const char* newline = static_cast<const char*>(memchr(data + pos, '\n', size_t(size - pos)));
+    qint64 end = newline ? qint64(newline - data) : size;
+    pos = newline ? end + 1 : size;
+    if (end > line.offset && data[end - 1] == '\r') {
+        --end;
+    }
+    line.length = end - line.offset;
+    return line;
+}
+
+bool isBlankLine(const char* data, const Line& line) {
+    for (qint64 i = 0; i < line.length; ++i) {
+        char c = data[line.offset + i];
+        if (c != ' ' && c != '\t' && c != '\r' && c != '\v' && c != '\f') return false;
+    }
+    return true;
+}
+
+// 解析 "HH:MM:SS,mmm"，p 指向 12 个字节
+bool parseTimeBytes(const char* p, QTime& time) {
+    static const char pattern[] = "dd:dd:dd,ddd";
+    for (int i = 0; i < 12; ++i) {
+        if (pattern[i] == 'd') {
+            if (p[i] < '0' || p[i] > '9') return false;
+        } else if (p[i] != pattern[i]) {
+            return false;
+        }
+    }
+    auto number = [p](int at, int digits) {
+        int value = 0;
+        for (int i = 0; i < digits; ++i) value = value * 10 + (p[at + i] - '0');
+        return value;
+    };
+    time = QTime(number(0, 2), number(3, 2), number(6, 2), number(9, 3));
+    return time.isValid();
+}
+
+// 在时间行中查找 "开始 --> 结束"，与 parse() 中的正则等价
+bool parseTimeLine(const char* p, qint64 length, QTime& start, QTime& end) {
+    for (qint64 arrow = 0; arrow + 3 <= length; ++arrow) {
+        if (p[arrow] != '-' || p[arrow + 1] != '-' || p[arrow + 2] != '>') continue;
+        
+        qint64 before = arrow;
+        while (before > 0 && (p[before - 1] == ' ' || p[before - 1] == '\t')) --before;
+        qint64 after = arrow + 3;
+        while (after < length && (p[after] == ' ' || p[after] == '\t')) ++after;
+        
+        if (before >= 12 && after + 12 <= length &&
+            parseTimeBytes(p + before - 12, start) && parseTimeBytes(p + after, end)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// 由一个字幕块的各行得到序号、时间和文本位置，不是有效字幕块时返回false
+bool parseBlockLines(const char* data, const QVector<Line>& lines, SubtitleItem& item, CueSpan& span) {
+    if (lines.size() < 3) return false;
+    
+    bool ok = false;
+    int index = QByteArray(data + lines[0].offset, lines[0].length).trimmed().toInt(&ok);
+    if (!ok) return false;
+    
+    QTime startTime;
+    QTime endTime;
+    if (!parseTimeLine(data + lines[1].offset, lines[1].length, startTime, endTime)) return false;
+    
+    span.blockOffset = lines[0].offset;
+    span.textOffset = lines[2].offset;
+    span.textLength = lines.last().offset + lines.last().length - span.textOffset;
+    span.blockLength = span.textOffset + span.textLength - span.blockOffset;
+    
+    item = SubtitleItem(index, startTime, endTime, QString());
+    return true;
+}
+
 }
 #ifdef Q_OS_WIN
 
@@ -82,47 +217,105 @@ QString decodeGbkWithWin32(const QByteArray& data, bool& ok) {
 
 #endif // Q_OS_WIN
 
+SubtitleTextEncoder::SubtitleTextEncoder(SubtitleEncoding encoding)
+    : m_encoder(createEncoderForEncoding(encoding))
+    , m_codePage(0)
+    , m_error(false)
+{
+#ifdef Q_OS_WIN
+    if (!m_encoder.isValid()) {
+        if (encoding == SubtitleEncoding::Gbk) {
+            m_codePage = 936;
+        } else if (encoding == SubtitleEncoding::Gb18030) {
+            m_codePage = 54936;
+        }
+    }
+#endif
+}
+
+bool SubtitleTextEncoder::isValid() const {
+    return m_encoder.isValid() || m_codePage != 0;
+}
+
+qsizetype SubtitleTextEncoder::encode(QStringView text) {
+    if (m_encoder.isValid()) {
+        // 缓冲只增不减，整个文件的编码都在同一块内存中完成
+        qsizetype required = m_encoder.requiredSpace(text.size());
+        if (m_buffer.size() < required) {
+            m_buffer.resize(required);
+        }
+        char* end = m_encoder.appendToBuffer(m_buffer.data(), text);
+        if (m_encoder.hasError()) {
+            m_error = true;
+        }
+        return end - m_buffer.data();
+    }
+    
+#ifdef Q_OS_WIN
+    if (m_codePage != 0 && !text.isEmpty()) {
+        const wchar_t* wide = reinterpret_cast<const wchar_t*>(text.utf16());
+        // GB18030 (54936) 不支持替换字符检测，lpUsedDefaultChar 必须为空
+        BOOL usedDefault = FALSE;
+        BOOL* usedDefaultPtr = m_codePage == 936 ? &usedDefault : nullptr;
+        int size = WideCharToMultiByte(m_codePage, 0, wide, int(text.size()), nullptr, 0, nullptr, nullptr);
+        if (size <= 0) {
+            m_error = true;
+            return 0;
+        }
+        if (m_buffer.size() < size) {
+            m_buffer.resize(size);
+        }
+        int converted = WideCharToMultiByte(m_codePage, 0, wide, int(text.size()), m_buffer.data(), size,
+                                            nullptr, usedDefaultPtr);
+        if (converted != size || usedDefault) {
+            m_error = true;
+        }
+        return converted;
+    }
+#endif
+    return 0;
+}
+
 bool SRTParser::parse(const QString& filePath,
                       QVector<SubtitleItem>& subtitles,
                       QString& errorMsg,
-                      SubtitleEncoding encoding) {
+                      SubtitleEncoding encoding,
+                      TextPool* pool) {
     subtitles.clear();
     
-    QFile file(filePath);
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        errorMsg = "无法打开文件: " + filePath;
-        return false;
+    QByteArray rawData;
+    {
+        PerfTrace::Scope scope("read");
+        QFile file(filePath);
+        if (!file.open(QIODevice::ReadOnly)) {
+            errorMsg = "无法打开文件: " + filePath;
+            return false;
+        }
+        
+        rawData = file.readAll();
+        file.close();
     }
     
-    QByteArray rawData = file.readAll();
-    file.close();
+    return parseData(rawData, subtitles, errorMsg, encoding, pool);
+}
+
+bool SRTParser::parseData(const QByteArray& rawData,
+                          QVector<SubtitleItem>& subtitles,
+                          QString& errorMsg,
+                          SubtitleEncoding encoding,
+                          TextPool* pool) {
+    subtitles.clear();
     
     QString content;
-    QStringDecoder decoder = createDecoderForEncoding(encoding);
-    if (decoder.isValid()) {
-        content = decoder.decode(rawData);
-        if (decoder.hasError()) {
-            errorMsg = "解码字幕内容时出错，请确认文件编码";
-            return false;
-        }
-    } else {
-#ifdef Q_OS_WIN
-        if (encoding == SubtitleEncoding::Gbk) {
-            bool winOk = false;
-            content = decodeGbkWithWin32(rawData, winOk);
-            if (!winOk) {
-                errorMsg = "当前系统不支持GBK/GB18030编码，请确认Windows区域和语言设置";
-                return false;
-            }
-        } else {
-            errorMsg = "当前Qt环境不支持所选编码（可能缺少ICU支持）";
-            return false;
-        }
-#else
-        errorMsg = "当前Qt环境不支持所选编码（可能缺少ICU支持）";
+    if (!decode(rawData, encoding, content, errorMsg)) {
         return false;
-#endif
     }
+    // 按二进制读取，解码后统一换行（UTF-16 不能在字节上转换）
+    if (content.contains(QLatin1Char('\r'))) {
+        content.replace(QLatin1String("\r\n"), QLatin1String("\n"));
+    }
+    
+    PerfTrace::Scope tokenizeScope("tokenize");
     
     // 按空行分割字幕块
     QStringList blocks = content.split(QRegularExpression("\\n\\s*\\n"), Qt::SkipEmptyParts);
@@ -149,12 +342,13 @@ bool SRTParser::parse(const QString& filePath,
         QTime endTime = parseTime(match.captured(2), ok);
         if (!ok) continue;
         
-        // 剩余行：字幕文本
-        QStringList textLines = lines.mid(2);
-        QString text = textLines.join("\n");
+        // 剩余行：字幕文本。块内没有空行，文本就是第三行起的连续子串，不需要再拼接
+        QStringView textView = textAfterSecondLine(block);
+        QString text = pool ? pool->intern(textView) : textView.toString();
         
         subtitles.append(SubtitleItem(index, startTime, endTime, text));
     }
+    tokenizeScope.setCount(subtitles.size());
     
     if (subtitles.isEmpty()) {
         errorMsg = "未找到有效的字幕条目";
@@ -164,38 +358,222 @@ bool SRTParser::parse(const QString& filePath,
     return true;
 }
 
-bool SRTParser::save(const QString& filePath, const QVector<SubtitleItem>& subtitles, QString& errorMsg) {
-    QFile file(filePath);
-    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+bool SRTParser::decode(const QByteArray& data, SubtitleEncoding encoding, QString& content, QString& errorMsg) {
+    PerfTrace::Scope scope("decode");
+    QStringDecoder decoder = createDecoderForEncoding(encoding);
+    if (decoder.isValid()) {
+        content = decoder.decode(data);
+        if (decoder.hasError()) {
+            errorMsg = "解码字幕内容时出错，请确认文件编码";
+            return false;
+        }
+        return true;
+    }
+    
+#ifdef Q_OS_WIN
+    if (encoding == SubtitleEncoding::Gbk) {
+        bool winOk = false;
+        content = decodeGbkWithWin32(data, winOk);
+        if (!winOk) {
+            errorMsg = "当前系统不支持GBK/GB18030编码，请确认Windows区域和语言设置";
+            return false;
+        }
+        return true;
+    }
+    if (encoding == SubtitleEncoding::Gb18030) {
+        // 不能退回 936，GBK 解不了 GB18030 的四字节序列
+        bool winOk = false;
+        content = decodeWithCodePage(data, 54936 /* GB18030 */, winOk);
+        if (!winOk) {
+            errorMsg = "当前系统不支持GB18030编码，请确认Windows区域和语言设置";
+            return false;
+        }
+        return true;
+    }
+#endif
+    errorMsg = "当前Qt环境不支持所选编码（可能缺少ICU支持）";
+    return false;
+}
+
+bool SRTParser::isAsciiCompatible(SubtitleEncoding encoding) {
+    // GBK/GB18030 的多字节序列首字节都 >= 0x81，不会出现换行符，序号行和时间行都是纯 ASCII；
+    // UTF-16 每个字符两个字节，不能按字节扫描
+    switch (encoding) {
+    case SubtitleEncoding::Utf8:
+    case SubtitleEncoding::Gbk:
+    case SubtitleEncoding::Gb18030:
+        return true;
+    case SubtitleEncoding::Utf16Le:
+        return false;
+    }
+    return false;
+}
+
+QString SRTParser::encodingName(SubtitleEncoding encoding) {
+    switch (encoding) {
+    case SubtitleEncoding::Utf8:
+        return "UTF-8";
+    case SubtitleEncoding::Gbk:
+        return "GBK";
+    case SubtitleEncoding::Gb18030:
+        return "GB18030";
+    case SubtitleEncoding::Utf16Le:
+        return "UTF-16LE";
+    }
+    return "未知";
+}
+
+int SRTParser::scanBlocks(const char* data, qint64 size,
+                          QVector<SubtitleItem>& cues, QVector<CueSpan>& spans) {
+    PerfTrace::Scope scope("scan");
+    cues.clear();
+    spans.clear();
+    
+    qint64 pos = 0;
+    // 跳过 UTF-8 BOM
+    if (size >= 3 && uchar(data[0]) == 0xEF && uchar(data[1]) == 0xBB && uchar(data[2]) == 0xBF) {
+        pos = 3;
+    }
+    
+    QVector<Line> lines;
+    while (pos < size) {
+        // 收集一个字幕块的所有行，空白行是块分隔符
+        lines.clear();
+        while (pos < size) {
+            Line line = nextLine(data, size, pos);
+            if (isBlankLine(data, line)) {
+                if (lines.isEmpty()) continue;
+                break;
+            }
+            lines.append(line);
+        }
+        SubtitleItem item;
+        CueSpan span;
+        if (!parseBlockLines(data, lines, item, span)) continue;
+        
+        cues.append(item);
+        spans.append(span);
+    }
+    scope.setCount(cues.size());
+    return cues.size();
+}
+
+bool SRTParser::parseBlock(const char* data, qint64 size, SubtitleItem& item, CueSpan& span) {
+    qint64 pos = 0;
+    if (size >= 3 && uchar(data[0]) == 0xEF && uchar(data[1]) == 0xBB && uchar(data[2]) == 0xBF) {
+        pos = 3;
+    }
+    
+    QVector<Line> lines;
+    while (pos < size) {
+        Line line = nextLine(data, size, pos);
+        if (isBlankLine(data, line)) {
+            if (lines.isEmpty()) continue;
+            break;
+        }
+        lines.append(line);
+    }
+    return parseBlockLines(data, lines, item, span);
+}
+
+bool SRTParser::save(const QString& filePath, const QVector<SubtitleItem>& subtitles, QString& errorMsg,
+                     SubtitleEncoding encoding) {
+    PerfTrace::Scope scope("save");
+    scope.setCount(subtitles.size());
+    
+    SubtitleTextEncoder encoder(encoding);
+    if (!encoder.isValid()) {
+        errorMsg = "当前Qt环境不支持所选编码（可能缺少ICU支持）";
+        return false;
+    }
+    
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly)) {
         errorMsg = "无法保存文件: " + filePath;
         return false;
     }
     
-    QTextStream out(&file);
-    out.setEncoding(QStringConverter::Utf8);
+    // 按块拼接文本，直接编码到复用的缓冲再写出，不经过 QTextStream 的中间转换
+    QString chunk;
+    chunk.reserve(kSaveChunkChars + 1024);
+    const QLatin1String lineBreak = newline();
+    auto writeChunk = [&]() -> bool {
+        qsizetype size = encoder.encode(chunk);
+        chunk.resize(0);
+        return file.write(encoder.data(), size) == size;
+    };
     
-    for (int i = 0; i < subtitles.size(); ++i) {
+    bool ok = true;
+    for (int i = 0; i < subtitles.size() && ok; ++i) {
         const SubtitleItem& item = subtitles[i];
         
         // 序号
-        out << (i + 1) << "\n";
+        chunk += QString::number(i + 1);
+        chunk += lineBreak;
         
         // 时间戳
-        out << formatTime(item.startTime) << " --> " << formatTime(item.endTime) << "\n";
+        chunk += formatTime(item.startTime);
+        chunk += QLatin1String(" --> ");
+        chunk += formatTime(item.endTime);
+        chunk += lineBreak;
         
         // 文本
-        out << item.text << "\n";
+        if (lineBreak.size() == 1) {
+            chunk += item.text;
+        } else {
+            QString text = item.text;
+            chunk += text.replace(QLatin1Char('\n'), lineBreak);
+        }
+        chunk += lineBreak;
         
         // 空行分隔
         if (i < subtitles.size() - 1) {
-            out << "\n";
+            chunk += lineBreak;
+        }
+        
+        if (chunk.size() >= kSaveChunkChars) {
+            ok = writeChunk();
         }
     }
+    // UTF-16 的 BOM 在第一次编码时写出，空文件也要保留
+    if (ok && (!chunk.isEmpty() || subtitles.isEmpty())) {
+        ok = writeChunk();
+    }
     
-    file.close();
+    if (!ok) {
+        file.cancelWriting();
+        errorMsg = "无法保存文件: " + filePath;
+        return false;
+    }
+    if (encoder.hasError()) {
+        file.cancelWriting();
+        errorMsg = QString("部分字符无法用 %1 编码表示，请改用 UTF-8 或 GB18030 保存").arg(encodingName(encoding));
+        return false;
+    }
+    if (!file.commit()) {
+        errorMsg = "无法保存文件: " + filePath;
+        return false;
+    }
     return true;
 }
 
+QString SRTParser::decodeText(const char* data, const CueSpan& span, SubtitleEncoding encoding) {
+    QByteArray raw = QByteArray::fromRawData(data + span.textOffset, span.textLength);
+    
+    // 与 parse() 一致：文本内部统一为 \n
+    if (raw.contains('\r')) {
+        raw = QByteArray(raw).replace("\r\n", "\n");
+    }
+    
+    QString text;
+    QString errorMsg;
+    if (!decode(raw, encoding, text, errorMsg)) {
+        // 单条解码失败时保留可读部分，不影响时间操作
+        text = QString::fromLatin1(raw);
+    }
+    return text;
+}
+
 QTime SRTParser::parseTime(const QString& timeStr, bool& ok) {
     ok = false;
     
@@ -227,21 +605,66 @@ QString SRTParser::formatTime(const QTime& time) {
 }
 
 void SRTParser::shiftTime(QVector<SubtitleItem>& subtitles, int milliseconds) {
-    for (SubtitleItem& item : subtitles) {
+    shiftTime(subtitles, milliseconds, 0, subtitles.size() - 1);
+}
+
+void SRTParser::shiftTime(QVector<SubtitleItem>& subtitles, int milliseconds, int first, int last) {
+    first = qMax(first, 0);
+    last = qMin(last, subtitles.size() - 1);
+    if (first > last) return;
+    
+    PerfTrace::Scope scope("shift");
+    scope.setCount(last - first + 1);
+    
+    for (int i = first; i <= last; ++i) {
+        SubtitleItem& item = subtitles[i];
         item.startTime = item.startTime.addMSecs(milliseconds);
         item.endTime = item.endTime.addMSecs(milliseconds);
     }
 }
 
+void SRTParser::scaleTime(QVector<SubtitleItem>& subtitles, double factor, const QTime& anchor,
+                          int first, int last) {
+    first = qMax(first, 0);
+    last = qMin(last, subtitles.size() - 1);
+    if (first > last) return;
+    
+    PerfTrace::Scope scope("scale");
+    scope.setCount(last - first + 1);
+    
+    for (int i = first; i <= last; ++i) {
+        SubtitleItem& item = subtitles[i];
+        int startOffset = anchor.msecsTo(item.startTime);
+        int endOffset = anchor.msecsTo(item.endTime);
+        item.startTime = anchor.addMSecs(qRound(startOffset * factor));
+        item.endTime = anchor.addMSecs(qRound(endOffset * factor));
+    }
+}
+
 void SRTParser::pointSync(QVector<SubtitleItem>& subtitles, 
                           int point1Index, const QTime& newPoint1Time,
                           int point2Index, const QTime& newPoint2Time) {
+    pointSync(subtitles, point1Index, newPoint1Time, point2Index, newPoint2Time,
+              0, subtitles.size() - 1);
+}
+
+void SRTParser::pointSync(QVector<SubtitleItem>& subtitles,
+                          int point1Index, const QTime& newPoint1Time,
+                          int point2Index, const QTime& newPoint2Time,
+                          int first, int last) {
     if (point1Index < 0 || point1Index >= subtitles.size() ||
         point2Index < 0 || point2Index >= subtitles.size() ||
         point1Index == point2Index) {
         return;
     }
     
+    first = qMax(first, 0);
+    last = qMin(last, subtitles.size() - 1);
+    if (first > last) return;
+    
+    PerfTrace::Scope scope("pointsync");
+    scope.setCount(last - first + 1);
+    
     // 获取原始时间点（使用开始时间）
     QTime oldPoint1Time = subtitles[point1Index].startTime;
     QTime oldPoint2Time = subtitles[point2Index].startTime;
@@ -255,8 +678,10 @@ void SRTParser::pointSync(QVector<SubtitleItem>& subtitles,
     // 计算缩放比例
     double scale = static_cast<double>(newDiff) / oldDiff;
     
-    // 调整所有字幕
-    for (SubtitleItem& item : subtitles) {
+    // 调整区间内的字幕
+    for (int i = first; i <= last; ++i) {
+        SubtitleItem& item = subtitles[i];
+        
         // 计算相对于point1的原始偏移
         int startOffset = oldPoint1Time.msecsTo(item.startTime);
         int endOffset = oldPoint1Time.msecsTo(item.endTime);
@@ -269,3 +694,18 @@ void SRTParser::pointSync(QVector<SubtitleItem>& subtitles,
         item.endTime = newPoint1Time.addMSecs(newEndOffset);
     }
 }
+
+bool SRTParser::rangeForTimeWindow(const QVector<SubtitleItem>& subtitles,
+                                   const QTime& from, const QTime& to,
+                                   int& first, int& last) {
+    first = -1;
+    last = -1;
+    auto begin = std::lower_bound(subtitles.cbegin(), subtitles.cend(), from,
+                                  [](const SubtitleItem& item, const QTime& time) { return item.startTime < time; });
+    auto end = std::upper_bound(begin, subtitles.cend(), to,
+                                [](const QTime& time, const SubtitleItem& item) { return time < item.startTime; });
+    if (begin == end) return false;
+    first = int(begin - subtitles.cbegin());
+    last = int(end - subtitles.cbegin()) - 1;
+    return true;
+}
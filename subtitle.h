@@ -1,13 +1,20 @@
 #ifndef SUBTITLE_H
 #define SUBTITLE_H
 
+#include <QByteArray>
 #include <QString>
+#include <QStringEncoder>
 #include <QTime>
 #include <QVector>
 
+class TextPool;
+
+// 新的编码只能追加在末尾：编辑日志按数值记录编码
 enum class SubtitleEncoding {
     Utf8,
-    Gbk
+    Gbk,
+    Gb18030,
+    Utf16Le     // 保存时写入 BOM
 };
 
 struct SubtitleItem {
@@ -26,16 +33,86 @@ struct SubtitleItem {
     }
 };
 
+// 字幕块在原始文件字节中的位置（按字节扫描时记录）
+struct CueSpan {
+    qint64 blockOffset;   // 序号行第一个字节
+    qint64 blockLength;   // 到最后一行文本结束（不含换行）
+    qint64 textOffset;    // 第一行文本第一个字节
+    qint64 textLength;    // 文本字节数（不含末尾换行，内部换行保持原样）
+    
+    CueSpan() : blockOffset(0), blockLength(0), textOffset(0), textLength(0) {}
+};
+
+// 把文本按所选编码分块编码，所有块复用同一个输出缓冲
+// 有状态：UTF-16 的 BOM 只在第一块前写入。Qt 缺少 ICU 时在 Windows 上改用系统代码页
+class SubtitleTextEncoder {
+public:
+    explicit SubtitleTextEncoder(SubtitleEncoding encoding);
+    
+    bool isValid() const;
+    
+    // 有字符无法用该编码表示（已被替换）
+    bool hasError() const { return m_error; }
+    
+    // 编码 text，结果在 data() 开始的缓冲中，返回字节数；缓冲在下次调用前有效
+    qsizetype encode(QStringView text);
+    const char* data() const { return m_buffer.constData(); }
+
+private:
+    QStringEncoder m_encoder;
+    quint32 m_codePage;
+    QByteArray m_buffer;
+    bool m_error;
+};
+
 class SRTParser {
 public:
-    // 解析SRT文件
+    // 解析SRT文件；提供 pool 时相同的文本共享同一个字符串
     static bool parse(const QString& filePath,
                       QVector<SubtitleItem>& subtitles,
                       QString& errorMsg,
-                      SubtitleEncoding encoding = SubtitleEncoding::Utf8);
+                      SubtitleEncoding encoding = SubtitleEncoding::Utf8,
+                      TextPool* pool = nullptr);
+    
+    // 解析内存中的文件内容（parse 读取文件后调用）
+    static bool parseData(const QByteArray& rawData,
+                          QVector<SubtitleItem>& subtitles,
+                          QString& errorMsg,
+                          SubtitleEncoding encoding = SubtitleEncoding::Utf8,
+                          TextPool* pool = nullptr);
+    
+    // 按所选编码解码原始字节
+    static bool decode(const QByteArray& data, SubtitleEncoding encoding, QString& content, QString& errorMsg);
     
-    // 保存为SRT文件
-    static bool save(const QString& filePath, const QVector<SubtitleItem>& subtitles, QString& errorMsg);
+    // 编码的结构字符（数字、冒号、逗号、换行）是否与 ASCII 相同，可以直接按字节扫描
+    static bool isAsciiCompatible(SubtitleEncoding encoding);
+    
+    // 在原始字节上切分字幕块，只解析序号和时间，不解码文本；
+    // cues 中的 text 为空，文本位置记录在 spans 中。返回识别出的字幕条数
+    static int scanBlocks(const char* data, qint64 size,
+                          QVector<SubtitleItem>& cues, QVector<CueSpan>& spans);
+    
+    // 解析缓冲区中的第一个字幕块（流式读取时逐块调用），文本同样只记录位置
+    static bool parseBlock(const char* data, qint64 size, SubtitleItem& item, CueSpan& span);
+    
+    // 解码 span 记录的文本字节，内部换行统一为 \n；解码失败时保留可读部分
+    static QString decodeText(const char* data, const CueSpan& span, SubtitleEncoding encoding);
+    
+    // 保存为SRT文件，按 encoding 直接编码写出；写完后再替换原文件
+    static bool save(const QString& filePath, const QVector<SubtitleItem>& subtitles, QString& errorMsg,
+                     SubtitleEncoding encoding = SubtitleEncoding::Utf8);
+    
+    // 写出字幕使用的换行符：Windows 上为 "\r\n"，其他平台为 "\n"；save 和 SubtitleStreamWriter 共用
+    static QLatin1String newline() {
+#ifdef Q_OS_WIN
+        return QLatin1String("\r\n");
+#else
+        return QLatin1String("\n");
+#endif
+    }
+    
+    // 界面和命令行显示的编码名称
+    static QString encodingName(SubtitleEncoding encoding);
     
     // 时间字符串转QTime
     static QTime parseTime(const QString& timeStr, bool& ok);
@@ -46,10 +123,29 @@ public:
     // 偏移所有字幕时间
     static void shiftTime(QVector<SubtitleItem>& subtitles, int milliseconds);
     
+    // 只偏移 [first, last] 区间内的字幕
+    static void shiftTime(QVector<SubtitleItem>& subtitles, int milliseconds, int first, int last);
+    
+    // 以 anchor 为基准按比例缩放 [first, last] 区间内的字幕时间
+    static void scaleTime(QVector<SubtitleItem>& subtitles, double factor, const QTime& anchor,
+                          int first, int last);
+    
     // Point Sync: 使用两个同步点调整时间
     static void pointSync(QVector<SubtitleItem>& subtitles, 
                          int point1Index, const QTime& newPoint1Time,
                          int point2Index, const QTime& newPoint2Time);
+    
+    // 只对 [first, last] 区间应用两点同步，区间外的字幕保持不变
+    static void pointSync(QVector<SubtitleItem>& subtitles,
+                         int point1Index, const QTime& newPoint1Time,
+                         int point2Index, const QTime& newPoint2Time,
+                         int first, int last);
+    
+    // 找出开始时间落在 [from, to] 内的首尾字幕，没有字幕落在窗口内时返回false
+    // subtitles 必须按开始时间排列（二分查找），否则窗口内的字幕不是连续的一段
+    static bool rangeForTimeWindow(const QVector<SubtitleItem>& subtitles,
+                                   const QTime& from, const QTime& to,
+                                   int& first, int& last);
 };
 
 #endif // SUBTITLE_H
@@ -0,0 +1,251 @@
+#include "subtitleconform.h"
+#include "perftrace.h"
+#include "subtitlesort.h"
+#include "textpool.h"
+#include <QFile>
+#include <QRegularExpression>
+#include <QStringList>
+#include <QTextStream>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// 时间值限制在 QTime 可表示的一天之内
+const int kMaxMilliseconds = 24 * 3600 * 1000 - 1;
+
+// CMX3600 事件行：事件号、卷名、轨道、转场（叠化还带时长），最后是源入出点和录制入出点
+const QRegularExpression& cmxEventPattern() {
+    static const QRegularExpression pattern(
+        "^\\d+\\s+\\S+\\s+(\\S+)\\s+\\S+.*?"
+        "(\\d\\d:\\d\\d:\\d\\d[:;]\\d\\d)\\s+(\\d\\d:\\d\\d:\\d\\d[:;]\\d\\d)\\s+"
+        "(\\d\\d:\\d\\d:\\d\\d[:;]\\d\\d)\\s+(\\d\\d:\\d\\d:\\d\\d[:;]\\d\\d)\\s*$");
+    return pattern;
+}
+
+// EDL 中与事件无关的行：标题、帧率模式、注释、变速等
+bool isEdlMetadata(const QString& line) {
+    static const QRegularExpression pattern("^(?:TITLE:|FCM:|SPLIT:|M2\\s|\\*)");
+    return pattern.match(line).hasMatch();
+}
+
+QTime toTime(int milliseconds) {
+    return QTime::fromMSecsSinceStartOfDay(qBound(0, milliseconds, kMaxMilliseconds));
+}
+
+}
+
+QString SubtitleConform::Stats::summary() const {
+    return QString("保留 %1 条，裁剪 %2 条，跨剪辑点丢弃 %3 条，随删除片段移除 %4 条")
+           .arg(kept).arg(trimmed).arg(dropped).arg(removed);
+}
+
+bool SubtitleConform::parseTimecode(const QString& token, double fps, int& milliseconds) {
+    static const QRegularExpression pattern("^(\\d+):(\\d\\d):(\\d\\d)(?:([,.])(\\d{1,3})|[:;](\\d\\d))?$");
+    QRegularExpressionMatch match = pattern.match(token);
+    if (!match.hasMatch()) {
+        bool ok = false;
+        milliseconds = token.toInt(&ok);
+        return ok && milliseconds >= 0;
+    }
+    
+    int minutes = match.captured(2).toInt();
+    int seconds = match.captured(3).toInt();
+    if (minutes >= 60 || seconds >= 60) return false;
+    qint64 value = ((match.captured(1).toLongLong() * 60 + minutes) * 60 + seconds) * 1000;
+    if (!match.captured(5).isEmpty()) {
+        // 毫秒不足三位时按小数处理："5.5" 是 5 秒 500 毫秒
+        value += match.captured(5).leftJustified(3, '0').toInt();
+    } else if (!match.captured(6).isEmpty()) {
+        int frames = match.captured(6).toInt();
+        if (fps <= 0.0 || frames >= std::ceil(fps)) return false;
+        value += qRound(frames * 1000.0 / fps);
+    }
+    if (value > kMaxMilliseconds) return false;
+    milliseconds = int(value);
+    return true;
+}
+
+bool SubtitleConform::readEdl(const QString& filePath, double fps, int originMs, QVector<Segment>& segments,
+                              QString& errorMsg) {
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        errorMsg = "无法打开剪辑表: " + filePath;
+        return false;
+    }
+    
+    segments.clear();
+    QTextStream in(&file);
+    int lineNumber = 0;
+    bool headerAllowed = true;
+    // "00:01:02,345" 中的逗号属于时间，所以按时间的形式取出各列，再确认其余部分只有分隔符
+    static const QRegularExpression timePattern("\\d+:\\d\\d:\\d\\d(?:[,.]\\d{1,3}|[:;]\\d\\d)?|\\d+");
+    static const QRegularExpression separatorsOnly("^[\\s,;]*$");
+    static const QRegularExpression letter("[A-Za-z]");
+    while (!in.atEnd()) {
+        QString line = in.readLine().trimmed();
+        ++lineNumber;
+        if (line.isEmpty() || line.startsWith('#') || isEdlMetadata(line)) continue;
+        
+        QStringList tokens;
+        QRegularExpressionMatch event = cmxEventPattern().match(line);
+        if (event.hasMatch()) {
+            // 同一剪辑的音频轨（A、A2、AA 等）与视频轨重复，只取含 V 的轨道和 B（音视频同剪）
+            const QString track = event.captured(1);
+            if (!track.contains('V', Qt::CaseInsensitive) && track.compare("B", Qt::CaseInsensitive) != 0) {
+                headerAllowed = false;
+                continue;
+            }
+            tokens << event.captured(2) << event.captured(3) << event.captured(4);
+        } else if (line.contains(letter)) {
+            // 第一行数据之前的一行文字当作表头
+            if (headerAllowed) {
+                headerAllowed = false;
+                continue;
+            }
+        } else {
+            QString rest = line;
+            QRegularExpressionMatchIterator it = timePattern.globalMatch(line);
+            while (it.hasNext()) {
+                tokens << it.next().captured(0);
+            }
+            rest.remove(timePattern);
+            if (!separatorsOnly.match(rest).hasMatch()) tokens.clear();
+        }
+        
+        int values[3];
+        bool valid = tokens.size() == 3;
+        for (int i = 0; valid && i < 3; ++i) {
+            valid = parseTimecode(tokens[i], fps, values[i]);
+            if (valid) {
+                values[i] -= originMs;
+                valid = values[i] >= 0;
+            }
+        }
+        if (!valid || values[1] < values[0]) {
+            errorMsg = QString("剪辑表第 %1 行格式无效：%2").arg(lineNumber).arg(line);
+            return false;
+        }
+        headerAllowed = false;
+        segments.append(Segment{values[0], values[1], values[2]});
+    }
+    
+    if (segments.isEmpty()) {
+        errorMsg = "剪辑表中没有片段";
+        return false;
+    }
+    return true;
+}
+
+QVector<SubtitleConform::Segment> SubtitleConform::normalize(const QVector<Segment>& segments) {
+    QVector<Segment> sorted;
+    sorted.reserve(segments.size());
+    for (const Segment& segment : segments) {
+        // 叠化的起始事件等零长度片段不承载任何画面
+        if (segment.oldOut > segment.oldIn) sorted.append(segment);
+    }
+    std::sort(sorted.begin(), sorted.end(), [](const Segment& a, const Segment& b) {
+        return a.oldIn != b.oldIn ? a.oldIn < b.oldIn : a.newIn < b.newIn;
+    });
+    
+    QVector<Segment> result;
+    result.reserve(sorted.size());
+    for (const Segment& segment : sorted) {
+        if (!result.isEmpty()) {
+            Segment& last = result.last();
+            if (last.oldOut == segment.oldIn && last.newIn + (last.oldOut - last.oldIn) == segment.newIn) {
+                last.oldOut = segment.oldOut;
+                continue;
+            }
+        }
+        result.append(segment);
+    }
+    return result;
+}
+
+QVector<SubtitleItem> SubtitleConform::conform(const QVector<SubtitleItem>& subtitles,
+                                               const QVector<Segment>& segments,
+                                               const Options& options, Stats* stats) {
+    PerfTrace::Scope scope("conform");
+    scope.setCount(subtitles.size());
+    
+    Stats localStats;
+    Stats& counts = stats ? *stats : localStats;
+    counts = Stats();
+    
+    const QVector<Segment> segs = normalize(segments);
+    QVector<int> order = SubtitleSort::sortedOrder(subtitles);
+    QVector<SubtitleItem> result;
+    result.reserve(subtitles.size());
+    
+    // 字幕按开始时间推进，lo 之前的片段都在当前字幕开始之前结束，以后也不会再用到；
+    // 片段按旧入点排列，扫描到入点不早于字幕结束为止
+    int lo = 0;
+    for (int i = 0; i < subtitles.size(); ++i) {
+        const SubtitleItem& item = subtitles[order.isEmpty() ? i : order[i]];
+        int start = item.startTime.msecsSinceStartOfDay();
+        int end = qMax(start, item.endTime.msecsSinceStartOfDay());
+        // 零时长的字幕按 1 毫秒查找所在片段
+        int probeEnd = qMax(end, start + 1);
+        while (lo < segs.size() && segs[lo].oldOut <= start) ++lo;
+        
+        int pieces = 0;
+        int whole = 0;
+        int best = -1;
+        int bestStart = 0;
+        int bestEnd = 0;
+        for (int j = lo; j < segs.size() && segs[j].oldIn < probeEnd; ++j) {
+            const Segment& seg = segs[j];
+            int clipStart = qMax(start, seg.oldIn);
+            int clipEnd = qMin(probeEnd, seg.oldOut);
+            if (clipEnd <= clipStart) continue;
+            ++pieces;
+            if (clipStart == start && clipEnd == probeEnd) {
+                // 完整落在片段内；同一素材被重复使用时每处都输出一条
+                int offset = seg.newIn - seg.oldIn;
+                result.append(SubtitleItem(0, toTime(start + offset), toTime(end + offset), item.text));
+                ++whole;
+            } else if (clipEnd - clipStart > bestEnd - bestStart) {
+                best = j;
+                bestStart = clipStart;
+                bestEnd = clipEnd;
+            }
+        }
+        
+        if (pieces == 0) {
+            ++counts.removed;
+        } else if (whole > 0) {
+            counts.kept += whole;
+        } else if (options.crossing == Trim && bestEnd - bestStart >= options.minDurationMs) {
+            int offset = segs[best].newIn - segs[best].oldIn;
+            result.append(SubtitleItem(0, toTime(bestStart + offset), toTime(bestEnd + offset), item.text));
+            ++counts.trimmed;
+        } else {
+            ++counts.dropped;
+        }
+    }
+    
+    // 片段可能被重新排列，按新时间排序后重新编号
+    QVector<int> newOrder = SubtitleSort::sortedOrder(result);
+    if (!newOrder.isEmpty()) SubtitleSort::applyOrder(result, newOrder);
+    SubtitleSort::renumber(result);
+    return result;
+}
+
+QString SubtitleConform::conformFile(const QString& inputPath, const QString& outputPath,
+                                     const QVector<Segment>& segments,
+                                     SubtitleEncoding encoding, SubtitleEncoding outputEncoding,
+                                     const Options& options, Stats* stats) {
+    TextPool pool;
+    QVector<SubtitleItem> subtitles;
+    QString errorMsg;
+    if (!SRTParser::parse(inputPath, subtitles, errorMsg, encoding, &pool)) {
+        return errorMsg;
+    }
+    
+    QVector<SubtitleItem> conformed = conform(subtitles, segments, options, stats);
+    if (!SRTParser::save(outputPath, conformed, errorMsg, outputEncoding)) {
+        return errorMsg;
+    }
+    return QString();
+}
@@ -0,0 +1,64 @@
+#ifndef SUBTITLECONFORM_H
+#define SUBTITLECONFORM_H
+
+#include <QString>
+#include <QVector>
+#include "subtitle.h"
+
+// 剪辑变更后的字幕重新对位（conform）
+// 剪辑表的每一段把旧版本的 [oldIn, oldOut) 放到新版本的 newIn 处，段可以重新排列、删除或重复使用。
+// 字幕和各段都按旧时间排序后同时推进，一趟即可把每条字幕映射到所在的段；
+// 跨越剪辑点的字幕按策略裁剪或丢弃，落在被删除部分的字幕直接丢弃。
+class SubtitleConform {
+public:
+    struct Segment {
+        int oldIn;
+        int oldOut;
+        int newIn;
+    };
+    
+    enum CrossingPolicy {
+        Trim,       // 保留落在同一段内最长的部分（不短于 minDurationMs）
+        Drop        // 丢弃跨越剪辑点的字幕
+    };
+    
+    struct Options {
+        CrossingPolicy crossing;
+        int minDurationMs;
+        
+        Options() : crossing(Trim), minDurationMs(500) {}
+    };
+    
+    struct Stats {
+        int kept;           // 完整保留（重复使用的段中每出现一次算一条）
+        int trimmed;
+        int dropped;        // 跨越剪辑点而丢弃
+        int removed;        // 落在被删除的部分
+        
+        Stats() : kept(0), trimmed(0), dropped(0), removed(0) {}
+        QString summary() const;
+    };
+    
+    // 读取剪辑表。支持两种格式：
+    // 每行 "旧入点 旧出点 新入点"，用逗号、分号、制表符或空白分隔，可有表头，# 开头为注释；
+    // CMX3600 EDL 的视频事件行（轨道含 V 或为 B），取源入点、源出点和录制入点，只有音频的事件忽略。
+    // 时间可以是 HH:MM:SS,mmm、HH:MM:SS.mmm、按 fps 换算的 HH:MM:SS:FF 或毫秒数；所有时间减去 originMs
+    static bool readEdl(const QString& filePath, double fps, int originMs, QVector<Segment>& segments,
+                        QString& errorMsg);
+    
+    static bool parseTimecode(const QString& token, double fps, int& milliseconds);
+    
+    // 按旧入点排序，并把首尾相接且新时间也连续的段合成一段（这样的边界不是剪辑点）
+    static QVector<Segment> normalize(const QVector<Segment>& segments);
+    
+    // 输入不要求有序；结果按新的开始时间排列并重新编号
+    static QVector<SubtitleItem> conform(const QVector<SubtitleItem>& subtitles, const QVector<Segment>& segments,
+                                         const Options& options, Stats* stats = nullptr);
+    
+    // 解析文件、重新对位后写到 outputPath，写完后再替换目标；在线程池中调用，返回错误信息，成功时为空
+    static QString conformFile(const QString& inputPath, const QString& outputPath, const QVector<Segment>& segments,
+                               SubtitleEncoding encoding, SubtitleEncoding outputEncoding,
+                               const Options& options, Stats* stats = nullptr);
+};
+
+#endif // SUBTITLECONFORM_H
@@ -0,0 +1,373 @@
+#include "subtitlediff.h"
+#include "perftrace.h"
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QStringList>
+#include <algorithm>
+
+namespace {
+
+// Myers 算法允许的最大编辑距离，超过时整段按"删除 + 插入"处理，避免 O(ND) 失控
+const int kMaxEditDistance = 1024;
+
+// patience 递归的最大深度，超过后直接用 Myers
+const int kMaxDepth = 32;
+
+bool sameTiming(const SubtitleItem& a, const SubtitleItem& b) {
+    return a.startTime == b.startTime && a.endTime == b.endTime;
+}
+
+// 时间区间有重叠（或开始时间相同），认为是同一条字幕被修改
+bool overlaps(const SubtitleItem& a, const SubtitleItem& b) {
+    int aStart = a.startTime.msecsSinceStartOfDay();
+    int bStart = b.startTime.msecsSinceStartOfDay();
+    return aStart == bStart
+        || (aStart < b.endTime.msecsSinceStartOfDay() && bStart < a.endTime.msecsSinceStartOfDay());
+}
+
+QJsonObject cueJson(const SubtitleItem& item, int row) {
+    QJsonObject cue;
+    cue["index"] = row + 1;
+    cue["start"] = SRTParser::formatTime(item.startTime);
+    cue["end"] = SRTParser::formatTime(item.endTime);
+    cue["text"] = item.text;
+    return cue;
+}
+
+}
+
+SubtitleDiff::SubtitleDiff()
+    : m_old(nullptr)
+    , m_new(nullptr)
+{
+    std::fill(m_counts, m_counts + KindCount, 0);
+}
+
+bool SubtitleDiff::same(int oldRow, int newRow) const {
+    // 先比哈希；来自同一个驻留池的文本在 == 中比较指针即可返回
+    return m_oldHash[oldRow] == m_newHash[newRow] && m_old->at(oldRow).text == m_new->at(newRow).text;
+}
+
+void SubtitleDiff::compare(const QVector<SubtitleItem>& oldItems, const QVector<SubtitleItem>& newItems) {
+    PerfTrace::Scope scope("diff");
+    scope.setCount(oldItems.size() + newItems.size());
+    
+    m_old = &oldItems;
+    m_new = &newItems;
+    m_oldHash.resize(oldItems.size());
+    for (int i = 0; i < oldItems.size(); ++i) {
+        m_oldHash[i] = qHash(oldItems[i].text);
+    }
+    m_newHash.resize(newItems.size());
+    for (int i = 0; i < newItems.size(); ++i) {
+        m_newHash[i] = qHash(newItems[i].text);
+    }
+    
+    m_ops.clear();
+    diffRange(0, oldItems.size(), 0, newItems.size(), 0);
+    classify();
+    
+    m_ops.clear();
+    m_oldHash.clear();
+    m_newHash.clear();
+    m_old = nullptr;
+    m_new = nullptr;
+}
+
+void SubtitleDiff::diffRange(int oldBegin, int oldEnd, int newBegin, int newEnd, int depth) {
+    // 公共前缀
+    while (oldBegin < oldEnd && newBegin < newEnd && same(oldBegin, newBegin)) {
+        m_ops.append({OpMatch, oldBegin++, newBegin++});
+    }
+    // 公共后缀，最后再输出
+    int suffix = 0;
+    while (oldEnd - suffix > oldBegin && newEnd - suffix > newBegin
+           && same(oldEnd - suffix - 1, newEnd - suffix - 1)) {
+        ++suffix;
+    }
+    oldEnd -= suffix;
+    newEnd -= suffix;
+    
+    if (oldBegin == oldEnd || newBegin == newEnd) {
+        emitReplace(oldBegin, oldEnd, newBegin, newEnd);
+    } else if (depth >= kMaxDepth) {
+        myers(oldBegin, oldEnd, newBegin, newEnd);
+    } else {
+        // 两边都只出现一次的文本作为锚点
+        struct Slot {
+            int oldCount = 0;
+            int newCount = 0;
+            int newRow = -1;
+        };
+        QHash<size_t, Slot> slots;
+        slots.reserve((oldEnd - oldBegin) + (newEnd - newBegin));
+        for (int i = oldBegin; i < oldEnd; ++i) {
+            Slot& slot = slots[m_oldHash[i]];
+            ++slot.oldCount;
+        }
+        for (int j = newBegin; j < newEnd; ++j) {
+            auto it = slots.find(m_newHash[j]);
+            if (it == slots.end()) continue;
+            ++it->newCount;
+            it->newRow = j;
+        }
+        
+        QVector<QPair<int, int>> anchors;
+        for (int i = oldBegin; i < oldEnd; ++i) {
+            const Slot& slot = slots.value(m_oldHash[i]);
+            if (slot.oldCount == 1 && slot.newCount == 1 && same(i, slot.newRow)) {
+                anchors.append(qMakePair(i, slot.newRow));
+            }
+        }
+        
+        if (anchors.isEmpty()) {
+            myers(oldBegin, oldEnd, newBegin, newEnd);
+        } else {
+            // 锚点按旧版本顺序排列，取新版本行号的最长递增子序列（耐心排序）
+            QVector<int> tails;
+            QVector<int> previous(anchors.size(), -1);
+            for (int a = 0; a < anchors.size(); ++a) {
+                auto pos = std::lower_bound(tails.begin(), tails.end(), anchors[a].second,
+                                            [&anchors](int t, int newRow) { return anchors[t].second < newRow; });
+                int length = int(pos - tails.begin());
+                if (length > 0) previous[a] = tails[length - 1];
+                if (pos == tails.end()) {
+                    tails.append(a);
+                } else {
+                    *pos = a;
+                }
+            }
+            QVector<int> chain;
+            for (int a = tails.last(); a >= 0; a = previous[a]) {
+                chain.append(a);
+            }
+            std::reverse(chain.begin(), chain.end());
+            
+            int oldPos = oldBegin;
+            int newPos = newBegin;
+            for (int a : chain) {
+                diffRange(oldPos, anchors[a].first, newPos, anchors[a].second, depth + 1);
+                m_ops.append({OpMatch, anchors[a].first, anchors[a].second});
+                oldPos = anchors[a].first + 1;
+                newPos = anchors[a].second + 1;
+            }
+            diffRange(oldPos, oldEnd, newPos, newEnd, depth + 1);
+        }
+    }
+    
+    for (int i = 0; i < suffix; ++i) {
+        m_ops.append({OpMatch, oldEnd + i, newEnd + i});
+    }
+}
+
+void SubtitleDiff::myers(int oldBegin, int oldEnd, int newBegin, int newEnd) {
+    const int n = oldEnd - oldBegin;
+    const int m = newEnd - newBegin;
+    const int maxD = qMin(n + m, kMaxEditDistance);
+    const int offset = maxD + 1;
+    
+    // v[k] 为对角线 k 上走得最远的 x；每一步开始前保存 v[-d-1 .. d+1] 用于回溯
+    QVector<int> v(2 * maxD + 3, 0);
+    QVector<int> trace;
+    QVector<int> traceStart;
+    int found = -1;
+    for (int d = 0; d <= maxD && found < 0; ++d) {
+        traceStart.append(trace.size());
+        for (int k = -d - 1; k <= d + 1; ++k) {
+            trace.append(v[offset + k]);
+        }
+        
+        for (int k = -d; k <= d; k += 2) {
+            int x;
+            if (k == -d || (k != d && v[offset + k - 1] < v[offset + k + 1])) {
+                x = v[offset + k + 1];
+            } else {
+                x = v[offset + k - 1] + 1;
+            }
+            int y = x - k;
+            while (x < n && y < m && same(oldBegin + x, newBegin + y)) {
+                ++x;
+                ++y;
+            }
+            v[offset + k] = x;
+            if (x >= n && y >= m) {
+                found = d;
+                break;
+            }
+        }
+    }
+    
+    if (found < 0) {
+        emitReplace(oldBegin, oldEnd, newBegin, newEnd);
+        return;
+    }
+    
+    QVector<Op> ops;
+    int x = n;
+    int y = m;
+    for (int d = found; d > 0; --d) {
+        const int* vd = trace.constData() + traceStart[d] + d + 1;
+        int k = x - y;
+        int previousK = (k == -d || (k != d && vd[k - 1] < vd[k + 1])) ? k + 1 : k - 1;
+        int previousX = vd[previousK];
+        int previousY = previousX - previousK;
+        while (x > previousX && y > previousY) {
+            ops.append({OpMatch, oldBegin + x - 1, newBegin + y - 1});
+            --x;
+            --y;
+        }
+        if (x == previousX) {
+            ops.append({OpInsert, -1, newBegin + previousY});
+        } else {
+            ops.append({OpDelete, oldBegin + previousX, -1});
+        }
+        x = previousX;
+        y = previousY;
+    }
+    while (x > 0 && y > 0) {
+        ops.append({OpMatch, oldBegin + x - 1, newBegin + y - 1});
+        --x;
+        --y;
+    }
+    
+    for (int i = ops.size() - 1; i >= 0; --i) {
+        m_ops.append(ops[i]);
+    }
+}
+
+void SubtitleDiff::emitReplace(int oldBegin, int oldEnd, int newBegin, int newEnd) {
+    for (int i = oldBegin; i < oldEnd; ++i) {
+        m_ops.append({OpDelete, i, -1});
+    }
+    for (int j = newBegin; j < newEnd; ++j) {
+        m_ops.append({OpInsert, -1, j});
+    }
+}
+
+void SubtitleDiff::classify() {
+    m_entries.clear();
+    m_entries.reserve(qMax(m_old->size(), m_new->size()));
+    std::fill(m_counts, m_counts + KindCount, 0);
+    
+    // 两个对齐条目之间的删除和插入
+    QVector<int> deleted;
+    QVector<int> inserted;
+    for (const Op& op : m_ops) {
+        switch (op.type) {
+        case OpDelete:
+            deleted.append(op.oldRow);
+            break;
+        case OpInsert:
+            inserted.append(op.newRow);
+            break;
+        case OpMatch:
+            pairChanges(deleted, inserted);
+            deleted.clear();
+            inserted.clear();
+            addEntry(sameTiming(m_old->at(op.oldRow), m_new->at(op.newRow)) ? Unchanged : TimingChanged,
+                     op.oldRow, op.newRow);
+            break;
+        }
+    }
+    pairChanges(deleted, inserted);
+}
+
+void SubtitleDiff::pairChanges(const QVector<int>& deleted, const QVector<int>& inserted) {
+    // 两边都按时间推进，时间重叠的删除和插入配成一条文本修改
+    int i = 0;
+    int j = 0;
+    while (i < deleted.size() && j < inserted.size()) {
+        const SubtitleItem& oldItem = m_old->at(deleted[i]);
+        const SubtitleItem& newItem = m_new->at(inserted[j]);
+        if (overlaps(oldItem, newItem)) {
+            addEntry(TextChanged, deleted[i++], inserted[j++]);
+        } else if (oldItem.startTime < newItem.startTime) {
+            addEntry(Deleted, deleted[i++], -1);
+        } else {
+            addEntry(Inserted, -1, inserted[j++]);
+        }
+    }
+    while (i < deleted.size()) {
+        addEntry(Deleted, deleted[i++], -1);
+    }
+    while (j < inserted.size()) {
+        addEntry(Inserted, -1, inserted[j++]);
+    }
+}
+
+void SubtitleDiff::addEntry(Kind kind, int oldRow, int newRow) {
+    m_entries.append(Entry(kind, oldRow, newRow));
+    ++m_counts[kind];
+}
+
+QString SubtitleDiff::summary() const {
+    QStringList parts;
+    for (int kind = TimingChanged; kind < KindCount; ++kind) {
+        parts << QString("%1 %2").arg(kindName(Kind(kind))).arg(m_counts[kind]);
+    }
+    return parts.join("，");
+}
+
+QString SubtitleDiff::kindName(Kind kind) {
+    switch (kind) {
+    case Unchanged:
+        return "未变";
+    case TimingChanged:
+        return "时间变化";
+    case TextChanged:
+        return "文本修改";
+    case Inserted:
+        return "新增";
+    case Deleted:
+        return "删除";
+    case KindCount:
+        break;
+    }
+    return QString();
+}
+
+const char* SubtitleDiff::kindKey(Kind kind) {
+    static const char* const keys[KindCount] = {"unchanged", "timing", "text", "inserted", "deleted"};
+    return kind < KindCount ? keys[kind] : "";
+}
+
+QByteArray SubtitleDiff::toJson(const QVector<SubtitleItem>& oldItems, const QVector<SubtitleItem>& newItems,
+                                const QString& oldName, const QString& newName, bool includeUnchanged) const {
+    QJsonObject oldInfo;
+    oldInfo["file"] = oldName;
+    oldInfo["cues"] = oldItems.size();
+    QJsonObject newInfo;
+    newInfo["file"] = newName;
+    newInfo["cues"] = newItems.size();
+    
+    QJsonObject counts;
+    for (int kind = 0; kind < KindCount; ++kind) {
+        counts[kindKey(Kind(kind))] = m_counts[kind];
+    }
+    
+    QJsonArray changes;
+    for (const Entry& entry : m_entries) {
+        if (entry.kind == Unchanged && !includeUnchanged) continue;
+        
+        QJsonObject change;
+        change["kind"] = kindKey(entry.kind);
+        if (entry.oldRow >= 0) change["old"] = cueJson(oldItems[entry.oldRow], entry.oldRow);
+        if (entry.newRow >= 0) change["new"] = cueJson(newItems[entry.newRow], entry.newRow);
+        if (entry.oldRow >= 0 && entry.newRow >= 0) {
+            const SubtitleItem& oldItem = oldItems[entry.oldRow];
+            const SubtitleItem& newItem = newItems[entry.newRow];
+            change["startShiftMs"] = oldItem.startTime.msecsTo(newItem.startTime);
+            change["endShiftMs"] = oldItem.endTime.msecsTo(newItem.endTime);
+        }
+        changes.append(change);
+    }
+    
+    QJsonObject report;
+    report["old"] = oldInfo;
+    report["new"] = newInfo;
+    report["summary"] = counts;
+    report["changes"] = changes;
+    return QJsonDocument(report).toJson(QJsonDocument::Indented);
+}
@@ -0,0 +1,80 @@
+#ifndef SUBTITLEDIFF_H
+#define SUBTITLEDIFF_H
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+#include "subtitle.h"
+
+// 两个版本字幕的结构化比较
+// 以文本哈希为序列做 patience diff：先用两边都只出现一次的文本作为锚点切分，
+// 锚点之间的小段再用 Myers 算法对齐。对齐的条目按时间是否变化分为未变/仅时间变化；
+// 未对齐的删除和插入中时间重叠的再配成一对，视为文本修改。
+// 一般的修订只有少量改动，十万条字幕的比较在百毫秒量级。
+class SubtitleDiff {
+public:
+    enum Kind {
+        Unchanged = 0,
+        TimingChanged,      // 文本相同，时间不同
+        TextChanged,        // 同一位置的文本被修改（时间可能也变了）
+        Inserted,           // 只在新版本中
+        Deleted,            // 只在旧版本中
+        KindCount
+    };
+    
+    struct Entry {
+        Kind kind;
+        int oldRow;         // 旧版本中的行号，插入时为 -1
+        int newRow;         // 新版本中的行号，删除时为 -1
+        
+        Entry() : kind(Unchanged), oldRow(-1), newRow(-1) {}
+        Entry(Kind k, int o, int n) : kind(k), oldRow(o), newRow(n) {}
+    };
+    
+    SubtitleDiff();
+    
+    // 比较两个版本，结果同时按两边的顺序排列
+    void compare(const QVector<SubtitleItem>& oldItems, const QVector<SubtitleItem>& newItems);
+    
+    const QVector<Entry>& entries() const { return m_entries; }
+    int count(Kind kind) const { return m_counts[kind]; }
+    int changeCount() const { return m_entries.size() - m_counts[Unchanged]; }
+    bool isIdentical() const { return changeCount() == 0; }
+    
+    // 一行摘要，例如 "时间变化 3，文本修改 1，新增 0，删除 2"
+    QString summary() const;
+    
+    // 机器可读的比较报告；includeUnchanged 为 false 时只列出有变化的条目
+    QByteArray toJson(const QVector<SubtitleItem>& oldItems, const QVector<SubtitleItem>& newItems,
+                      const QString& oldName, const QString& newName, bool includeUnchanged = false) const;
+    
+    static QString kindName(Kind kind);     // 界面显示的名称
+    static const char* kindKey(Kind kind);  // 报告中使用的英文键
+
+private:
+    enum OpType { OpMatch, OpDelete, OpInsert };
+    struct Op {
+        OpType type;
+        int oldRow;
+        int newRow;
+    };
+    
+    bool same(int oldRow, int newRow) const;
+    void diffRange(int oldBegin, int oldEnd, int newBegin, int newEnd, int depth);
+    void myers(int oldBegin, int oldEnd, int newBegin, int newEnd);
+    void emitReplace(int oldBegin, int oldEnd, int newBegin, int newEnd);
+    void classify();
+    void pairChanges(const QVector<int>& deleted, const QVector<int>& inserted);
+    void addEntry(Kind kind, int oldRow, int newRow);
+    
+    const QVector<SubtitleItem>* m_old;
+    const QVector<SubtitleItem>* m_new;
+    QVector<size_t> m_oldHash;
+    QVector<size_t> m_newHash;
+    QVector<Op> m_ops;
+    
+    QVector<Entry> m_entries;
+    int m_counts[KindCount];
+};
+
+#endif // SUBTITLEDIFF_H
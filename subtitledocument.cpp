@@ -0,0 +1,411 @@
+#include "subtitledocument.h"
+#include "subtitletablemodel.h"
+#include "lazysubtitlefile.h"
+#include "perftrace.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QThread>
+#include <QThreadPool>
+#include <QtConcurrent>
+#include <algorithm>
+
+SubtitleDocument::SubtitleDocument(QObject* parent)
+    : QObject(parent)
+    , m_encoding(SubtitleEncoding::Utf8)
+    , m_modified(false)
+    , m_model(nullptr)
+    , m_journal(&m_subtitles)
+    , m_timeIndexValid(false)
+    , m_revision(0)
+    , m_saving(false)
+    , m_saveEncoding(SubtitleEncoding::Utf8)
+    , m_saveRevision(0)
+{
+    connect(&m_saveWatcher, &QFutureWatcher<SubtitleSaveResult>::finished, this, &SubtitleDocument::finishSave);
+}
+
+SubtitleDocument::~SubtitleDocument()
+{
+    // 快照归后台任务所有，这里只需要等文件写完
+    m_saveWatcher.waitForFinished();
+}
+
+QThreadPool* SubtitleDocument::workerPool()
+{
+    // 解析以内存和解码为主，线程数与核心数一致即可；保留一个核心给界面线程
+    static QThreadPool* pool = [] {
+        QThreadPool* p = new QThreadPool();
+        p->setMaxThreadCount(qMax(1, QThread::idealThreadCount() - 1));
+        return p;
+    }();
+    return pool;
+}
+
+SubtitleLoadResult SubtitleDocument::loadFile(const QString& filePath, SubtitleEncoding encoding)
+{
+    SubtitleLoadResult result;
+    result.filePath = filePath;
+    result.encoding = encoding;
+    {
+        PerfTrace::Scope scope("read");
+        QFile file(filePath);
+        if (!file.open(QIODevice::ReadOnly)) {
+            result.errorMsg = "无法打开文件: " + filePath;
+            return result;
+        }
+        result.data = file.readAll();
+    }
+    result.ok = SRTParser::parseData(result.data, result.subtitles, result.errorMsg, encoding, &result.textPool);
+    return result;
+}
+
+namespace {
+
+// 只重新扫描 newData 中与 oldData 不同的字节所在的字幕块。
+// 公共前缀之前和公共后缀之后的字幕块保持不变，扫描的起点和终点都是旧文件中的块边界
+bool reparseChangedRange(const QByteArray& oldData, QVector<CueSpan> oldSpans, int rowCount,
+                         SubtitleEncoding encoding, SubtitleReloadResult& result)
+{
+    if (rowCount <= 0 || oldData.isEmpty() || !SRTParser::isAsciiCompatible(encoding)) {
+        return false;
+    }
+    if (oldSpans.isEmpty()) {
+        QVector<SubtitleItem> cues;
+        SRTParser::scanBlocks(oldData.constData(), oldData.size(), cues, oldSpans);
+    }
+    // 字节扫描与 parse() 分出的条数不同时行号对不上，只能整体重新解析
+    if (oldSpans.size() != rowCount) {
+        return false;
+    }
+    
+    const QByteArray& newData = result.data;
+    const char* oldBytes = oldData.constData();
+    const char* newBytes = newData.constData();
+    const qint64 oldSize = oldData.size();
+    const qint64 newSize = newData.size();
+    const qint64 commonSize = qMin(oldSize, newSize);
+    
+    const qint64 prefix = std::mismatch(oldBytes, oldBytes + commonSize, newBytes).first - oldBytes;
+    qint64 suffix = 0;
+    while (suffix < commonSize - prefix && oldBytes[oldSize - 1 - suffix] == newBytes[newSize - 1 - suffix]) {
+        ++suffix;
+    }
+    const qint64 tailStart = oldSize - suffix;
+    const qint64 delta = newSize - oldSize;
+    const int count = oldSpans.size();
+    
+    // 第一条结束位置不早于第一个不同字节的字幕，再往前一条：它后面的空行被删掉时两条会合并
+    auto firstTouched = std::lower_bound(oldSpans.cbegin(), oldSpans.cend(), prefix,
+                                         [](const CueSpan& span, qint64 offset) {
+        return span.blockOffset + span.blockLength < offset;
+    });
+    int first = qMax(0, int(firstTouched - oldSpans.cbegin()) - 1);
+    
+    // 第一条完全落在公共后缀中的字幕之后再留一条：两者之间的空行完整，扫描必然在这里重新同步
+    auto firstIntact = std::lower_bound(oldSpans.cbegin(), oldSpans.cend(), tailStart,
+                                        [](const CueSpan& span, qint64 offset) {
+        return span.blockOffset < offset;
+    });
+    int end = qMin(count, int(firstIntact - oldSpans.cbegin()) + 1);
+    
+    const qint64 scanBegin = first == 0 ? 0 : oldSpans[first].blockOffset;
+    const qint64 scanEnd = end == count ? newSize : oldSpans[end].blockOffset + delta;
+    
+    QVector<SubtitleItem> cues;
+    QVector<CueSpan> spans;
+    SRTParser::scanBlocks(newBytes + scanBegin, scanEnd - scanBegin, cues, spans);
+    for (int i = 0; i < cues.size(); ++i) {
+        CueSpan& span = spans[i];
+        span.blockOffset += scanBegin;
+        span.textOffset += scanBegin;
+        cues[i].text = SRTParser::decodeText(newBytes, span, encoding);
+    }
+    
+    // 新文件的块位置：前面不变，中间是新扫描的，后面整体平移
+    result.spans.reserve(first + spans.size() + count - end);
+    result.spans += oldSpans.mid(0, first);
+    result.spans += spans;
+    for (int i = end; i < count; ++i) {
+        CueSpan span = oldSpans[i];
+        span.blockOffset += delta;
+        span.textOffset += delta;
+        result.spans.append(span);
+    }
+    
+    result.incremental = true;
+    result.first = first;
+    result.removed = end - first;
+    result.items = cues;
+    return true;
+}
+
+} // namespace
+
+SubtitleReloadResult SubtitleDocument::reloadFile(const QString& filePath, SubtitleEncoding encoding,
+                                                  const QByteArray& oldData, const QVector<CueSpan>& oldSpans,
+                                                  int rowCount)
+{
+    PerfTrace::Scope scope("reload");
+    SubtitleReloadResult result;
+    result.filePath = filePath;
+    
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        result.errorMsg = "无法打开文件: " + filePath;
+        return result;
+    }
+    result.data = file.readAll();
+    file.close();
+    
+    // 内容没变（例如自己刚保存过，或只是修改了时间戳）
+    if (result.data == oldData) {
+        result.ok = true;
+        return result;
+    }
+    result.changed = true;
+    
+    if (reparseChangedRange(oldData, oldSpans, rowCount, encoding, result)) {
+        scope.setCount(result.items.size());
+        result.ok = true;
+        return result;
+    }
+    
+    result.ok = SRTParser::parseData(result.data, result.items, result.errorMsg, encoding);
+    scope.setCount(result.items.size());
+    return result;
+}
+
+QString SubtitleDocument::retimeFileTimingOnly(const QString& sourcePath, const QString& targetPath,
+                                               SubtitleEncoding encoding, const RetimeTransform& transform)
+{
+    LazySubtitleFile file;
+    QString errorMsg;
+    if (!file.open(sourcePath, encoding, errorMsg)) {
+        return errorMsg;
+    }
+    
+    transform.apply(file.cues(), 0, file.size() - 1);
+    if (!file.save(targetPath, errorMsg)) {
+        return errorMsg;
+    }
+    return QString();
+}
+
+void SubtitleDocument::setSubtitles(const QVector<SubtitleItem>& subtitles)
+{
+    if (m_model) {
+        m_model->beginResetRows();
+    }
+    m_subtitles = subtitles;
+    internTexts();
+    m_timeIndexValid = false;
+    if (m_model) {
+        m_model->endResetRows();
+    }
+}
+
+void SubtitleDocument::internTexts()
+{
+    PerfTrace::Scope scope("intern");
+    scope.setCount(m_subtitles.size());
+    
+    for (SubtitleItem& item : m_subtitles) {
+        QString text = m_textPool.intern(item.text);
+        // 已经是池中的缓冲时不写回，避免无谓的分离
+        if (!TextPool::sameText(text, item.text)) {
+            item.text = text;
+        }
+    }
+}
+
+SubtitleSort::Result SubtitleDocument::sortByStartTime()
+{
+    SubtitleSort::Result result;
+    const QVector<int> order = SubtitleSort::sortedOrder(m_subtitles, workerPool());
+    if (!order.isEmpty()) {
+        if (m_model) {
+            m_model->beginReorderRows();
+        }
+        result.moved = SubtitleSort::applyOrder(m_subtitles, order);
+        result.renumbered = SubtitleSort::renumber(m_subtitles);
+        if (m_model) {
+            m_model->endReorderRows(order);
+        }
+        timingsChanged(-1, -1);
+    } else {
+        result.renumbered = SubtitleSort::renumber(m_subtitles);
+        if (m_model && result.renumbered > 0) {
+            m_model->notifyRowsChanged(0, m_subtitles.size() - 1);
+        }
+    }
+    
+    if (result.changed()) {
+        m_journal.recordReplaceAll();
+    }
+    return result;
+}
+
+void SubtitleDocument::setModified(bool modified)
+{
+    if (modified) {
+        ++m_revision;
+    }
+    if (m_modified == modified) return;
+    m_modified = modified;
+    emit modifiedChanged(modified);
+}
+
+bool SubtitleDocument::startSave(const QString& filePath, SubtitleEncoding encoding)
+{
+    if (m_saving) return false;
+    
+    m_saving = true;
+    m_savePath = filePath;
+    m_saveEncoding = encoding;
+    m_saveRevision = m_revision;
+    
+    // 复制只增加引用计数；之后界面线程的编辑会让文档的数组分离，快照保持不变
+    QVector<SubtitleItem> snapshot = m_subtitles;
+    m_saveWatcher.setFuture(QtConcurrent::run(workerPool(), [snapshot, filePath, encoding]() {
+        SubtitleSaveResult result;
+        if (!SRTParser::save(filePath, snapshot, result.errorMsg, encoding)) {
+            return result;
+        }
+        // 读回写出的内容，之后据此区分自己的保存和外部修改
+        QFile file(filePath);
+        if (file.open(QIODevice::ReadOnly)) {
+            result.data = file.readAll();
+        }
+        return result;
+    }));
+    return true;
+}
+
+void SubtitleDocument::waitForSave()
+{
+    if (!m_saving) return;
+    m_saveWatcher.waitForFinished();
+    finishSave();
+}
+
+void SubtitleDocument::finishSave()
+{
+    // waitForSave 已经处理过时，随后到达的 finished 信号直接忽略
+    if (!m_saving) return;
+    m_saving = false;
+    
+    SubtitleSaveResult result = m_saveWatcher.result();
+    const QString& errorMsg = result.errorMsg;
+    if (errorMsg.isEmpty()) {
+        m_filePath = m_savePath;
+        m_encoding = m_saveEncoding;
+        setDiskData(result.data);
+        m_journal.start(m_filePath, m_encoding);
+        if (m_revision == m_saveRevision) {
+            setModified(false);
+        } else {
+            // 保存期间的编辑不在刚写出的文件里：文档仍是已修改，日志以快照记录当前内容
+            m_journal.recordReplaceAll();
+        }
+    }
+    emit saveFinished(errorMsg);
+}
+
+void SubtitleDocument::applyReload(const SubtitleReloadResult& result)
+{
+    if (!result.incremental) {
+        setSubtitles(result.items);
+    } else {
+        const int inserted = result.items.size();
+        const int common = qMin(result.removed, inserted);
+        if (m_model) {
+            m_model->beginReplaceRows(result.first, result.removed, inserted);
+        }
+        for (int i = 0; i < common; ++i) {
+            m_subtitles[result.first + i] = result.items[i];
+        }
+        if (result.removed > common) {
+            m_subtitles.remove(result.first + common, result.removed - common);
+        } else if (inserted > common) {
+            m_subtitles.insert(result.first + common, inserted - common, SubtitleItem());
+            for (int i = common; i < inserted; ++i) {
+                m_subtitles[result.first + i] = result.items[i];
+            }
+        }
+        for (int i = 0; i < inserted; ++i) {
+            SubtitleItem& item = m_subtitles[result.first + i];
+            item.text = m_textPool.intern(item.text);
+        }
+        if (m_model) {
+            m_model->endReplaceRows();
+        }
+        
+        if (inserted == result.removed && inserted > 0) {
+            timingsChanged(result.first, result.first + inserted - 1);
+        } else {
+            timingsChanged(-1, -1);
+        }
+    }
+    
+    m_diskData = result.data;
+    m_diskSpans = result.spans;
+    m_journal.start(result.filePath, m_encoding);
+}
+
+QString SubtitleDocument::displayName() const
+{
+    if (m_filePath.isEmpty()) {
+        return "未命名";
+    }
+    return QFileInfo(m_filePath).fileName();
+}
+
+SubtitleTableModel* SubtitleDocument::model()
+{
+    if (!m_model) {
+        m_model = new SubtitleTableModel(&m_subtitles, this);
+        connect(m_model, &SubtitleTableModel::cellEdited, this, [this](int row, int column, const QString& value) {
+            m_journal.recordCellEdit(row, column, value);
+            if (column == SubtitleTableModel::StartColumn || column == SubtitleTableModel::EndColumn) {
+                timingsChanged(row, row);
+            } else if (column == SubtitleTableModel::TextColumn) {
+                m_subtitles[row].text = m_textPool.intern(m_subtitles[row].text);
+            }
+        });
+    }
+    return m_model;
+}
+
+void SubtitleDocument::releaseModel()
+{
+    delete m_model;
+    m_model = nullptr;
+}
+
+const IntervalIndex& SubtitleDocument::timeIndex()
+{
+    if (!m_timeIndexValid) {
+        m_timeIndex.build(m_subtitles);
+        m_timeIndexValid = true;
+    }
+    return m_timeIndex;
+}
+
+void SubtitleDocument::timingsChanged(int first, int last)
+{
+    if (!m_timeIndexValid) return;
+    if (first < 0 || last < first || m_timeIndex.size() != m_subtitles.size()) {
+        m_timeIndexValid = false;
+        return;
+    }
+    
+    // 修改的行数较多时重建比逐条更新更快
+    if (last - first + 1 > m_subtitles.size() / 8 + 1) {
+        m_timeIndexValid = false;
+        return;
+    }
+    for (int row = first; row <= last && row < m_subtitles.size(); ++row) {
+        const SubtitleItem& item = m_subtitles[row];
+        m_timeIndex.update(row, item.startTime.msecsSinceStartOfDay(), item.endTime.msecsSinceStartOfDay());
+    }
+}
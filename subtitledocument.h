@@ -0,0 +1,172 @@
+#ifndef SUBTITLEDOCUMENT_H
+#define SUBTITLEDOCUMENT_H
+
+#include <QFutureWatcher>
+#include <QObject>
+#include <QString>
+#include <QVector>
+#include "subtitle.h"
+#include "editjournal.h"
+#include "intervalindex.h"
+#include "retimetransform.h"
+#include "subtitlesort.h"
+#include "textpool.h"
+
+class QThreadPool;
+class SubtitleTableModel;
+
+// 后台解析结果
+struct SubtitleLoadResult {
+    QString filePath;
+    SubtitleEncoding encoding;
+    QVector<SubtitleItem> subtitles;
+    TextPool textPool;          // 解析时使用的驻留池，随结果交给文档
+    QByteArray data;            // 文件原始内容，用于比较之后的外部修改
+    QString errorMsg;
+    bool ok;
+    
+    SubtitleLoadResult() : encoding(SubtitleEncoding::Utf8), ok(false) {}
+};
+
+// 后台保存的结果
+struct SubtitleSaveResult {
+    QString errorMsg;           // 为空表示成功
+    QByteArray data;            // 写出后的文件内容
+};
+
+// 文件在外部被修改后重新解析的结果
+// 增量时只有 [first, first + removed) 行被替换为 items，否则 items 是全部字幕
+struct SubtitleReloadResult {
+    QString filePath;
+    QByteArray data;            // 新的文件内容
+    QVector<CueSpan> spans;     // data 中每条字幕的位置，整体重新解析时为空
+    bool changed;               // 与上次载入或保存时的内容不同
+    bool incremental;
+    int first;
+    int removed;
+    QVector<SubtitleItem> items;
+    QString errorMsg;
+    bool ok;
+    
+    SubtitleReloadResult() : changed(false), incremental(false), first(0), removed(0), ok(false) {}
+};
+
+// 一个打开的字幕文件：拥有自己的字幕数组和表格模型
+class SubtitleDocument : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit SubtitleDocument(QObject* parent = nullptr);
+    ~SubtitleDocument();
+    
+    // 所有文档共享的解析/保存线程池
+    static QThreadPool* workerPool();
+    
+    // 在线程池中调用，不触碰任何界面对象
+    static SubtitleLoadResult loadFile(const QString& filePath, SubtitleEncoding encoding);
+    
+    // 读取外部修改后的文件，与 oldData 比较后只重新解析变化的字节区间；
+    // oldSpans 为空时先扫描 oldData。rowCount 与磁盘上的字幕条数不一致（例如有未保存的编辑，传 -1）
+    // 或编码不能按字节扫描时整体重新解析。在线程池中调用
+    static SubtitleReloadResult reloadFile(const QString& filePath, SubtitleEncoding encoding,
+                                           const QByteArray& oldData, const QVector<CueSpan>& oldSpans,
+                                           int rowCount);
+    
+    // 以仅时间模式调整一个文件的时间并写到 targetPath，文本字节原样复制；
+    // 在线程池中调用，返回错误信息，成功时为空
+    static QString retimeFileTimingOnly(const QString& sourcePath, const QString& targetPath,
+                                        SubtitleEncoding encoding, const RetimeTransform& transform);
+    
+    QVector<SubtitleItem>& subtitles() { return m_subtitles; }
+    const QVector<SubtitleItem>& subtitles() const { return m_subtitles; }
+    
+    // 整体替换字幕内容并刷新模型
+    void setSubtitles(const QVector<SubtitleItem>& subtitles);
+    
+    // 文本驻留池：相同文本共享一份缓冲，单元格编辑的文本也会驻留
+    TextPool& textPool() { return m_textPool; }
+    void setTextPool(const TextPool& pool) { m_textPool = pool; }
+    
+    // 直接修改 subtitles() 后调用，重新驻留所有文本
+    void internTexts();
+    
+    // 按开始时间稳定排序并重新编号，视图只收到一次布局变化；调用方负责标记已修改
+    SubtitleSort::Result sortByStartTime();
+    
+    QString filePath() const { return m_filePath; }
+    void setFilePath(const QString& filePath) { m_filePath = filePath; }
+    
+    SubtitleEncoding encoding() const { return m_encoding; }
+    void setEncoding(SubtitleEncoding encoding) { m_encoding = encoding; }
+    
+    bool isModified() const { return m_modified; }
+    void setModified(bool modified);
+    
+    // 每次 setModified(true) 加一，用于判断保存期间是否又有编辑
+    quint64 revision() const { return m_revision; }
+    
+    // 在线程池中保存当前内容的写时复制快照，保存期间可以继续编辑；
+    // 上一次保存尚未完成时返回 false。完成后发出 saveFinished
+    bool startSave(const QString& filePath, SubtitleEncoding encoding);
+    bool isSaving() const { return m_saving; }
+    
+    // 等待正在进行的保存写完并立即处理结果（关闭文档或退出前调用）
+    void waitForSave();
+    
+    // 最近一次载入或保存时磁盘上的内容，用于识别外部修改和增量重新解析
+    const QByteArray& diskData() const { return m_diskData; }
+    const QVector<CueSpan>& diskSpans() const { return m_diskSpans; }
+    void setDiskData(const QByteArray& data) { m_diskData = data; m_diskSpans.clear(); }
+    
+    // 应用 reloadFile 的结果：只替换变化的行，并以新的文件为基准重新开始日志
+    void applyReload(const SubtitleReloadResult& result);
+    
+    // 标签页显示的名称
+    QString displayName() const;
+    
+    // 表格模型按需创建；非活动文档可以释放以节省内存
+    SubtitleTableModel* model();
+    bool hasModel() const { return m_model != nullptr; }
+    void releaseModel();
+    
+    // 崩溃恢复日志，单元格编辑会自动记录，批量操作由调用方记录
+    EditJournal& journal() { return m_journal; }
+    
+    // 时间区间索引，首次使用时构建；单元格修改时间会增量更新
+    const IntervalIndex& timeIndex();
+    
+    // 批量修改 [first, last] 行的时间后调用；整体替换内容后传 -1 使索引失效
+    void timingsChanged(int first, int last);
+
+signals:
+    void modifiedChanged(bool modified);
+    
+    // 后台保存完成，errorMsg 为空表示成功
+    void saveFinished(const QString& errorMsg);
+
+private:
+    void finishSave();
+    
+    QVector<SubtitleItem> m_subtitles;
+    QString m_filePath;
+    SubtitleEncoding m_encoding;
+    bool m_modified;
+    SubtitleTableModel* m_model;
+    EditJournal m_journal;
+    IntervalIndex m_timeIndex;
+    bool m_timeIndexValid;
+    TextPool m_textPool;
+    
+    quint64 m_revision;
+    bool m_saving;
+    QFutureWatcher<SubtitleSaveResult> m_saveWatcher;
+    QString m_savePath;
+    SubtitleEncoding m_saveEncoding;
+    quint64 m_saveRevision;
+    
+    QByteArray m_diskData;
+    QVector<CueSpan> m_diskSpans;
+};
+
+#endif // SUBTITLEDOCUMENT_H
@@ -0,0 +1,279 @@
+#include "subtitlemerge.h"
+#include "perftrace.h"
+#include "subtitlesort.h"
+#include "textpool.h"
+#include <QStringList>
+#include <algorithm>
+
+namespace {
+
+const int kPrimary = 0;
+const int kSecondary = 1;
+
+struct Cue {
+    const SubtitleItem* item;
+    int start;
+    int end;
+};
+
+struct Segment {
+    int start;
+    int end;
+    QString text;
+};
+
+// 按开始时间排列的只读视图，不复制文本；结束早于开始的字幕按零时长处理
+QVector<Cue> sortedCues(const QVector<SubtitleItem>& items) {
+    QVector<int> order = SubtitleSort::sortedOrder(items);
+    QVector<Cue> cues;
+    cues.reserve(items.size());
+    for (int i = 0; i < items.size(); ++i) {
+        const SubtitleItem& item = items[order.isEmpty() ? i : order[i]];
+        int start = item.startTime.msecsSinceStartOfDay();
+        cues.append(Cue{&item, start, qMax(start, item.endTime.msecsSinceStartOfDay())});
+    }
+    return cues;
+}
+
+inline int overlapOf(const Cue& a, const Cue& b) {
+    return qMin(a.end, b.end) - qMax(a.start, b.start);
+}
+
+// 算作重叠所需的最少毫秒数；minOverlapMs 为 0 时也要求真正重叠，首尾相接不算
+inline int requiredOverlap(const SubtitleMerge::Options& options) {
+    return qMax(1, options.minOverlapMs);
+}
+
+QString compose(const QString& primary, const QString& secondary, bool secondaryFirst) {
+    if (primary.isEmpty()) return secondary;
+    if (secondary.isEmpty()) return primary;
+    return secondaryFirst ? secondary + '\n' + primary : primary + '\n' + secondary;
+}
+
+class Merger {
+public:
+    Merger(const SubtitleMerge::Options& options, SubtitleMerge::Stats& stats)
+        : m_options(options), m_stats(stats) {}
+    
+    void mergeGroup(const QVector<Cue>& primary, const QVector<Cue>& secondary);
+    QVector<Segment>& segments() { return m_segments; }
+
+private:
+    void emitCue(const Cue& cue) { m_segments.append(Segment{cue.start, cue.end, cue.item->text}); }
+    void stack(const QVector<Cue>& primary, const QVector<Cue>& secondary);
+    void split(const QVector<Cue>& primary, const QVector<Cue>& secondary);
+    
+    const SubtitleMerge::Options& m_options;
+    SubtitleMerge::Stats& m_stats;
+    QVector<Segment> m_segments;
+};
+
+void Merger::mergeGroup(const QVector<Cue>& primary, const QVector<Cue>& secondary) {
+    if (secondary.isEmpty()) {
+        for (const Cue& cue : primary) {
+            emitCue(cue);
+        }
+        return;
+    }
+    if (primary.isEmpty()) {
+        m_stats.unmatched += secondary.size();
+        if (m_options.keepUnmatched) {
+            for (const Cue& cue : secondary) {
+                emitCue(cue);
+            }
+        }
+        return;
+    }
+    if (m_options.mode == SubtitleMerge::Split) {
+        split(primary, secondary);
+    } else {
+        stack(primary, secondary);
+    }
+}
+
+void Merger::stack(const QVector<Cue>& primary, const QVector<Cue>& secondary) {
+    // 副字幕按开始时间递增，结束时间早于当前副字幕开始的主字幕以后也不会再重叠
+    QVector<QStringList> attached(primary.size());
+    int low = 0;
+    for (const Cue& cue : secondary) {
+        while (low < primary.size() && primary[low].end <= cue.start) {
+            ++low;
+        }
+        int best = -1;
+        int bestOverlap = requiredOverlap(m_options) - 1;
+        for (int i = low; i < primary.size() && primary[i].start < cue.end; ++i) {
+            int overlap = overlapOf(primary[i], cue);
+            if (overlap > bestOverlap) {
+                best = i;
+                bestOverlap = overlap;
+            }
+        }
+        
+        if (best >= 0) {
+            attached[best].append(cue.item->text);
+            ++m_stats.matched;
+        } else {
+            ++m_stats.unmatched;
+            if (m_options.keepUnmatched) {
+                emitCue(cue);
+            }
+        }
+    }
+    
+    for (int i = 0; i < primary.size(); ++i) {
+        m_segments.append(Segment{primary[i].start, primary[i].end,
+                                  compose(primary[i].item->text, attached[i].join(' '), m_options.secondaryFirst)});
+    }
+}
+
+void Merger::split(const QVector<Cue>& primary, const QVector<Cue>& secondary) {
+    for (const Cue& cue : secondary) {
+        bool matched = std::any_of(primary.begin(), primary.end(), [&](const Cue& other) {
+            return overlapOf(other, cue) >= requiredOverlap(m_options);
+        });
+        if (matched) {
+            ++m_stats.matched;
+        } else {
+            ++m_stats.unmatched;
+        }
+    }
+    
+    QVector<int> bounds;
+    bounds.reserve(2 * (primary.size() + secondary.size()));
+    for (const Cue& cue : primary) {
+        bounds << cue.start << cue.end;
+    }
+    for (const Cue& cue : secondary) {
+        bounds << cue.start << cue.end;
+    }
+    std::sort(bounds.begin(), bounds.end());
+    bounds.erase(std::unique(bounds.begin(), bounds.end()), bounds.end());
+    
+    // 组内通常只有几条字幕，逐段检查哪些字幕覆盖该段
+    const int groupBegin = m_segments.size();
+    for (int b = 0; b + 1 < bounds.size(); ++b) {
+        const int from = bounds[b];
+        const int to = bounds[b + 1];
+        QStringList texts[2];
+        for (int track = kPrimary; track <= kSecondary; ++track) {
+            for (const Cue& cue : track == kPrimary ? primary : secondary) {
+                if (cue.start <= from && cue.end >= to) {
+                    texts[track].append(cue.item->text);
+                }
+            }
+        }
+        if (texts[kPrimary].isEmpty() && (texts[kSecondary].isEmpty() || !m_options.keepUnmatched)) {
+            continue;
+        }
+        
+        QString text = compose(texts[kPrimary].join('\n'), texts[kSecondary].join('\n'), m_options.secondaryFirst);
+        Segment* last = m_segments.size() > groupBegin && m_segments.last().end == from ? &m_segments.last() : nullptr;
+        if (last && (to - from < m_options.minSegmentMs || last->text == text)) {
+            // 太短的片段或文本不变的片段延长前一段
+            last->end = to;
+        } else if (last && last->end - last->start < m_options.minSegmentMs) {
+            // 前一段太短，由这一段吸收
+            last->end = to;
+            last->text = text;
+        } else {
+            m_segments.append(Segment{from, to, text});
+        }
+    }
+}
+
+} // namespace
+
+QString SubtitleMerge::Stats::summary() const {
+    return QString("主字幕 %1 条，副字幕 %2 条（%3 条已合并，%4 条无对应），输出 %5 条")
+           .arg(primaryCues).arg(secondaryCues).arg(matched).arg(unmatched).arg(outputCues);
+}
+
+QVector<SubtitleItem> SubtitleMerge::merge(const QVector<SubtitleItem>& primary, const QVector<SubtitleItem>& secondary,
+                                           const Options& options, Stats* stats) {
+    PerfTrace::Scope scope("merge");
+    scope.setCount(primary.size() + secondary.size());
+    
+    Stats localStats;
+    Stats& counts = stats ? *stats : localStats;
+    counts = Stats();
+    counts.primaryCues = primary.size();
+    counts.secondaryCues = secondary.size();
+    
+    const QVector<Cue> tracks[2] = {sortedCues(primary), sortedCues(secondary)};
+    Merger merger(options, counts);
+    
+    // 两条轨道按开始时间交替取出字幕，与当前组重叠的字幕加入该组，否则当前组结束
+    QVector<Cue> group[2];
+    int next[2] = {0, 0};
+    while (next[kPrimary] < tracks[kPrimary].size() || next[kSecondary] < tracks[kSecondary].size()) {
+        group[kPrimary].clear();
+        group[kSecondary].clear();
+        int groupEnd = 0;
+        for (;;) {
+            int track = kPrimary;
+            if (next[kPrimary] == tracks[kPrimary].size()) {
+                track = kSecondary;
+            } else if (next[kSecondary] < tracks[kSecondary].size()
+                       && tracks[kSecondary][next[kSecondary]].start < tracks[kPrimary][next[kPrimary]].start) {
+                track = kSecondary;
+            }
+            if (next[track] == tracks[track].size()) break;
+            
+            const Cue& cue = tracks[track][next[track]];
+            bool empty = group[kPrimary].isEmpty() && group[kSecondary].isEmpty();
+            if (!empty && cue.start > groupEnd - requiredOverlap(options)) break;
+            group[track].append(cue);
+            groupEnd = qMax(groupEnd, cue.end);
+            ++next[track];
+        }
+        merger.mergeGroup(group[kPrimary], group[kSecondary]);
+    }
+    
+    // 组内先写主字幕再写无对应的副字幕，最后整体按开始时间排一次（几乎有序）
+    const QVector<Segment>& segments = merger.segments();
+    QVector<SubtitleItem> result;
+    result.reserve(segments.size());
+    for (const Segment& segment : segments) {
+        result.append(SubtitleItem(0, QTime::fromMSecsSinceStartOfDay(segment.start),
+                                   QTime::fromMSecsSinceStartOfDay(segment.end), segment.text));
+    }
+    SubtitleSort::applyOrder(result, SubtitleSort::sortedOrder(result));
+    SubtitleSort::renumber(result);
+    counts.outputCues = result.size();
+    return result;
+}
+
+QString SubtitleMerge::mergeFiles(const QString& primaryPath, const QString& secondaryPath, const QString& outputPath,
+                                  SubtitleEncoding encoding, SubtitleEncoding outputEncoding,
+                                  const Options& options, Stats* stats) {
+    TextPool pool;
+    QVector<SubtitleItem> primary;
+    QVector<SubtitleItem> secondary;
+    QString errorMsg;
+    if (!SRTParser::parse(primaryPath, primary, errorMsg, encoding, &pool)
+        || !SRTParser::parse(secondaryPath, secondary, errorMsg, encoding, &pool)) {
+        return errorMsg;
+    }
+    
+    QVector<SubtitleItem> merged = merge(primary, secondary, options, stats);
+    if (!SRTParser::save(outputPath, merged, errorMsg, outputEncoding)) {
+        return errorMsg;
+    }
+    return QString();
+}
+
+QString SubtitleMerge::modeName(Mode mode) {
+    return mode == Split ? QString("split") : QString("stack");
+}
+
+bool SubtitleMerge::parseMode(const QString& name, Mode& mode) {
+    if (name.isEmpty() || name == "stack") {
+        mode = Stack;
+        return true;
+    }
+    if (name == "split") {
+        mode = Split;
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,54 @@
+#ifndef SUBTITLEMERGE_H
+#define SUBTITLEMERGE_H
+
+#include <QString>
+#include <QVector>
+#include "subtitle.h"
+
+// 双语字幕合并：把主字幕和副字幕按时间重叠拼成一条字幕，主语言在上
+// 两条轨道按开始时间排序后同时推进（归并连接），互相重叠的字幕归为一组，组内再决定如何组合，
+// 每条字幕只被访问常数次。组的划分忽略小于 minOverlapMs 的重叠，避免相邻字幕首尾相接时连成一长串。
+class SubtitleMerge {
+public:
+    enum Mode {
+        Stack,      // 保留主字幕的时间，每条副字幕并入与它重叠最多的主字幕
+        Split       // 在每个边界处切开，每一段显示当时出现的全部文本
+    };
+    
+    struct Options {
+        Mode mode;
+        int minOverlapMs;       // 重叠少于此值视为不重叠；为 0 时首尾相接仍不算重叠
+        int minSegmentMs;       // Split 模式下短于此值的片段并入相邻片段
+        bool keepUnmatched;     // 保留没有对应主字幕的副字幕
+        bool secondaryFirst;    // 副语言放在上面
+        
+        Options() : mode(Stack), minOverlapMs(100), minSegmentMs(300), keepUnmatched(true), secondaryFirst(false) {}
+    };
+    
+    struct Stats {
+        int primaryCues;
+        int secondaryCues;
+        int matched;            // 与主字幕重叠的副字幕条数
+        int unmatched;          // 没有对应主字幕的副字幕条数
+        int outputCues;
+        
+        Stats() : primaryCues(0), secondaryCues(0), matched(0), unmatched(0), outputCues(0) {}
+        QString summary() const;
+    };
+    
+    // 输入不要求有序；结果按开始时间排列并编号为 1..N。
+    // 同一轨道内同时出现的多条字幕各占一行；Stack 模式下并入同一条主字幕的多条副字幕用空格连成一行
+    static QVector<SubtitleItem> merge(const QVector<SubtitleItem>& primary, const QVector<SubtitleItem>& secondary,
+                                       const Options& options, Stats* stats = nullptr);
+    
+    // 解析两个文件、合并后写到 outputPath，写完后再替换目标；在线程池中调用，返回错误信息，成功时为空
+    static QString mergeFiles(const QString& primaryPath, const QString& secondaryPath, const QString& outputPath,
+                              SubtitleEncoding encoding, SubtitleEncoding outputEncoding,
+                              const Options& options, Stats* stats = nullptr);
+    
+    // 命令行和界面使用的模式名称：stack、split
+    static QString modeName(Mode mode);
+    static bool parseMode(const QString& name, Mode& mode);
+};
+
+#endif // SUBTITLEMERGE_H
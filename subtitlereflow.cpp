@@ -0,0 +1,506 @@
+#include "subtitlereflow.h"
+#include "parallelchunks.h"
+#include "perftrace.h"
+#include "subtitlesort.h"
+#include <QStringList>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+const int kMaxTimeMs = 24 * 3600 * 1000 - 1;
+
+// 不能出现在行首的标点附在前一个字后面，不能出现在行尾的开括号附在后一个字前面
+const QString kNoLineStart = QStringLiteral("，。、；：？！）」』】》〉”’…—·％,.;:?!)]}%");
+const QString kNoLineEnd = QStringLiteral("（「『【《〈“‘([{");
+
+// 在这些标点之后断行更自然
+const QString kBreakAfter = QStringLiteral("，。、；：？！…,.;:?!");
+
+bool isCjkChar(uint ucs) {
+    return (ucs >= 0x1100 && ucs <= 0x11FF)         // 谚文字母
+        || (ucs >= 0x2E80 && ucs <= 0x9FFF)         // 部首、标点、假名、统一汉字
+        || (ucs >= 0xAC00 && ucs <= 0xD7AF)         // 谚文音节
+        || (ucs >= 0xF900 && ucs <= 0xFAFF)         // 兼容汉字
+        || (ucs >= 0xFE30 && ucs <= 0xFE4F)         // 竖排标点
+        || (ucs >= 0xFF00 && ucs <= 0xFF60)         // 全角字符
+        || (ucs >= 0x20000 && ucs <= 0x3FFFF);      // 扩展区汉字
+}
+
+// 字数（代理对算一个字），不计首尾空白
+int charCount(QStringView text) {
+    text = text.trimmed();
+    int count = 0;
+    for (QChar c : text) {
+        if (!c.isLowSurrogate()) ++count;
+    }
+    return count;
+}
+
+// 断行的最小单位：一个汉字或一个英文单词，连同附在上面的标点
+struct Unit {
+    int begin;
+    int end;
+    int width;          // 字数
+    bool spaceBefore;   // 与前一个单位之间有空格
+};
+
+// 一段文本的断行和拆分
+class Layout {
+public:
+    Layout(const QString& text, const SubtitleReflow::Rules& rules);
+    
+    int unitCount() const { return m_units.size(); }
+    int lineLimit() const { return m_lineLimit; }
+    double cpsLimit() const { return m_cpsLimit; }
+    
+    // [from, to) 排成一行时的字数（含单词间的空格）和不计空白的字数
+    int width(int from, int to) const {
+        int spaces = to - from > 1 ? m_spaces[to] - m_spaces[from + 1] : 0;
+        return m_widths[to] - m_widths[from] + spaces;
+    }
+    int chars(int from, int to) const { return m_widths[to] - m_widths[from]; }
+    
+    // 把 [from, to) 断成最少的行，行数相同时各行长度尽量均衡，并优先在标点后断开
+    QStringList breakLines(int from, int to) const;
+    
+    // 把 [from, to) 按长度均分为 parts 段，优先在标点后分开；返回各段的起点
+    QVector<int> partition(int from, int to, int parts) const;
+
+private:
+    QString lineText(int from, int to) const;
+    bool endsWithBreakPunctuation(int unit) const {
+        return kBreakAfter.contains(m_text[m_units[unit].end - 1]);
+    }
+    
+    QString m_text;
+    QVector<Unit> m_units;
+    QVector<int> m_widths;      // 前缀字数
+    QVector<int> m_spaces;      // 前缀空格数
+    int m_lineLimit;
+    double m_cpsLimit;
+};
+
+Layout::Layout(const QString& text, const SubtitleReflow::Rules& rules)
+    : m_text(text)
+{
+    // 原来的换行：两侧都是西文时换成空格，否则直接相连
+    int cjkChars = 0;
+    int totalChars = 0;
+    bool pendingSpace = false;
+    bool pendingBreak = false;
+    bool lastCjk = false;
+    for (qsizetype i = 0; i < text.size();) {
+        QChar c = text[i];
+        if (c == QLatin1Char('\n')) {
+            pendingBreak = true;
+            ++i;
+            continue;
+        }
+        if (c.isSpace()) {
+            pendingSpace = true;
+            ++i;
+            continue;
+        }
+        
+        uint ucs = c.unicode();
+        int length = 1;
+        if (c.isHighSurrogate() && i + 1 < text.size() && text[i + 1].isLowSurrogate()) {
+            ucs = QChar::surrogateToUcs4(c, text[i + 1]);
+            length = 2;
+        }
+        bool cjk = isCjkChar(ucs);
+        ++totalChars;
+        if (cjk) ++cjkChars;
+        
+        bool adjacent = !m_units.isEmpty() && !pendingSpace && !pendingBreak;
+        bool joins = adjacent && ((!cjk && !lastCjk) || kNoLineStart.contains(c)
+                                  || kNoLineEnd.contains(text[m_units.last().end - 1]));
+        if (joins) {
+            m_units.last().end = int(i + length);
+            ++m_units.last().width;
+        } else {
+            bool space = pendingSpace || (pendingBreak && !lastCjk && !cjk);
+            m_units.append(Unit{int(i), int(i + length), 1, !m_units.isEmpty() && space});
+        }
+        lastCjk = cjk;
+        pendingSpace = false;
+        pendingBreak = false;
+        i += length;
+    }
+    
+    m_widths.resize(m_units.size() + 1);
+    m_spaces.resize(m_units.size() + 1);
+    m_widths[0] = 0;
+    m_spaces[0] = 0;
+    for (int u = 0; u < m_units.size(); ++u) {
+        m_widths[u + 1] = m_widths[u] + m_units[u].width;
+        m_spaces[u + 1] = m_spaces[u] + (m_units[u].spaceBefore ? 1 : 0);
+    }
+    
+    // 以中文为主的字幕使用中文的限制
+    bool cjkText = totalChars > 0 && cjkChars * 2 >= totalChars;
+    m_lineLimit = qMax(1, cjkText ? rules.maxCjkCharsPerLine : rules.maxCharsPerLine);
+    m_cpsLimit = cjkText ? rules.maxCjkCps : rules.maxCps;
+}
+
+QString Layout::lineText(int from, int to) const {
+    QString line;
+    for (int u = from; u < to; ++u) {
+        if (u > from && m_units[u].spaceBefore) {
+            line += QLatin1Char(' ');
+        }
+        line += QStringView(m_text).mid(m_units[u].begin, m_units[u].end - m_units[u].begin);
+    }
+    return line;
+}
+
+QStringList Layout::breakLines(int from, int to) const {
+    if (from >= to) return QStringList();
+    const int limit = m_lineLimit;
+    if (width(from, to) <= limit) {
+        return QStringList{lineText(from, to)};
+    }
+    
+    // cost[j]：前 j 个单位的最优断法。行数优先，其次是各行空余字数的平方和，在标点后断开有奖励；
+    // 一行的宽度随起点前移单调增加，超出限制即可停止（单个超长单位独占一行）
+    const int count = to - from;
+    const qint64 kLineCost = qint64(1) << 40;
+    const qint64 kPunctuationBonus = qint64(limit) * limit / 4;
+    const qint64 kUnreached = std::numeric_limits<qint64>::max();
+    QVector<qint64> cost(count + 1, kUnreached);
+    QVector<int> previous(count + 1, -1);
+    cost[0] = 0;
+    for (int j = 1; j <= count; ++j) {
+        for (int i = j - 1; i >= 0; --i) {
+            int lineWidth = width(from + i, from + j);
+            if (lineWidth > limit && i < j - 1) break;
+            if (cost[i] == kUnreached) continue;
+            
+            qint64 slack = qMax(0, limit - lineWidth);
+            qint64 candidate = cost[i] + kLineCost + slack * slack;
+            if (j < count && endsWithBreakPunctuation(from + j - 1)) {
+                candidate -= kPunctuationBonus;
+            }
+            if (candidate < cost[j]) {
+                cost[j] = candidate;
+                previous[j] = i;
+            }
+        }
+    }
+    
+    QStringList lines;
+    for (int j = count; j > 0; j = previous[j]) {
+        lines.prepend(lineText(from + previous[j], from + j));
+    }
+    return lines;
+}
+
+QVector<int> Layout::partition(int from, int to, int parts) const {
+    const int total = width(from, to);
+    const int bonus = total / (parts * 6);
+    QVector<int> starts{from};
+    for (int part = 1; part < parts; ++part) {
+        const int target = total * part / parts;
+        int best = -1;
+        int bestDistance = std::numeric_limits<int>::max();
+        // 每段至少留一个单位
+        for (int boundary = starts.last() + 1; boundary <= to - (parts - part); ++boundary) {
+            int distance = std::abs(width(from, boundary) - target);
+            if (endsWithBreakPunctuation(boundary - 1)) {
+                distance -= bonus;
+            }
+            if (distance < bestDistance) {
+                best = boundary;
+                bestDistance = distance;
+            }
+        }
+        starts.append(best);
+    }
+    return starts;
+}
+
+bool isDialogue(const QStringList& lines) {
+    if (lines.size() < 2) return false;
+    for (const QString& line : lines) {
+        QString trimmed = line.trimmed();
+        if (trimmed.isEmpty()) return false;
+        QChar first = trimmed[0];
+        if (first != QLatin1Char('-') && first != QChar(0xFF0D) && first != QChar(0x2014)) return false;
+    }
+    return true;
+}
+
+bool overflows(const QStringList& lines, int limit) {
+    return std::any_of(lines.begin(), lines.end(), [limit](const QString& line) {
+        return charCount(line) > limit;
+    });
+}
+
+inline int msOf(const QTime& time) {
+    return time.msecsSinceStartOfDay();
+}
+
+// 为满足阅读速度向后延长结束时间，不超过下一条字幕的开始减去间隔；返回新的结束时间
+int fitReadingSpeed(int start, int end, int chars, double cps, int nextStart, int minGapMs) {
+    if (cps <= 0 || chars == 0) return end;
+    qint64 needed = qint64(std::ceil(chars * 1000.0 / cps));
+    if (end - start >= needed) return end;
+    qint64 limit = qMin<qint64>(qint64(nextStart) - minGapMs, kMaxTimeMs);
+    return int(qMax<qint64>(end, qMin<qint64>(start + needed, limit)));
+}
+
+bool readsTooFast(int start, int end, int chars, double cps) {
+    return cps > 0 && chars * 1000.0 > cps * (end - start);
+}
+
+// 两条字幕合并后的文本：各自一行且都不超长时上下排列，否则整体重新断行；放不下时返回 false
+bool mergedText(const QString& first, const QString& second, const SubtitleReflow::Rules& rules, QString& text) {
+    QString joined = first + QLatin1Char('\n') + second;
+    Layout layout(joined, rules);
+    bool singleLines = !first.contains(QLatin1Char('\n')) && !second.contains(QLatin1Char('\n'));
+    if (singleLines && rules.maxLines >= 2 && charCount(first) <= layout.lineLimit()
+        && charCount(second) <= layout.lineLimit()) {
+        text = joined;
+        return true;
+    }
+    
+    QStringList lines = layout.breakLines(0, layout.unitCount());
+    if (lines.size() > rules.maxLines || overflows(lines, layout.lineLimit())) return false;
+    text = lines.join(QLatin1Char('\n'));
+    return true;
+}
+
+// 顺序合并过短的相邻字幕（合并结果会影响下一次判断，不能并行）
+QVector<SubtitleItem> mergeShortCues(const QVector<SubtitleItem>& subtitles, const SubtitleReflow::Rules& rules,
+                                     SubtitleReflow::Result& result) {
+    QVector<SubtitleItem> merged;
+    merged.reserve(subtitles.size());
+    int run = 1;
+    auto finishRun = [&]() {
+        if (run > 1) {
+            const SubtitleItem& last = merged.last();
+            result.changes.append(SubtitleReflow::Change{last.index, msOf(last.startTime), SubtitleReflow::Merged, run});
+            result.merged += run - 1;
+        }
+        run = 1;
+    };
+    
+    for (const SubtitleItem& item : subtitles) {
+        if (!merged.isEmpty()) {
+            SubtitleItem& last = merged.last();
+            int lastStart = msOf(last.startTime);
+            int lastEnd = msOf(last.endTime);
+            int itemEnd = msOf(item.endTime);
+            bool tooShort = lastEnd - lastStart < rules.minDurationMs || item.duration() < rules.minDurationMs;
+            QString text;
+            if (tooShort && msOf(item.startTime) - lastEnd <= rules.maxMergeGapMs
+                && qMax(lastEnd, itemEnd) - lastStart <= rules.maxDurationMs
+                && mergedText(last.text, item.text, rules, text)) {
+                last.text = text;
+                last.endTime = QTime::fromMSecsSinceStartOfDay(qMax(lastEnd, itemEnd));
+                ++run;
+                continue;
+            }
+        }
+        finishRun();
+        merged.append(item);
+    }
+    finishRun();
+    return merged;
+}
+
+// 处理第 row 条字幕，结果追加到 output；只读取相邻字幕的开始时间，可以并行
+void processCue(const QVector<SubtitleItem>& subtitles, int row, const SubtitleReflow::Rules& rules,
+                QVector<SubtitleItem>& output, SubtitleReflow::Result& result) {
+    using Change = SubtitleReflow::Change;
+    const SubtitleItem& item = subtitles[row];
+    const int start = msOf(item.startTime);
+    const int end = qMax(start, msOf(item.endTime));
+    const int nextStart = row + 1 < subtitles.size() ? msOf(subtitles[row + 1].startTime) : kMaxTimeMs + rules.minGapMs;
+    if (item.text.trimmed().isEmpty()) {
+        output.append(item);
+        return;
+    }
+    
+    Layout layout(item.text, rules);
+    const int unitCount = layout.unitCount();
+    const int limit = layout.lineLimit();
+    QStringList lines = item.text.split(QLatin1Char('\n'));
+    bool dialogue = isDialogue(lines);
+    bool violates = lines.size() > rules.maxLines || overflows(lines, limit);
+    bool fitsOneLine = lines.size() > 1 && layout.width(0, unitCount) <= limit;
+    
+    // 对话行每行是一个说话人，不重新断行
+    if (!dialogue && (violates || fitsOneLine)) {
+        lines = layout.breakLines(0, unitCount);
+    }
+    
+    int parts = 1;
+    if (!dialogue) {
+        int maxLines = qMax(1, rules.maxLines);
+        parts = (lines.size() + maxLines - 1) / maxLines;
+        if (rules.maxDurationMs > 0 && end - start > rules.maxDurationMs && lines.size() >= 2) {
+            parts = qMax(parts, (end - start + rules.maxDurationMs - 1) / rules.maxDurationMs);
+        }
+        parts = qBound(1, parts, unitCount);
+    }
+    
+    if (parts == 1) {
+        QString text = lines.join(QLatin1Char('\n'));
+        if (text != item.text) {
+            ++result.reflowed;
+            result.changes.append(Change{item.index, start, SubtitleReflow::Reflowed, 1});
+        }
+        if (lines.size() > rules.maxLines || overflows(lines, limit)) {
+            ++result.violations;
+            result.changes.append(Change{item.index, start, SubtitleReflow::TooLong, 1});
+        }
+        
+        int chars = layout.chars(0, unitCount);
+        int newEnd = fitReadingSpeed(start, end, chars, layout.cpsLimit(), nextStart, rules.minGapMs);
+        if (newEnd > end) {
+            ++result.extended;
+            result.changes.append(Change{item.index, start, SubtitleReflow::Extended, newEnd - end});
+        }
+        if (readsTooFast(start, newEnd, chars, layout.cpsLimit())) {
+            ++result.violations;
+            result.changes.append(Change{item.index, start, SubtitleReflow::TooFast, 1});
+        }
+        output.append(SubtitleItem(item.index, item.startTime, QTime::fromMSecsSinceStartOfDay(newEnd), text));
+        return;
+    }
+    
+    // 按字数比例分配时间，各段之间留出间隔
+    ++result.split;
+    result.added += parts - 1;
+    result.changes.append(Change{item.index, start, SubtitleReflow::Split, parts});
+    QVector<int> starts = layout.partition(0, unitCount, parts);
+    starts.append(unitCount);
+    const qint64 duration = end - start;
+    const int total = qMax(1, layout.width(0, unitCount));
+    bool tooLong = false;
+    bool tooFast = false;
+    for (int part = 0; part < parts; ++part) {
+        int from = starts[part];
+        int to = starts[part + 1];
+        int partStart = start + int(duration * layout.width(0, from) / total);
+        int partEnd = end;
+        if (part + 1 < parts) {
+            partEnd = start + int(duration * layout.width(0, to) / total);
+            if (partEnd - partStart > rules.minGapMs) {
+                partEnd -= rules.minGapMs;
+            }
+        }
+        
+        QStringList partLines = layout.breakLines(from, to);
+        tooLong = tooLong || partLines.size() > rules.maxLines || overflows(partLines, limit);
+        
+        int chars = layout.chars(from, to);
+        if (part + 1 == parts) {
+            int newEnd = fitReadingSpeed(partStart, partEnd, chars, layout.cpsLimit(), nextStart, rules.minGapMs);
+            if (newEnd > partEnd) {
+                ++result.extended;
+                result.changes.append(Change{item.index, partStart, SubtitleReflow::Extended, newEnd - partEnd});
+                partEnd = newEnd;
+            }
+        }
+        tooFast = tooFast || readsTooFast(partStart, partEnd, chars, layout.cpsLimit());
+        
+        output.append(SubtitleItem(item.index, QTime::fromMSecsSinceStartOfDay(partStart),
+                                   QTime::fromMSecsSinceStartOfDay(partEnd), partLines.join(QLatin1Char('\n'))));
+    }
+    if (tooLong) {
+        ++result.violations;
+        result.changes.append(Change{item.index, start, SubtitleReflow::TooLong, 1});
+    }
+    if (tooFast) {
+        ++result.violations;
+        result.changes.append(Change{item.index, start, SubtitleReflow::TooFast, 1});
+    }
+}
+
+struct Chunk {
+    QVector<SubtitleItem> output;
+    SubtitleReflow::Result result;
+};
+
+QString describe(const SubtitleReflow::Change& change) {
+    switch (change.kind) {
+    case SubtitleReflow::Reflowed:
+        return "重新断行";
+    case SubtitleReflow::Split:
+        return QString("拆分为 %1 条").arg(change.count);
+    case SubtitleReflow::Merged:
+        return QString("与后面 %1 条合并").arg(change.count - 1);
+    case SubtitleReflow::Extended:
+        return QString("结束时间延长 %1 毫秒").arg(change.count);
+    case SubtitleReflow::TooFast:
+        return "阅读速度仍超出限制（后面没有足够的间隙）";
+    case SubtitleReflow::TooLong:
+        return "行数或每行字数仍超出限制";
+    }
+    return QString();
+}
+
+} // namespace
+
+QString SubtitleReflow::Result::summary() const {
+    return QString("重新断行 %1 条，拆分 %2 条（新增 %3 条），合并减少 %4 条，延长 %5 条，%6 处仍不符合规范")
+           .arg(reflowed).arg(split).arg(added).arg(merged).arg(extended).arg(violations);
+}
+
+QString SubtitleReflow::Result::report() const {
+    QStringList lines{summary()};
+    for (const Change& change : changes) {
+        lines << QString("第 %1 条 %2  %3")
+                 .arg(change.index)
+                 .arg(SRTParser::formatTime(QTime::fromMSecsSinceStartOfDay(change.startMs)), describe(change));
+    }
+    return lines.join(QLatin1Char('\n'));
+}
+
+QVector<SubtitleItem> SubtitleReflow::apply(const QVector<SubtitleItem>& subtitles, const Rules& rules, Result& result,
+                                            QThreadPool* pool) {
+    PerfTrace::Scope scope("reflow");
+    scope.setCount(subtitles.size());
+    result = Result();
+    
+    QVector<SubtitleItem> sorted = subtitles;
+    SubtitleSort::applyOrder(sorted, SubtitleSort::sortedOrder(sorted, pool));
+    const QVector<SubtitleItem> merged = mergeShortCues(sorted, rules, result);
+    
+    QVector<Chunk> chunks(ParallelChunks::chunkCount(merged.size()));
+    Chunk* chunkData = chunks.data();
+    ParallelChunks::run(merged.size(), pool, [&merged, &rules, chunkData](int index, int begin, int end) {
+        Chunk& chunk = chunkData[index];
+        chunk.output.reserve(end - begin);
+        for (int row = begin; row < end; ++row) {
+            processCue(merged, row, rules, chunk.output, chunk.result);
+        }
+    });
+    
+    // 各块按顺序拼接；拆分出的各段都在原字幕的时间范围内，结果仍按开始时间排列
+    QVector<SubtitleItem> output;
+    output.reserve(merged.size());
+    for (const Chunk& chunk : chunks) {
+        output += chunk.output;
+        result.reflowed += chunk.result.reflowed;
+        result.split += chunk.result.split;
+        result.added += chunk.result.added;
+        result.extended += chunk.result.extended;
+        result.violations += chunk.result.violations;
+        result.changes += chunk.result.changes;
+    }
+    std::stable_sort(result.changes.begin(), result.changes.end(), [](const Change& a, const Change& b) {
+        return a.startMs < b.startMs;
+    });
+    SubtitleSort::renumber(output);
+    return output;
+}
+
+QString SubtitleReflow::reflowText(const QString& text, const Rules& rules) {
+    Layout layout(text, rules);
+    return layout.breakLines(0, layout.unitCount()).join(QLatin1Char('\n'));
+}
@@ -0,0 +1,72 @@
+#ifndef SUBTITLEREFLOW_H
+#define SUBTITLEREFLOW_H
+
+#include <QString>
+#include <QVector>
+#include "subtitle.h"
+
+class QThreadPool;
+
+// 按交付规范（每行字数、每条行数、阅读速度）批量整理字幕
+// 先顺序合并过短的相邻字幕，然后按块并行处理每一条：重新断行、拆分过长的字幕、
+// 阅读速度过快时向后面的间隙延长。中文按字断行，英文不在单词中间断开，
+// 标点不放在行首、开括号不放在行尾。结果按开始时间排列并重新编号。
+class SubtitleReflow {
+public:
+    struct Rules {
+        int maxCharsPerLine;        // 以中文为主的字幕用 maxCjkCharsPerLine
+        int maxCjkCharsPerLine;
+        int maxLines;
+        double maxCps;              // 每秒字数，不计空白；以中文为主的字幕用 maxCjkCps
+        double maxCjkCps;
+        int minDurationMs;          // 短于此值的字幕尝试与相邻字幕合并
+        int maxDurationMs;          // 长于此值的多行字幕按行拆分
+        int minGapMs;               // 拆分和延长时与下一条字幕保留的间隔
+        int maxMergeGapMs;          // 间隔超过此值的字幕不合并
+        
+        Rules() : maxCharsPerLine(42), maxCjkCharsPerLine(16), maxLines(2), maxCps(20.0), maxCjkCps(9.0),
+                  minDurationMs(833), maxDurationMs(7000), minGapMs(83), maxMergeGapMs(500) {}
+    };
+    
+    enum ChangeKind {
+        Reflowed,       // 重新断行
+        Split,          // 拆分为多条
+        Merged,         // 与后面的字幕合并
+        Extended,       // 为满足阅读速度延长了结束时间
+        TooFast,        // 无法满足阅读速度
+        TooLong         // 无法满足行数或每行字数（例如单个超长单词、对话行）
+    };
+    
+    struct Change {
+        int index;          // 原字幕的序号
+        int startMs;
+        ChangeKind kind;
+        int count;          // 拆分后的条数、合并的条数或延长的毫秒数
+    };
+    
+    struct Result {
+        int reflowed;
+        int split;          // 被拆分的字幕条数
+        int added;          // 拆分新增的条数
+        int merged;         // 合并减少的条数
+        int extended;
+        int violations;     // 仍不符合规范的条数
+        QVector<Change> changes;
+        
+        Result() : reflowed(0), split(0), added(0), merged(0), extended(0), violations(0) {}
+        bool changed() const { return reflowed > 0 || split > 0 || merged > 0 || extended > 0; }
+        QString summary() const;
+        
+        // 逐条列出修改，供预览（试运行）使用
+        QString report() const;
+    };
+    
+    // 返回整理后的字幕，输入保持不变；只想预览时丢弃返回值、查看 result 即可。pool 为空时单线程处理
+    static QVector<SubtitleItem> apply(const QVector<SubtitleItem>& subtitles, const Rules& rules, Result& result,
+                                       QThreadPool* pool = nullptr);
+    
+    // 按规则重新断行一段文本（不检查是否需要），超过行数限制时返回的行数也会超过
+    static QString reflowText(const QString& text, const Rules& rules);
+};
+
+#endif // SUBTITLEREFLOW_H
@@ -0,0 +1,197 @@
+#include "subtitlesnap.h"
+#include "perftrace.h"
+#include "subtitleconform.h"
+#include "subtitlesort.h"
+#include <QFile>
+#include <QRegularExpression>
+#include <QTextStream>
+#include <algorithm>
+#include <climits>
+
+namespace {
+
+// 时间值限制在 QTime 可表示的一天之内
+const int kMaxMilliseconds = 24 * 3600 * 1000 - 1;
+
+// 在有序切换点数组上来回移动的游标；查询的时间大致递增时每次只移动几步
+class Cursor {
+public:
+    explicit Cursor(const QVector<int>& keyframes) : m_keyframes(keyframes), m_position(0) {}
+    
+    // 距离 time 最近且不超过 threshold 的切换点，没有时返回 -1；距离相同时取较早的一个
+    int nearest(int time, int threshold) {
+        const int count = m_keyframes.size();
+        while (m_position < count && m_keyframes[m_position] < time) ++m_position;
+        while (m_position > 0 && m_keyframes[m_position - 1] >= time) --m_position;
+        
+        int best = -1;
+        int bestDistance = threshold + 1;
+        if (m_position > 0 && time - m_keyframes[m_position - 1] < bestDistance) {
+            best = m_keyframes[m_position - 1];
+            bestDistance = time - best;
+        }
+        if (m_position < count && m_keyframes[m_position] - time < bestDistance) {
+            best = m_keyframes[m_position];
+        }
+        return best;
+    }
+
+private:
+    const QVector<int>& m_keyframes;
+    int m_position;
+};
+
+}
+
+QString SubtitleSnap::Stats::summary() const {
+    QString text = QString("吸附开始时间 %1 条，结束时间 %2 条").arg(starts).arg(ends);
+    if (skipped > 0) {
+        text += QString("，%1 处因间隔或时长不足未吸附").arg(skipped);
+    }
+    return text;
+}
+
+bool SubtitleSnap::readKeyframes(const QString& filePath, double fps, bool frameNumbers, QVector<int>& keyframes,
+                                 QString& errorMsg) {
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        errorMsg = "无法打开切换点文件: " + filePath;
+        return false;
+    }
+    
+    keyframes.clear();
+    QTextStream in(&file);
+    int lineNumber = 0;
+    bool aegisub = false;
+    double frameRate = fps;
+    static const QRegularExpression secondsPattern("^\\d+\\.\\d+$");
+    while (!in.atEnd()) {
+        QString line = in.readLine().trimmed();
+        ++lineNumber;
+        if (lineNumber == 1 && line.startsWith("# keyframe format v1", Qt::CaseInsensitive)) {
+            aegisub = true;
+            frameNumbers = true;
+            continue;
+        }
+        if (line.isEmpty() || line.startsWith('#')) continue;
+        if (aegisub && line.startsWith("fps ")) {
+            bool ok = false;
+            double rate = line.mid(4).toDouble(&ok);
+            if (ok && rate > 0) frameRate = rate;
+            continue;
+        }
+        
+        bool ok = false;
+        int milliseconds = 0;
+        if (frameNumbers) {
+            qint64 frame = line.toLongLong(&ok);
+            double value = ok && frame >= 0 && frameRate > 0 ? frame * 1000.0 / frameRate : -1.0;
+            ok = value >= 0 && value <= kMaxMilliseconds;
+            milliseconds = ok ? qRound(value) : 0;
+        } else if (secondsPattern.match(line).hasMatch()) {
+            double value = line.toDouble(&ok) * 1000.0;
+            ok = ok && value <= kMaxMilliseconds;
+            milliseconds = ok ? qRound(value) : 0;
+        } else {
+            ok = SubtitleConform::parseTimecode(line, fps, milliseconds);
+        }
+        if (!ok) {
+            errorMsg = QString("切换点文件第 %1 行格式无效：%2").arg(lineNumber).arg(line);
+            return false;
+        }
+        keyframes.append(milliseconds);
+    }
+    
+    if (keyframes.isEmpty()) {
+        errorMsg = "切换点文件中没有切换点";
+        return false;
+    }
+    std::sort(keyframes.begin(), keyframes.end());
+    keyframes.erase(std::unique(keyframes.begin(), keyframes.end()), keyframes.end());
+    return true;
+}
+
+SubtitleSnap::Stats SubtitleSnap::apply(QVector<SubtitleItem>& subtitles, const QVector<int>& keyframes,
+                                        const Options& options) {
+    PerfTrace::Scope scope("snap");
+    scope.setCount(subtitles.size());
+    
+    Stats stats;
+    const int count = subtitles.size();
+    if (count == 0 || keyframes.isEmpty() || (!options.snapStarts && !options.snapEnds)) return stats;
+    
+    QVector<int> order = SubtitleSort::sortedOrder(subtitles);
+    QVector<int> starts(count);
+    QVector<int> ends(count);
+    for (int i = 0; i < count; ++i) {
+        const SubtitleItem& item = subtitles[order.isEmpty() ? i : order[i]];
+        starts[i] = item.startTime.msecsSinceStartOfDay();
+        ends[i] = qMax(starts[i], item.endTime.msecsSinceStartOfDay());
+    }
+    
+    // 开始时间的候选先算出来，结束时间吸附时要看下一条会不会提前
+    QVector<int> startCandidates(count, -1);
+    if (options.snapStarts) {
+        Cursor cursor(keyframes);
+        for (int i = 0; i < count; ++i) {
+            startCandidates[i] = cursor.nearest(starts[i], options.thresholdMs);
+        }
+    }
+    
+    QVector<int> newStarts = starts;
+    QVector<int> newEnds = ends;
+    
+    // previousEnd 为前面各条字幕的最晚结束时间。向后移动不会缩小与前一条的间隔；向前移动要给前一条留出 minGapMs
+    auto snapStart = [&](int i, int previousEnd) {
+        const int candidate = startCandidates[i];
+        if (candidate < 0 || candidate == starts[i]) return;
+        const int minDuration = qMin(options.minDurationMs, ends[i] - starts[i]);
+        if ((candidate > starts[i] || candidate >= previousEnd + options.minGapMs) && ends[i] - candidate >= minDuration) {
+            newStarts[i] = candidate;
+            ++stats.starts;
+        } else {
+            ++stats.skipped;
+        }
+    };
+    
+    Cursor endCursor(keyframes);
+    int previousEnd = INT_MIN / 2;     // 前面各条字幕（已吸附）的最晚结束时间
+    snapStart(0, previousEnd);
+    for (int i = 0; i < count; ++i) {
+        const int end = ends[i];
+        const int minDuration = qMin(options.minDurationMs, end - starts[i]);
+        
+        // 先按本条原来的结束时间决定下一条的开始（包括间隔和时长检查），
+        // 本条的结束再按下一条最终的开始约束，被放弃的开始吸附不会影响本条
+        if (i + 1 < count) {
+            snapStart(i + 1, qMax(previousEnd, end));
+        }
+        
+        int candidate = options.snapEnds ? endCursor.nearest(end, options.thresholdMs) : -1;
+        if (candidate >= 0 && candidate != end) {
+            int target = candidate;
+            // 下一条从同一个切换点开始时，停在切换点之前 minGapMs 处
+            if (i + 1 < count && newStarts[i + 1] >= end) {
+                target = qMin(target, newStarts[i + 1] - options.minGapMs);
+            }
+            if (target != end && qAbs(target - end) <= options.thresholdMs && target - newStarts[i] >= minDuration) {
+                newEnds[i] = target;
+                ++stats.ends;
+            } else {
+                ++stats.skipped;
+            }
+        }
+        previousEnd = qMax(previousEnd, newEnds[i]);
+    }
+    
+    for (int i = 0; i < count; ++i) {
+        if (newStarts[i] == starts[i] && newEnds[i] == ends[i]) continue;
+        int row = order.isEmpty() ? i : order[i];
+        SubtitleItem& item = subtitles[row];
+        item.startTime = QTime::fromMSecsSinceStartOfDay(newStarts[i]);
+        item.endTime = QTime::fromMSecsSinceStartOfDay(newEnds[i]);
+        stats.firstRow = stats.firstRow < 0 ? row : qMin(stats.firstRow, row);
+        stats.lastRow = qMax(stats.lastRow, row);
+    }
+    return stats;
+}
@@ -0,0 +1,46 @@
+#ifndef SUBTITLESNAP_H
+#define SUBTITLESNAP_H
+
+#include <QString>
+#include <QVector>
+#include "subtitle.h"
+
+// 把字幕的开始和结束时间吸附到镜头切换点（关键帧）
+// 字幕按开始时间排列后与有序的切换点数组同时推进：开始和结束各用一个游标，
+// 游标只在相邻字幕之间小幅移动，整体为一趟线性扫描。吸附后与相邻字幕的间隔小于 minGapMs
+// 或时长不足时，结束时间改为停在下一条开始之前 minGapMs 处，仍不满足则放弃这次吸附。
+class SubtitleSnap {
+public:
+    struct Options {
+        int thresholdMs;        // 与切换点相距不超过此值才吸附
+        int minGapMs;           // 与相邻字幕保留的最小间隔
+        int minDurationMs;      // 吸附后的最短时长（原本更短的字幕不再缩短）
+        bool snapStarts;
+        bool snapEnds;
+        
+        Options() : thresholdMs(250), minGapMs(83), minDurationMs(500), snapStarts(true), snapEnds(true) {}
+    };
+    
+    struct Stats {
+        int starts;         // 吸附了开始时间的条数
+        int ends;
+        int skipped;        // 在阈值内有切换点、但因间隔或时长放弃的边界数
+        int firstRow;       // 被修改的行的范围，没有修改时为 -1
+        int lastRow;
+        
+        Stats() : starts(0), ends(0), skipped(0), firstRow(-1), lastRow(-1) {}
+        bool changed() const { return firstRow >= 0; }
+        QString summary() const;
+    };
+    
+    // 读取切换点列表，返回排序去重后的毫秒数。每行一个时间：HH:MM:SS,mmm、按 fps 换算的 HH:MM:SS:FF、
+    // 带小数的秒数或毫秒数；frameNumbers 为真时整数按帧号换算。# 开头为注释。
+    // 也接受 Aegisub 关键帧文件（"# keyframe format v1"），其中为帧号，帧率取文件中的 fps 行（为 0 时用 fps）
+    static bool readKeyframes(const QString& filePath, double fps, bool frameNumbers, QVector<int>& keyframes,
+                              QString& errorMsg);
+    
+    // 就地修改字幕时间，不改变行的顺序；keyframes 必须升序
+    static Stats apply(QVector<SubtitleItem>& subtitles, const QVector<int>& keyframes, const Options& options);
+};
+
+#endif // SUBTITLESNAP_H
@@ -0,0 +1,152 @@
+#include "subtitlesort.h"
+#include "perftrace.h"
+#include <QThreadPool>
+#include <QtConcurrent/QtConcurrentMap>
+#include <array>
+#include <functional>
+#include <utility>
+
+namespace {
+
+const int kDigitBits = 9;
+const int kBuckets = 1 << kDigitBits;
+const int kPasses = 3;                      // 3 × 9 = 27 位，足够表示 24 小时的毫秒数
+
+// 少于这么多条时单线程更快；每块至少这么多条
+const int kParallelThreshold = 1 << 16;
+const int kMinChunkSize = 1 << 15;
+
+// 高 32 位是开始时间，低 32 位是原来的行号
+inline quint64 packKey(const SubtitleItem& item, int row) {
+    return (quint64(quint32(item.startTime.msecsSinceStartOfDay())) << 32) | quint32(row);
+}
+
+inline int digitOf(quint64 value, int pass) {
+    return int((value >> (32 + pass * kDigitBits)) & (kBuckets - 1));
+}
+
+struct Chunk {
+    qsizetype begin;
+    qsizetype end;
+    std::array<qsizetype, kBuckets> counts;     // 计数，随后变为本块各桶的写入位置
+};
+
+void runChunks(QVector<Chunk>& chunks, QThreadPool* pool, const std::function<void(Chunk&)>& work) {
+    if (chunks.size() == 1 || !pool) {
+        for (Chunk& chunk : chunks) {
+            work(chunk);
+        }
+        return;
+    }
+    QtConcurrent::blockingMap(pool, chunks, work);
+}
+
+} // namespace
+
+bool SubtitleSort::isSorted(const QVector<SubtitleItem>& subtitles) {
+    for (int i = 1; i < subtitles.size(); ++i) {
+        if (subtitles[i].startTime < subtitles[i - 1].startTime) {
+            return false;
+        }
+    }
+    return true;
+}
+
+QVector<int> SubtitleSort::sortedOrder(const QVector<SubtitleItem>& subtitles, QThreadPool* pool) {
+    PerfTrace::Scope scope("sort");
+    scope.setCount(subtitles.size());
+    
+    if (isSorted(subtitles)) {
+        return QVector<int>();
+    }
+    
+    const qsizetype count = subtitles.size();
+    QVector<quint64> source(count);
+    QVector<quint64> target(count);
+    for (qsizetype row = 0; row < count; ++row) {
+        source[row] = packKey(subtitles[row], int(row));
+    }
+    
+    int chunkCount = 1;
+    if (pool && count >= kParallelThreshold) {
+        chunkCount = int(qBound<qsizetype>(1, count / kMinChunkSize, qMax(1, pool->maxThreadCount())));
+    }
+    QVector<Chunk> chunks(chunkCount);
+    for (int c = 0; c < chunkCount; ++c) {
+        chunks[c].begin = count * c / chunkCount;
+        chunks[c].end = count * (c + 1) / chunkCount;
+    }
+    
+    for (int pass = 0; pass < kPasses; ++pass) {
+        const quint64* from = source.constData();
+        quint64* to = target.data();
+        
+        runChunks(chunks, pool, [from, pass](Chunk& chunk) {
+            chunk.counts.fill(0);
+            for (qsizetype i = chunk.begin; i < chunk.end; ++i) {
+                ++chunk.counts[digitOf(from[i], pass)];
+            }
+        });
+        
+        // 所有元素这一位都相同时本趟不改变顺序
+        bool trivial = false;
+        for (int digit = 0; digit < kBuckets && !trivial; ++digit) {
+            qsizetype total = 0;
+            for (const Chunk& chunk : chunks) {
+                total += chunk.counts[digit];
+            }
+            trivial = total == count;
+        }
+        if (trivial) continue;
+        
+        // 先按桶、再按块分配输出位置：同一个桶里前面块的元素排在前面，排序保持稳定
+        qsizetype offset = 0;
+        for (int digit = 0; digit < kBuckets; ++digit) {
+            for (Chunk& chunk : chunks) {
+                qsizetype size = chunk.counts[digit];
+                chunk.counts[digit] = offset;
+                offset += size;
+            }
+        }
+        
+        runChunks(chunks, pool, [from, to, pass](Chunk& chunk) {
+            for (qsizetype i = chunk.begin; i < chunk.end; ++i) {
+                to[chunk.counts[digitOf(from[i], pass)]++] = from[i];
+            }
+        });
+        std::swap(source, target);
+    }
+    
+    QVector<int> order(count);
+    for (qsizetype i = 0; i < count; ++i) {
+        order[i] = int(quint32(source[i]));
+    }
+    return order;
+}
+
+int SubtitleSort::applyOrder(QVector<SubtitleItem>& subtitles, const QVector<int>& order) {
+    if (order.size() != subtitles.size()) return 0;
+    
+    int moved = 0;
+    QVector<SubtitleItem> sorted;
+    sorted.reserve(subtitles.size());
+    for (int row = 0; row < order.size(); ++row) {
+        if (order[row] != row) ++moved;
+        sorted.append(std::move(subtitles[order[row]]));
+    }
+    subtitles = std::move(sorted);
+    return moved;
+}
+
+int SubtitleSort::renumber(QVector<SubtitleItem>& subtitles) {
+    int renumbered = 0;
+    const QVector<SubtitleItem>& items = subtitles;
+    for (int row = 0; row < items.size(); ++row) {
+        // 只在序号不同时写入，序号本来就连续时不会让共享的数组分离
+        if (items[row].index != row + 1) {
+            subtitles[row].index = row + 1;
+            ++renumbered;
+        }
+    }
+    return renumbered;
+}
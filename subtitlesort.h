@@ -0,0 +1,35 @@
+#ifndef SUBTITLESORT_H
+#define SUBTITLESORT_H
+
+#include <QVector>
+#include "subtitle.h"
+
+class QThreadPool;
+
+// 字幕按开始时间稳定排序并重新编号
+// 开始时间换算为一天内的毫秒数（不超过 27 位），用 LSD 基数排序，每趟 9 位共 3 趟，
+// 时间相同的字幕保持文件中的先后顺序。条数较多时每趟的计数和分发按块并行：
+// 各块按顺序分配输出位置，结果与单线程完全相同。
+class SubtitleSort {
+public:
+    struct Result {
+        int moved;          // 位置发生变化的字幕条数
+        int renumbered;     // 序号被改写的字幕条数
+        
+        Result() : moved(0), renumbered(0) {}
+        bool changed() const { return moved > 0 || renumbered > 0; }
+    };
+    
+    static bool isSorted(const QVector<SubtitleItem>& subtitles);
+    
+    // 排序后的行顺序，order[新行] = 旧行；已经有序时返回空数组。pool 为空时单线程排序
+    static QVector<int> sortedOrder(const QVector<SubtitleItem>& subtitles, QThreadPool* pool = nullptr);
+    
+    // 按 order 重新排列，返回位置发生变化的条数
+    static int applyOrder(QVector<SubtitleItem>& subtitles, const QVector<int>& order);
+    
+    // 按位置重新编号为 1..N，返回序号被改写的条数
+    static int renumber(QVector<SubtitleItem>& subtitles);
+};
+
+#endif // SUBTITLESORT_H
@@ -0,0 +1,198 @@
+#include "subtitlesplice.h"
+#include "perftrace.h"
+#include "retimetransform.h"
+#include "subtitlestream.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QRegularExpression>
+#include <QSaveFile>
+#include <memory>
+
+qint64 SubtitleSplice::join(const QVector<Part>& parts, SubtitleEncoding encoding, SubtitleEncoding outputEncoding,
+                            QIODevice* output, QString& errorMsg)
+{
+    PerfTrace::Scope scope("join");
+    
+    for (int i = 1; i < parts.size(); ++i) {
+        if (parts[i].startMs < parts[i - 1].startMs) {
+            errorMsg = QString("第 %1 部分的开始时间早于前一部分").arg(i + 1);
+            return -1;
+        }
+    }
+    
+    SubtitleStreamWriter writer(output, outputEncoding);
+    for (const Part& part : parts) {
+        QFile file(part.filePath);
+        if (!file.open(QIODevice::ReadOnly)) {
+            errorMsg = "无法打开文件: " + part.filePath;
+            return -1;
+        }
+        
+        RetimeTransform transform = RetimeTransform::shift(part.startMs);
+        SubtitleStreamReader reader(&file, encoding);
+        SubtitleItem item;
+        while (reader.readNext(item)) {
+            transform.apply(item);
+            if (!writer.write(item)) break;
+        }
+        if (reader.hasError()) {
+            errorMsg = QFileInfo(part.filePath).fileName() + "：" + reader.errorString();
+            return -1;
+        }
+        if (writer.hasError()) break;
+    }
+    
+    if (!writer.flush()) {
+        errorMsg = writer.errorString();
+        return -1;
+    }
+    scope.setCount(writer.cuesWritten());
+    return writer.cuesWritten();
+}
+
+bool SubtitleSplice::split(QIODevice* input, SubtitleEncoding encoding, SubtitleEncoding outputEncoding,
+                           const QVector<int>& cutPointsMs, const QStringList& outputPaths, bool rebase,
+                           QVector<qint64>& counts, QString& errorMsg)
+{
+    PerfTrace::Scope scope("split");
+    
+    if (outputPaths.size() != cutPointsMs.size() + 1) {
+        errorMsg = "输出文件数与分段数不一致";
+        return false;
+    }
+    counts.fill(0, outputPaths.size());
+    
+    // 当前段的输出；进入下一段时先提交上一段
+    int segment = -1;
+    std::unique_ptr<QSaveFile> file;
+    std::unique_ptr<SubtitleStreamWriter> writer;
+    RetimeTransform transform;
+    
+    auto finishSegment = [&]() -> bool {
+        if (!writer) return true;
+        bool ok = writer->flush();
+        if (!ok) errorMsg = writer->errorString();
+        counts[segment] = writer->cuesWritten();
+        writer.reset();
+        if (ok && !file->commit()) {
+            errorMsg = "无法写入文件: " + file->fileName();
+            ok = false;
+        }
+        file.reset();
+        return ok;
+    };
+    auto startSegment = [&](int index) -> bool {
+        segment = index;
+        file.reset(new QSaveFile(outputPaths[index]));
+        if (!file->open(QIODevice::WriteOnly)) {
+            errorMsg = "无法写入文件: " + outputPaths[index];
+            return false;
+        }
+        writer.reset(new SubtitleStreamWriter(file.get(), outputEncoding));
+        int origin = (rebase && index > 0) ? cutPointsMs[index - 1] : 0;
+        transform = RetimeTransform::shift(-origin);
+        return true;
+    };
+    
+    if (!startSegment(0)) return false;
+    
+    SubtitleStreamReader reader(input, encoding);
+    SubtitleItem item;
+    while (reader.readNext(item)) {
+        int startMs = item.startTime.msecsSinceStartOfDay();
+        while (segment < cutPointsMs.size() && startMs >= cutPointsMs[segment]) {
+            if (!finishSegment() || !startSegment(segment + 1)) return false;
+        }
+        transform.apply(item);
+        if (!writer->write(item)) {
+            errorMsg = writer->errorString();
+            return false;
+        }
+    }
+    if (reader.hasError()) {
+        errorMsg = reader.errorString();
+        return false;
+    }
+    
+    // 后面没有字幕的段也写出空文件，输出数量始终与分段数一致
+    if (!finishSegment()) return false;
+    while (segment + 1 < outputPaths.size()) {
+        if (!startSegment(segment + 1) || !finishSegment()) return false;
+    }
+    
+    scope.setCount(reader.cuesRead());
+    return true;
+}
+
+QString SubtitleSplice::joinFiles(const QVector<Part>& parts, SubtitleEncoding encoding, SubtitleEncoding outputEncoding,
+                                  const QString& outputPath)
+{
+    QSaveFile file(outputPath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return "无法写入文件: " + outputPath;
+    }
+    
+    QString errorMsg;
+    if (join(parts, encoding, outputEncoding, &file, errorMsg) < 0) {
+        file.cancelWriting();
+        return errorMsg;
+    }
+    if (!file.commit()) {
+        return "无法写入文件: " + outputPath;
+    }
+    return QString();
+}
+
+QString SubtitleSplice::splitFile(const QString& inputPath, SubtitleEncoding encoding, SubtitleEncoding outputEncoding,
+                                  const QVector<int>& cutPointsMs, const QStringList& outputPaths, bool rebase)
+{
+    QFile file(inputPath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return "无法打开文件: " + inputPath;
+    }
+    
+    QVector<qint64> counts;
+    QString errorMsg;
+    if (!split(&file, encoding, outputEncoding, cutPointsMs, outputPaths, rebase, counts, errorMsg)) {
+        return errorMsg;
+    }
+    return QString();
+}
+
+QStringList SubtitleSplice::partPaths(const QString& basePath, int partCount)
+{
+    QFileInfo info(basePath);
+    QString suffix = info.suffix().isEmpty() ? QString("srt") : info.suffix();
+    QStringList paths;
+    for (int i = 0; i < partCount; ++i) {
+        paths << info.dir().filePath(QString("%1_part%2.%3").arg(info.completeBaseName()).arg(i + 1).arg(suffix));
+    }
+    return paths;
+}
+
+bool SubtitleSplice::parseCutPoints(const QString& text, QVector<int>& cutPointsMs, QString& errorMsg)
+{
+    cutPointsMs.clear();
+    // 时间本身含逗号（00:01:02,000）：只有前面是 H:MM:SS、后面恰好是三位数字的逗号才视为毫秒部分，
+    // 其余逗号都是分隔符，500,750 是两个毫秒数
+    const QStringList tokens = text.split(QRegularExpression("[;\\s]+|,(?!(?<=\\d:\\d\\d:\\d\\d,)\\d{3}(?:\\D|$))"),
+                                          Qt::SkipEmptyParts);
+    for (const QString& token : tokens) {
+        int milliseconds = 0;
+        if (!RetimeTransform::parseTimeValue(token, milliseconds) || milliseconds <= 0) {
+            errorMsg = "无效的分割点: " + token;
+            return false;
+        }
+        if (!cutPointsMs.isEmpty() && milliseconds <= cutPointsMs.last()) {
+            errorMsg = "分割点必须递增: " + token;
+            return false;
+        }
+        cutPointsMs.append(milliseconds);
+    }
+    if (cutPointsMs.isEmpty()) {
+        errorMsg = "没有指定分割点";
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,50 @@
+#ifndef SUBTITLESPLICE_H
+#define SUBTITLESPLICE_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include "subtitle.h"
+
+class QIODevice;
+
+// 分段字幕的合并与分割
+// 两者都基于 SubtitleStreamReader/Writer 逐条处理：读一条、平移一条、写一条，
+// 写出时按顺序重新编号，任何时刻只持有一条字幕，内存占用与文件大小和分段数无关。
+class SubtitleSplice {
+public:
+    struct Part {
+        QString filePath;
+        int startMs;        // 这一部分在完整影片中的开始时间，所有字幕按此平移
+        
+        Part() : startMs(0) {}
+        Part(const QString& path, int start) : filePath(path), startMs(start) {}
+    };
+    
+    // 依次读取各部分写到 output，序号连续，按 outputEncoding 编码；返回写出的条数，出错时返回 -1
+    static qint64 join(const QVector<Part>& parts, SubtitleEncoding encoding, SubtitleEncoding outputEncoding,
+                       QIODevice* output, QString& errorMsg);
+    
+    // 在各分割点（毫秒，递增）处把 input 分成 cutPoints.size() + 1 段，依次写到 outputPaths。
+    // 按开始时间归属：开始时间不早于分割点的字幕进入下一段；跨越分割点的字幕留在前一段。
+    // rebase 为 true 时每段的时间从所在段的分割点起算。counts 返回每段的条数。
+    static bool split(QIODevice* input, SubtitleEncoding encoding, SubtitleEncoding outputEncoding,
+                      const QVector<int>& cutPointsMs, const QStringList& outputPaths, bool rebase,
+                      QVector<qint64>& counts, QString& errorMsg);
+    
+    // 合并到文件，写完后再替换目标；在线程池中调用，返回错误信息，成功时为空
+    static QString joinFiles(const QVector<Part>& parts, SubtitleEncoding encoding, SubtitleEncoding outputEncoding,
+                             const QString& outputPath);
+    
+    // 分割文件；在线程池中调用，返回错误信息，成功时为空
+    static QString splitFile(const QString& inputPath, SubtitleEncoding encoding, SubtitleEncoding outputEncoding,
+                             const QVector<int>& cutPointsMs, const QStringList& outputPaths, bool rebase);
+    
+    // 分割输出的默认文件名：base_part1.srt、base_part2.srt ...
+    static QStringList partPaths(const QString& basePath, int partCount);
+    
+    // 解析逗号或空格分隔的分割点列表（HH:MM:SS,mmm 或毫秒数），要求严格递增
+    static bool parseCutPoints(const QString& text, QVector<int>& cutPointsMs, QString& errorMsg);
+};
+
+#endif // SUBTITLESPLICE_H
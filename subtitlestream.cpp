@@ -0,0 +1,166 @@
+#include "subtitlestream.h"
+#include <QIODevice>
+
+namespace {
+
+// 缓冲达到该大小时写入设备；较小的值让管道下游尽早拿到数据
+const int kFlushThreshold = 16 * 1024;
+
+bool isBlank(const QByteArray& line) {
+    for (char c : line) {
+        if (c != ' ' && c != '\t' && c != '\r' && c != '\n' && c != '\v' && c != '\f') return false;
+    }
+    return true;
+}
+
+}
+
+SubtitleStreamReader::SubtitleStreamReader(QIODevice* device, SubtitleEncoding encoding)
+    : m_device(device)
+    , m_encoding(encoding)
+    , m_blockFirstLine(0)
+    , m_lineNumber(0)
+    , m_cuesRead(0)
+    , m_atEnd(false)
+{
+    // 按行切分字节流，要求换行符是单字节
+    if (!SRTParser::isAsciiCompatible(encoding)) {
+        m_errorMsg = QString("流式读取不支持 %1 编码，请先转换为 UTF-8").arg(SRTParser::encodingName(encoding));
+    }
+}
+
+bool SubtitleStreamReader::readLine(QByteArray& line) {
+    while (true) {
+        line = m_device->readLine();
+        if (!line.isEmpty()) {
+            ++m_lineNumber;
+            return true;
+        }
+        // 套接字、进程等设备需要等待更多数据；文件和标准输入的 readLine 本身会阻塞
+        if (m_device->isSequential() && m_device->waitForReadyRead(-1)) {
+            continue;
+        }
+        return false;
+    }
+}
+
+bool SubtitleStreamReader::readNext(SubtitleItem& item) {
+    if (!m_errorMsg.isEmpty()) return false;
+    
+    QByteArray line;
+    while (!m_atEnd) {
+        if (!readLine(line)) {
+            m_atEnd = true;
+            break;
+        }
+        
+        if (isBlank(line)) {
+            if (m_block.isEmpty()) continue;
+            if (finishBlock(item)) return true;
+            if (hasError()) return false;
+            continue;
+        }
+        
+        if (m_block.isEmpty()) {
+            m_blockFirstLine = m_lineNumber;
+        }
+        m_block += line;
+    }
+    
+    // 最后一个块后面可能没有空行
+    if (!m_block.isEmpty() && finishBlock(item)) {
+        return true;
+    }
+    return false;
+}
+
+bool SubtitleStreamReader::finishBlock(SubtitleItem& item) {
+    CueSpan span;
+    bool ok = SRTParser::parseBlock(m_block.constData(), m_block.size(), item, span);
+    if (!ok) {
+        // 与 parse() 一致，无法识别的块直接跳过
+        m_block.clear();
+        return false;
+    }
+    
+    QByteArray raw = m_block.mid(span.textOffset, span.textLength);
+    if (raw.contains('\r')) {
+        raw.replace("\r\n", "\n");
+    }
+    m_block.clear();
+    
+    QString errorMsg;
+    if (!SRTParser::decode(raw, m_encoding, item.text, errorMsg)) {
+        m_errorMsg = QString("第 %1 行：%2").arg(m_blockFirstLine).arg(errorMsg);
+        return false;
+    }
+    
+    ++m_cuesRead;
+    return true;
+}
+
+SubtitleStreamWriter::SubtitleStreamWriter(QIODevice* device, SubtitleEncoding encoding)
+    : m_device(device)
+    , m_encoder(encoding)
+    , m_encoding(encoding)
+    , m_cuesWritten(0)
+{
+    m_buffer.reserve(kFlushThreshold * 2);
+    m_pending.reserve(1024);
+    if (!m_encoder.isValid()) {
+        m_errorMsg = "当前Qt环境不支持所选编码（可能缺少ICU支持）";
+    }
+}
+
+SubtitleStreamWriter::~SubtitleStreamWriter() {
+    flush();
+}
+
+bool SubtitleStreamWriter::write(const SubtitleItem& item) {
+    if (!m_errorMsg.isEmpty()) return false;
+    
+    // 与 SRTParser::save 相同的格式和换行符：条目之间一个空行，末尾没有空行
+    const QLatin1String newline = SRTParser::newline();
+    m_pending.resize(0);
+    if (m_cuesWritten > 0) {
+        m_pending += newline;
+    }
+    ++m_cuesWritten;
+    m_pending += QString::number(m_cuesWritten);
+    m_pending += newline;
+    m_pending += SRTParser::formatTime(item.startTime);
+    m_pending += QLatin1String(" --> ");
+    m_pending += SRTParser::formatTime(item.endTime);
+    m_pending += newline;
+    if (newline.size() == 1) {
+        m_pending += item.text;
+    } else {
+        QString text = item.text;
+        m_pending += text.replace(QLatin1Char('\n'), newline);
+    }
+    m_pending += newline;
+    
+    qsizetype size = m_encoder.encode(m_pending);
+    if (m_encoder.hasError()) {
+        m_errorMsg = QString("第 %1 条字幕含有无法用 %2 编码表示的字符")
+                     .arg(m_cuesWritten).arg(SRTParser::encodingName(m_encoding));
+        return false;
+    }
+    m_buffer.append(m_encoder.data(), size);
+    
+    if (m_buffer.size() >= kFlushThreshold) {
+        return flush();
+    }
+    return true;
+}
+
+bool SubtitleStreamWriter::flush() {
+    if (m_buffer.isEmpty() || !m_errorMsg.isEmpty()) return m_errorMsg.isEmpty();
+    
+    if (m_device->write(m_buffer) != m_buffer.size()) {
+        m_errorMsg = "写入失败：" + m_device->errorString();
+        return false;
+    }
+    m_buffer.resize(0);
+    return true;
+}
@@ -0,0 +1,63 @@
+#ifndef SUBTITLESTREAM_H
+#define SUBTITLESTREAM_H
+
+#include <QByteArray>
+#include <QString>
+#include "subtitle.h"
+
+class QIODevice;
+
+// 逐条读取字幕的流式读取器
+// 可用于任意 QIODevice（文件、管道、标准输入），任何时刻只缓存一个字幕块，
+// 读到一条就可以交给下游处理，内存占用与文件大小无关。只支持与 ASCII 兼容的编码
+class SubtitleStreamReader {
+public:
+    explicit SubtitleStreamReader(QIODevice* device, SubtitleEncoding encoding = SubtitleEncoding::Utf8);
+    
+    // 读取下一条字幕；到达结尾或出错时返回false，用 hasError() 区分
+    bool readNext(SubtitleItem& item);
+    
+    bool hasError() const { return !m_errorMsg.isEmpty(); }
+    QString errorString() const { return m_errorMsg; }
+    qint64 cuesRead() const { return m_cuesRead; }
+
+private:
+    bool readLine(QByteArray& line);
+    bool finishBlock(SubtitleItem& item);
+    
+    QIODevice* m_device;
+    SubtitleEncoding m_encoding;
+    QByteArray m_block;
+    qint64 m_blockFirstLine;
+    qint64 m_lineNumber;
+    qint64 m_cuesRead;
+    bool m_atEnd;
+    QString m_errorMsg;
+};
+
+// 逐条写出字幕的流式写入器，按写入顺序重新编号，按所选编码直接编码输出
+class SubtitleStreamWriter {
+public:
+    explicit SubtitleStreamWriter(QIODevice* device, SubtitleEncoding encoding = SubtitleEncoding::Utf8);
+    ~SubtitleStreamWriter();
+    
+    bool write(const SubtitleItem& item);
+    
+    // 把缓冲写入设备；析构时也会调用
+    bool flush();
+    
+    bool hasError() const { return !m_errorMsg.isEmpty(); }
+    QString errorString() const { return m_errorMsg; }
+    qint64 cuesWritten() const { return m_cuesWritten; }
+
+private:
+    QIODevice* m_device;
+    SubtitleTextEncoder m_encoder;
+    SubtitleEncoding m_encoding;
+    QString m_pending;      // 当前一条字幕的文本，编码后追加到 m_buffer
+    QByteArray m_buffer;
+    qint64 m_cuesWritten;
+    QString m_errorMsg;
+};
+
+#endif // SUBTITLESTREAM_H
@@ -0,0 +1,186 @@
+#include "subtitletablemodel.h"
+
+SubtitleTableModel::SubtitleTableModel(QVector<SubtitleItem>* subtitles, QObject* parent)
+    : QAbstractTableModel(parent)
+    , m_subtitles(subtitles)
+    , m_replaceFirst(0)
+    , m_replaceRemoved(0)
+    , m_replaceInserted(0)
+{
+}
+
+int SubtitleTableModel::rowCount(const QModelIndex& parent) const
+{
+    if (parent.isValid()) return 0;
+    return m_subtitles->size();
+}
+
+int SubtitleTableModel::columnCount(const QModelIndex& parent) const
+{
+    if (parent.isValid()) return 0;
+    return ColumnCount;
+}
+
+QVariant SubtitleTableModel::data(const QModelIndex& index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_subtitles->size()) return QVariant();
+    if (role != Qt::DisplayRole && role != Qt::EditRole) return QVariant();
+    
+    const SubtitleItem& item = m_subtitles->at(index.row());
+    switch (index.column()) {
+    case IndexColumn:
+        return QString::number(item.index);
+    case StartColumn:
+        return SRTParser::formatTime(item.startTime);
+    case EndColumn:
+        return SRTParser::formatTime(item.endTime);
+    case TextColumn:
+        return item.text;
+    }
+    return QVariant();
+}
+
+QVariant SubtitleTableModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (role != Qt::DisplayRole) return QVariant();
+    if (orientation == Qt::Vertical) return section + 1;
+    
+    switch (section) {
+    case IndexColumn:
+        return QString("序号");
+    case StartColumn:
+        return QString("开始时间");
+    case EndColumn:
+        return QString("结束时间");
+    case TextColumn:
+        return QString("字幕文本");
+    }
+    return QVariant();
+}
+
+Qt::ItemFlags SubtitleTableModel::flags(const QModelIndex& index) const
+{
+    if (!index.isValid()) return Qt::NoItemFlags;
+    return Qt::ItemIsSelectable | Qt::ItemIsEnabled | Qt::ItemIsEditable;
+}
+
+bool SubtitleTableModel::setData(const QModelIndex& index, const QVariant& value, int role)
+{
+    if (!index.isValid() || role != Qt::EditRole || index.row() >= m_subtitles->size()) {
+        return false;
+    }
+    
+    SubtitleItem& item = (*m_subtitles)[index.row()];
+    QString text = value.toString();
+    
+    bool ok = true;
+    switch (index.column()) {
+    case IndexColumn: {
+        int newIndex = text.toInt(&ok);
+        if (!ok) {
+            emit editRejected("序号必须是整数");
+            return false;
+        }
+        item.index = newIndex;
+        break;
+    }
+    case StartColumn: {
+        QTime time = SRTParser::parseTime(text, ok);
+        if (!ok) {
+            emit editRejected("时间格式不正确，应为 HH:MM:SS,mmm");
+            return false;
+        }
+        item.startTime = time;
+        break;
+    }
+    case EndColumn: {
+        QTime time = SRTParser::parseTime(text, ok);
+        if (!ok) {
+            emit editRejected("时间格式不正确，应为 HH:MM:SS,mmm");
+            return false;
+        }
+        item.endTime = time;
+        break;
+    }
+    case TextColumn:
+        item.text = text;
+        break;
+    default:
+        return false;
+    }
+    
+    emit dataChanged(index, index, {Qt::DisplayRole, Qt::EditRole});
+    emit cellEdited(index.row(), index.column(), text);
+    return true;
+}
+
+void SubtitleTableModel::beginResetRows()
+{
+    beginResetModel();
+}
+
+void SubtitleTableModel::endResetRows()
+{
+    endResetModel();
+}
+
+void SubtitleTableModel::notifyRowsChanged(int firstRow, int lastRow)
+{
+    if (m_subtitles->isEmpty()) return;
+    firstRow = qBound(0, firstRow, m_subtitles->size() - 1);
+    lastRow = qBound(firstRow, lastRow, m_subtitles->size() - 1);
+    emit dataChanged(index(firstRow, 0), index(lastRow, ColumnCount - 1));
+}
+
+void SubtitleTableModel::beginReplaceRows(int firstRow, int removed, int inserted)
+{
+    m_replaceFirst = firstRow;
+    m_replaceRemoved = removed;
+    m_replaceInserted = inserted;
+    
+    int common = qMin(removed, inserted);
+    if (removed > common) {
+        beginRemoveRows(QModelIndex(), firstRow + common, firstRow + removed - 1);
+    } else if (inserted > common) {
+        beginInsertRows(QModelIndex(), firstRow + common, firstRow + inserted - 1);
+    }
+}
+
+void SubtitleTableModel::endReplaceRows()
+{
+    int common = qMin(m_replaceRemoved, m_replaceInserted);
+    if (m_replaceRemoved > common) {
+        endRemoveRows();
+    } else if (m_replaceInserted > common) {
+        endInsertRows();
+    }
+    if (common > 0) {
+        notifyRowsChanged(m_replaceFirst, m_replaceFirst + common - 1);
+    }
+}
+
+void SubtitleTableModel::beginReorderRows()
+{
+    emit layoutAboutToBeChanged();
+}
+
+void SubtitleTableModel::endReorderRows(const QVector<int>& order)
+{
+    QVector<int> newRowOf(order.size());
+    for (int row = 0; row < order.size(); ++row) {
+        newRowOf[order[row]] = row;
+    }
+    
+    const QModelIndexList oldIndexes = persistentIndexList();
+    QModelIndexList newIndexes;
+    newIndexes.reserve(oldIndexes.size());
+    for (const QModelIndex& oldIndex : oldIndexes) {
+        if (oldIndex.row() < newRowOf.size()) {
+            newIndexes.append(index(newRowOf[oldIndex.row()], oldIndex.column()));
+        } else {
+            newIndexes.append(QModelIndex());
+        }
+    }
+    changePersistentIndexList(oldIndexes, newIndexes);
+    emit layoutChanged();
+}
@@ -0,0 +1,65 @@
+#ifndef SUBTITLETABLEMODEL_H
+#define SUBTITLETABLEMODEL_H
+
+#include <QAbstractTableModel>
+#include <QVector>
+#include "subtitle.h"
+
+// 直接映射文档字幕数组的表格模型
+// 不复制任何数据，单元格文本在 data() 中按需生成，行数再多也是常数内存
+class SubtitleTableModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    enum Column {
+        IndexColumn = 0,
+        StartColumn,
+        EndColumn,
+        TextColumn,
+        ColumnCount
+    };
+    
+    explicit SubtitleTableModel(QVector<SubtitleItem>* subtitles, QObject* parent = nullptr);
+    
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+    Qt::ItemFlags flags(const QModelIndex& index) const override;
+    bool setData(const QModelIndex& index, const QVariant& value, int role = Qt::EditRole) override;
+    
+    // 字幕数组被整体替换前后分别调用
+    void beginResetRows();
+    void endResetRows();
+    
+    // 字幕数组中 [firstRow, lastRow] 区间被原地修改后调用，只发出一次 dataChanged
+    void notifyRowsChanged(int firstRow, int lastRow);
+    
+    // 字幕数组的 [firstRow, firstRow + removed) 被替换为 inserted 行时，在修改数组前后分别调用；
+    // 行数的差额按插入/删除通知，其余按原地修改通知，视图保留选区和滚动位置
+    void beginReplaceRows(int firstRow, int removed, int inserted);
+    void endReplaceRows();
+    
+    // 字幕数组按 order 重新排列（order[新行] = 旧行）的前后分别调用，整个过程只发出一次布局变化；
+    // 选区等持久索引跟随字幕移动到新的行
+    void beginReorderRows();
+    void endReorderRows(const QVector<int>& order);
+
+signals:
+    // 用户输入无法接受（例如时间格式错误）
+    void editRejected(const QString& message);
+    
+    // 用户通过界面成功修改了一个单元格
+    void cellEdited(int row, int column, const QString& value);
+
+private:
+    QVector<SubtitleItem>* m_subtitles;
+    
+    // beginReplaceRows 记录的区间
+    int m_replaceFirst;
+    int m_replaceRemoved;
+    int m_replaceInserted;
+};
+
+#endif // SUBTITLETABLEMODEL_H
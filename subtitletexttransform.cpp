@@ -0,0 +1,268 @@
+#include "subtitletexttransform.h"
+#include "chineseconverter.h"
+#include "parallelchunks.h"
+#include "perftrace.h"
+#include "textpool.h"
+#include <QStringList>
+
+namespace {
+
+// 汉字和假名；标点不算，用来判断 ASCII 标点是否处在中文语境中
+bool isCjkLetter(QChar ch) {
+    const ushort u = ch.unicode();
+    return (u >= 0x4E00 && u <= 0x9FFF) || (u >= 0x3400 && u <= 0x4DBF) || (u >= 0xF900 && u <= 0xFAFF)
+        || (u >= 0x3040 && u <= 0x30FF);
+}
+
+// 全角的数字和拉丁字母
+bool isFullWidthAlnum(ushort u) {
+    return (u >= 0xFF10 && u <= 0xFF19) || (u >= 0xFF21 && u <= 0xFF3A) || (u >= 0xFF41 && u <= 0xFF5A);
+}
+
+// 输出中最后一个非空白字符，没有时为空字符
+QChar lastVisible(const QString& text) {
+    for (int i = text.size() - 1; i >= 0; --i) {
+        if (!text[i].isSpace()) return text[i];
+    }
+    return QChar();
+}
+
+// 从 from 开始的第一个非空白字符的位置，没有时为 text.size()
+int nextVisible(const QString& text, int from) {
+    while (from < text.size() && text[from].isSpace()) ++from;
+    return from;
+}
+
+// 对应的中文全角标点，不转换时为空字符
+QChar fullWidthFor(QChar ch) {
+    switch (ch.unicode()) {
+    case ',': return QChar(0xFF0C);
+    case '?': return QChar(0xFF1F);
+    case '!': return QChar(0xFF01);
+    case ':': return QChar(0xFF1A);
+    case ';': return QChar(0xFF1B);
+    case '(': return QChar(0xFF08);
+    case ')': return QChar(0xFF09);
+    case '.': return QChar(0x3002);
+    default: return QChar();
+    }
+}
+
+std::shared_ptr<const ChineseConverter> converterFor(const SubtitleTextTransform::Options& options,
+                                                     QString& errorMsg) {
+    ChineseConverter::Direction direction = options.conversion == SubtitleTextTransform::ToTraditional
+                                            ? ChineseConverter::SimplifiedToTraditional
+                                            : ChineseConverter::TraditionalToSimplified;
+    return ChineseConverter::shared(direction, options.dictionaryDirectory, errorMsg);
+}
+
+}
+
+QString SubtitleTextTransform::Result::summary() const {
+    return QString("修改了 %1 条字幕的文本").arg(changed);
+}
+
+QString SubtitleTextTransform::stripTags(const QString& text) {
+    const int length = text.size();
+    QString result;
+    result.reserve(length);
+    bool changed = false;
+    for (int i = 0; i < length; ++i) {
+        const QChar ch = text[i];
+        if (ch == '<') {
+            // <i>、</i>、<font color="...">：< 之后（可有 /）必须是字母
+            int tagStart = i + 1 < length && text[i + 1] == '/' ? i + 2 : i + 1;
+            int close = text.indexOf('>', i + 1);
+            int nested = text.indexOf('<', i + 1);
+            if (close > tagStart && text[tagStart].isLetter() && (nested < 0 || nested > close)) {
+                i = close;
+                changed = true;
+                continue;
+            }
+        } else if (ch == '{' && i + 1 < length && text[i + 1] == '\\') {
+            int close = text.indexOf('}', i + 2);
+            if (close > 0) {
+                i = close;
+                changed = true;
+                continue;
+            }
+        } else if (ch == '\\' && i + 1 < length) {
+            const QChar next = text[i + 1];
+            if (next == 'N' || next == 'n' || next == 'h') {
+                result += next == 'h' ? QLatin1Char(' ') : QLatin1Char('\n');
+                ++i;
+                changed = true;
+                continue;
+            }
+        }
+        result += ch;
+    }
+    if (!changed) return text;
+    
+    // 去掉只剩空白的行和标签留下的首尾空格
+    QStringList lines = result.split('\n');
+    QStringList kept;
+    for (const QString& line : lines) {
+        QString trimmed = line.trimmed();
+        if (!trimmed.isEmpty()) kept.append(trimmed);
+    }
+    return kept.join('\n');
+}
+
+QString SubtitleTextTransform::normalizePunctuation(const QString& text, Punctuation punctuation) {
+    if (punctuation == KeepPunctuation) return text;
+    
+    const int length = text.size();
+    QString result;
+    result.reserve(length);
+    bool changed = false;
+    for (int i = 0; i < length; ++i) {
+        const QChar ch = text[i];
+        const ushort u = ch.unicode();
+        if (isFullWidthAlnum(u)) {
+            result += QChar(u - 0xFEE0);
+            changed = true;
+            continue;
+        }
+        
+        if (punctuation == HalfWidth) {
+            if (u >= 0xFF01 && u <= 0xFF5E) {
+                result += QChar(u - 0xFEE0);
+                changed = true;
+            } else if (u == 0x3000) {
+                result += QLatin1Char(' ');
+                changed = true;
+            } else {
+                result += ch;
+            }
+            continue;
+        }
+        
+        const QChar full = fullWidthFor(ch);
+        if (full.isNull()) {
+            result += ch;
+            continue;
+        }
+        const QChar previous = lastVisible(result);
+        int nextIndex = nextVisible(text, i + 1);
+        const QChar next = nextIndex < length ? text[nextIndex] : QChar();
+        bool convert = false;
+        if (ch == '(') {
+            convert = isCjkLetter(next);
+        } else if (ch == ')') {
+            convert = isCjkLetter(previous);
+        } else if (ch == '.') {
+            // 省略号在中文两侧都可以；句号只跟在汉字后面，避免改动小数和缩写
+            if (text.mid(i, 3) == QLatin1String("...") && (isCjkLetter(previous) || isCjkLetter(next))) {
+                while (!result.isEmpty() && result.back().isSpace() && result.back() != '\n') result.chop(1);
+                result += QString(2, QChar(0x2026));
+                i += 2;
+                while (i + 1 < length && text[i + 1] == '.') ++i;
+                changed = true;
+                continue;
+            }
+            convert = isCjkLetter(previous) && !next.isLetterOrNumber();
+        } else {
+            // 1,000 和 12:30 中的标点保持不变
+            bool betweenDigits = previous.isDigit() && next.isDigit();
+            convert = !betweenDigits && (isCjkLetter(previous) || isCjkLetter(next));
+        }
+        if (!convert) {
+            result += ch;
+            continue;
+        }
+        // 全角标点自带间距，去掉两侧的空格
+        while (!result.isEmpty() && result.back().isSpace() && result.back() != '\n') result.chop(1);
+        result += full;
+        while (i + 1 < length && text[i + 1] == ' ') ++i;
+        changed = true;
+    }
+    return changed ? result : text;
+}
+
+bool SubtitleTextTransform::parseConversion(const QString& name, Conversion& conversion) {
+    if (name.isEmpty() || name == "none") {
+        conversion = NoConversion;
+    } else if (name == "traditional" || name == "t" || name == "s2t") {
+        conversion = ToTraditional;
+    } else if (name == "simplified" || name == "s" || name == "t2s") {
+        conversion = ToSimplified;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool SubtitleTextTransform::parsePunctuation(const QString& name, Punctuation& punctuation) {
+    if (name.isEmpty() || name == "keep") {
+        punctuation = KeepPunctuation;
+    } else if (name == "half") {
+        punctuation = HalfWidth;
+    } else if (name == "full") {
+        punctuation = FullWidth;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool SubtitleTextTransform::prepare(const Options& options, QString& errorMsg) {
+    return options.conversion == NoConversion || converterFor(options, errorMsg) != nullptr;
+}
+
+bool SubtitleTextTransform::apply(QVector<SubtitleItem>& subtitles, const Options& options, Result& result,
+                                  QString& errorMsg, QThreadPool* pool) {
+    result = Result();
+    std::shared_ptr<const ChineseConverter> converter;
+    if (options.conversion != NoConversion) {
+        converter = converterFor(options, errorMsg);
+        if (!converter) return false;
+    }
+    if (options.isEmpty() || subtitles.isEmpty()) return true;
+    
+    PerfTrace::Scope scope("textTransform");
+    scope.setCount(subtitles.size());
+    
+    // 先在这里分离数组，各块只写自己范围内的字幕
+    SubtitleItem* items = subtitles.data();
+    const ChineseConverter* chinese = converter.get();
+    QVector<int> changed(ParallelChunks::chunkCount(subtitles.size()), 0);
+    int* counts = changed.data();
+    ParallelChunks::run(subtitles.size(), pool, [items, &options, chinese, counts](int chunk, int begin, int end) {
+        for (int row = begin; row < end; ++row) {
+            QString text = items[row].text;
+            if (options.stripTags) text = stripTags(text);
+            if (chinese) text = chinese->convert(text);
+            text = normalizePunctuation(text, options.punctuation);
+            if (text != items[row].text) {
+                items[row].text = text;
+                ++counts[chunk];
+            }
+        }
+    });
+    
+    for (int count : changed) {
+        result.changed += count;
+    }
+    return true;
+}
+
+QString SubtitleTextTransform::transformFile(const QString& inputPath, const QString& outputPath,
+                                             SubtitleEncoding encoding, SubtitleEncoding outputEncoding,
+                                             const Options& options, Result* result) {
+    TextPool pool;
+    QVector<SubtitleItem> subtitles;
+    QString errorMsg;
+    if (!SRTParser::parse(inputPath, subtitles, errorMsg, encoding, &pool)) {
+        return errorMsg;
+    }
+    
+    Result localResult;
+    if (!apply(subtitles, options, result ? *result : localResult, errorMsg)) {
+        return errorMsg;
+    }
+    if (!SRTParser::save(outputPath, subtitles, errorMsg, outputEncoding)) {
+        return errorMsg;
+    }
+    return QString();
+}
@@ -0,0 +1,65 @@
+#ifndef SUBTITLETEXTTRANSFORM_H
+#define SUBTITLETEXTTRANSFORM_H
+
+#include <QString>
+#include <QVector>
+#include "subtitle.h"
+
+class QThreadPool;
+
+// 批量处理字幕文本：去掉 HTML/ASS 标签、简繁转换、统一全角/半角标点，按此顺序执行
+// 每条字幕互不相关，按 4096 条一块在线程池中并行；只改文本，不改时间和顺序。
+class SubtitleTextTransform {
+public:
+    enum Conversion {
+        NoConversion,
+        ToTraditional,
+        ToSimplified
+    };
+    
+    enum Punctuation {
+        KeepPunctuation,
+        HalfWidth,      // 全角字母、数字和 ASCII 标点的全角形式改为半角，全角空格改为空格
+        FullWidth       // 全角字母数字改为半角；紧邻汉字的 ASCII 标点改为中文全角标点
+    };
+    
+    struct Options {
+        Conversion conversion;
+        bool stripTags;
+        Punctuation punctuation;
+        QString dictionaryDirectory;    // OpenCC 格式的词典目录，空为只用内置字词表
+        
+        Options() : conversion(NoConversion), stripTags(false), punctuation(KeepPunctuation) {}
+        bool isEmpty() const { return conversion == NoConversion && !stripTags && punctuation == KeepPunctuation; }
+    };
+    
+    struct Result {
+        int changed;        // 文本有变化的字幕条数
+        
+        Result() : changed(0) {}
+        QString summary() const;
+    };
+    
+    // 预先加载并编译词典（结果在进程内共享），批量处理前调用一次即可
+    static bool prepare(const Options& options, QString& errorMsg);
+    
+    // 就地修改字幕文本；词典加载失败时返回 false，字幕保持不变。pool 为空时单线程处理
+    static bool apply(QVector<SubtitleItem>& subtitles, const Options& options, Result& result, QString& errorMsg,
+                      QThreadPool* pool = nullptr);
+    
+    // 解析文件、处理后写到 outputPath；在线程池中调用，各文件之间并行，返回错误信息，成功时为空
+    static QString transformFile(const QString& inputPath, const QString& outputPath,
+                                 SubtitleEncoding encoding, SubtitleEncoding outputEncoding,
+                                 const Options& options, Result* result = nullptr);
+    
+    // 去掉 <i>、</font> 等 HTML 标签和 {\an8} 等 ASS 覆盖代码，\N 换行，\h 空格，并去掉因此变空的行
+    static QString stripTags(const QString& text);
+    
+    static QString normalizePunctuation(const QString& text, Punctuation punctuation);
+    
+    // 命令行参数：traditional/t、simplified/s；half、full
+    static bool parseConversion(const QString& name, Conversion& conversion);
+    static bool parsePunctuation(const QString& name, Punctuation& punctuation);
+};
+
+#endif // SUBTITLETEXTTRANSFORM_H
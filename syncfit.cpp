@@ -0,0 +1,264 @@
+#include "syncfit.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// 残差超过该值（且超过 3 倍稳健标准差）才判为离群，约等于几帧的点选误差
+const double kMinOutlierMs = 300.0;
+
+// RANSAC 内点阈值
+const double kRansacInlierMs = 300.0;
+
+// 点数不多时枚举所有点对，否则随机抽取固定数量，保持 O(P)
+const int kRansacSamples = 64;
+
+const int kHuberIterations = 10;
+
+// 平滑时每个点两侧各取的邻点数，窗口内做局部直线拟合
+const int kSmoothingRadius = 2;
+
+struct Line {
+    double slope;
+    double intercept;
+    
+    double at(double x) const { return slope * x + intercept; }
+};
+
+// 加权最小二乘直线，先中心化以避免大数相减的精度损失；所有 x 相同时退化为平移
+Line weightedFit(const QVector<QPair<int, int>>& points, const QVector<double>& weights) {
+    double sw = 0;
+    double sx = 0;
+    double sy = 0;
+    for (int i = 0; i < points.size(); ++i) {
+        sw += weights[i];
+        sx += weights[i] * points[i].first;
+        sy += weights[i] * points[i].second;
+    }
+    Line line = {1.0, 0.0};
+    if (sw <= 0) return line;
+    
+    double mx = sx / sw;
+    double my = sy / sw;
+    double sxx = 0;
+    double sxy = 0;
+    for (int i = 0; i < points.size(); ++i) {
+        double dx = points[i].first - mx;
+        sxx += weights[i] * dx * dx;
+        sxy += weights[i] * dx * (points[i].second - my);
+    }
+    line.slope = (sxx > 1e-9) ? sxy / sxx : 1.0;
+    line.intercept = my - line.slope * mx;
+    return line;
+}
+
+// 中位数绝对偏差换算的稳健标准差
+double robustSigma(const QVector<double>& residuals) {
+    if (residuals.isEmpty()) return 0;
+    QVector<double> absolute;
+    absolute.reserve(residuals.size());
+    for (double r : residuals) absolute.append(std::abs(r));
+    auto middle = absolute.begin() + absolute.size() / 2;
+    std::nth_element(absolute.begin(), middle, absolute.end());
+    return 1.4826 * *middle;
+}
+
+QVector<double> residualsFor(const QVector<QPair<int, int>>& points, const Line& line) {
+    QVector<double> residuals(points.size());
+    for (int i = 0; i < points.size(); ++i) {
+        residuals[i] = line.at(points[i].first) - points[i].second;
+    }
+    return residuals;
+}
+
+Line ransac(const QVector<QPair<int, int>>& points) {
+    const int n = points.size();
+    Line best = weightedFit(points, QVector<double>(n, 1.0));
+    int bestInliers = -1;
+    double bestError = 0;
+    
+    auto consider = [&](int a, int b) {
+        if (points[a].first == points[b].first) return;
+        Line line;
+        line.slope = double(points[b].second - points[a].second) / (points[b].first - points[a].first);
+        // 明显不合理的斜率（倒放或相差一倍以上）直接跳过
+        if (line.slope <= 0.5 || line.slope >= 2.0) return;
+        line.intercept = points[a].second - line.slope * points[a].first;
+        
+        int inliers = 0;
+        double error = 0;
+        for (int i = 0; i < n; ++i) {
+            double r = std::abs(line.at(points[i].first) - points[i].second);
+            if (r <= kRansacInlierMs) {
+                ++inliers;
+                error += r;
+            }
+        }
+        if (inliers > bestInliers || (inliers == bestInliers && error < bestError)) {
+            best = line;
+            bestInliers = inliers;
+            bestError = error;
+        }
+    };
+    
+    if (n * (n - 1) / 2 <= kRansacSamples) {
+        for (int a = 0; a < n; ++a) {
+            for (int b = a + 1; b < n; ++b) consider(a, b);
+        }
+    } else {
+        // 固定种子，同样的点每次得到同样的结果
+        quint32 seed = 0x9E3779B9u;
+        auto next = [&seed]() {
+            seed ^= seed << 13;
+            seed ^= seed >> 17;
+            seed ^= seed << 5;
+            return seed;
+        };
+        for (int s = 0; s < kRansacSamples; ++s) {
+            int a = int(next() % quint32(n));
+            int b = int(next() % quint32(n));
+            if (a != b) consider(a, b);
+        }
+    }
+    return best;
+}
+
+// 以 RANSAC 结果为初值做 Huber 迭代重加权最小二乘
+Line robustFit(const QVector<QPair<int, int>>& points) {
+    Line line = ransac(points);
+    QVector<double> weights(points.size(), 1.0);
+    for (int iteration = 0; iteration < kHuberIterations; ++iteration) {
+        QVector<double> residuals = residualsFor(points, line);
+        double k = 1.345 * qMax(robustSigma(residuals), 40.0);
+        for (int i = 0; i < points.size(); ++i) {
+            double r = std::abs(residuals[i]);
+            weights[i] = (r <= k) ? 1.0 : k / r;
+        }
+        Line next = weightedFit(points, weights);
+        bool converged = std::abs(next.slope - line.slope) < 1e-9 && std::abs(next.intercept - line.intercept) < 0.5;
+        line = next;
+        if (converged) break;
+    }
+    return line;
+}
+
+// 每个点的目标时间换成其邻域（按源时间排序后前后各 kSmoothingRadius 个点）直线拟合在该点的值，
+// 消除逐点的点选抖动，同时保留跨越多个点的漂移变化；O(P * kSmoothingRadius)
+QVector<QPair<int, int>> smoothPoints(QVector<QPair<int, int>> points) {
+    std::sort(points.begin(), points.end());
+    QVector<QPair<int, int>> smoothed;
+    smoothed.reserve(points.size());
+    const int n = points.size();
+    for (int i = 0; i < n; ++i) {
+        int first = qMax(0, i - kSmoothingRadius);
+        int last = qMin(n - 1, i + kSmoothingRadius);
+        QVector<QPair<int, int>> window = points.mid(first, last - first + 1);
+        Line line = weightedFit(window, QVector<double>(window.size(), 1.0));
+        smoothed.append(qMakePair(points[i].first, int(std::lround(line.at(points[i].first)))));
+    }
+    return smoothed;
+}
+
+void markOutliers(SyncFitter::Result& result) {
+    double threshold = qMax(kMinOutlierMs, 3.0 * robustSigma(result.residuals));
+    result.outliers.fill(false, result.residuals.size());
+    result.outlierCount = 0;
+    for (int i = 0; i < result.residuals.size(); ++i) {
+        if (std::abs(result.residuals[i]) > threshold) {
+            result.outliers[i] = true;
+            ++result.outlierCount;
+        }
+    }
+}
+
+void computeRms(SyncFitter::Result& result) {
+    double sum = 0;
+    int count = 0;
+    for (int i = 0; i < result.residuals.size(); ++i) {
+        if (result.outliers.value(i)) continue;
+        sum += result.residuals[i] * result.residuals[i];
+        ++count;
+    }
+    result.rmsMs = count > 0 ? std::sqrt(sum / count) : 0;
+}
+
+}
+
+SyncFitter::Result SyncFitter::fit(const QVector<QPair<int, int>>& points, Mode mode) {
+    Result result;
+    if (points.size() < minimumPoints(mode)) return result;
+    
+    switch (mode) {
+    case Interpolate:
+        result.transform = RetimeTransform::piecewise(points);
+        result.residuals.fill(0.0, points.size());
+        result.outliers.fill(false, points.size());
+        break;
+    case LeastSquares: {
+        Line line = weightedFit(points, QVector<double>(points.size(), 1.0));
+        result.transform = RetimeTransform::affine(line.slope, line.intercept);
+        result.residuals = residualsFor(points, line);
+        markOutliers(result);
+        break;
+    }
+    case Robust: {
+        Line line = robustFit(points);
+        result.transform = RetimeTransform::affine(line.slope, line.intercept);
+        result.residuals = residualsFor(points, line);
+        markOutliers(result);
+        break;
+    }
+    case RobustPiecewise: {
+        // 离群点相对稳健仿射判定；其余点平滑后作为分段线性映射的节点
+        Line line = robustFit(points);
+        result.residuals = residualsFor(points, line);
+        markOutliers(result);
+        QVector<QPair<int, int>> inliers;
+        for (int i = 0; i < points.size(); ++i) {
+            if (!result.outliers[i]) inliers.append(points[i]);
+        }
+        result.transform = RetimeTransform::piecewise(smoothPoints(inliers));
+        // 最终残差相对实际使用的映射
+        for (int i = 0; i < points.size(); ++i) {
+            result.residuals[i] = result.transform.map(points[i].first) - points[i].second;
+        }
+        break;
+    }
+    case ModeCount:
+        return result;
+    }
+    
+    computeRms(result);
+    result.ok = true;
+    return result;
+}
+
+int SyncFitter::minimumPoints(Mode mode) {
+    switch (mode) {
+    case Interpolate:
+    case LeastSquares:
+        return 2;
+    case Robust:
+    case RobustPiecewise:
+        return 3;
+    case ModeCount:
+        break;
+    }
+    return 2;
+}
+
+QString SyncFitter::modeName(Mode mode) {
+    switch (mode) {
+    case Interpolate:
+        return "逐点插值";
+    case LeastSquares:
+        return "最小二乘仿射";
+    case Robust:
+        return "稳健仿射（剔除离群点）";
+    case RobustPiecewise:
+        return "剔除离群点后平滑分段";
+    case ModeCount:
+        break;
+    }
+    return QString();
+}
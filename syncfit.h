@@ -0,0 +1,39 @@
+#ifndef SYNCFIT_H
+#define SYNCFIT_H
+
+#include <QPair>
+#include <QString>
+#include <QVector>
+#include "retimetransform.h"
+
+// 由多个（可能有误点的）同步点拟合时间映射
+// 所有模式都是闭式解或固定次数的 O(P) 迭代，添加同步点时可以实时重算
+class SyncFitter {
+public:
+    enum Mode {
+        Interpolate = 0,     // 逐点插值：严格经过每个同步点
+        LeastSquares,        // 最小二乘仿射
+        Robust,              // 稳健仿射：RANSAC 选出内点后用 Huber 权重迭代
+        RobustPiecewise,     // 用稳健仿射剔除离群点，其余点做局部线性平滑后分段插值
+        ModeCount
+    };
+    
+    struct Result {
+        bool ok;
+        RetimeTransform transform;
+        QVector<double> residuals;   // 每个点：拟合值 - 目标时间（毫秒），顺序与输入一致
+        QVector<bool> outliers;      // 被判定为离群的点
+        double rmsMs;                // 非离群点残差的均方根
+        int outlierCount;
+        
+        Result() : ok(false), rmsMs(0), outlierCount(0) {}
+    };
+    
+    // points 为 (源毫秒, 目标毫秒)
+    static Result fit(const QVector<QPair<int, int>>& points, Mode mode);
+    
+    static int minimumPoints(Mode mode);
+    static QString modeName(Mode mode);
+};
+
+#endif // SYNCFIT_H
@@ -0,0 +1,319 @@
+#include "syncmatcher.h"
+#include "perftrace.h"
+#include <QSet>
+#include <QStringList>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+const int kSignatureSize = 32;
+const int kBands = 8;
+const int kRowsPerBand = kSignatureSize / kBands;
+
+// 单个 LSH 桶最多检查的行数，防止 "♪" 之类的高频台词拖慢查询
+const int kMaxBucketScan = 64;
+
+// 时间接近度的高斯尺度
+const double kTimeScaleMs = 5000.0;
+
+// 估计整体偏移时认为"确定匹配"的相似度阈值
+const double kAnchorSimilarity = 0.7;
+
+quint64 mix64(quint64 x) {
+    // splitmix64 终结函数
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+const quint64* minHashSeeds() {
+    struct Seeds {
+        quint64 values[kSignatureSize];
+        Seeds() {
+            for (int i = 0; i < kSignatureSize; ++i) {
+                values[i] = mix64(0x9e3779b97f4a7c15ULL * (i + 1));
+            }
+        }
+    };
+    static const Seeds seeds;
+    return seeds.values;
+}
+
+bool isCjk(QChar ch) {
+    switch (ch.script()) {
+    case QChar::Script_Han:
+    case QChar::Script_Hiragana:
+    case QChar::Script_Katakana:
+    case QChar::Script_Hangul:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// 生成 n-gram 指纹：中日韩文字取字符二元组，其他文字取整词加字符三元组
+void collectShingles(const QString& normalized, QVector<quint64>& hashes) {
+    hashes.clear();
+    const QStringList tokens = normalized.split(' ', Qt::SkipEmptyParts);
+    for (const QString& token : tokens) {
+        QStringView view(token);
+        bool cjk = false;
+        for (QChar ch : view) {
+            if (isCjk(ch)) {
+                cjk = true;
+                break;
+            }
+        }
+        
+        if (cjk) {
+            if (view.size() == 1) {
+                hashes.append(qHash(view, 1));
+            }
+            for (qsizetype i = 0; i + 1 < view.size(); ++i) {
+                hashes.append(qHash(view.mid(i, 2), 2));
+            }
+        } else {
+            // 整词（数字、人名在不同语言中往往相同）
+            hashes.append(qHash(view, 3));
+            for (qsizetype i = 0; i + 2 < view.size(); ++i) {
+                hashes.append(qHash(view.mid(i, 3), 4));
+            }
+        }
+    }
+}
+
+}
+
+SyncCandidateRanker::SyncCandidateRanker()
+    : m_estimatedOffset(0)
+{
+}
+
+QString SyncCandidateRanker::normalizeText(const QString& text) {
+    QString result;
+    result.reserve(text.size());
+    
+    bool inHtmlTag = false;
+    bool inAssTag = false;
+    for (QChar ch : text) {
+        // 去除 <i>…</i> 和 {\an8} 之类的标签
+        if (inHtmlTag) {
+            if (ch == '>') inHtmlTag = false;
+            continue;
+        }
+        if (inAssTag) {
+            if (ch == '}') inAssTag = false;
+            continue;
+        }
+        if (ch == '<') {
+            inHtmlTag = true;
+            continue;
+        }
+        if (ch == '{') {
+            inAssTag = true;
+            continue;
+        }
+        
+        // 全角 ASCII 转半角
+        char16_t u = ch.unicode();
+        if (u >= 0xFF01 && u <= 0xFF5E) {
+            ch = QChar(char16_t(u - 0xFEE0));
+        } else if (u == 0x3000) {
+            ch = QChar(' ');
+        }
+        
+        if (ch.isLetterOrNumber()) {
+            result += ch.toLower();
+        } else if (ch == '?' || ch == '!') {
+            // 问号和感叹号在不同语言中通常保留，是有用的信号
+            result += ' ';
+            result += ch;
+            result += ' ';
+        } else if (!result.isEmpty() && !result.endsWith(' ')) {
+            result += ' ';
+        }
+    }
+    return result.trimmed();
+}
+
+void SyncCandidateRanker::computeSignatures(const QVector<SubtitleItem>& subtitles, Track& track) const {
+    const quint64* seeds = minHashSeeds();
+    track.signatures.fill(0xFFFFFFFFu, subtitles.size() * kSignatureSize);
+    track.hasText.fill(false, subtitles.size());
+    
+    QVector<quint64> shingles;
+    for (int row = 0; row < subtitles.size(); ++row) {
+        collectShingles(normalizeText(subtitles[row].text), shingles);
+        if (shingles.isEmpty()) continue;
+        
+        track.hasText[row] = true;
+        quint32* signature = track.signatures.data() + row * kSignatureSize;
+        for (quint64 shingle : shingles) {
+            for (int i = 0; i < kSignatureSize; ++i) {
+                quint32 value = quint32(mix64(shingle ^ seeds[i]) >> 32);
+                if (value < signature[i]) {
+                    signature[i] = value;
+                }
+            }
+        }
+    }
+}
+
+quint64 SyncCandidateRanker::bandKey(const quint32* signature, int band) const {
+    quint64 key = mix64(quint64(band) + 1);
+    for (int r = 0; r < kRowsPerBand; ++r) {
+        key = mix64(key ^ signature[band * kRowsPerBand + r]);
+    }
+    return key;
+}
+
+void SyncCandidateRanker::setSource(const QVector<SubtitleItem>& source) {
+    PerfTrace::Scope scope("fingerprint");
+    scope.setCount(source.size());
+    
+    computeSignatures(source, m_source);
+    m_sourceStartMs.resize(source.size());
+    for (int i = 0; i < source.size(); ++i) {
+        m_sourceStartMs[i] = source[i].startTime.msecsSinceStartOfDay();
+    }
+    updateEstimatedOffset();
+}
+
+void SyncCandidateRanker::setReference(const QVector<SubtitleItem>& reference) {
+    PerfTrace::Scope scope("fingerprint");
+    scope.setCount(reference.size());
+    
+    computeSignatures(reference, m_reference);
+    
+    m_referenceStartMs.resize(reference.size());
+    m_referenceByTime.resize(reference.size());
+    for (int i = 0; i < reference.size(); ++i) {
+        m_referenceStartMs[i] = reference[i].startTime.msecsSinceStartOfDay();
+        m_referenceByTime[i] = qMakePair(m_referenceStartMs[i], i);
+    }
+    std::sort(m_referenceByTime.begin(), m_referenceByTime.end());
+    
+    m_buckets.clear();
+    for (int row = 0; row < reference.size(); ++row) {
+        if (!m_reference.hasText[row]) continue;
+        const quint32* signature = m_reference.signatures.constData() + row * kSignatureSize;
+        for (int band = 0; band < kBands; ++band) {
+            m_buckets[bandKey(signature, band)].append(row);
+        }
+    }
+    
+    updateEstimatedOffset();
+}
+
+double SyncCandidateRanker::similarity(int sourceRow, int referenceIndex) const {
+    if (!m_source.hasText[sourceRow] || !m_reference.hasText[referenceIndex]) return 0.0;
+    
+    const quint32* a = m_source.signatures.constData() + sourceRow * kSignatureSize;
+    const quint32* b = m_reference.signatures.constData() + referenceIndex * kSignatureSize;
+    int equal = 0;
+    for (int i = 0; i < kSignatureSize; ++i) {
+        if (a[i] == b[i]) ++equal;
+    }
+    return double(equal) / kSignatureSize;
+}
+
+void SyncCandidateRanker::updateEstimatedOffset() {
+    m_estimatedOffset = 0;
+    if (m_source.hasText.isEmpty() || m_reference.hasText.isEmpty()) return;
+    
+    // 长轨道抽样即可，偏移估计只需要几十个可靠的匹配
+    const int sourceCount = m_source.hasText.size();
+    const int stride = qMax(1, sourceCount / 2000);
+    
+    QVector<int> offsets;
+    for (int row = 0; row < sourceCount; row += stride) {
+        if (!m_source.hasText[row]) continue;
+        
+        const quint32* signature = m_source.signatures.constData() + row * kSignatureSize;
+        int bestIndex = -1;
+        double bestSimilarity = 0;
+        for (int band = 0; band < kBands; ++band) {
+            auto it = m_buckets.constFind(bandKey(signature, band));
+            if (it == m_buckets.constEnd()) continue;
+            // 高频台词出现在太多位置，不能用来确定偏移
+            if (it->size() > 4) continue;
+            for (int referenceIndex : *it) {
+                double sim = similarity(row, referenceIndex);
+                if (sim > bestSimilarity) {
+                    bestSimilarity = sim;
+                    bestIndex = referenceIndex;
+                }
+            }
+        }
+        
+        if (bestIndex >= 0 && bestSimilarity >= kAnchorSimilarity) {
+            offsets.append(m_referenceStartMs[bestIndex] - m_sourceStartMs[row]);
+        }
+    }
+    
+    if (offsets.size() < 3) return;
+    
+    // 取中位数，个别错误匹配不影响结果
+    auto middle = offsets.begin() + offsets.size() / 2;
+    std::nth_element(offsets.begin(), middle, offsets.end());
+    m_estimatedOffset = *middle;
+}
+
+QVector<SyncCandidateRanker::Candidate> SyncCandidateRanker::rank(int sourceRow, int expectedMs,
+                                                                  int maxCandidates) const {
+    QVector<Candidate> candidates;
+    if (sourceRow < 0 || sourceRow >= m_source.hasText.size() || m_referenceByTime.isEmpty()) {
+        return candidates;
+    }
+    
+    // 已加入候选列表的参考字幕行号
+    QSet<int> seen;
+    auto addCandidate = [&](int referenceIndex, int referenceStartMs) {
+        if (seen.contains(referenceIndex)) return;
+        Candidate c;
+        c.referenceIndex = referenceIndex;
+        c.textScore = similarity(sourceRow, referenceIndex);
+        double dt = std::abs(referenceStartMs - expectedMs) / kTimeScaleMs;
+        c.timeScore = std::exp(-0.5 * dt * dt);
+        // 文本高度相似时即使时间相差很远也排在前面
+        c.score = 0.65 * c.textScore + 0.35 * c.timeScore;
+        seen.insert(referenceIndex);
+        candidates.append(c);
+    };
+    
+    // 时间近邻：二分查找预计时间附近的 k 条
+    auto pos = std::lower_bound(m_referenceByTime.constBegin(), m_referenceByTime.constEnd(),
+                                qMakePair(expectedMs, -1));
+    int center = int(pos - m_referenceByTime.constBegin());
+    int from = qMax(0, center - maxCandidates);
+    int to = qMin(m_referenceByTime.size(), center + maxCandidates);
+    for (int i = from; i < to; ++i) {
+        addCandidate(m_referenceByTime[i].second, m_referenceByTime[i].first);
+    }
+    
+    // 文本相似：查 LSH 桶
+    if (m_source.hasText[sourceRow]) {
+        const quint32* signature = m_source.signatures.constData() + sourceRow * kSignatureSize;
+        for (int band = 0; band < kBands; ++band) {
+            auto it = m_buckets.constFind(bandKey(signature, band));
+            if (it == m_buckets.constEnd()) continue;
+            int scanned = 0;
+            for (int referenceIndex : *it) {
+                if (++scanned > kMaxBucketScan) break;
+                addCandidate(referenceIndex, m_referenceStartMs[referenceIndex]);
+            }
+        }
+    }
+    
+    std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) {
+        return a.score > b.score;
+    });
+    if (candidates.size() > maxCandidates) {
+        candidates.resize(maxCandidates);
+    }
+    return candidates;
+}
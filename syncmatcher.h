@@ -0,0 +1,63 @@
+#ifndef SYNCMATCHER_H
+#define SYNCMATCHER_H
+
+#include <QHash>
+#include <QString>
+#include <QVector>
+#include "subtitle.h"
+
+// 点同步的参考字幕候选排序
+// 结合时间接近度和文本指纹（归一化文本的 n-gram + MinHash）。
+// 指纹在加载时为每条字幕计算一次；每次点击只查 LSH 桶和按时间二分查找，
+// 复杂度为 O(log M + k)，与两轨之间的偏移大小无关。
+class SyncCandidateRanker {
+public:
+    struct Candidate {
+        int referenceIndex;
+        double score;       // 综合得分 0~1
+        double textScore;   // MinHash 估计的 Jaccard 相似度
+        double timeScore;   // 时间接近度
+        
+        Candidate() : referenceIndex(-1), score(0), textScore(0), timeScore(0) {}
+    };
+    
+    SyncCandidateRanker();
+    
+    void setSource(const QVector<SubtitleItem>& source);
+    void setReference(const QVector<SubtitleItem>& reference);
+    
+    // 根据文本高度相似的字幕对估计的整体偏移（参考 - 源，毫秒），没有足够的匹配时为0
+    int estimatedOffset() const { return m_estimatedOffset; }
+    
+    // 为源字幕 sourceRow 排序参考候选，expectedMs 为预计的参考时间
+    QVector<Candidate> rank(int sourceRow, int expectedMs, int maxCandidates) const;
+    
+    // 文本归一化：去除标签、全角转半角、小写、去掉标点和多余空白
+    static QString normalizeText(const QString& text);
+
+private:
+    struct Track {
+        QVector<quint32> signatures;     // 每条字幕 kSignatureSize 个 MinHash 值
+        QVector<bool> hasText;
+    };
+    
+    void computeSignatures(const QVector<SubtitleItem>& subtitles, Track& track) const;
+    double similarity(int sourceRow, int referenceIndex) const;
+    quint64 bandKey(const quint32* signature, int band) const;
+    void updateEstimatedOffset();
+    
+    Track m_source;
+    Track m_reference;
+    QVector<int> m_sourceStartMs;
+    QVector<int> m_referenceStartMs;
+    
+    // 参考字幕按开始时间排序：(开始时间, 行号)
+    QVector<QPair<int, int>> m_referenceByTime;
+    
+    // LSH：每个 band 的签名片段 -> 参考行号
+    QHash<quint64, QVector<int>> m_buckets;
+    
+    int m_estimatedOffset;
+};
+
+#endif // SYNCMATCHER_H
@@ -0,0 +1,119 @@
+#include "synctrackmodel.h"
+#include <QBrush>
+
+namespace {
+
+// 表格中文本列最多显示的字符数
+const int kTextPreviewLength = 50;
+
+}
+
+SyncTrackModel::SyncTrackModel(const QVector<SubtitleItem>* subtitles, QObject* parent)
+    : QAbstractTableModel(parent)
+    , m_subtitles(subtitles)
+{
+}
+
+int SyncTrackModel::rowCount(const QModelIndex& parent) const
+{
+    if (parent.isValid()) return 0;
+    return m_subtitles->size();
+}
+
+int SyncTrackModel::columnCount(const QModelIndex& parent) const
+{
+    if (parent.isValid()) return 0;
+    return ColumnCount;
+}
+
+QVariant SyncTrackModel::data(const QModelIndex& index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_subtitles->size()) return QVariant();
+    
+    if (role == Qt::BackgroundRole || role == Qt::ToolTipRole) {
+        const Highlight* highlight = findHighlight(index.row());
+        if (!highlight) return QVariant();
+        if (role == Qt::BackgroundRole) return QBrush(highlight->color);
+        return highlight->toolTip;
+    }
+    if (role != Qt::DisplayRole) return QVariant();
+    
+    const SubtitleItem& item = m_subtitles->at(index.row());
+    switch (index.column()) {
+    case IndexColumn:
+        return QString::number(index.row() + 1);
+    case TimeColumn:
+        return SRTParser::formatTime(item.startTime);
+    case TextColumn:
+        if (item.text.length() > kTextPreviewLength) {
+            return item.text.left(kTextPreviewLength) + "...";
+        }
+        return item.text;
+    }
+    return QVariant();
+}
+
+QVariant SyncTrackModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (role != Qt::DisplayRole) return QVariant();
+    if (orientation == Qt::Vertical) return section + 1;
+    
+    switch (section) {
+    case IndexColumn:
+        return QString("序号");
+    case TimeColumn:
+        return QString("时间");
+    case TextColumn:
+        return QString("文本");
+    }
+    return QVariant();
+}
+
+void SyncTrackModel::beginResetRows()
+{
+    beginResetModel();
+    m_highlights.clear();
+}
+
+void SyncTrackModel::endResetRows()
+{
+    endResetModel();
+}
+
+void SyncTrackModel::notifyTimesChanged()
+{
+    if (m_subtitles->isEmpty()) return;
+    emit dataChanged(index(0, TimeColumn), index(m_subtitles->size() - 1, TimeColumn), {Qt::DisplayRole});
+}
+
+void SyncTrackModel::setHighlights(const QVector<Highlight>& highlights)
+{
+    QVector<Highlight> old = m_highlights;
+    m_highlights = highlights;
+    for (const Highlight& highlight : old) {
+        notifyRow(highlight.row);
+    }
+    for (const Highlight& highlight : m_highlights) {
+        notifyRow(highlight.row);
+    }
+}
+
+void SyncTrackModel::clearHighlights()
+{
+    setHighlights(QVector<Highlight>());
+}
+
+const SyncTrackModel::Highlight* SyncTrackModel::findHighlight(int row) const
+{
+    // 最多只有几条高亮，线性查找即可
+    for (const Highlight& highlight : m_highlights) {
+        if (highlight.row == row) return &highlight;
+    }
+    return nullptr;
+}
+
+void SyncTrackModel::notifyRow(int row)
+{
+    if (row < 0 || row >= m_subtitles->size()) return;
+    emit dataChanged(index(row, 0), index(row, ColumnCount - 1), {Qt::BackgroundRole, Qt::ToolTipRole});
+}
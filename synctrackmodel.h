@@ -0,0 +1,59 @@
+#ifndef SYNCTRACKMODEL_H
+#define SYNCTRACKMODEL_H
+
+#include <QAbstractTableModel>
+#include <QColor>
+#include <QVector>
+#include "subtitle.h"
+
+// 点同步对话框中源/参考字幕的只读表格模型
+// 与 SubtitleTableModel 一样直接映射字幕数组，只为可见行生成文本；
+// 候选高亮保存在一个很小的旁路数组中，不随字幕条数增长
+class SyncTrackModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    enum Column {
+        IndexColumn = 0,
+        TimeColumn,
+        TextColumn,
+        ColumnCount
+    };
+    
+    struct Highlight {
+        int row;
+        QColor color;
+        QString toolTip;
+        
+        Highlight() : row(-1) {}
+        Highlight(int r, const QColor& c, const QString& tip) : row(r), color(c), toolTip(tip) {}
+    };
+    
+    explicit SyncTrackModel(const QVector<SubtitleItem>* subtitles, QObject* parent = nullptr);
+    
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+    
+    // 字幕数组被整体替换（行数可能变化）前后分别调用
+    void beginResetRows();
+    void endResetRows();
+    
+    // 行数不变、只有时间被修改时调用，视图保留选区和滚动位置
+    void notifyTimesChanged();
+    
+    // 替换高亮行，只刷新新旧高亮涉及的行
+    void setHighlights(const QVector<Highlight>& highlights);
+    void clearHighlights();
+
+private:
+    const Highlight* findHighlight(int row) const;
+    void notifyRow(int row);
+    
+    const QVector<SubtitleItem>* m_subtitles;
+    QVector<Highlight> m_highlights;
+};
+
+#endif // SYNCTRACKMODEL_H
@@ -0,0 +1,148 @@
+#include "corpusgenerator.h"
+#include <QRandomGenerator>
+#include <QStringEncoder>
+#include <QStringList>
+
+namespace {
+
+// 所有词汇都能用 GBK 表示，同一份语料可以生成各种编码的文件
+const char* const kChineseWords[] = {
+    "我们", "今天", "晚上", "一起", "去", "看", "电影", "你", "说", "什么", "这里", "没有",
+    "人", "知道", "为什么", "时间", "已经", "来不及", "了", "朋友", "字幕", "测试", "繁體",
+    "中文", "回家", "明天", "早上", "等", "一下", "真的", "吗", "别", "担心", "相信", "我"
+};
+
+const char* const kChinesePunctuation[] = { "，", "。", "？", "！", "……", "：" };
+
+const char* const kLatinWords[] = {
+    "the", "quick", "time", "we", "never", "said", "that", "again", "Hello", "world", "okay",
+    "right", "now", "café", "where", "are", "you", "going", "I", "don't", "know", "it's", "late"
+};
+
+// 对白里常见的重复行
+const char* const kRepeatedLines[] = {
+    "嗯", "（笑）", "- 什么？", "<i>Okay.</i>", "谢谢", "No.", "走吧！", "- Yeah."
+};
+
+template <typename T, int N>
+constexpr int countOf(T (&)[N]) { return N; }
+
+QString chineseLine(QRandomGenerator& random) {
+    QString line;
+    int words = 2 + int(random.bounded(8));
+    for (int i = 0; i < words; ++i) {
+        line += QString::fromUtf8(kChineseWords[random.bounded(countOf(kChineseWords))]);
+    }
+    line += QString::fromUtf8(kChinesePunctuation[random.bounded(countOf(kChinesePunctuation))]);
+    return line;
+}
+
+QString latinLine(QRandomGenerator& random) {
+    QStringList words;
+    int count = 2 + int(random.bounded(8));
+    for (int i = 0; i < count; ++i) {
+        words << QString::fromUtf8(kLatinWords[random.bounded(countOf(kLatinWords))]);
+    }
+    words[0][0] = words[0][0].toUpper();
+    return words.join(' ') + (random.bounded(4) == 0 ? "?" : ".");
+}
+
+QString textLine(QRandomGenerator& random) {
+    switch (random.bounded(10)) {
+    case 0:
+        return QString::fromUtf8(kRepeatedLines[random.bounded(countOf(kRepeatedLines))]);
+    case 1:
+    case 2:
+        return latinLine(random);
+    case 3:
+        // 中英混排
+        return chineseLine(random) + " " + latinLine(random);
+    default:
+        return chineseLine(random);
+    }
+}
+
+QStringEncoder encoderFor(const CorpusOptions& options) {
+    switch (options.encoding) {
+    case SubtitleEncoding::Utf8:
+        return QStringEncoder(QStringConverter::Utf8,
+                              options.bom ? QStringConverter::Flag::WriteBom : QStringConverter::Flag::Default);
+    case SubtitleEncoding::Gbk: {
+        QStringEncoder encoder("GBK");
+        if (encoder.isValid()) {
+            return encoder;
+        }
+        return QStringEncoder("GB18030");
+    }
+    case SubtitleEncoding::Gb18030:
+        return QStringEncoder("GB18030");
+    case SubtitleEncoding::Utf16Le:
+        return QStringEncoder(QStringConverter::Utf16LE,
+                              options.bom ? QStringConverter::Flag::WriteBom : QStringConverter::Flag::Default);
+    }
+    return QStringEncoder();
+}
+
+} // namespace
+
+QVector<SubtitleItem> CorpusGenerator::generateItems(int cues, quint32 seed) {
+    QRandomGenerator random(seed);
+    QVector<SubtitleItem> items;
+    items.reserve(cues);
+    
+    // 平均间隔随条数缩小，一百万条时也不会超过 QTime 的 24 小时范围
+    const int step = qBound(40, 75000000 / qMax(cues, 1), 4000);
+    const QTime origin(0, 0, 1);
+    int startMs = 0;
+    for (int i = 0; i < cues; ++i) {
+        startMs += step / 2 + int(random.bounded(step / 2 + 1));
+        int durationMs = step / 2 + int(random.bounded(step * 3 / 2 + 1));
+        
+        QString text = textLine(random);
+        int extraLines = random.bounded(10) < 3 ? 1 + int(random.bounded(2)) : 0;
+        for (int line = 0; line < extraLines; ++line) {
+            text += '\n';
+            text += textLine(random);
+        }
+        
+        items.append(SubtitleItem(i + 1, origin.addMSecs(startMs), origin.addMSecs(startMs + durationMs), text));
+    }
+    return items;
+}
+
+bool CorpusGenerator::serialize(const QVector<SubtitleItem>& items, const CorpusOptions& options, QByteArray& data) {
+    QStringEncoder encoder = encoderFor(options);
+    if (!encoder.isValid()) {
+        return false;
+    }
+    
+    const QLatin1String newline(options.crlf ? "\r\n" : "\n");
+    QString content;
+    for (int i = 0; i < items.size(); ++i) {
+        const SubtitleItem& item = items[i];
+        content += QString::number(item.index);
+        content += newline;
+        content += SRTParser::formatTime(item.startTime);
+        content += QLatin1String(" --> ");
+        content += SRTParser::formatTime(item.endTime);
+        content += newline;
+        QString text = item.text;
+        content += options.crlf ? text.replace('\n', newline) : text;
+        content += newline;
+        if (i < items.size() - 1) {
+            content += newline;
+        }
+    }
+    
+    data = encoder.encode(content);
+    return !encoder.hasError();
+}
+
+QString CorpusGenerator::variantName(const CorpusOptions& options) {
+    QString name = SRTParser::encodingName(options.encoding).toLower().remove('-');
+    name += options.crlf ? "-crlf" : "-lf";
+    if (options.bom && options.encoding != SubtitleEncoding::Gbk && options.encoding != SubtitleEncoding::Gb18030) {
+        name += "-bom";
+    }
+    return name;
+}
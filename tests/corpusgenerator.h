@@ -0,0 +1,33 @@
+#ifndef CORPUSGENERATOR_H
+#define CORPUSGENERATOR_H
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+#include "subtitle.h"
+
+// 语料的格式参数
+struct CorpusOptions {
+    int cues;
+    SubtitleEncoding encoding;
+    bool crlf;          // 换行使用 \r\n
+    bool bom;           // 文件开头写入 BOM（GBK 没有 BOM，忽略）
+    quint32 seed;
+    
+    CorpusOptions() : cues(1000), encoding(SubtitleEncoding::Utf8), crlf(false), bom(false), seed(20240601) {}
+};
+
+// 确定性的测试字幕生成器：相同的条数和种子在任何平台上都得到相同的字幕。
+// 文本混合中文、英文和少量重复行，时间单调递增并始终落在 24 小时以内。
+class CorpusGenerator {
+public:
+    static QVector<SubtitleItem> generateItems(int cues, quint32 seed);
+    
+    // 按 SRT 格式自行拼接并编码（不经过 SRTParser::save），当前环境不支持该编码时返回 false
+    static bool serialize(const QVector<SubtitleItem>& items, const CorpusOptions& options, QByteArray& data);
+    
+    // 用例名称，例如 "utf8-crlf-bom"
+    static QString variantName(const CorpusOptions& options);
+};
+
+#endif // CORPUSGENERATOR_H
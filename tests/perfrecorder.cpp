@@ -0,0 +1,133 @@
+#include "perfrecorder.h"
+#include <QFile>
+#include <QJsonDocument>
+#include <QSaveFile>
+
+#if defined(Q_OS_WIN)
+#include <qt_windows.h>
+#include <psapi.h>
+#elif defined(Q_OS_LINUX)
+#include <QByteArray>
+#else
+#include <sys/resource.h>
+#endif
+
+PerfRecorder::PerfRecorder() : m_tolerance(20.0) {
+}
+
+bool PerfRecorder::loadBaseline(const QString& filePath, QString& errorMsg) {
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        errorMsg = "无法打开性能基线: " + filePath;
+        return false;
+    }
+    
+    QJsonParseError parseError;
+    QJsonDocument document = QJsonDocument::fromJson(file.readAll(), &parseError);
+    if (!document.isObject()) {
+        errorMsg = "性能基线格式错误: " + parseError.errorString();
+        return false;
+    }
+    m_baseline = document.object();
+    return true;
+}
+
+bool PerfRecorder::recordThroughput(const QString& key, double cuesPerSecond, bool compare, QString& message) {
+    m_throughput.insert(key, qRound64(cuesPerSecond));
+    
+    double baseline = m_baseline.value("throughput").toObject().value(key).toDouble();
+    if (!compare || baseline <= 0) {
+        return true;
+    }
+    double floor = baseline * (1.0 - m_tolerance / 100.0);
+    if (cuesPerSecond >= floor) {
+        return true;
+    }
+    message = QString("%1 吞吐回退：%2 条/秒，基线 %3 条/秒（允许 %4%）")
+                  .arg(key).arg(qRound64(cuesPerSecond)).arg(qRound64(baseline)).arg(m_tolerance);
+    return false;
+}
+
+bool PerfRecorder::recordPeakMemory(const QString& key, qint64 bytes, bool compare, QString& message) {
+    if (bytes <= 0) {
+        return true;    // 当前平台拿不到峰值
+    }
+    m_peakMemory.insert(key, bytes);
+    
+    double baseline = m_baseline.value("peakMemory").toObject().value(key).toDouble();
+    if (!compare || baseline <= 0) {
+        return true;
+    }
+    double ceiling = baseline * (1.0 + m_tolerance / 100.0);
+    if (bytes <= ceiling) {
+        return true;
+    }
+    message = QString("%1 峰值内存回退：%2 MB，基线 %3 MB（允许 %4%）")
+                  .arg(key)
+                  .arg(bytes / 1048576.0, 0, 'f', 1)
+                  .arg(baseline / 1048576.0, 0, 'f', 1)
+                  .arg(m_tolerance);
+    return false;
+}
+
+bool PerfRecorder::writeReport(const QString& filePath, QString& errorMsg) const {
+    QJsonObject root;
+    root.insert("tolerancePercent", m_tolerance);
+    root.insert("throughput", m_throughput);
+    root.insert("peakMemory", m_peakMemory);
+    
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        errorMsg = "无法写入性能报告: " + filePath;
+        return false;
+    }
+    file.write(QJsonDocument(root).toJson(QJsonDocument::Indented));
+    if (!file.commit()) {
+        errorMsg = "无法写入性能报告: " + filePath;
+        return false;
+    }
+    return true;
+}
+
+void PerfRecorder::resetPeakMemory() {
+#if defined(Q_OS_LINUX)
+    // 写入 5 会把 VmHWM 重置为当前的常驻内存
+    QFile file("/proc/self/clear_refs");
+    if (file.open(QIODevice::WriteOnly)) {
+        file.write("5");
+    }
+#endif
+}
+
+qint64 PerfRecorder::peakMemoryBytes() {
+#if defined(Q_OS_WIN)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return qint64(counters.PeakWorkingSetSize);
+    }
+    return 0;
+#elif defined(Q_OS_LINUX)
+    QFile file("/proc/self/status");
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        return 0;
+    }
+    while (!file.atEnd()) {
+        QByteArray line = file.readLine();
+        if (line.startsWith("VmHWM:")) {
+            // "VmHWM:    123456 kB"
+            return line.mid(6).trimmed().split(' ').first().toLongLong() * 1024;
+        }
+    }
+    return 0;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#ifdef Q_OS_MACOS
+    return qint64(usage.ru_maxrss);     // macOS 以字节为单位
+#else
+    return qint64(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
@@ -0,0 +1,38 @@
+#ifndef PERFRECORDER_H
+#define PERFRECORDER_H
+
+#include <QJsonObject>
+#include <QString>
+
+// 基准测试结果的记录与基线比较
+// 报告和基线是同一种 JSON 格式：{"throughput": {键: 条/秒}, "peakMemory": {键: 字节}}，
+// 上一次的报告可以直接作为下一次的基线。没有基线时只记录不比较。
+class PerfRecorder {
+public:
+    PerfRecorder();
+    
+    bool loadBaseline(const QString& filePath, QString& errorMsg);
+    bool hasBaseline() const { return !m_baseline.isEmpty(); }
+    
+    // 允许的回退百分比，例如 20 表示吞吐低于基线的 80% 或内存高于基线的 120% 时失败
+    void setTolerance(double percent) { m_tolerance = percent; }
+    double tolerance() const { return m_tolerance; }
+    
+    // 记录一项结果并与基线比较；回退超过容差时返回 false，message 说明原因
+    bool recordThroughput(const QString& key, double cuesPerSecond, bool compare, QString& message);
+    bool recordPeakMemory(const QString& key, qint64 bytes, bool compare, QString& message);
+    
+    bool writeReport(const QString& filePath, QString& errorMsg) const;
+    
+    // 进程的峰值常驻内存。Linux 上可以清零后重新统计，其他平台只能得到进程启动以来的峰值
+    static void resetPeakMemory();
+    static qint64 peakMemoryBytes();
+
+private:
+    QJsonObject m_baseline;
+    QJsonObject m_throughput;
+    QJsonObject m_peakMemory;
+    double m_tolerance;
+};
+
+#endif // PERFRECORDER_H
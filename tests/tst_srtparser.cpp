@@ -0,0 +1,729 @@
+#include <QtTest>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QRandomGenerator>
+#include <QTemporaryDir>
+#include <QThreadPool>
+#include "chineseconverter.h"
+#include "corpusgenerator.h"
+#include "doublearraytrie.h"
+#include "libraryindex.h"
+#include "perfrecorder.h"
+#include "subtitle.h"
+#include "subtitleconform.h"
+#include "subtitlemerge.h"
+#include "subtitlesnap.h"
+#include "subtitlesort.h"
+#include <algorithm>
+#include <numeric>
+
+// SRTParser 的往返正确性与吞吐回归测试，以及重新对位等时间轴算法的边界用例
+// 环境变量（ctest 中由 CMake 设置）：
+//   SUBTITLEEDIT_BENCH_MIN_CUES / SUBTITLEEDIT_BENCH_MAX_CUES  参与测试的语料条数范围
+//   SUBTITLEEDIT_BENCH_BASELINE   性能基线 JSON，为空时只记录不比较
+//   SUBTITLEEDIT_BENCH_TOLERANCE  允许的回退百分比（默认 20）
+//   SUBTITLEEDIT_BENCH_REPORT     本次结果的输出路径，可作为下一次的基线
+
+namespace {
+
+const int kCorpusSizes[] = { 1000, 10000, 100000, 1000000 };
+
+// 条数更少的用例耗时太短、抖动大，只记录不比较
+const int kMinComparedCues = 10000;
+
+// 每项计时在预热（即校验结果的那一遍）之后重复运行，取中位数，单次抖动不会造成误报
+const int kTimedRuns = 5;
+
+int envInt(const char* name, int defaultValue) {
+    bool ok = false;
+    int value = qEnvironmentVariableIntValue(name, &ok);
+    return ok ? value : defaultValue;
+}
+
+double cuesPerSecond(int cues, qint64 elapsedNs) {
+    return elapsedNs > 0 ? cues * 1e9 / elapsedNs : 0.0;
+}
+
+// run 自己计时并返回纳秒数，准备工作不计入
+template <typename Run>
+qint64 medianNs(Run run) {
+    QVector<qint64> samples;
+    for (int i = 0; i < kTimedRuns; ++i) {
+        samples.append(run());
+    }
+    std::sort(samples.begin(), samples.end());
+    return samples[samples.size() / 2];
+}
+
+bool sameItems(const QVector<SubtitleItem>& expected, const QVector<SubtitleItem>& actual, QString& message) {
+    if (expected.size() != actual.size()) {
+        message = QString("条数不同：期望 %1，实际 %2").arg(expected.size()).arg(actual.size());
+        return false;
+    }
+    for (int i = 0; i < expected.size(); ++i) {
+        const SubtitleItem& a = expected[i];
+        const SubtitleItem& b = actual[i];
+        if (a.index != b.index || a.startTime != b.startTime || a.endTime != b.endTime || a.text != b.text) {
+            message = QString("第 %1 条不同：期望 %2 %3 --> %4 \"%5\"，实际 %6 %7 --> %8 \"%9\"")
+                          .arg(QString::number(i),
+                               QString::number(a.index), SRTParser::formatTime(a.startTime),
+                               SRTParser::formatTime(a.endTime), a.text,
+                               QString::number(b.index), SRTParser::formatTime(b.startTime),
+                               SRTParser::formatTime(b.endTime), b.text);
+            return false;
+        }
+    }
+    return true;
+}
+
+SubtitleItem cue(int index, int startMs, int endMs, const QString& text) {
+    return SubtitleItem(index, QTime::fromMSecsSinceStartOfDay(startMs), QTime::fromMSecsSinceStartOfDay(endMs), text);
+}
+
+// 每条 2 秒，依次写出 texts 中的文本
+bool writeSrt(const QString& path, const QStringList& texts) {
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) return false;
+    QString content;
+    for (int i = 0; i < texts.size(); ++i) {
+        content += QString("%1\n%2 --> %3\n%4\n\n")
+                       .arg(QString::number(i + 1),
+                            SRTParser::formatTime(QTime::fromMSecsSinceStartOfDay(i * 2000)),
+                            SRTParser::formatTime(QTime::fromMSecsSinceStartOfDay(i * 2000 + 1500)),
+                            texts[i]);
+    }
+    return file.write(content.toUtf8()) >= 0;
+}
+
+QStringList hitFiles(const QVector<LibraryIndex::Hit>& hits) {
+    QStringList names;
+    for (const LibraryIndex::Hit& hit : hits) {
+        names << QFileInfo(hit.filePath).fileName() + ":" + QString::number(hit.row);
+    }
+    names.sort();
+    return names;
+}
+
+QString firstDifference(const QByteArray& expected, const QByteArray& actual) {
+    qsizetype size = qMin(expected.size(), actual.size());
+    qsizetype at = 0;
+    while (at < size && expected[at] == actual[at]) ++at;
+    return QString("输出与期望字节在偏移 %1 处不同（期望 %2 字节，实际 %3 字节）")
+        .arg(at).arg(expected.size()).arg(actual.size());
+}
+
+} // namespace
+
+class TestSrtParser : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    
+    void roundTrip_data();
+    void roundTrip();
+    
+    void retime_data();
+    void retime();
+    
+    void sortByStartTime();
+    
+    void mergeMinOverlap_data();
+    void mergeMinOverlap();
+    
+    void conformNormalize();
+    void conform();
+    void snap();
+    
+    void trieLongestMatch();
+    void chineseConvert();
+    
+    void librarySearch();
+    void libraryStaleIndex();
+
+private:
+    void addRow(const CorpusOptions& options);
+    bool compared(int cues) const { return cues >= kMinComparedCues; }
+    
+    QTemporaryDir m_dir;
+    PerfRecorder m_recorder;
+    int m_minCues = 0;
+    int m_maxCues = 0;
+};
+
+void TestSrtParser::initTestCase() {
+    QVERIFY(m_dir.isValid());
+    m_minCues = envInt("SUBTITLEEDIT_BENCH_MIN_CUES", 1000);
+    m_maxCues = envInt("SUBTITLEEDIT_BENCH_MAX_CUES", 100000);
+    m_recorder.setTolerance(envInt("SUBTITLEEDIT_BENCH_TOLERANCE", 20));
+    
+    QString baselinePath = qEnvironmentVariable("SUBTITLEEDIT_BENCH_BASELINE");
+    if (!baselinePath.isEmpty()) {
+        QString errorMsg;
+        QVERIFY2(m_recorder.loadBaseline(baselinePath, errorMsg), qPrintable(errorMsg));
+    }
+}
+
+void TestSrtParser::cleanupTestCase() {
+    QString reportPath = qEnvironmentVariable("SUBTITLEEDIT_BENCH_REPORT");
+    if (reportPath.isEmpty()) return;
+    
+    QString errorMsg;
+    QVERIFY2(m_recorder.writeReport(reportPath, errorMsg), qPrintable(errorMsg));
+    qInfo("性能报告已写入 %s", qPrintable(reportPath));
+}
+
+void TestSrtParser::addRow(const CorpusOptions& options) {
+    QTest::addRow("%s/%d", qPrintable(CorpusGenerator::variantName(options)), options.cues)
+        << options.cues << int(options.encoding) << options.crlf << options.bom;
+}
+
+void TestSrtParser::roundTrip_data() {
+    QTest::addColumn<int>("cues");
+    QTest::addColumn<int>("encoding");
+    QTest::addColumn<bool>("crlf");
+    QTest::addColumn<bool>("bom");
+    
+    for (int cues : kCorpusSizes) {
+        if (cues < m_minCues || cues > m_maxCues) continue;
+        
+        CorpusOptions options;
+        options.cues = cues;
+        addRow(options);                                // UTF-8，LF，无 BOM
+        
+        options.crlf = true;
+        options.bom = true;
+        addRow(options);                                // UTF-8，CRLF，带 BOM
+        
+        options.encoding = SubtitleEncoding::Gbk;
+        options.bom = false;
+        addRow(options);                                // GBK，CRLF
+        
+        options.encoding = SubtitleEncoding::Utf16Le;
+        options.crlf = false;
+        options.bom = true;
+        addRow(options);                                // UTF-16LE，LF，带 BOM
+    }
+}
+
+// 生成的文件 -> parse -> save -> parse，两次解析都要与生成的字幕完全一致，
+// 保存的字节要与按平台换行重新生成的语料完全一致
+void TestSrtParser::roundTrip() {
+    QFETCH(int, cues);
+    QFETCH(int, encoding);
+    QFETCH(bool, crlf);
+    QFETCH(bool, bom);
+    
+    CorpusOptions options;
+    options.cues = cues;
+    options.encoding = SubtitleEncoding(encoding);
+    options.crlf = crlf;
+    options.bom = bom;
+    const QString key = CorpusGenerator::variantName(options) + "/" + QString::number(cues);
+    
+    const QVector<SubtitleItem> expected = CorpusGenerator::generateItems(cues, options.seed);
+    const QString inputPath = m_dir.filePath("input.srt");
+    {
+        QByteArray data;
+        if (!CorpusGenerator::serialize(expected, options, data)) {
+            QSKIP("当前Qt环境不支持该编码");
+        }
+        QFile file(inputPath);
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        QCOMPARE(file.write(data), qint64(data.size()));
+    }
+    
+    PerfRecorder::resetPeakMemory();
+    QString errorMsg;
+    QString mismatch;
+    
+    // 第一遍校验结果，同时作为计时前的预热
+    QVector<SubtitleItem> parsed;
+    QVERIFY2(SRTParser::parse(inputPath, parsed, errorMsg, options.encoding), qPrintable(errorMsg));
+    QVERIFY2(sameItems(expected, parsed, mismatch), qPrintable(mismatch));
+    
+    const QString outputPath = m_dir.filePath("output.srt");
+    QVERIFY2(SRTParser::save(outputPath, parsed, errorMsg, options.encoding), qPrintable(errorMsg));
+    const qint64 peakBytes = PerfRecorder::peakMemoryBytes();
+    
+    // 保存总是使用平台换行，只有 UTF-16 写入 BOM
+    CorpusOptions savedOptions = options;
+#ifdef Q_OS_WIN
+    savedOptions.crlf = true;
+#else
+    savedOptions.crlf = false;
+#endif
+    savedOptions.bom = options.encoding == SubtitleEncoding::Utf16Le;
+    {
+        QByteArray expectedBytes;
+        QVERIFY(CorpusGenerator::serialize(expected, savedOptions, expectedBytes));
+        QFile file(outputPath);
+        QVERIFY(file.open(QIODevice::ReadOnly));
+        QByteArray actualBytes = file.readAll();
+        QVERIFY2(actualBytes == expectedBytes, qPrintable(firstDifference(expectedBytes, actualBytes)));
+    }
+    
+    QVector<SubtitleItem> reparsed;
+    QVERIFY2(SRTParser::parse(outputPath, reparsed, errorMsg, options.encoding), qPrintable(errorMsg));
+    QVERIFY2(sameItems(expected, reparsed, mismatch), qPrintable(mismatch));
+    
+    bool ok = true;
+    const qint64 parseNs = medianNs([&]() {
+        QVector<SubtitleItem> items;
+        QElapsedTimer timer;
+        timer.start();
+        ok = SRTParser::parse(inputPath, items, errorMsg, options.encoding) && ok;
+        return timer.nsecsElapsed();
+    });
+    const qint64 saveNs = medianNs([&]() {
+        QElapsedTimer timer;
+        timer.start();
+        ok = SRTParser::save(outputPath, parsed, errorMsg, options.encoding) && ok;
+        return timer.nsecsElapsed();
+    });
+    QVERIFY2(ok, qPrintable(errorMsg));
+    
+    QString message;
+    QVERIFY2(m_recorder.recordThroughput(key + "/parse", cuesPerSecond(cues, parseNs), compared(cues), message),
+             qPrintable(message));
+    QVERIFY2(m_recorder.recordThroughput(key + "/save", cuesPerSecond(cues, saveNs), compared(cues), message),
+             qPrintable(message));
+    QVERIFY2(m_recorder.recordPeakMemory(key, peakBytes, compared(cues), message), qPrintable(message));
+    qInfo("%s: 解析 %.0f 条/秒，保存 %.0f 条/秒，峰值内存 %.1f MB", qPrintable(key),
+          cuesPerSecond(cues, parseNs), cuesPerSecond(cues, saveNs), peakBytes / 1048576.0);
+}
+
+void TestSrtParser::retime_data() {
+    QTest::addColumn<int>("cues");
+    QTest::addColumn<int>("encoding");
+    QTest::addColumn<bool>("crlf");
+    QTest::addColumn<bool>("bom");
+    
+    for (int cues : kCorpusSizes) {
+        if (cues < m_minCues || cues > m_maxCues) continue;
+        CorpusOptions options;
+        options.cues = cues;
+        addRow(options);
+    }
+}
+
+// shiftTime 正反平移后复原；pointSync 把两个同步点准确映射到新时间且保持顺序
+void TestSrtParser::retime() {
+    QFETCH(int, cues);
+    const QString key = "retime/" + QString::number(cues);
+    const QVector<SubtitleItem> original = CorpusGenerator::generateItems(cues, CorpusOptions().seed);
+    
+    QVector<SubtitleItem> items = original;
+    SRTParser::shiftTime(items, 1234);
+    for (int i = 0; i < cues; ++i) {
+        QCOMPARE(items[i].startTime, original[i].startTime.addMSecs(1234));
+        QCOMPARE(items[i].endTime, original[i].endTime.addMSecs(1234));
+    }
+    SRTParser::shiftTime(items, -1234);
+    QString mismatch;
+    QVERIFY2(sameItems(original, items, mismatch), qPrintable(mismatch));
+    
+    // 两个同步点：后移 2 秒，并把两点之间拉长 0.1%
+    const int point1 = cues / 10;
+    const int point2 = cues * 9 / 10;
+    const QTime newPoint1 = original[point1].startTime.addMSecs(2000);
+    const int oldSpan = original[point1].startTime.msecsTo(original[point2].startTime);
+    const QTime newPoint2 = newPoint1.addMSecs(qRound(oldSpan * 1.001));
+    SRTParser::pointSync(items, point1, newPoint1, point2, newPoint2);
+    
+    QCOMPARE(items[point1].startTime, newPoint1);
+    QVERIFY(qAbs(items[point2].startTime.msecsTo(newPoint2)) <= 1);
+    for (int i = 1; i < cues; ++i) {
+        QVERIFY2(items[i - 1].startTime <= items[i].startTime, qPrintable(QString("第 %1 条顺序错乱").arg(i)));
+    }
+    
+    // 上面的校验就是预热；每次计时前复制一份并先分离，复制的开销不计入
+    const qint64 shiftNs = medianNs([&]() {
+        QVector<SubtitleItem> copy = original;
+        copy.detach();
+        QElapsedTimer timer;
+        timer.start();
+        SRTParser::shiftTime(copy, 1234);
+        return timer.nsecsElapsed();
+    });
+    const qint64 syncNs = medianNs([&]() {
+        QVector<SubtitleItem> copy = original;
+        copy.detach();
+        QElapsedTimer timer;
+        timer.start();
+        SRTParser::pointSync(copy, point1, newPoint1, point2, newPoint2);
+        return timer.nsecsElapsed();
+    });
+    
+    QString message;
+    QVERIFY2(m_recorder.recordThroughput(key + "/shift", cuesPerSecond(cues, shiftNs), compared(cues), message),
+             qPrintable(message));
+    QVERIFY2(m_recorder.recordThroughput(key + "/pointsync", cuesPerSecond(cues, syncNs), compared(cues), message),
+             qPrintable(message));
+}
+
+// 与 SubtitleDocument::sortByStartTime 相同的步骤：求出顺序、重排、重新编号
+void TestSrtParser::sortByStartTime() {
+    // 低 18 位相同、只有第三趟（18～26 位）能区分的开始时间；相同时间保持原来的先后
+    const int high = 1 << 18;
+    QVector<SubtitleItem> items = {
+        cue(1, 1000 + 2 * high, 1000 + 2 * high + 500, "late"),
+        cue(2, 1000, 1500, "tie 1"),
+        cue(3, 1000 + high, 1000 + high + 500, "middle"),
+        cue(4, 1000, 1500, "tie 2"),
+    };
+    QVERIFY(!SubtitleSort::isSorted(items));
+    const QVector<int> order = SubtitleSort::sortedOrder(items);
+    QCOMPARE(order, QVector<int>({1, 3, 2, 0}));
+    QCOMPARE(SubtitleSort::applyOrder(items, order), 3);
+    QCOMPARE(SubtitleSort::renumber(items), 3);
+    const QVector<SubtitleItem> expected = {
+        cue(1, 1000, 1500, "tie 1"),
+        cue(2, 1000, 1500, "tie 2"),
+        cue(3, 1000 + high, 1000 + high + 500, "middle"),
+        cue(4, 1000 + 2 * high, 1000 + 2 * high + 500, "late"),
+    };
+    QString mismatch;
+    QVERIFY2(sameItems(expected, items, mismatch), qPrintable(mismatch));
+    
+    // 已经有序：不返回顺序，序号连续时不改写，也不让共享的数组分离
+    const QVector<SubtitleItem> shared = items;
+    QVERIFY(SubtitleSort::isSorted(items));
+    QVERIFY(SubtitleSort::sortedOrder(items).isEmpty());
+    QCOMPARE(SubtitleSort::renumber(items), 0);
+    QVERIFY(items.constData() == shared.constData());
+    
+    // 条数足够多时按块并行，结果必须与稳定排序完全相同；时间覆盖全天，大量重复
+    const int count = 200000;
+    QRandomGenerator random(20240601);
+    QVector<SubtitleItem> large;
+    large.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        const int start = int(random.bounded(86400)) * 1000 + int(random.bounded(4)) * 250;
+        large.append(cue(i + 1, start, start + 1000, QString()));
+    }
+    QVector<int> stable(count);
+    std::iota(stable.begin(), stable.end(), 0);
+    std::stable_sort(stable.begin(), stable.end(), [&large](int a, int b) {
+        return large[a].startTime < large[b].startTime;
+    });
+    QThreadPool pool;
+    pool.setMaxThreadCount(4);
+    QCOMPARE(SubtitleSort::sortedOrder(large, &pool), stable);
+    QCOMPARE(SubtitleSort::sortedOrder(large), stable);
+}
+
+void TestSrtParser::mergeMinOverlap_data() {
+    QTest::addColumn<int>("mode");
+    QTest::addColumn<int>("minOverlapMs");
+    QTest::addColumn<int>("secondaryStart");
+    QTest::addColumn<bool>("matched");
+    
+    // 主字幕为 [1000, 2000)
+    for (int mode : {int(SubtitleMerge::Stack), int(SubtitleMerge::Split)}) {
+        const QByteArray name = SubtitleMerge::modeName(SubtitleMerge::Mode(mode)).toLatin1();
+        QTest::addRow("%s/touching/0", name.constData()) << mode << 0 << 2000 << false;
+        QTest::addRow("%s/1ms/0", name.constData()) << mode << 0 << 1999 << true;
+        QTest::addRow("%s/99ms/100", name.constData()) << mode << 100 << 1901 << false;
+        QTest::addRow("%s/100ms/100", name.constData()) << mode << 100 << 1900 << true;
+    }
+}
+
+// 重叠恰好等于 minOverlapMs 时算作对应；minOverlapMs 为 0 时首尾相接不算
+void TestSrtParser::mergeMinOverlap() {
+    QFETCH(int, mode);
+    QFETCH(int, minOverlapMs);
+    QFETCH(int, secondaryStart);
+    QFETCH(bool, matched);
+    
+    SubtitleMerge::Options options;
+    options.mode = SubtitleMerge::Mode(mode);
+    options.minOverlapMs = minOverlapMs;
+    options.minSegmentMs = 0;
+    SubtitleMerge::Stats stats;
+    const QVector<SubtitleItem> result = SubtitleMerge::merge({ cue(1, 1000, 2000, "primary") },
+                                                              { cue(1, secondaryStart, 3000, "secondary") },
+                                                              options, &stats);
+    QCOMPARE(stats.matched, matched ? 1 : 0);
+    QCOMPARE(stats.unmatched, matched ? 0 : 1);
+    if (options.mode == SubtitleMerge::Stack) {
+        // 对应时副字幕并入主字幕，否则单独保留
+        QCOMPARE(result.size(), matched ? 1 : 2);
+        QCOMPARE(result[0].text, matched ? QString("primary\nsecondary") : QString("primary"));
+    } else if (!matched) {
+        QString mismatch;
+        QVERIFY2(sameItems({ cue(1, 1000, 2000, "primary"), cue(2, secondaryStart, 3000, "secondary") }, result,
+                           mismatch),
+                 qPrintable(mismatch));
+    }
+}
+
+// 乱序输入按旧入点排序；首尾相接且新时间连续的段合并，零长度的段丢弃
+void TestSrtParser::conformNormalize() {
+    const QVector<SubtitleConform::Segment> segments = {
+        {5000, 8000, 105000},
+        {0, 5000, 100000},
+        {8000, 9000, 200000},
+        {9000, 9000, 0},
+    };
+    const QVector<SubtitleConform::Segment> normalized = SubtitleConform::normalize(segments);
+    QCOMPARE(normalized.size(), 2);
+    QCOMPARE(normalized[0].oldIn, 0);
+    QCOMPARE(normalized[0].oldOut, 8000);
+    QCOMPARE(normalized[0].newIn, 100000);
+    QCOMPARE(normalized[1].oldIn, 8000);
+    QCOMPARE(normalized[1].oldOut, 9000);
+    QCOMPARE(normalized[1].newIn, 200000);
+}
+
+// 旧版本的 [0, 10) 秒在新版本中用了两次（20 秒和 40 秒处），[10, 20) 秒移到开头，20 秒之后删除
+void TestSrtParser::conform() {
+    const QVector<SubtitleConform::Segment> segments = {
+        {0, 10000, 20000},
+        {10000, 20000, 0},
+        {0, 10000, 40000},
+    };
+    const QVector<SubtitleItem> subtitles = {
+        cue(1, 15000, 16000, "moved"),
+        cue(2, 1000, 2000, "reused"),
+        cue(3, 9600, 11000, "crossing"),        // 跨越剪辑点，后一段的 1 秒最长
+        cue(4, 19800, 20300, "short"),          // 留在片段内的只有 200 毫秒
+        cue(5, 25000, 26000, "removed"),
+    };
+    
+    SubtitleConform::Options options;
+    SubtitleConform::Stats stats;
+    QVector<SubtitleItem> result = SubtitleConform::conform(subtitles, segments, options, &stats);
+    const QVector<SubtitleItem> trimmed = {
+        cue(1, 0, 1000, "crossing"),
+        cue(2, 5000, 6000, "moved"),
+        cue(3, 21000, 22000, "reused"),
+        cue(4, 41000, 42000, "reused"),
+    };
+    QString mismatch;
+    QVERIFY2(sameItems(trimmed, result, mismatch), qPrintable(mismatch));
+    QCOMPARE(stats.kept, 3);
+    QCOMPARE(stats.trimmed, 1);
+    QCOMPARE(stats.dropped, 1);
+    QCOMPARE(stats.removed, 1);
+    
+    options.crossing = SubtitleConform::Drop;
+    result = SubtitleConform::conform(subtitles, segments, options, &stats);
+    const QVector<SubtitleItem> dropped = {
+        cue(1, 5000, 6000, "moved"),
+        cue(2, 21000, 22000, "reused"),
+        cue(3, 41000, 42000, "reused"),
+    };
+    QVERIFY2(sameItems(dropped, result, mismatch), qPrintable(mismatch));
+    QCOMPARE(stats.kept, 3);
+    QCOMPARE(stats.trimmed, 0);
+    QCOMPARE(stats.dropped, 2);
+    QCOMPARE(stats.removed, 1);
+}
+
+void TestSrtParser::snap() {
+    QString mismatch;
+    
+    // 开始和结束都在阈值内，各自吸附到最近的切换点；关掉开始吸附时只动结束
+    QVector<SubtitleItem> items = { cue(1, 1100, 2900, "a") };
+    SubtitleSnap::Stats stats = SubtitleSnap::apply(items, {1000, 3000}, SubtitleSnap::Options());
+    QVERIFY2(sameItems({ cue(1, 1000, 3000, "a") }, items, mismatch), qPrintable(mismatch));
+    QCOMPARE(stats.starts, 1);
+    QCOMPARE(stats.ends, 1);
+    QCOMPARE(stats.skipped, 0);
+    
+    items = { cue(1, 1100, 2900, "a") };
+    SubtitleSnap::Options endsOnly;
+    endsOnly.snapStarts = false;
+    stats = SubtitleSnap::apply(items, {1000, 3000}, endsOnly);
+    QVERIFY2(sameItems({ cue(1, 1100, 3000, "a") }, items, mismatch), qPrintable(mismatch));
+    QCOMPARE(stats.starts, 0);
+    QCOMPARE(stats.ends, 1);
+    
+    // 前后两条吸附到同一个切换点：下一条从切换点开始，本条停在它之前 minGapMs 处；行的顺序不变
+    items = { cue(1, 5100, 7000, "next"), cue(2, 3000, 4900, "previous") };
+    stats = SubtitleSnap::apply(items, {5000}, SubtitleSnap::Options());
+    QVERIFY2(sameItems({ cue(1, 5000, 7000, "next"), cue(2, 3000, 4917, "previous") }, items, mismatch),
+             qPrintable(mismatch));
+    QCOMPARE(stats.starts, 1);
+    QCOMPARE(stats.ends, 1);
+    QCOMPARE(stats.firstRow, 0);
+    QCOMPARE(stats.lastRow, 1);
+    
+    // 下一条离前一条太近、放弃了开始吸附，前一条的结束按下一条实际的开始留出间隔
+    items = { cue(1, 3000, 4990, "previous"), cue(2, 5050, 7000, "next") };
+    stats = SubtitleSnap::apply(items, {5000}, SubtitleSnap::Options());
+    QVERIFY2(sameItems({ cue(1, 3000, 4967, "previous"), cue(2, 5050, 7000, "next") }, items, mismatch),
+             qPrintable(mismatch));
+    QCOMPARE(stats.starts, 0);
+    QCOMPARE(stats.ends, 1);
+    QCOMPARE(stats.skipped, 1);
+    
+    // 阈值之外的切换点不影响字幕
+    items = { cue(1, 1000, 2000, "a") };
+    stats = SubtitleSnap::apply(items, {1500}, SubtitleSnap::Options());
+    QVERIFY(!stats.changed());
+    QVERIFY2(sameItems({ cue(1, 1000, 2000, "a") }, items, mismatch), qPrintable(mismatch));
+}
+
+void TestSrtParser::trieLongestMatch() {
+    DoubleArrayTrie trie;
+    trie.build({}, {});
+    QVERIFY(trie.isEmpty());
+    int value = -1;
+    QCOMPARE(trie.longestMatch(QString("a").constData(), 1, value), 0);
+    
+    trie.build({"ab", "abcd", "b", "中", "中国", "中国人"}, {0, 1, 2, 3, 4, 5});
+    QVERIFY(!trie.isEmpty());
+    
+    // 返回最长的词条，经过的中间节点（abc）不是词条时退回到上一个词条
+    struct Case { const char* text; int length; int matched; int value; };
+    const Case cases[] = {
+        {"abcd", -1, 4, 1},
+        {"abcx", -1, 2, 0},
+        {"abcd", 3, 2, 0},
+        {"a", -1, 0, -1},
+        {"bab", -1, 1, 2},
+        {"中国队", -1, 2, 4},
+        {"中国人民", -1, 3, 5},
+        {"x中国", -1, 0, -1},
+    };
+    for (const Case& c : cases) {
+        const QString text = QString::fromUtf8(c.text);
+        value = -1;
+        const int matched = trie.longestMatch(text.constData(), c.length < 0 ? text.size() : c.length, value);
+        QVERIFY2(matched == c.matched && value == c.value,
+                 qPrintable(QString("%1：匹配 %2 个码元，编号 %3").arg(text).arg(matched).arg(value)));
+    }
+}
+
+void TestSrtParser::chineseConvert() {
+    QString errorMsg;
+    auto toTraditional = ChineseConverter::shared(ChineseConverter::SimplifiedToTraditional, QString(), errorMsg);
+    QVERIFY2(toTraditional, qPrintable(errorMsg));
+    // 词条优先于单字：“发”单独为“發”，在“头发”“发型”中为“髮”
+    QCOMPARE(toTraditional->convert("头发和发型都发了"), QString("頭髮和髮型都發了"));
+    QCOMPARE(toTraditional->convert("干杯，干活"), QString("乾杯，幹活"));
+    const QString unchanged = "abc 123";
+    QCOMPARE(toTraditional->convert(unchanged), unchanged);
+    
+    auto toSimplified = ChineseConverter::shared(ChineseConverter::TraditionalToSimplified, QString(), errorMsg);
+    QVERIFY2(toSimplified, qPrintable(errorMsg));
+    QCOMPARE(toSimplified->convert("頭髮和髮型"), QString("头发和发型"));
+    
+    // 词典目录中的条目覆盖内置条目，多种写法取第一种；更长的词条优先
+    const QString dictionaryDir = m_dir.filePath("opencc");
+    QVERIFY(QDir().mkpath(dictionaryDir));
+    QFile characters(QDir(dictionaryDir).filePath("STCharacters.txt"));
+    QVERIFY(characters.open(QIODevice::WriteOnly));
+    characters.write("# test\n发\t髮 發\n");
+    characters.close();
+    QFile phrases(QDir(dictionaryDir).filePath("STPhrases.txt"));
+    QVERIFY(phrases.open(QIODevice::WriteOnly));
+    phrases.write("发了\t發了\n都发了\t都發了啊\n");
+    phrases.close();
+    
+    auto custom = ChineseConverter::shared(ChineseConverter::SimplifiedToTraditional, dictionaryDir, errorMsg);
+    QVERIFY2(custom, qPrintable(errorMsg));
+    QCOMPARE(custom->convert("发"), QString("髮"));
+    QCOMPARE(custom->convert("发了"), QString("發了"));
+    QCOMPARE(custom->convert("都发了"), QString("都發了啊"));
+    QCOMPARE(custom->convert("都发"), QString("都髮"));
+}
+
+// 汉字按相邻两字索引、末字另作单字；一个字的查询按前缀匹配，句中的字也能命中
+void TestSrtParser::librarySearch() {
+    const QString root = m_dir.filePath("library-search");
+    QVERIFY(QDir().mkpath(root + "/season1"));
+    QVERIFY(writeSrt(root + "/a.srt", {"我们喜欢猫", "Hello World"}));
+    QVERIFY(writeSrt(root + "/season1/b.srt", {"今天天气很好", "hello again"}));
+    
+    LibraryIndex index(root);
+    LibraryIndex::UpdateStats stats;
+    QString errorMsg;
+    QVERIFY2(index.update(SubtitleEncoding::Utf8, stats, errorMsg), qPrintable(errorMsg));
+    QCOMPARE(stats.files, 2);
+    QCOMPARE(stats.parsed, 2);
+    QCOMPARE(stats.cues, 4);
+    
+    QVector<LibraryIndex::Hit> hits = index.search("喜");
+    QCOMPARE(hits.size(), 1);
+    QCOMPARE(QFileInfo(hits[0].filePath).fileName(), QString("a.srt"));
+    QCOMPARE(hits[0].row, 0);
+    QCOMPARE(hits[0].startMs, 0);
+    QCOMPARE(hits[0].text, QString("我们喜欢猫"));
+    
+    QCOMPARE(hitFiles(index.search("们")), QStringList({"a.srt:0"}));
+    QCOMPARE(hitFiles(index.search("猫")), QStringList({"a.srt:0"}));
+    QCOMPARE(hitFiles(index.search("天气")), QStringList({"b.srt:0"}));
+    QVERIFY(index.search("狗").isEmpty());
+    QVERIFY(index.search("欢喜").isEmpty());
+    
+    // 拉丁字母不区分大小写；多词查询时命中词多的排在前面
+    QCOMPARE(hitFiles(index.search("HELLO")), QStringList({"a.srt:1", "b.srt:1"}));
+    hits = index.search("hello again");
+    QCOMPARE(hits.size(), 2);
+    QCOMPARE(hits[0].matchedTerms, 2);
+    QCOMPARE(QFileInfo(hits[0].filePath).fileName(), QString("b.srt"));
+    QCOMPARE(hits[0].startMs, 2000);
+}
+
+// 修改、删除的文件在更新时重新解析或移出索引；索引文件损坏时整体重建
+void TestSrtParser::libraryStaleIndex() {
+    const QString root = m_dir.filePath("library-stale");
+    QVERIFY(QDir().mkpath(root));
+    QVERIFY(writeSrt(root + "/a.srt", {"我们喜欢猫"}));
+    QVERIFY(writeSrt(root + "/b.srt", {"今天天气很好"}));
+    
+    QString errorMsg;
+    LibraryIndex::UpdateStats stats;
+    {
+        LibraryIndex index(root);
+        QVERIFY2(index.update(SubtitleEncoding::Utf8, stats, errorMsg), qPrintable(errorMsg));
+        QCOMPARE(stats.parsed, 2);
+        
+        // 大小改变的文件重新解析，其余沿用
+        QVERIFY(writeSrt(root + "/a.srt", {"我们喜欢小狗", "第二句"}));
+        QVERIFY2(index.update(SubtitleEncoding::Utf8, stats, errorMsg), qPrintable(errorMsg));
+        QCOMPARE(stats.parsed, 1);
+        QCOMPARE(stats.reused, 1);
+        QCOMPARE(stats.cues, 3);
+        QVERIFY(index.search("猫").isEmpty());
+        QCOMPARE(hitFiles(index.search("狗")), QStringList({"a.srt:0"}));
+        QCOMPARE(hitFiles(index.search("天气")), QStringList({"b.srt:0"}));
+        
+        QVERIFY(QFile::remove(root + "/b.srt"));
+        QVERIFY2(index.update(SubtitleEncoding::Utf8, stats, errorMsg), qPrintable(errorMsg));
+        QCOMPARE(stats.removed, 1);
+        QCOMPARE(stats.files, 1);
+        QVERIFY(index.search("天气").isEmpty());
+    }
+    
+    // 重新打开时沿用保存的索引
+    {
+        LibraryIndex index(root);
+        QVERIFY2(index.load(errorMsg), qPrintable(errorMsg));
+        QCOMPARE(index.cueCount(), 2);
+        QVERIFY2(index.update(SubtitleEncoding::Utf8, stats, errorMsg), qPrintable(errorMsg));
+        QCOMPARE(stats.parsed, 0);
+        QCOMPARE(stats.reused, 1);
+    }
+    
+    QFile indexFile(LibraryIndex::defaultIndexPath(root));
+    QVERIFY(indexFile.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    indexFile.write("not an index");
+    indexFile.close();
+    
+    LibraryIndex index(root);
+    QVERIFY(!index.load(errorMsg));
+    QVERIFY(!index.isLoaded());
+    QVERIFY2(index.update(SubtitleEncoding::Utf8, stats, errorMsg), qPrintable(errorMsg));
+    QCOMPARE(stats.parsed, 1);
+    QCOMPARE(stats.reused, 0);
+    QCOMPARE(hitFiles(index.search("狗")), QStringList({"a.srt:0"}));
+}
+
+QTEST_GUILESS_MAIN(TestSrtParser)
+#include "tst_srtparser.moc"
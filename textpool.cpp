@@ -0,0 +1,52 @@
+#include "textpool.h"
+#include <QSet>
+
+TextPool::TextPool()
+    : m_size(0)
+{
+}
+
+QString TextPool::intern(QStringView text) {
+    if (text.isEmpty()) return QString();
+    
+    size_t hash = qHash(text);
+    auto it = m_strings.constFind(hash);
+    while (it != m_strings.constEnd() && it.key() == hash) {
+        if (*it == text) return *it;
+        ++it;
+    }
+    
+    QString stored = text.toString();
+    stored.squeeze();
+    m_strings.insert(hash, stored);
+    ++m_size;
+    return stored;
+}
+
+QString TextPool::intern(const QString& text) {
+    return intern(QStringView(text));
+}
+
+void TextPool::clear() {
+    m_strings.clear();
+    m_size = 0;
+}
+
+TextPool::Stats TextPool::measure(const QVector<SubtitleItem>& subtitles) {
+    Stats stats;
+    stats.cues = subtitles.size();
+    
+    QSet<const QChar*> buffers;
+    for (const SubtitleItem& item : subtitles) {
+        if (item.text.isEmpty()) continue;
+        
+        qint64 bytes = qint64(item.text.size()) * qint64(sizeof(QChar));
+        stats.logicalBytes += bytes;
+        if (!buffers.contains(item.text.constData())) {
+            buffers.insert(item.text.constData());
+            stats.storedBytes += bytes;
+        }
+    }
+    stats.uniqueTexts = buffers.size();
+    return stats;
+}
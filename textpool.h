@@ -0,0 +1,47 @@
+#ifndef TEXTPOOL_H
+#define TEXTPOOL_H
+
+#include <QHash>
+#include <QString>
+#include <QStringView>
+#include <QVector>
+#include "subtitle.h"
+
+// 字幕文本驻留池
+// 相同的文本只保存一份，所有引用共享同一个 QString 缓冲（隐式共享），
+// 因此池中得到的两个文本相等当且仅当 constData() 指针相等。
+// 查找时直接用 QStringView 计算哈希，已存在的文本不会产生新的分配。
+// 不是线程安全的：每次解析使用自己的池，解析完成后随结果交给文档。
+class TextPool {
+public:
+    struct Stats {
+        qint64 cues;            // 字幕条数
+        qint64 uniqueTexts;     // 不同文本缓冲的数量
+        qint64 logicalBytes;    // 不共享时文本占用的字节数
+        qint64 storedBytes;     // 实际占用的字节数
+        
+        Stats() : cues(0), uniqueTexts(0), logicalBytes(0), storedBytes(0) {}
+        qint64 savedBytes() const { return logicalBytes - storedBytes; }
+    };
+    
+    TextPool();
+    
+    // 返回与 text 相等的共享字符串
+    QString intern(QStringView text);
+    QString intern(const QString& text);
+    
+    int size() const { return m_size; }
+    void clear();
+    
+    // 统计字幕数组中文本的实际共享情况（按缓冲指针去重）
+    static Stats measure(const QVector<SubtitleItem>& subtitles);
+    
+    // 两条已驻留的文本是否相同：只比较指针
+    static bool sameText(const QString& a, const QString& b) { return a.constData() == b.constData(); }
+
+private:
+    QMultiHash<size_t, QString> m_strings;
+    int m_size;
+};
+
+#endif // TEXTPOOL_H
@@ -0,0 +1,459 @@
+#include "timelinewidget.h"
+#include "subtitlesort.h"
+#include "subtitletablemodel.h"
+#include <QMouseEvent>
+#include <QPainter>
+#include <QWheelEvent>
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+
+namespace {
+
+const int kRulerHeight = 18;
+const int kBaseBucketMs = 100;
+const int kMinCuePixels = 4;          // 平均每条字幕不足这么宽时改画覆盖率
+const int kEdgeTolerance = 4;
+const int kMinDurationMs = 100;       // 拖动边缘时保留的最短时长
+const int kMaxTimeMs = 24 * 3600 * 1000 - 1;
+const double kMinMsPerPixel = 1.0;
+
+const QColor kBackgroundColor(250, 250, 250);
+const QColor kRulerColor(235, 235, 235);
+const QColor kCueColor(120, 160, 220);
+const QColor kOverlapColor(230, 120, 100);
+const QColor kSelectedColor(60, 110, 200);
+const QColor kPlayheadColor(220, 40, 40);
+
+// 刻度间隔，取相邻刻度至少相距 80 像素的最小值
+const int kTickSteps[] = {10, 50, 100, 500, 1000, 5000, 10000, 30000, 60000, 300000, 600000, 1800000, 3600000};
+const int kMinTickPixels = 80;
+
+QString tickLabel(int timeMs, int stepMs) {
+    QTime time = QTime::fromMSecsSinceStartOfDay(timeMs);
+    return time.toString(stepMs < 1000 ? "H:mm:ss.zzz" : "H:mm:ss");
+}
+
+} // namespace
+
+TimelineWidget::TimelineWidget(QWidget* parent)
+    : QWidget(parent)
+    , m_subtitles(nullptr)
+    , m_dirty(false)
+    , m_viewStartMs(0)
+    , m_msPerPixel(1000)
+    , m_selectionFirst(-1)
+    , m_selectionLast(-1)
+    , m_playheadMs(-1)
+    , m_dragPosition(-1)
+    , m_dragEdge(NoEdge)
+    , m_dragTimeMs(0)
+    , m_panning(false)
+    , m_panOriginX(0)
+    , m_panOriginMs(0)
+{
+    setMouseTracking(true);
+    setAttribute(Qt::WA_OpaquePaintEvent);
+    setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Fixed);
+}
+
+QSize TimelineWidget::sizeHint() const {
+    return QSize(600, 72);
+}
+
+void TimelineWidget::setSubtitles(const QVector<SubtitleItem>* subtitles, SubtitleTableModel* model) {
+    if (m_model) {
+        disconnect(m_model, nullptr, this, nullptr);
+    }
+    m_subtitles = model ? subtitles : nullptr;
+    m_model = model;
+    m_selectionFirst = -1;
+    m_selectionLast = -1;
+    m_dragPosition = -1;
+    m_dragEdge = NoEdge;
+    m_panning = false;
+    
+    if (model) {
+        connect(model, &QAbstractItemModel::modelReset, this, &TimelineWidget::invalidate);
+        connect(model, &QAbstractItemModel::dataChanged, this, &TimelineWidget::onDataChanged);
+        connect(model, &QAbstractItemModel::rowsInserted, this, &TimelineWidget::invalidate);
+        connect(model, &QAbstractItemModel::rowsRemoved, this, &TimelineWidget::invalidate);
+        connect(model, &QAbstractItemModel::layoutChanged, this, &TimelineWidget::invalidate);
+    }
+    rebuild();
+    fitAll();
+    update();
+}
+
+void TimelineWidget::setSelectedRows(int first, int last) {
+    m_selectionFirst = first;
+    m_selectionLast = last;
+    if (m_subtitles && first >= 0 && first < m_subtitles->size()) {
+        int startMs = (*m_subtitles)[first].startTime.msecsSinceStartOfDay();
+        double viewEndMs = m_viewStartMs + width() * m_msPerPixel;
+        if (startMs < m_viewStartMs || startMs >= viewEndMs) {
+            m_viewStartMs = startMs - width() * m_msPerPixel / 2;
+            clampView();
+        }
+    }
+    update();
+}
+
+void TimelineWidget::setPlayhead(int timeMs) {
+    if (timeMs == m_playheadMs) return;
+    m_playheadMs = timeMs;
+    
+    // 播放位置走出视口时整页翻过去
+    double viewEndMs = m_viewStartMs + width() * m_msPerPixel;
+    if (timeMs >= 0 && (timeMs < m_viewStartMs || timeMs >= viewEndMs)) {
+        m_viewStartMs = timeMs;
+        clampView();
+    }
+    update();
+}
+
+void TimelineWidget::invalidate() {
+    m_dirty = true;
+    // 数据变了，拖动中的位置可能已指向别的字幕或越界，放弃这次拖动
+    m_dragPosition = -1;
+    m_dragEdge = NoEdge;
+    update();
+}
+
+void TimelineWidget::onDataChanged(const QModelIndex& topLeft, const QModelIndex& bottomRight) {
+    // 只改了序号或文本时排列不变，重绘即可；涉及开始或结束时间才重建
+    if (bottomRight.column() < SubtitleTableModel::StartColumn || topLeft.column() > SubtitleTableModel::EndColumn) {
+        update();
+        return;
+    }
+    invalidate();
+}
+
+void TimelineWidget::rebuild() {
+    m_dirty = false;
+    m_rows.clear();
+    m_starts.clear();
+    m_ends.clear();
+    m_maxEnds.clear();
+    m_levels.clear();
+    if (!m_model) {
+        // 模型已随文档释放，数组可能随之失效
+        m_subtitles = nullptr;
+    }
+    if (!m_subtitles || m_subtitles->isEmpty()) return;
+    
+    const QVector<SubtitleItem>& subtitles = *m_subtitles;
+    const int count = subtitles.size();
+    m_rows = SubtitleSort::sortedOrder(subtitles);
+    m_starts.resize(count);
+    m_ends.resize(count);
+    m_maxEnds.resize(count);
+    int maxEnd = 0;
+    for (int i = 0; i < count; ++i) {
+        const SubtitleItem& item = subtitles[m_rows.isEmpty() ? i : m_rows[i]];
+        m_starts[i] = item.startTime.msecsSinceStartOfDay();
+        m_ends[i] = qMax(m_starts[i], item.endTime.msecsSinceStartOfDay());
+        maxEnd = qMax(maxEnd, m_ends[i]);
+        m_maxEnds[i] = maxEnd;
+    }
+    
+    // 第 0 级按 kBaseBucketMs 分桶累计覆盖时长，往上每级两桶合一
+    QVector<qint64> base(maxEnd / kBaseBucketMs + 1, 0);
+    for (int i = 0; i < count; ++i) {
+        for (int bucket = m_starts[i] / kBaseBucketMs; bucket * kBaseBucketMs < m_ends[i]; ++bucket) {
+            int bucketStart = bucket * kBaseBucketMs;
+            base[bucket] += qMin(m_ends[i], bucketStart + kBaseBucketMs) - qMax(m_starts[i], bucketStart);
+        }
+    }
+    m_levels.append(base);
+    while (m_levels.last().size() > 1) {
+        const QVector<qint64>& lower = m_levels.last();
+        QVector<qint64> upper((lower.size() + 1) / 2, 0);
+        for (int i = 0; i < lower.size(); ++i) {
+            upper[i / 2] += lower[i];
+        }
+        m_levels.append(upper);
+    }
+}
+
+void TimelineWidget::fitAll() {
+    int spanMs = m_maxEnds.isEmpty() ? 60000 : m_maxEnds.last();
+    m_viewStartMs = 0;
+    m_msPerPixel = double(spanMs) / qMax(1, width());
+    clampView();
+}
+
+void TimelineWidget::clampView() {
+    int spanMs = m_maxEnds.isEmpty() ? 60000 : m_maxEnds.last();
+    double maxMsPerPixel = qMax(kMinMsPerPixel, double(spanMs) / qMax(1, width()));
+    m_msPerPixel = qBound(kMinMsPerPixel, m_msPerPixel, maxMsPerPixel);
+    m_viewStartMs = qBound(0.0, m_viewStartMs, qMax(0.0, spanMs - width() * m_msPerPixel));
+}
+
+double TimelineWidget::timeAt(double x) const {
+    return m_viewStartMs + x * m_msPerPixel;
+}
+
+double TimelineWidget::xAt(double timeMs) const {
+    return (timeMs - m_viewStartMs) / m_msPerPixel;
+}
+
+void TimelineWidget::visibleRange(int& first, int& last) const {
+    // 前缀最大结束时间单调，之前的字幕都在视口左侧结束；开始时间不早于视口右端的字幕都在右侧
+    double fromMs = m_viewStartMs;
+    double toMs = timeAt(width());
+    first = int(std::upper_bound(m_maxEnds.begin(), m_maxEnds.end(), fromMs) - m_maxEnds.begin());
+    last = int(std::lower_bound(m_starts.begin(), m_starts.end(), toMs) - m_starts.begin());
+    last = qMax(first, last);
+}
+
+bool TimelineWidget::detailMode(int visibleCount) const {
+    return qint64(visibleCount) * kMinCuePixels <= width();
+}
+
+int TimelineWidget::hitTest(const QPoint& pos, Edge& edge) const {
+    edge = NoEdge;
+    if (pos.y() < kRulerHeight || m_starts.isEmpty()) return -1;
+    
+    int first = 0;
+    int last = 0;
+    visibleRange(first, last);
+    if (!detailMode(last - first)) return -1;
+    
+    // 边缘优先于字幕内部，相邻字幕首尾相接时先命中后一条的开始
+    int body = -1;
+    for (int i = last - 1; i >= first; --i) {
+        double startX = xAt(m_starts[i]);
+        double endX = xAt(m_ends[i]);
+        if (std::abs(pos.x() - startX) <= kEdgeTolerance) {
+            edge = StartEdge;
+            return i;
+        }
+        if (std::abs(pos.x() - endX) <= kEdgeTolerance) {
+            edge = EndEdge;
+            return i;
+        }
+        if (body < 0 && pos.x() > startX && pos.x() < endX) {
+            body = i;
+        }
+    }
+    if (body >= 0) {
+        edge = Body;
+    }
+    return body;
+}
+
+void TimelineWidget::paintEvent(QPaintEvent* event) {
+    Q_UNUSED(event);
+    if (m_dirty) {
+        rebuild();
+        clampView();
+    }
+    
+    QPainter painter(this);
+    painter.fillRect(rect(), kBackgroundColor);
+    paintRuler(painter);
+    
+    QRect track(0, kRulerHeight + 2, width(), height() - kRulerHeight - 4);
+    if (!m_starts.isEmpty()) {
+        int first = 0;
+        int last = 0;
+        visibleRange(first, last);
+        if (detailMode(last - first)) {
+            paintCues(painter, track, first, last);
+        } else {
+            paintDensity(painter, track);
+        }
+    }
+    
+    if (m_playheadMs >= 0) {
+        int x = qRound(xAt(m_playheadMs));
+        painter.setPen(kPlayheadColor);
+        painter.drawLine(x, 0, x, height());
+    }
+}
+
+void TimelineWidget::paintRuler(QPainter& painter) {
+    painter.fillRect(0, 0, width(), kRulerHeight, kRulerColor);
+    
+    int stepMs = kTickSteps[std::size(kTickSteps) - 1];
+    for (int step : kTickSteps) {
+        if (step / m_msPerPixel >= kMinTickPixels) {
+            stepMs = step;
+            break;
+        }
+    }
+    
+    painter.setPen(palette().color(QPalette::Mid));
+    qint64 tick = qint64(m_viewStartMs / stepMs) * stepMs;
+    double endMs = timeAt(width());
+    for (; tick <= endMs && tick <= kMaxTimeMs; tick += stepMs) {
+        int x = qRound(xAt(tick));
+        painter.drawLine(x, kRulerHeight - 5, x, kRulerHeight);
+        painter.drawText(x + 3, 0, kMinTickPixels, kRulerHeight, Qt::AlignLeft | Qt::AlignVCenter,
+                         tickLabel(int(tick), stepMs));
+    }
+}
+
+void TimelineWidget::paintDensity(QPainter& painter, const QRect& track) {
+    // 选每个桶不宽于一列的最高一级，每列只需累加一两个桶
+    int level = 0;
+    while (level + 1 < m_levels.size() && (qint64(kBaseBucketMs) << (level + 1)) <= m_msPerPixel) {
+        ++level;
+    }
+    const QVector<qint64>& buckets = m_levels[level];
+    const double bucketMs = double(qint64(kBaseBucketMs) << level);
+    
+    for (int x = 0; x < width(); ++x) {
+        qint64 firstBucket = qint64(timeAt(x) / bucketMs);
+        qint64 endBucket = qMax(firstBucket + 1, qint64(timeAt(x + 1) / bucketMs));
+        if (firstBucket >= buckets.size()) break;
+        endBucket = qMin<qint64>(endBucket, buckets.size());
+        
+        qint64 covered = 0;
+        for (qint64 bucket = firstBucket; bucket < endBucket; ++bucket) {
+            covered += buckets[bucket];
+        }
+        if (covered == 0) continue;
+        
+        // 覆盖率超过 1 说明这一段有字幕互相重叠
+        double ratio = covered / ((endBucket - firstBucket) * bucketMs);
+        int barHeight = qMax(1, qRound(qMin(1.0, ratio) * track.height()));
+        painter.fillRect(x, track.bottom() - barHeight + 1, 1, barHeight, ratio > 1.0 ? kOverlapColor : kCueColor);
+    }
+}
+
+void TimelineWidget::paintCues(QPainter& painter, const QRect& track, int first, int last) {
+    const QFontMetrics metrics = fontMetrics();
+    int laneEnd = -1;
+    for (int i = first; i < last; ++i) {
+        int startMs = m_starts[i];
+        int endMs = m_ends[i];
+        if (i == m_dragPosition && m_dragEdge == StartEdge) {
+            startMs = m_dragTimeMs;
+        } else if (i == m_dragPosition && m_dragEdge == EndEdge) {
+            endMs = m_dragTimeMs;
+        }
+        
+        // 与之前的字幕重叠时画在下半部分
+        bool overlap = startMs < laneEnd;
+        laneEnd = qMax(laneEnd, endMs);
+        int x0 = qRound(xAt(startMs));
+        int x1 = qMax(x0 + 1, qRound(xAt(endMs)));
+        QRect box(x0, track.top(), x1 - x0, track.height());
+        if (overlap) {
+            box.setTop(track.center().y());
+        }
+        
+        int row = m_rows.isEmpty() ? i : m_rows[i];
+        bool selected = m_selectionFirst >= 0 && row >= m_selectionFirst && row <= m_selectionLast;
+        painter.fillRect(box, selected ? kSelectedColor : (overlap ? kOverlapColor : kCueColor));
+        painter.setPen(Qt::white);
+        painter.drawLine(box.topLeft(), box.bottomLeft());
+        
+        if (box.width() > 24) {
+            QRect textBox = box.adjusted(3, 0, -3, 0);
+            painter.drawText(textBox, Qt::AlignLeft | Qt::AlignVCenter,
+                             metrics.elidedText((*m_subtitles)[row].text.simplified(), Qt::ElideRight, textBox.width()));
+        }
+    }
+}
+
+void TimelineWidget::mousePressEvent(QMouseEvent* event) {
+    if (m_dirty) {
+        rebuild();
+    }
+    if (event->button() != Qt::LeftButton || m_starts.isEmpty()) return;
+    
+    Edge edge = NoEdge;
+    int position = hitTest(event->pos(), edge);
+    if (m_model && (edge == StartEdge || edge == EndEdge)) {
+        m_dragPosition = position;
+        m_dragEdge = edge;
+        m_dragTimeMs = edge == StartEdge ? m_starts[position] : m_ends[position];
+        return;
+    }
+    if (edge == Body) {
+        emit rowActivated(m_rows.isEmpty() ? position : m_rows[position]);
+    }
+    m_panning = true;
+    m_panOriginX = event->pos().x();
+    m_panOriginMs = m_viewStartMs;
+}
+
+void TimelineWidget::mouseMoveEvent(QMouseEvent* event) {
+    if ((m_dragEdge == StartEdge || m_dragEdge == EndEdge) &&
+        (m_dragPosition < 0 || m_dragPosition >= m_starts.size())) {
+        m_dragPosition = -1;
+        m_dragEdge = NoEdge;
+    }
+    if (m_dragEdge == StartEdge || m_dragEdge == EndEdge) {
+        int timeMs = qRound(timeAt(event->pos().x()));
+        if (m_dragEdge == StartEdge) {
+            m_dragTimeMs = qBound(0, timeMs, qMax(0, m_ends[m_dragPosition] - kMinDurationMs));
+        } else {
+            m_dragTimeMs = qBound(qMin(kMaxTimeMs, m_starts[m_dragPosition] + kMinDurationMs), timeMs, kMaxTimeMs);
+        }
+        update();
+        return;
+    }
+    if (m_panning) {
+        m_viewStartMs = m_panOriginMs - (event->pos().x() - m_panOriginX) * m_msPerPixel;
+        clampView();
+        update();
+        return;
+    }
+    
+    Edge edge = NoEdge;
+    hitTest(event->pos(), edge);
+    setCursor(edge == StartEdge || edge == EndEdge ? Qt::SizeHorCursor : Qt::ArrowCursor);
+}
+
+void TimelineWidget::mouseReleaseEvent(QMouseEvent* event) {
+    Q_UNUSED(event);
+    m_panning = false;
+    if (m_dragEdge != StartEdge && m_dragEdge != EndEdge) return;
+    
+    int position = m_dragPosition;
+    Edge edge = m_dragEdge;
+    m_dragPosition = -1;
+    m_dragEdge = NoEdge;
+    if (position < 0 || position >= m_starts.size()) {
+        update();
+        return;
+    }
+    
+    int oldMs = edge == StartEdge ? m_starts[position] : m_ends[position];
+    if (m_model && m_dragTimeMs != oldMs) {
+        // 与在表格中输入时间相同：模型校验并写回，记入编辑日志，文档标记为已修改
+        int row = m_rows.isEmpty() ? position : m_rows[position];
+        int column = edge == StartEdge ? SubtitleTableModel::StartColumn : SubtitleTableModel::EndColumn;
+        m_model->setData(m_model->index(row, column),
+                         SRTParser::formatTime(QTime::fromMSecsSinceStartOfDay(m_dragTimeMs)), Qt::EditRole);
+    }
+    update();
+}
+
+void TimelineWidget::wheelEvent(QWheelEvent* event) {
+    QPoint delta = event->angleDelta();
+    double x = event->position().x();
+    if (delta.x() != 0 || (event->modifiers() & Qt::ShiftModifier)) {
+        // 横向滚动或 Shift+滚轮平移
+        int steps = delta.x() != 0 ? delta.x() : delta.y();
+        m_viewStartMs -= steps * m_msPerPixel;
+    } else {
+        // 以光标所在时刻为中心缩放
+        double anchorMs = timeAt(x);
+        m_msPerPixel *= std::pow(1.0015, -delta.y());
+        clampView();
+        m_viewStartMs = anchorMs - x * m_msPerPixel;
+    }
+    clampView();
+    update();
+    event->accept();
+}
+
+void TimelineWidget::resizeEvent(QResizeEvent* event) {
+    QWidget::resizeEvent(event);
+    clampView();
+}
@@ -0,0 +1,101 @@
+#ifndef TIMELINEWIDGET_H
+#define TIMELINEWIDGET_H
+
+#include <QPointer>
+#include <QVector>
+#include <QWidget>
+#include "subtitle.h"
+
+class QModelIndex;
+class SubtitleTableModel;
+
+// 可缩放的横向时间轴，显示字幕区间、间隙和重叠
+// 字幕按开始时间排列后保存为起止时间数组，绘制时二分查找视口内的字幕，只画可见部分；
+// 视口内字幕太密时改画覆盖率柱状图，覆盖率来自预先按 2 的幂逐级汇总的分桶，每列只读一两个桶。
+// 两种模式每帧的工作量都只与控件宽度有关，与字幕总数无关。
+// 拖动字幕边缘修改时间，松开时通过模型的 setData 写回，与表格中编辑单元格走同一条路径。
+class TimelineWidget : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit TimelineWidget(QWidget* parent = nullptr);
+    
+    // 显示 model 映射的字幕数组并缩放到整条轨道；传空指针清空
+    void setSubtitles(const QVector<SubtitleItem>* subtitles, SubtitleTableModel* model);
+    
+    // 高亮 [first, last] 行（-1 表示没有选中），选中的字幕不在视口内时滚动过去
+    void setSelectedRows(int first, int last);
+    
+    // 播放位置（毫秒），-1 隐藏
+    void setPlayhead(int timeMs);
+    
+    QSize sizeHint() const override;
+
+signals:
+    // 单击了某条字幕
+    void rowActivated(int row);
+
+protected:
+    void paintEvent(QPaintEvent* event) override;
+    void mousePressEvent(QMouseEvent* event) override;
+    void mouseMoveEvent(QMouseEvent* event) override;
+    void mouseReleaseEvent(QMouseEvent* event) override;
+    void wheelEvent(QWheelEvent* event) override;
+    void resizeEvent(QResizeEvent* event) override;
+
+private:
+    enum Edge { NoEdge, StartEdge, EndEdge, Body };
+    
+    // 影响时间的变化只做标记，下次绘制时重建数组
+    void invalidate();
+    // 只涉及序号或文本列的修改不影响时间，不重建
+    void onDataChanged(const QModelIndex& topLeft, const QModelIndex& bottomRight);
+    void rebuild();
+    
+    void fitAll();
+    void clampView();
+    double timeAt(double x) const;
+    double xAt(double timeMs) const;
+    
+    // 视口内的字幕为 [first, last)（按开始时间排列后的位置）
+    void visibleRange(int& first, int& last) const;
+    bool detailMode(int visibleCount) const;
+    
+    // pos 下的字幕位置和命中的部位，只在逐条绘制时有效
+    int hitTest(const QPoint& pos, Edge& edge) const;
+    
+    void paintRuler(QPainter& painter);
+    void paintDensity(QPainter& painter, const QRect& track);
+    void paintCues(QPainter& painter, const QRect& track, int first, int last);
+    
+    const QVector<SubtitleItem>* m_subtitles;
+    QPointer<SubtitleTableModel> m_model;
+    bool m_dirty;
+    
+    // 按开始时间排列后的行号（已经有序时为空）、起止时间和结束时间的前缀最大值
+    QVector<int> m_rows;
+    QVector<int> m_starts;
+    QVector<int> m_ends;
+    QVector<int> m_maxEnds;
+    
+    // m_levels[k] 的每个桶宽 kBaseBucketMs << k 毫秒，值为桶内被字幕覆盖的毫秒数（重叠累加）
+    QVector<QVector<qint64>> m_levels;
+    
+    double m_viewStartMs;
+    double m_msPerPixel;
+    
+    int m_selectionFirst;
+    int m_selectionLast;
+    int m_playheadMs;
+    
+    // 拖动字幕边缘或平移视图
+    int m_dragPosition;
+    Edge m_dragEdge;
+    int m_dragTimeMs;
+    bool m_panning;
+    int m_panOriginX;
+    double m_panOriginMs;
+};
+
+#endif // TIMELINEWIDGET_H